@@ -8,8 +8,8 @@
 #ifdef __KERNEL__
 #include <linux/list.h>
 #else
-#include <signal.h>
 #include <sys/queue.h>
+#include <timerwheel.h>
 #endif
 
 extern DataModelElement_t *slcDataModel;
@@ -75,18 +75,55 @@ typedef struct QueryTimerJob {
 	 * Access the datamodel node to acquire/release the lock and call the status function.
 	 */
 	DataModelElement_t *dm;
+	#ifdef __KERNEL__
 	/**
-	 * The actual timer :-)
+	 * Queries polling the same source with the same selectors share one hrtimer and the tuples of each call to the source.
+	 * {@link list} links this job into the members of its group.
 	 */
-	#ifdef __KERNEL__
-	struct hrtimer timer;
+	struct SourceTimerGroup *group;
+	struct list_head list;
+	/**
+	 * The next deadline of this query in ns of CLOCK_MONOTONIC. It is a multiple of {@link period} and lies on the grid of the group's timer.
+	 */
+	u64 next;
+	/**
+	 * Set by the timer handler to the number of samples the query gets at the current tick. More than one, if it catches up.
+	 */
+	int due;
+	/**
+	 * Number of deadlines skipped, because the timer handler fell behind by more than TIMER_MAX_CATCHUP periods
+	 */
+	u64 missed;
+	/**
+	 * Number of samples taken one ms or more after their deadline
+	 */
+	u64 late;
 	#else
-	timer_t timerID;
-	struct sigevent timerNotify;
-	struct itimerspec timerValue;
+	/**
+	 * The actual timer :-)
+	 */
+	TimerEntry_t timer;
+	/**
+	 * Number of expiries dropped, because the executors fell behind
+	 */
+	unsigned long long dropped;
 	#endif
 } QueryTimerJob_t;
 
+/**
+ * How well the timer of a source query kept up with its period
+ */
+typedef struct SourceTimerStats {
+	/**
+	 * Number of deadlines no sample was taken for
+	 */
+	unsigned long long missed;
+	/**
+	 * Number of samples taken one ms or more after their deadline. The following deadlines are not shifted by a late one.
+	 */
+	unsigned long long late;
+} SourceTimerStats_t;
+
 typedef struct QuerySelectors {
 	/**
 	 * Auxiliary member to maintain each query in a linked-list
@@ -97,6 +134,10 @@ typedef struct QuerySelectors {
 	LIST_ENTRY(QuerySelectors) listEntry;
 	#endif
 	Query_t *query;
+	/**
+	 * The predicates of the query the provider evaluates before building a tuple. NULL, if there are none.
+	 */
+	Pushdown_t *pushdown;
 } QuerySelectors_t;
 
 int registerProvider(DataModelElement_t *dm, Query_t *queries);
@@ -107,6 +148,16 @@ int initSLC(void);
 void destroySLC(void);
 int initSLCDatamodel(void);
 
+/**
+ * Frees an object a writer unlinked from the datamodel, e.g. a query registry, a plan node or a datamodel node.
+ */
+typedef void (*releaseRetired)(void *ptr);
+void retireObject(void *ptr, releaseRetired release);
+void retireMemory(void *ptr);
+void retireQuery(Query_t *query);
+void retireQuerySelectors(QuerySelectors_t *selectors);
+void synchronizeSLC(void);
+
 void eventOccuredBroadcast(char *datamodelName, Tupel_t *tupel);
 void eventOccuredUnicast(Query_t *query, Tupel_t *tupel);
 void objectChangedBroadcast(char *datamodelName, Tupel_t *tupel, int event);
@@ -150,6 +201,13 @@ void startSourceTimer(DataModelElement_t *dm, Query_t *query);
  * @param query a pointer to the query which should be executed query x ms
  */
 void stopSourceTimer(Query_t *query);
+/**
+ * Reports the number of missed and late deadlines of the timer of {@link query}.
+ * @param query a pointer to a source query
+ * @param stats filled with the counters of the timer
+ * @return 0 on success. -EPARAM, if no timer is running for {@link query}.
+ */
+int getSourceTimerStats(Query_t *query, SourceTimerStats_t *stats);
 /**
  * Deletes {@link query} from all lists it was enqueued to.
  * @param query a pointer to the query which should be deleted
@@ -5,9 +5,16 @@
 #include <linux/slab.h>
 #include <linux/string.h>
 #include <linux/rwlock.h>
+#include <linux/rcupdate.h>
+#include <linux/spinlock.h>
+#include <linux/math64.h>
+#include <linux/irqflags.h>
+#include <asm/barrier.h>
+#include <asm/processor.h>
 #include <linux/module.h>
 #include <linux/list.h>
 #include <linux/hrtimer.h>
+#include <linux/ktime.h>
 #include <asm/page.h>
 #include <linux/delay.h>
 #include <linux/version.h>
@@ -19,6 +26,9 @@
 #include <unistd.h>
 #include <sys/queue.h>
 #include <errno.h>
+#include <sched.h>
+#include <time.h>
+#include <epoch.h>
 #define PAGE_SIZE 4096
 #endif
 
@@ -35,20 +45,23 @@
 #define TEST_BIT(varName,bit)				(((varName) & bit) == bit)
 #define SET_BIT(varName,bit)				((varName) |= bit)
 #define CLEAR_BIT(varName,bit)				((varName) = (varName) & ~(1 << bit))
-#define SLEEP_THRESH_SUCESS					2
-#define SLEEP_THRESH_FAILED					2
-#define SLEEP_STEP							10000
-#define SLEEP_MIN							1000
-#define SLEEP_MAX							1000000
+/**
+ * The longest time a communication thread blocks without checking its rxBuffer, even if no doorbell rang
+ */
+#define COMM_WAIT_TIMEOUT_MS				1000
+/**
+ * The most expiries a periodic timer fires in a row to catch up on the deadlines it passed. Any further one is counted as missed.
+ */
+#define TIMER_MAX_CATCHUP					3
 
 #ifdef __KERNEL__
 #if LINUX_VERSION_CODE < KERNEL_VERSION(4,4,0)
-#define	ALLOC(size)							kmalloc(size,GFP_KERNEL & ~__GFP_WAIT)
-#define REALLOC(ptr,size)					krealloc(ptr,size,GFP_KERNEL & ~__GFP_WAIT)
+#define ALLOC_GFP							(GFP_KERNEL & ~__GFP_WAIT)
 #else
-#define	ALLOC(size)							kmalloc(size,GFP_KERNEL & ~__GFP_RECLAIM)
-#define REALLOC(ptr,size)					krealloc(ptr,size,GFP_KERNEL & ~__GFP_RECLAIM)
+#define ALLOC_GFP							(GFP_KERNEL & ~__GFP_RECLAIM)
 #endif
+#define	ALLOC(size)							kmalloc(size,ALLOC_GFP)
+#define REALLOC(ptr,size)					krealloc(ptr,size,ALLOC_GFP)
 #define	FREE(ptr)							kfree(ptr)
 #define STRTOINT(strVar,intVar)				kstrtos32(strVar,10,&intVar)
 #define STRTOCHAR(strVar,charVar)			kstrtos8(strVar,10,&charVar)
@@ -60,48 +73,66 @@
 #define RELEASE_READ_LOCK(varName)			read_unlock_irqrestore(&varName,flags)
 #define ACQUIRE_WRITE_LOCK(varName)			write_lock_irqsave(&varName,flags)
 #define RELEASE_WRITE_LOCK(varName)			write_unlock_irqrestore(&varName,flags)
+#define DECLARE_OPERATOR_LOCK(varName)		spinlock_t varName
+#define INIT_OPERATOR_LOCK(varName)			spin_lock_init(&varName)
+#define DESTROY_OPERATOR_LOCK(varName)		do { } while (0)
+#define ACQUIRE_OPERATOR_LOCK(varName)		spin_lock_irqsave(&varName,flags)
+#define RELEASE_OPERATOR_LOCK(varName)		spin_unlock_irqrestore(&varName,flags)
+#define DIV_U64(dividend,divisor)			div64_u64(dividend,divisor)
+#define DIV_S64(dividend,divisor)			div64_s64(dividend,divisor)
+#define LOAD_ACQUIRE(ptr)					smp_load_acquire(ptr)
+#define STORE_RELEASE(ptr,value)			smp_store_release(ptr,value)
+#define CPU_RELAX()							cpu_relax()
+#define MEMORY_BARRIER()					smp_mb()
+#define LOCAL_IRQ_SAVE()					local_irq_save(flags)
+#define LOCAL_IRQ_RESTORE()					local_irq_restore(flags)
 #define MSLEEP(x)							mdelay(x)
+/**
+ * Readers of the datamodel, the query registries and the provider lists do not take any lock. Writers serialize on the slcLock,
+ * publish a modified copy and retire the old one. See synchronizeSLC().
+ */
+#define SLC_READ_LOCK()						rcu_read_lock()
+#define SLC_READ_UNLOCK()					rcu_read_unlock()
+#define SLC_SYNCHRONIZE()					synchronize_rcu()
 #define LAYER_CODE							0x1
 #define ENDPOINT_CONNECTED()				(atomic_read(&communicationFileMmapRef) >= 1)
-#define INIT_SLEEP_TIME						1000
 extern atomic_t communicationFileMmapRef;
 
 /**
  * Declares a list named <varNamePrefix>QueriesList which is intended to store a query registered to a source, event or object.
- * Furthermore, it declares a lock named <varNamePrefix>ListLock which is used to protect the list against concurrent access.
+ * Furthermore, it declares a lock named <varNamePrefix>ListLock which serializes the insertion and removal of queries.
+ * Iterating over the list does not take it.
  */
 #define DECLARE_QUERY_LIST(varNamePrefix) static LIST_HEAD(varNamePrefix ## QueriesList); \
 static DEFINE_SPINLOCK(varNamePrefix ## ListLock);
 /**
- * Acquires the read lock on slcLockVar and <varNamePrefix>ListLock.
+ * Enters an RCU read-side critical section.
  * Iterates over every entry in <varNamePrefix>QueriesList. The current element will be stored in tempListVar.
  * It's intended to use in conjunction with events.
  */
 #define forEachQueryEvent(slcLockVar, varNamePrefix, tempListVar, tempVar)	do { \
-	unsigned long flags; \
-	spin_lock(&varNamePrefix ## ListLock); \
-	list_for_each(tempListVar,&varNamePrefix ## QueriesList) { \
+	SLC_READ_LOCK(); \
+	list_for_each_rcu(tempListVar,&varNamePrefix ## QueriesList) { \
 	tempVar = container_of(tempListVar,QuerySelectors_t,list);
 
 /**
- * Acquires the read lock on slcLockVar and <varNamePrefix>ListLock.
+ * Enters an RCU read-side critical section.
  * Iterates over every entry in <varNamePrefix>QueriesList. The current element will be stored in tempListVar.
  * It's intended to use in conjunction with objects. Therefore it has an additional parameter newEvent. Each query
  * in the list which does not registered for newEvent will be skipped.
  */
 #define forEachQueryObject(slcLockVar, varNamePrefix, tempListVar, tempVar, newEvent)	do { \
-	unsigned long flags; \
-	spin_lock_irqsave(&varNamePrefix ## ListLock, flags); \
-	list_for_each(tempListVar,&varNamePrefix ## QueriesList) { \
+	SLC_READ_LOCK(); \
+	list_for_each_rcu(tempListVar,&varNamePrefix ## QueriesList) { \
 	tempVar = container_of(tempListVar,QuerySelectors_t,list); \
 	if ((((ObjectStream_t*)tempVar->query->root)->objectEvents & newEvent) != newEvent) { \
 		continue; \
 	}
 /**
- * Releases the <varNamePrefix>ListLock and the slcLockVar
+ * Leaves the RCU read-side critical section
  */
 #define endForEachQuery(slcLockVar,varNamePrefix)				} \
-	spin_unlock_irqrestore(&varNamePrefix ## ListLock, flags); \
+	SLC_READ_UNLOCK(); \
 	} while (0);
 /**
  * Allocates a QuerySeletor_t, assigns the query (queryVar) to it, acquires <varNamePrefix>ListLock and inserts 
@@ -114,15 +145,17 @@ static DEFINE_SPINLOCK(varNamePrefix ## ListLock);
 	} \
 	listEmptyVar = list_empty(&varNamePrefix ## QueriesList); \
 	tempVar->query = queryVar; \
+	tempVar->pushdown = NULL; \
 	do { \
 	unsigned long flags; \
 	spin_lock_irqsave(&varNamePrefix ## ListLock, flags); \
-	list_add_tail(&tempVar->list,&varNamePrefix ## QueriesList); \
+	list_add_tail_rcu(&tempVar->list,&varNamePrefix ## QueriesList); \
 	spin_unlock_irqrestore(&varNamePrefix ## ListLock, flags); \
 	} while (0);
 /**
  * Searches the <varNamePrefix>QueriesList for an element which query member is equal to queryVar.
  * If it was found, it will be safely removed from list while holding the <varNamePrefix>ListLock.
+ * A reader might still look at it. Hence, it is freed after a grace period.
  * listEmptyVar will be 1, if the list is empty after removal.
  */
 #define findAndDeleteQuery(varNamePrefix,listEmptyVar, tempVar, queryVar, listPos, listNext)	\
@@ -131,8 +164,8 @@ static DEFINE_SPINLOCK(varNamePrefix ## ListLock);
 	list_for_each_safe(listPos,listNext,&varNamePrefix ## QueriesList) { \
 		tempVar = container_of(listPos,QuerySelectors_t,list); \
 		if (tempVar->query == query) { \
-			list_del(&tempVar->list); \
-			FREE(tempVar); \
+			list_del_rcu(&tempVar->list); \
+			retireQuerySelectors(tempVar); \
 			break; \
 		} \
 	} \
@@ -148,36 +181,53 @@ static DEFINE_SPINLOCK(varNamePrefix ## ListLock);
 #define DECLARE_LOCK(varName)				pthread_rwlock_t varName
 #define DECLARE_LOCK_EXTERN(varName)		extern pthread_rwlock_t varName
 #define INIT_LOCK(varName)					pthread_rwlock_init(&varName,NULL)
-#define ACQUIRE_READ_LOCK(varName)			pthread_rwlock_wrlock(&varName)
+#define ACQUIRE_READ_LOCK(varName)			pthread_rwlock_rdlock(&varName)
 #define TRY_READ_LOCK(varName)				pthread_rwlock_tryrdlock(&varName)
 #define RELEASE_READ_LOCK(varName)			pthread_rwlock_unlock(&varName)
-#define ACQUIRE_WRITE_LOCK(varName)			pthread_rwlock_rdlock(&varName)
+#define ACQUIRE_WRITE_LOCK(varName)			pthread_rwlock_wrlock(&varName)
 #define RELEASE_WRITE_LOCK(varName)			pthread_rwlock_unlock(&varName)
+#define DECLARE_OPERATOR_LOCK(varName)		pthread_mutex_t varName
+#define INIT_OPERATOR_LOCK(varName)			pthread_mutex_init(&varName,NULL)
+#define DESTROY_OPERATOR_LOCK(varName)		pthread_mutex_destroy(&varName)
+#define ACQUIRE_OPERATOR_LOCK(varName)		pthread_mutex_lock(&varName)
+#define RELEASE_OPERATOR_LOCK(varName)		pthread_mutex_unlock(&varName)
+#define DIV_U64(dividend,divisor)			((dividend) / (divisor))
+#define DIV_S64(dividend,divisor)			((dividend) / (divisor))
+#define LOAD_ACQUIRE(ptr)					__atomic_load_n(ptr,__ATOMIC_ACQUIRE)
+#define STORE_RELEASE(ptr,value)			__atomic_store_n(ptr,value,__ATOMIC_RELEASE)
+#define CPU_RELAX()							sched_yield()
+#define MEMORY_BARRIER()					__sync_synchronize()
+#define LOCAL_IRQ_SAVE()					do { } while (0)
+#define LOCAL_IRQ_RESTORE()					do { } while (0)
 #define USEC_PER_MSEC						1000L
 #define USEC_PER_SEC						1000000L
+#define NSEC_PER_USEC						1000L
 #define TIMER_SIGNAL						SIGRTMIN
 #define MSLEEP(x)							usleep((x) * 1000)
+#define SLC_READ_LOCK()						epochReadLock()
+#define SLC_READ_UNLOCK()					epochReadUnlock()
+#define SLC_SYNCHRONIZE()					synchronizeEpoch()
 #define LAYER_CODE							0x2
 #define ENDPOINT_CONNECTED()				(1)
-#define INIT_SLEEP_TIME						500
 
+/*
+ * Like the kernel ones, the lists of the providers are iterated without holding <varNamePrefix>ListLock.
+ * An element is fully initialized, before it gets published. A removed one keeps its next pointer and is freed after a grace period.
+ */
 #define DECLARE_QUERY_LIST(varNamePrefix) static LIST_HEAD(varNamePrefix ## QueriesListHEAD,QuerySelectors) varNamePrefix ## QueriesList = LIST_HEAD_INITIALIZER(varNamePrefix ## QueriesList); \
 static pthread_mutex_t varNamePrefix ## ListLock;
 
-#define forEachQueryEvent(slcLockVar, varNamePrefix, tempListVar, tempVar)		ACQUIRE_READ_LOCK(slcLockVar); \
-	pthread_mutex_lock(&varNamePrefix ## ListLock); \
-	LIST_FOREACH(tempListVar,&varNamePrefix ## QueriesList,listEntry) { 
+#define forEachQueryEvent(slcLockVar, varNamePrefix, tempListVar, tempVar)		SLC_READ_LOCK(); \
+	for (tempListVar = LOAD_ACQUIRE(&LIST_FIRST(&varNamePrefix ## QueriesList)); tempListVar != NULL; tempListVar = LOAD_ACQUIRE(&LIST_NEXT(tempListVar,listEntry))) { 
 
-#define forEachQueryObject(slcLockVar, varNamePrefix, tempListVar, tempVar, newEvent)	ACQUIRE_READ_LOCK(slcLockVar); \
-	pthread_mutex_lock(&varNamePrefix ## ListLock); \
-	LIST_FOREACH(tempListVar,&varNamePrefix ## QueriesList,listEntry) { \
+#define forEachQueryObject(slcLockVar, varNamePrefix, tempListVar, tempVar, newEvent)	SLC_READ_LOCK(); \
+	for (tempListVar = LOAD_ACQUIRE(&LIST_FIRST(&varNamePrefix ## QueriesList)); tempListVar != NULL; tempListVar = LOAD_ACQUIRE(&LIST_NEXT(tempListVar,listEntry))) { \
 	if ((((ObjectStream_t*)tempVar->query->root)->objectEvents & newEvent) != newEvent) { \
 		continue; \
 	}
 
 #define endForEachQuery(slcLockVar,varNamePrefix)				} \
-	pthread_mutex_unlock(&varNamePrefix ## ListLock); \
-	RELEASE_READ_LOCK(slcLockVar);
+	SLC_READ_UNLOCK();
 
 #define addAndEnqueueQuery(varNamePrefix,listEmptyVar, tempVar, queryVar) tempVar = (QuerySelectors_t*)ALLOC(sizeof(QuerySelectors_t)); \
 	if (tempVar == NULL) { \
@@ -185,8 +235,14 @@ static pthread_mutex_t varNamePrefix ## ListLock;
 	} \
 	listEmptyVar = LIST_EMPTY(&varNamePrefix ## QueriesList); \
 	tempVar->query = queryVar; \
+	tempVar->pushdown = NULL; \
 	pthread_mutex_lock(&varNamePrefix ## ListLock); \
-	LIST_INSERT_HEAD(&varNamePrefix ## QueriesList,tempVar,listEntry); \
+	LIST_NEXT(tempVar,listEntry) = LIST_FIRST(&varNamePrefix ## QueriesList); \
+	if (LIST_FIRST(&varNamePrefix ## QueriesList) != NULL) { \
+		LIST_FIRST(&varNamePrefix ## QueriesList)->listEntry.le_prev = &LIST_NEXT(tempVar,listEntry); \
+	} \
+	tempVar->listEntry.le_prev = &LIST_FIRST(&varNamePrefix ## QueriesList); \
+	STORE_RELEASE(&LIST_FIRST(&varNamePrefix ## QueriesList),tempVar); \
 	pthread_mutex_unlock(&varNamePrefix ## ListLock);
 
 #define findAndDeleteQuery(varNamePrefix,listEmptyVar, tempVar, queryVar, listNext)	pthread_mutex_lock(&varNamePrefix ## ListLock); \
@@ -194,7 +250,7 @@ static pthread_mutex_t varNamePrefix ## ListLock;
 		listNext = LIST_NEXT(tempVar,listEntry); \
 		if (tempVar->query == query) { \
 			LIST_REMOVE(tempVar,listEntry); \
-			FREE(tempVar); \
+			retireQuerySelectors(tempVar); \
 			break; \
 		} \
 	} \
@@ -286,4 +342,18 @@ static inline unsigned long long getCycles(void) {
 }
 #endif
 
+/**
+ * Returns a monotonic timestamp in nanoseconds
+ */
+static inline unsigned long long getTimeNS(void) {
+#ifdef __KERNEL__
+	return ktime_get_ns();
+#else
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC,&now);
+	return (unsigned long long)now.tv_sec * 1000000000ULL + now.tv_nsec;
+#endif
+}
+
 #endif // __COMMON_H__
@@ -4,6 +4,10 @@
 #define BUFFER_PAGES			64
 #define NUM_PAGES				(2 * BUFFER_PAGES + 1)
 #define RING_BUFFER_SIZE		40
+/**
+ * Both layers share the ringbuffers. Hence, they have to agree on its layout regardless of L1_CACHE_BYTES.
+ */
+#define RING_CACHELINE_SIZE		64
 
 enum LayerMessageType {
 	MSG_EMPTY				=	0x1,
@@ -12,7 +16,8 @@ enum LayerMessageType {
 	MSG_DM_SNAPSHOT,
 	MSG_QUERY_ADD,
 	MSG_QUERY_DEL,
-	MSG_QUERY_CONTINUE
+	MSG_QUERY_CONTINUE,
+	MSG_QUERY_CONTINUE_BATCH
 };
 /**
  * Used to send messages between layers.
@@ -29,6 +34,13 @@ typedef struct LayerMessage {
 	char *addr;
 } LayerMessage_t;
 
+/**
+ * A bounded queue of messages from one layer to the other. It lives in the shared memory.
+ * Its only reader is the communication thread of the receiving layer. Any thread of the sending layer may write to it
+ * without taking a lock: a writer reserves a slot by advancing {@link reserve} and publishes it by advancing {@link write}
+ * in the order slots were reserved.
+ * The indices are placed on distinct cache lines, since they are written by different CPUs.
+ */
 typedef struct Ringbuffer {
 	/**
 	 * Maximum number of messages
@@ -37,17 +49,33 @@ typedef struct Ringbuffer {
 	 */
 	unsigned int size;
 	/**
-	 * Index of the next message which should be read
+	 * Index of the next message which should be read. Written by the reader only.
+	 */
+	unsigned int read __attribute__((aligned(RING_CACHELINE_SIZE)));
+	/**
+	 * Index of the next slot a writer may reserve
+	 */
+	unsigned int reserve __attribute__((aligned(RING_CACHELINE_SIZE)));
+	/**
+	 * Index of the first slot whose payload was not freed yet. Slots between it and read are consumed, but cannot be reserved.
+	 */
+	unsigned int reclaimed;
+	/**
+	 * Set while a writer frees the payloads of consumed messages
 	 */
-	unsigned int read;
+	unsigned int reclaiming;
 	/**
-	 * Index at which to write a new element
+	 * Index at which to write a new element. Each slot before it is visible to the reader.
 	 */
-	unsigned int write;
+	unsigned int write __attribute__((aligned(RING_CACHELINE_SIZE)));
+	/**
+	 * Set by the reader before it blocks. A writer seeing it rings the doorbell of the receiving layer.
+	 */
+	unsigned int readerWaiting __attribute__((aligned(RING_CACHELINE_SIZE)));
 	/**
 	 * Array of messages which are the actual ringbuffer
 	 */
-	LayerMessage_t elements[RING_BUFFER_SIZE];
+	LayerMessage_t elements[RING_BUFFER_SIZE] __attribute__((aligned(RING_CACHELINE_SIZE)));
 } Ringbuffer_t;
 
 extern void *sharedMemoryKernelBase;
@@ -57,11 +85,20 @@ extern Ringbuffer_t *rxBuffer;
 extern unsigned int *globalQueryID;
 extern unsigned int skippedQueryCont;
 extern unsigned int totalQueryCont;
+extern unsigned int sentQueryContFrames;
 
 void ringBufferInit(void);
+void ringBufferReset(Ringbuffer_t *ringBuffer);
 LayerMessage_t* ringBufferReadBegin(Ringbuffer_t *ringBuffer);
 void ringBufferReadEnd(Ringbuffer_t *ringBuffer);
 int ringBufferWrite(Ringbuffer_t *ringBuffer, int type, char *addr);
+int ringBufferPending(Ringbuffer_t *ringBuffer);
+int ringBufferWaitBegin(Ringbuffer_t *ringBuffer);
+void ringBufferWaitEnd(Ringbuffer_t *ringBuffer);
+/**
+ * Wakes up the communication thread of the other layer. Each layer implements it on its own.
+ */
+void ringBufferDoorbell(void);
 
 
 #endif // __COMMUNICATION_H__
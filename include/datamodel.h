@@ -5,12 +5,15 @@
 #include <common.h>
 #include <liballoc.h>
 
-#define MAX_QUERIES_PER_DM	8
+/**
+ * Number of slots a query registry starts with. It doubles each time it runs full.
+ */
+#define QUERY_REGISTRY_MIN_SIZE	4
 
-#define ALLOC_CHILDREN_ARRAY(size)			(DataModelElement_t**)ALLOC(sizeof(DataModelElement_t*) * size)
+#define ALLOC_CHILDREN_ARRAY(size)			(DataModelElement_t**)ALLOC(sizeof(DataModelElement_t*) * (size))
 #define ALLOC_TYPEINFO(type)				(type*)ALLOC(sizeof(type))
-#define REALLOC_CHILDREN_ARRAY(ptr,size)	(DataModelElement_t**)REALLOC(ptr,sizeof(DataModelElement_t*) * size)
-#define ALLOC_STATIC_CHILDREN_ARRAY(size)	(DataModelElement_t**)ALLOC(sizeof(DataModelElement_t*) * size)
+#define REALLOC_CHILDREN_ARRAY(ptr,size)	(DataModelElement_t**)REALLOC(ptr,sizeof(DataModelElement_t*) * (size))
+#define ALLOC_STATIC_CHILDREN_ARRAY(size)	(DataModelElement_t**)ALLOC(sizeof(DataModelElement_t*) * (size))
 
 #define DECLARE_ELEMENT(elem)				static DataModelElement_t elem;
 #define DECLARE_ELEMENTS(vars...)			static DataModelElement_t vars;
@@ -70,19 +73,32 @@ typedef struct TypeItem {
 
 typedef struct Selector Selector_t;
 typedef struct Query Query_t;
+struct PlanNode;
 
 typedef void (*activateEventCallback)(Query_t *query);
 typedef void (*deactivateEventCallback)(Query_t *query);
 
 typedef struct Tupel Tupel_t;
 
+/**
+ * The queries registered to an event, object or source. Only the first {@link num} slots are in use. Each query knows its slot (Query_t->idx).
+ * A query is appended and removed by moving the last one into its slot. Hence, both take constant time and iterating just visits live queries.
+ * Readers do not take the slcLock. A query is appended in place. A removal or a registry running full publishes a modified copy.
+ * The old one is retired. See synchronizeSLC().
+ */
+typedef struct QueryRegistry {
+	unsigned int num;
+	unsigned int size;
+	struct Query *queries[];
+} QueryRegistry_t;
+
 typedef struct Event {
 	unsigned short returnType;
 	DECLARE_BUFFER(returnName);
 	activateEventCallback activate;
 	deactivateEventCallback deactivate;
-	struct Query *queries[MAX_QUERIES_PER_DM];
-	int numQueries;
+	QueryRegistry_t *queries;					// NULL, as long as no query was registered
+	struct PlanNode *plans;						// The operators the queries have in common. See addQueryToPlan().
 } Event_t;
 
 typedef Tupel_t* (*getSource)(Selector_t *selectors, int len, Tupel_t* leftTuple);
@@ -91,8 +107,7 @@ typedef struct Source {
 	unsigned short returnType;
 	DECLARE_BUFFER(returnName);
 	getSource callback;
-	struct Query *queries[MAX_QUERIES_PER_DM];
-	int numQueries;
+	QueryRegistry_t *queries;					// NULL, as long as no query was registered
 	DECLARE_LOCK(lock);
 } Source_t;
 
@@ -107,11 +122,17 @@ typedef struct Object {
 	activateObject activate;
 	deactivateObject deactivate;
 	generateStatus status;
-	struct Query *queries[MAX_QUERIES_PER_DM];
-	int numQueries;
+	QueryRegistry_t *queries;					// NULL, as long as no query was registered
+	struct PlanNode *plans;						// The operators the queries have in common. See addQueryToPlan().
+	unsigned int generation;					// Incremented each time an instance is created or deleted. See objectInstancesChanged().
 } Object_t;
 
 void printDatamodel(DataModelElement_t *root);
+QueryRegistry_t** getQueryRegistry(DataModelElement_t *node);
+struct PlanNode** getQueryPlans(DataModelElement_t *node);
+int addQueryToRegistry(QueryRegistry_t **registry, Query_t *query);
+void delQueryFromRegistry(QueryRegistry_t **registry, Query_t *query);
+void freeQueryRegistry(QueryRegistry_t **registry);
 int checkDataModelSyntax(DataModelElement_t *rootCurrent,DataModelElement_t *rootToCheck, DataModelElement_t **errElem);
 DataModelElement_t* getDescription(DataModelElement_t *root, char *name);
 int mergeDataModel(int justCheckSyntax, DataModelElement_t *oldTree, DataModelElement_t *newTree) ;
@@ -165,15 +186,22 @@ static inline int resolveType(DataModelElement_t *rootDM, DataModelElement_t *el
 	return type;
 }
 
+/**
+ * Tells the slc that an instance of the object {@link elem} was created or deleted.
+ * Snapshots of it, e.g. the cached tuples of a hash join, are fetched again on their next use.
+ * @param elem a pointer to the object node
+ */
+static inline void objectInstancesChanged(DataModelElement_t *elem) {
+	__sync_fetch_and_add(&((Object_t*)elem->typeInfo)->generation,1);
+}
+
 #define SET_CHILDREN_ARRAY(varName,numChildren) if (numChildren > 0) { \
 		varName.children = ALLOC_STATIC_CHILDREN_ARRAY(numChildren); \
 	} else { \
 		varName.children = NULL; \
 	}
 
-#define INIT_QUERY_ARRAY(queryVar,size) 	for (i = 0; i < size; i++) { \
-	queryVar[i] = NULL; \
-}
+#define INIT_QUERY_REGISTRY(queryVar) 	queryVar = NULL;
 
 #define INIT_MODEL(varName,numChildren)	memset(&varName.name,'\0',MAX_NAME_LEN); \
 	varName.childrenLen = numChildren; \
@@ -199,8 +227,7 @@ static inline int resolveType(DataModelElement_t *rootDM, DataModelElement_t *el
 	varName.dataModelType = SOURCE; \
 	varName.typeInfo = ALLOC(sizeof(Source_t)); \
 	((Source_t*)varName.typeInfo)->callback = cbFunc; \
-	((Source_t*)varName.typeInfo)->numQueries = 0; \
-	INIT_QUERY_ARRAY(((Source_t*)varName.typeInfo)->queries,MAX_QUERIES_PER_DM);
+	INIT_QUERY_REGISTRY(((Source_t*)varName.typeInfo)->queries);
 
 #define INIT_SOURCE_POD(varName,nodeName,parentNode,srcType,cbFunc)	INIT_SOURCE_BASIC(varName,nodeName,parentNode,cbFunc) \
 	memset(&((Source_t*)varName.typeInfo)->returnName,0,MAX_NAME_LEN); \
@@ -221,8 +248,9 @@ static inline int resolveType(DataModelElement_t *rootDM, DataModelElement_t *el
 	((Object_t*)varName.typeInfo)->activate = activateFunc; \
 	((Object_t*)varName.typeInfo)->deactivate = deactivateFunc; \
 	((Object_t*)varName.typeInfo)->status = statusFunc; \
-	((Object_t*)varName.typeInfo)->numQueries = 0; \
-	INIT_QUERY_ARRAY(((Object_t*)varName.typeInfo)->queries,MAX_QUERIES_PER_DM);
+	INIT_QUERY_REGISTRY(((Object_t*)varName.typeInfo)->queries); \
+	((Object_t*)varName.typeInfo)->plans = NULL; \
+	((Object_t*)varName.typeInfo)->generation = 0;
 
 #define INIT_EVENT_POD(varName,nodeName,parentNode,evtType,regFunc, unregFunc)	strncpy((char*)&varName.name,nodeName,MAX_NAME_LEN); \
 	varName.childrenLen = 0; \
@@ -235,8 +263,8 @@ static inline int resolveType(DataModelElement_t *rootDM, DataModelElement_t *el
 	memset(&((Event_t*)varName.typeInfo)->returnName,0,MAX_NAME_LEN); \
 	((Event_t*)varName.typeInfo)->activate = regFunc; \
 	((Event_t*)varName.typeInfo)->deactivate = unregFunc; \
-	((Event_t*)varName.typeInfo)->numQueries = 0; \
-	INIT_QUERY_ARRAY(((Event_t*)varName.typeInfo)->queries,MAX_QUERIES_PER_DM)
+	INIT_QUERY_REGISTRY(((Event_t*)varName.typeInfo)->queries) \
+	((Event_t*)varName.typeInfo)->plans = NULL;
 
 #define INIT_EVENT_COMPLEX(varName,nodeName,parentNode,returnTypeName,regFunc, unregFunc)	strncpy((char*)&varName.name,nodeName,MAX_NAME_LEN); \
 	varName.childrenLen = 0; \
@@ -249,8 +277,8 @@ static inline int resolveType(DataModelElement_t *rootDM, DataModelElement_t *el
 	strncpy((char*)&((Event_t*)varName.typeInfo)->returnName,returnTypeName,MAX_NAME_LEN); \
 	((Event_t*)varName.typeInfo)->activate = regFunc; \
 	((Event_t*)varName.typeInfo)->deactivate = unregFunc; \
-	((Event_t*)varName.typeInfo)->numQueries = 0; \
-	INIT_QUERY_ARRAY(((Event_t*)varName.typeInfo)->queries,MAX_QUERIES_PER_DM)
+	INIT_QUERY_REGISTRY(((Event_t*)varName.typeInfo)->queries) \
+	((Event_t*)varName.typeInfo)->plans = NULL;
 
 #define INIT_COMPLEX_TYPE(varName,nodeName,parentNode,numChildren)	strncpy((char*)&varName.name,nodeName,MAX_NAME_LEN);\
 	varName.childrenLen = numChildren; \
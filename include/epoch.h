@@ -0,0 +1,55 @@
+#ifndef __EPOCH_H__
+#define __EPOCH_H__
+
+/**
+ * The userspace counterpart of the RCU read side the kernel layer uses for the datamodel and the query registries.
+ * A thread entering a read section announces the current global epoch in its own EpochReader_t. Nothing else is written.
+ * synchronizeEpoch() advances the global epoch and waits for each thread, which announced an older one, to leave its read section.
+ * Afterwards, memory unlinked before the call cannot be referenced by any reader anymore.
+ * Read sections nest. A thread must neither block for long nor call synchronizeEpoch() while being inside one.
+ */
+typedef struct EpochReader {
+	/**
+	 * The global epoch the thread entered its outermost read section in. 0, if it is outside of any.
+	 */
+	unsigned long epoch;
+	unsigned int depth;
+	struct EpochReader *next;
+} __attribute__((aligned(64))) EpochReader_t;
+
+extern __thread EpochReader_t epochReader;
+extern __thread int epochRegistered;
+extern unsigned long globalEpoch;
+/**
+ * Set, if synchronizeEpoch() forces a memory barrier on each running thread by membarrier(2).
+ * A reader just needs a compiler barrier in this case. Otherwise, it has to issue a full memory barrier.
+ */
+extern int epochMembarrier;
+
+void registerEpochReader(void);
+void synchronizeEpoch(void);
+
+static inline void epochReadLock(void) {
+	if (!epochRegistered) {
+		registerEpochReader();
+	}
+	if (epochReader.depth++ > 0) {
+		return;
+	}
+	__atomic_store_n(&epochReader.epoch,__atomic_load_n(&globalEpoch,__ATOMIC_RELAXED),__ATOMIC_RELAXED);
+	// Any pointer of the datamodel must not be loaded before the epoch is visible to synchronizeEpoch()
+	if (__atomic_load_n(&epochMembarrier,__ATOMIC_RELAXED)) {
+		__atomic_signal_fence(__ATOMIC_SEQ_CST);
+	} else {
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	}
+}
+
+static inline void epochReadUnlock(void) {
+	if (--epochReader.depth > 0) {
+		return;
+	}
+	__atomic_store_n(&epochReader.epoch,0,__ATOMIC_RELEASE);
+}
+
+#endif // __EPOCH_H__
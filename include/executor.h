@@ -0,0 +1,85 @@
+#ifndef __EXECUTOR_H__
+#define __EXECUTOR_H__
+
+#include <query.h>
+#include <datamodel.h>
+#include <communication.h>
+
+/**
+ * Names the environment variable holding the number of executor threads the userspace layer starts
+ */
+#define EXEC_THREADS_ENV				"SLC_EXEC_THREADS"
+#define MAX_EXEC_THREADS				32
+/**
+ * Number of slots of each job queue. Has to be a power of two.
+ */
+#define EXEC_QUEUE_SIZE					4096
+/**
+ * An executor runs up to this number of jobs before it releases the slcLock again
+ */
+#define EXEC_BATCH_SIZE					32
+
+/**
+ * A slot of an ExecQueue_t. {@link seq} tells producers and consumers whether the slot
+ * is free or holds a job for the current lap of the queue.
+ * A job without a tuple polls the source of its query. See runSourceTimer().
+ */
+typedef struct ExecSlot {
+	unsigned long seq;
+	Query_t *query;
+	Tupel_t *tuple;
+	int step;
+} ExecSlot_t;
+
+/**
+ * A bounded, lock-free multi-producer/multi-consumer queue of query jobs.
+ * Both positions live on their own cache line. Otherwise, producers and consumers would contend for it.
+ */
+typedef struct ExecQueue {
+	unsigned long enqueuePos __attribute__((aligned(RING_CACHELINE_SIZE)));
+	unsigned long dequeuePos __attribute__((aligned(RING_CACHELINE_SIZE)));
+	ExecSlot_t slots[EXEC_QUEUE_SIZE] __attribute__((aligned(RING_CACHELINE_SIZE)));
+} ExecQueue_t;
+
+typedef struct ExecStats {
+	/**
+	 * Number of executor threads
+	 */
+	unsigned int threads;
+	/**
+	 * Maximum number of jobs waiting in a queue
+	 */
+	unsigned int maxWaiting;
+	unsigned long long executed;
+	/**
+	 * Number of jobs of urgent queries. The urgent lane executed them.
+	 */
+	unsigned long long urgent;
+	/**
+	 * Number of times an executor went to sleep and a producer woke one up, respectively
+	 */
+	unsigned long long sleeps;
+	unsigned long long wakeups;
+	/**
+	 * Number of times a producer found a queue full
+	 */
+	unsigned long long queueFull;
+	/**
+	 * Number of jobs of ORDERED or urgent queries an executor dropped, because their queue was full
+	 */
+	unsigned long long dropped;
+} ExecStats_t;
+
+int startExecutors(unsigned int numThreads);
+void stopExecutors(void);
+void submitQueryJob(Query_t *query, Tupel_t *tuple, int step);
+int trySubmitQueryJob(Query_t *query, Tupel_t *tuple, int step);
+void cancelQueryJobs(Query_t *query);
+void getExecStats(ExecStats_t *stats);
+/**
+ * Has to be implemented by the layer. Calls the source of {@link query} and enqueues the returned tuples.
+ * An executor runs it for each expiry of the timer of a source query. The caller holds the slcLock.
+ */
+void runSourceTimer(Query_t *query);
+
+#endif // __EXECUTOR_H__
@@ -61,12 +61,36 @@ extern void* liballoc_alloc(size_t);
  * \return 0 if the memory was successfully freed.
  */
 extern int liballoc_free(void*,size_t);
+
+/** A snapshot of the allocator state. See PREFIX(allocstats).
+ */
+typedef struct SlcAllocStats {
+	unsigned int totalPages;			///< The number of pages the system provides.
+	unsigned int usedPages;				///< The number of pages currently handed out by liballoc_alloc.
+	unsigned int peakPages;				///< The highest value usedPages ever had.
+	unsigned int largestFreeRun;		///< The longest run of contiguous free pages.
+	unsigned long long inUse;			///< The number of bytes currently malloc'ed.
+	unsigned long long peakInUse;		///< The highest value inUse ever had.
+	unsigned long long failed;			///< The number of allocations which returned NULL.
+} SlcAllocStats_t;
+
+/** Percentage of the free pages which are not part of the largest free run.
+ * A request for more pages than largestFreeRun fails, although that many pages might be free.
+ */
+#define ALLOC_FRAGMENTATION(stats)	((stats).usedPages == (stats).totalPages ? 0 : \
+	100 - (100 * (stats).largestFreeRun) / ((stats).totalPages - (stats).usedPages))
+
+/** This is the hook into the local system which reports the page related
+ * members of SlcAllocStats_t. It is called while holding the liballoc lock.
+ */
+extern void liballoc_page_stats(SlcAllocStats_t*);
        
 
 extern void    *PREFIX(malloc)(size_t);				///< The standard function.
 extern void    *PREFIX(realloc)(void *, size_t);		///< The standard function.
 extern void    *PREFIX(calloc)(size_t, size_t);		///< The standard function.
 extern void     PREFIX(free)(void *);					///< The standard function.
+extern void     PREFIX(allocstats)(SlcAllocStats_t *);	///< Takes a snapshot of the allocator state.
 
 
 #ifdef __cplusplus
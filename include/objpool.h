@@ -0,0 +1,59 @@
+#ifndef __OBJPOOL_H__
+#define __OBJPOOL_H__
+
+#include <common.h>
+
+/**
+ * Tuple headers and items are allocated from a small number of size classes.
+ * The smallest class is OBJ_POOL_MIN_SIZE bytes, each further class is twice as large.
+ * Anything larger than the largest class is passed through to ALLOC().
+ */
+#define OBJ_POOL_CLASSES				5
+#define OBJ_POOL_MIN_SHIFT				6
+#define OBJ_POOL_MIN_SIZE				(1 << OBJ_POOL_MIN_SHIFT)
+#define OBJ_POOL_MAX_SIZE				(OBJ_POOL_MIN_SIZE << (OBJ_POOL_CLASSES - 1))
+/**
+ * Marks an object allocated by ALLOC(), because it did not fit any class
+ */
+#define OBJ_POOL_LARGE					OBJ_POOL_CLASSES
+/**
+ * Userspace: number of objects carved from one slab, which is the only allocation
+ * a pool ever requests from malloc(). A thread keeps at most OBJ_POOL_CACHE_MAX free
+ * objects per class. If it has more, it hands OBJ_POOL_BATCH of them over to the shared depot.
+ */
+#define OBJ_POOL_SLAB_OBJECTS			128
+#define OBJ_POOL_CACHE_MAX				256
+#define OBJ_POOL_BATCH					64
+
+/**
+ * Precedes each object. While the object is on a freelist, {@link next} links it.
+ * Otherwise, {@link cls} tells which pool it has to be returned to.
+ * {@link size} is only valid for OBJ_POOL_LARGE objects.
+ */
+typedef union ObjHeader {
+	union ObjHeader *next;
+	struct {
+		unsigned int cls;
+		unsigned int size;
+	};
+} ObjHeader_t;
+
+typedef struct ObjPoolStats {
+	/**
+	 * Number of slabs per class requested from malloc(). Always 0 in the kernel, since the slab allocator grows the kmem_caches.
+	 */
+	unsigned long long grown[OBJ_POOL_CLASSES];
+	/**
+	 * Number of objects being too large for any class
+	 */
+	unsigned long long large;
+} ObjPoolStats_t;
+
+int initObjPools(void);
+void destroyObjPools(void);
+void* allocObject(unsigned int size);
+void freeObject(void *ptr);
+void* reallocObject(void *ptr, unsigned int size);
+void getObjPoolStats(ObjPoolStats_t *stats);
+
+#endif // __OBJPOOL_H__
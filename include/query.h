@@ -6,6 +6,27 @@
 #include <datamodel.h>
 #include <resultset.h>
 
+/**
+ * The maximum number of tuples a SORT operator keeps per window
+ */
+#define MAX_SORT_TUPLES		1024
+/**
+ * The size of a frame carrying the continuations of several queries to the remote layer
+ */
+#define QUERY_CONT_FRAME_SIZE		PAGE_SIZE
+/**
+ * The longest time a continuation waits in a frame, before the frame is sent along with the next continuation
+ */
+#define QUERY_CONT_DEADLINE_NS		1000000ULL
+/**
+ * The interval, in which flushExpiredWindows() closes the expired time-based windows of quiet streams
+ */
+#define WINDOW_FLUSH_NS				10000000ULL
+/**
+ * Each continuation within a frame starts at a multiple of it
+ */
+#define QUERY_CONT_ALIGN(size)		(((size) + 7) & ~7)
+
 #define GET_BASE(varName)	(Operator_t*)&varName
 #define ADD_PREDICATE(varOperator,slot,predicateVar)	varOperator.predicates[slot] = &predicateVar;
 #define ADD_ELEMENT(varOperator,slot,elementVar,elementName)	varOperator.elements[slot] = &elementVar; \
@@ -57,12 +78,49 @@
 	varName.op_type = JOIN; \
 	varName.op_child = childVar; \
 	varName.predicateLen = numPredicates; \
-	varName.predicates = (Predicate_t**)ALLOC(sizeof(Predicate_t*) * numPredicates);
+	varName.predicates = (Predicate_t**)ALLOC(sizeof(Predicate_t*) * numPredicates); \
+	varName.cacheTTL = 0; \
+	varName.state = NULL;
+/**
+ * Turns {@link varName} into a hash join. The tuples of the joined node are cached for {@link ttlMS} ms.
+ */
+#define SET_JOIN_CACHE(varName,ttlMS)	varName.cacheTTL = ttlMS;
 
 #define INIT_FILTER(varName,childVar,numPredicates)	varName.op_type = FILTER; \
 	varName.op_child = childVar; \
 	varName.predicateLen = numPredicates; \
-	varName.predicates = (Predicate_t**)ALLOC(sizeof(Predicate_t*) * numPredicates);
+	varName.predicates = (Predicate_t**)ALLOC(sizeof(Predicate_t*) * numPredicates); \
+	varName.compiled = NULL;
+
+#define INIT_AGGREGATE(varName,aggregateType,childVar,numElements,aggSizeUnit,aggSize,aggAdvanceUnit,aggAdvance)	varName.op_type = aggregateType; \
+	varName.op_child = childVar; \
+	varName.elementsLen = numElements; \
+	varName.elements = (Element_t**)ALLOC(sizeof(Element_t*) * numElements); \
+	varName.sizeUnit = aggSizeUnit; \
+	varName.size = aggSize; \
+	varName.advanceUnit = aggAdvanceUnit; \
+	varName.advance = aggAdvance; \
+	varName.state = NULL;
+
+#define INIT_GROUP(varName,childVar,numElements,groupSizeUnit,groupSize)	varName.op_type = GROUP; \
+	varName.op_child = childVar; \
+	varName.elementsLen = numElements; \
+	varName.elements = (Element_t**)ALLOC(sizeof(Element_t*) * numElements); \
+	varName.sizeUnit = groupSizeUnit; \
+	varName.size = groupSize; \
+	varName.order = SORT_ASCENDING; \
+	varName.limit = 0; \
+	varName.state = NULL;
+
+#define INIT_SORT(varName,childVar,numElements,sortSizeUnit,sortSize,sortOrder,sortLimit)	varName.op_type = SORT; \
+	varName.op_child = childVar; \
+	varName.elementsLen = numElements; \
+	varName.elements = (Element_t**)ALLOC(sizeof(Element_t*) * numElements); \
+	varName.sizeUnit = sortSizeUnit; \
+	varName.size = sortSize; \
+	varName.order = sortOrder; \
+	varName.limit = sortLimit; \
+	varName.state = NULL;
 
 #define INIT_SELECT(varName,childVar,numElements) varName.op_type = SELECT; \
 	varName.op_child = childVar; \
@@ -77,7 +135,8 @@
 
 enum QueryFlags {
 	COMPACT		=	0x1,
-	TRANSFERED	=	0x2
+	TRANSFERED	=	0x2,
+	ORDERED		=	0x4		// The query keeps state across tuples, e.g. a window. Its tuples have to be executed in the order they were enqueued.
 };
 
 enum OperatorType {
@@ -124,6 +183,12 @@ enum SizeUnit {
 	SIZEUNIT_END
 };
 
+enum SortOrder {
+	SORT_ASCENDING	=	0x0,
+	SORT_DESCENDING	=	0x1,
+	SORTORDER_END
+};
+
 enum PredicateFlags {
 	PRED_SELEC		=	1 << 1,
 };
@@ -177,8 +242,27 @@ typedef struct __attribute__((packed)) QueryContinue {
 	 * The number of operators the remote layer has to skip before continuing execution.
 	 */
 	unsigned short steps;
+	/**
+	 * The number of bytes occupied by this continuation and its tuples
+	 */
+	unsigned int size;
 } QueryContinue_t;
 
+/**
+ * Carries several continuations in one message (MSG_QUERY_CONTINUE_BATCH).
+ * The continuations follow the frame header back to back. Each one is followed by its tuples.
+ */
+typedef struct __attribute__((packed)) QueryContinueFrame {
+	/**
+	 * The number of continuations in this frame
+	 */
+	unsigned short entries;
+	/**
+	 * The number of bytes used so far including the header
+	 */
+	unsigned int size;
+} QueryContinueFrame_t;
+
 /**
  * Baseclass for a query. Each element of a query uses this struct.
  */
@@ -257,6 +341,7 @@ typedef struct __attribute__((packed)) Filter {
 	#define op_child	base.child
 	unsigned short predicateLen;
 	Predicate_t **predicates;
+	void *compiled;							// Layer-specific. Set up by addQueries(). See compileFilter().
 } Filter_t;
 
 typedef struct Select {
@@ -267,6 +352,11 @@ typedef struct Select {
 	Element_t **elements;
 } Select_t;
 
+/**
+ * Sorts the tuples of a tumbling window by its elements. The first element is the most significant one.
+ * Only the first {@link limit} tuples are kept, e.g. the top 10 processes by stime. At the end of a window,
+ * they are emitted in order.
+ */
 typedef struct __attribute__((packed)) Sort {
 	Operator_t base;
 	#define op_type	base.type
@@ -275,15 +365,17 @@ typedef struct __attribute__((packed)) Sort {
 	Element_t **elements;
 	unsigned short sizeUnit;
 	unsigned int size;
+	unsigned short order;					// One of SortOrder. Unused by GROUP.
+	unsigned int limit;						// The maximum number of tuples emitted per window. 0 means MAX_SORT_TUPLES. Unused by GROUP.
+	void *state;							// Layer-specific. Set up by addQueries().
 } Sort_t;
-/**
- * NOT IMPLEMENTED
- */
 
-typedef Sort_t Group_t;
 /**
- * NOT IMPLEMENTED
+ * Groups the tuples of a tumbling window by the values of its elements. If the next operator is a MIN, MAX or AVG
+ * using the same window, it is evaluated per group. At the end of a window, one tuple per group is emitted.
+ * It holds the elements followed by the aggregated ones.
  */
+typedef Sort_t Group_t;
 
 typedef struct __attribute__((packed)) Join {
 	Operator_t base;
@@ -292,6 +384,8 @@ typedef struct __attribute__((packed)) Join {
 	Element_t element;
 	unsigned short predicateLen;
 	Predicate_t **predicates;
+	unsigned int cacheTTL;					// If not 0, the tuples of the joined node are fetched once and reused for this number of ms. See initJoinState().
+	void *state;							// Layer-specific. Set up by addQueries(). See initJoinState().
 } Join_t;
 /**
  * Datamodell: Object: +Fkt für 
@@ -308,22 +402,109 @@ typedef struct __attribute__((packed)) Aggregate {
 	unsigned int size;
 	unsigned short advanceUnit;
 	unsigned int advance;
+	void *state;							// Layer-specific. Set up by addQueries(). See initAggregateState().
 } Aggregate_t;
-/**
- * NOT IMPLEMENTET
- */
 
 typedef struct __attribute__((packed)) Query {
 	struct Query *next;								// Since a provider can issue more than one query at a time the next pointer holds the address of the next query. The user has to set it to NULL, if the current instance is the last one.
 	Operator_t *root;								// Points to the first element of the actual query, which in fact is of type GEN_{OBJECT,SOURCE,EVENT}.
 	unsigned short flags;
-	unsigned short idx;
+	unsigned short idx;								// The slot of the query in the registry of its node. See addQueryToRegistry().
 	unsigned int size;
 	unsigned int layerCode;
 	unsigned int queryID;								// An unique identifier for this query. The first byte is used to address the queries array of a node in the datamodel. The upper bytes contain a global id, which is incremented each time a new query is registered.
 	queryCompletedFunction onQueryCompleted;		// A function being called, if a query completes *and* the tupel is not rejected. The called code has to free the tupel!
+	struct Query *hashNext;							// Links the queries sharing a bucket of the query id hash. See resolveQuery().
+	struct PlanNode *plan;							// The node of the shared plan the leading filters of this query end at. See addQueryToPlan().
+	struct Query *planNext;							// Links the queries ending at the same plan node
 } Query_t;
 
+/**
+ * A query is urgent, if its stream was declared so. Its tuples bypass the bulk traffic in both layers.
+ */
+static inline int isQueryUrgent(Query_t *query) {
+	return ((GenStream_t*)query->root)->urgent != 0;
+}
+
+/**
+ * The queries registered to an event or object are merged into a tree of their leading operators.
+ * A root node stands for a stream, i.e. all queries having the same selectors (and object events).
+ * Each further node stands for a filter several queries start with. If two queries differ in their n-th filter,
+ * the tree forks at depth n. A query is attached to the node its last leading filter ends at.
+ * eventOccuredBroadcast() and objectChangedBroadcast() apply a filter shared by at least two queries once per tuple.
+ * Each query is enqueued with the number of operators it can skip.
+ * A node does not own its operator. It belongs to one of the queries below the node.
+ */
+typedef struct PlanNode {
+	struct PlanNode *parent;
+	struct PlanNode *children;
+	struct PlanNode *sibling;
+	Operator_t *op;
+	unsigned short depth;							// The number of operators evaluated once this node is passed
+	unsigned int count;								// The number of queries attached to this node and all nodes below
+	Query_t *members;								// The queries attached to this node. Linked by Query_t->planNext.
+} PlanNode_t;
+
+/**
+ * A value a provider knows about an event before it builds a tuple, e.g. the length of a packet.
+ * It is stored the same way as inside a tuple.
+ */
+typedef union PushdownValue {
+	int intValue;
+	char byteValue;
+	PTR_TYPE stringValue;
+} PushdownValue_t;
+
+/**
+ * Names a member of the tuples a provider builds. A provider keeps an array of them. The value of the i-th field
+ * has to be passed in the i-th slot to matchPushdown().
+ */
+typedef struct PushdownField {
+	char *path;										// The complete path of the member, e.g. "net.packetType.dataLength"
+	int type;										// INT, BYTE or STRING
+} PushdownField_t;
+
+typedef struct PushdownPredicate {
+	int (*compare)(void *left, void *right);
+	unsigned short field;							// The slot of the value the constant is compared to
+	unsigned short constLeft;						// 1, if the constant is the left-hand side of the predicate
+	PushdownValue_t constant;
+} PushdownPredicate_t;
+
+/**
+ * The predicates of a query a provider evaluates on its own, before it builds a tuple. See compilePushdown().
+ */
+typedef struct Pushdown {
+	unsigned int num;
+	PushdownPredicate_t predicates[];
+} Pushdown_t;
+
+/**
+ * Checks, if a tuple carrying {@link values} could pass the leading filters of a query.
+ * @param pushdown the predicates returned by compilePushdown(). Might be NULL.
+ * @param values the values of the fields passed to compilePushdown()
+ * @return 0, if the query will definitely drop the tuple. 1 otherwise.
+ */
+static inline int matchPushdown(Pushdown_t *pushdown, PushdownValue_t *values) {
+	PushdownPredicate_t *cur = NULL;
+	unsigned int i = 0;
+
+	if (pushdown == NULL) {
+		return 1;
+	}
+	for (i = 0; i < pushdown->num; i++) {
+		cur = &pushdown->predicates[i];
+		if (cur->constLeft) {
+			if (cur->compare(&cur->constant,&values[cur->field]) == 0) {
+				return 0;
+			}
+		} else if (cur->compare(&values[cur->field],&cur->constant) == 0) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
 static inline void initQuery(Query_t *query) {
 	query->next = NULL;
 	query->root = NULL;
@@ -333,6 +514,8 @@ static inline void initQuery(Query_t *query) {
 	query->queryID = 0;
 	query->onQueryCompleted = NULL;
 	query->size = 0;
+	query->plan = NULL;
+	query->planNext = NULL;
 }
 
 int checkQuerySyntax(DataModelElement_t *rootDM, Operator_t *rootQuery, Operator_t **errOperator, int sync);
@@ -355,6 +538,28 @@ int calcQuerySize(Query_t *query);
 void copyAndCollectQuery(Query_t *origin, void *freeMem);
 void rewriteQueryAddress(Query_t *query, void *oldBaseAddr, void *newBaseAddr);
 void freeOperator(Operator_t *op, int freeOperator);
+int compileOperators(DataModelElement_t *rootDM, Operator_t *op);
+void releaseCompiledOperators(Operator_t *op);
+int isSameSelectors(GenStream_t *left, GenStream_t *right);
 Query_t* resolveQuery(DataModelElement_t *rootDM, QueryID_t *id);
+void hashQuery(Query_t *query);
+void unhashQuery(Query_t *query);
+int addQueryToPlan(PlanNode_t **plans, Query_t *query);
+void delQueryFromPlan(PlanNode_t **plans, Query_t *query);
+void freeQueryPlans(PlanNode_t **plans);
+void broadcastToPlans(DataModelElement_t *rootDM, PlanNode_t *plans, Tupel_t *tuple, int event);
+Pushdown_t* compilePushdown(Query_t *query, PushdownField_t *fields, int numFields);
+void freePushdown(Pushdown_t *pushdown);
+void flushQueryContinues(void);
+void flushExpiredQueryContinues(void);
+void flushQueryWindows(DataModelElement_t *rootDM, Query_t *query);
+unsigned long long flushExpiredWindows(void);
+int dispatchQueryContinue(DataModelElement_t *rootDM, QueryContinue_t *queryCont, void *oldBaseAddr, void *newBaseAddr);
+int dispatchQueryContinueFrame(DataModelElement_t *rootDM, QueryContinueFrame_t *frame, void *oldBaseAddr, void *newBaseAddr);
+
+/**
+ * If set, continuations are collected in frames instead of sending each one on its own
+ */
+extern int queryContBatching;
 
 #endif // __QUERY_H__
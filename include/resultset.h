@@ -8,12 +8,24 @@
 #endif
 #include <output.h>
 #include <datamodel.h>
+#include <objpool.h>
 
 DECLARE_LOCK_EXTERN(slcLock);
 
 enum TupleFlags {
-	TUPLE_COMPACT		=	0x1
+	TUPLE_COMPACT		=	0x1,
+	TUPLE_TEMPLATE		=	0x2,					// The tuple was instantiated from a TupleTemplate_t. It is compact as well, but allocated by allocObject().
+	TUPLE_SHARED		=	0x4						// The tuple shares the items of another one. It just owns its header and the item pointer array.
 };
+/**
+ * A tuple instantiated from a template stores the size of its memory area in the bytes above the first one.
+ */
+#define TUPLE_SIZE_SHIFT		8
+#define TUPLE_SIZE_MASK			(~0U << TUPLE_SIZE_SHIFT)
+#define GET_TUPLE_SIZE(tuple)	((tuple)->flags >> TUPLE_SIZE_SHIFT)
+#define TUPLE_TEMPLATE_ALIGN(size)	(((size) + 7) & ~7)
+#define MAX_TEMPLATE_ITEMS		8
+#define MAX_TEMPLATE_BUFFERS	8
 
 #define ALLOC_ITEM_ARRAY(size)	(Item_t**)ALLOC(sizeof(Item_t**) * size)
 
@@ -32,8 +44,61 @@ typedef struct __attribute__((packed)) Tupel {
 	unsigned short itemLen;						// Number of items
 	unsigned int flags;							// If the first byte contains an one, the tupel and its items are stored in one large memory area. If so, the remaining bytes contain the size of thie area in bytes.
 	Item_t **items;
+	struct Tupel *shared;						// The tuple whose items are shared, if TUPLE_SHARED is set. NULL otherwise.
+	unsigned int refs;							// The number of references to this tuple. The tuple is freed along with the last one.
 } Tupel_t;
 
+/**
+ * A precompiled access path to a member of a tuple. It is resolved once by initMemberAccessor(), e.g. while initializing a provider,
+ * and replaces the lookup by name performed by getMemberPointer() on each access.
+ * Since the item is addressed by its slot, an accessor can only be used on tuples with a fixed layout, e.g. the ones created by the provider itself.
+ */
+typedef struct MemberAccessor {
+	DECLARE_BUFFER(itemName)					// The path describing the item, e.g. "net.packetType"
+	int slot;									// The position of the item within the item pointer array
+	int itemSize;								// Number of bytes allocated for the items value
+	int offset;									// The offset in bytes of the member relative to the items value
+	int size;									// The size of the member in bytes. If it is an array, the size of one array element.
+	int type;									// The resolved type of the member
+	DataModelElement_t *dm;						// The datamodel node describing the member
+} MemberAccessor_t;
+
+/**
+ * Describes an accessor which should be resolved by initMemberAccessors(). Providers usually keep a static array of them.
+ */
+typedef struct MemberAccessorDesc {
+	MemberAccessor_t *accessor;
+	int slot;
+	char *itemTypeName;
+	char *typeName;
+} MemberAccessorDesc_t;
+
+/**
+ * Reserves memory for a string or an array member in each tuple instantiated from a template.
+ * A string holds up to {@link capacity} - 1 characters, an array up to {@link capacity} elements.
+ */
+typedef struct TupleBufferDesc {
+	MemberAccessor_t *accessor;					// A resolved accessor to the string or array member
+	int capacity;
+} TupleBufferDesc_t;
+
+/**
+ * The layout of the tuples a provider creates for one event or source. It is computed once by initTupleTemplate().
+ * A tuple instantiated from it occupies one object: the tuple, the item pointer array, each item followed by its value and
+ * a buffer for each string and array. The capacity of a buffer is stored in the int right in front of it.
+ * Hence, creating a tuple takes one allocation and one memcpy of {@link image}. Afterwards, just the pointers are moved to the new base address.
+ * Every string and array member of the items has to be backed by a buffer.
+ */
+typedef struct TupleTemplate {
+	int size;									// The size of a tuple in bytes
+	int itemLen;
+	int bufferLen;
+	int itemOffset[MAX_TEMPLATE_ITEMS];			// The offset of each item relative to the tuple
+	int pointerOffset[MAX_TEMPLATE_BUFFERS];	// The offset of the member pointing to a buffer relative to the tuple
+	int bufferOffset[MAX_TEMPLATE_BUFFERS];		// The offset of each buffer relative to the tuple
+	void *image;								// A tuple with all names, capacities and default values set
+} TupleTemplate_t;
+
 /**
  * This algorithm is the basis for each operation on a tupel.
  * First, it tries to find an item which name (tupelVar->items[i]->name) matches the first part of the provided element name.
@@ -176,6 +241,7 @@ static inline void setItemString(DataModelElement_t *rootDM, Tupel_t *tupel, cha
 /**
  * Allocates an array with {@link num} elements at {@link typeName}.
  * If the tupel is compact, the function refueses access to the tupel, because its sized is fixed.
+ * A tupel instantiated from a template reuses the reserved buffer, as long as {@link num} does not exceed its capacity.
  * @param rootDM a pointer to the slc datamodel
  * @param tupel a pointer to the tupel
  * @param typeName a path specification to describe the wy through the datamodel
@@ -190,6 +256,15 @@ static inline void setItemArray(DataModelElement_t *rootDM, Tupel_t *tupel, char
 		return;
 	}
 	size = getDataModelSize(rootDM,dm,1);
+	if (TEST_BIT(tupel->flags,TUPLE_TEMPLATE)) {
+		// The array is backed by a buffer reserved by the template. Its capacity is stored in front of it.
+		if (num > *((int*)(*(PTR_TYPE*)valuePtr) - 1)) {
+			DEBUG_MSG(1,"Array %s exceeds its capacity\n",typeName);
+			return;
+		}
+		*(int*)(*((PTR_TYPE*)valuePtr)) = num;
+		return;
+	}
 	if (TEST_BIT(tupel->flags,TUPLE_COMPACT)) {
 		DEBUG_MSG(1,"Refusing access (%s) to an item, because tupel is compact.\n",__FUNCTION__);
 		return;
@@ -361,6 +436,210 @@ static inline char* getArraySlotString(DataModelElement_t *rootDM,Tupel_t *tupel
 	}
 	return (char*)((*(PTR_TYPE*)(valuePtr)) + sizeof(int) + arraySlot * SIZE_STRING);
 }
+/**
+ * Returns a pointer to the memory area where the value of the member described by {@link accessor} resides.
+ * In contrast to getMemberPointer(), it neither searches the items nor walks the datamodel.
+ * @param tuple a pointer to the tuple which should be examined
+ * @param accessor a pointer to an accessor resolved by initMemberAccessor()
+ * @return a pointer to the members value or NULL, if the item is not present
+ */
+static inline void* getMemberPointerAcc(Tupel_t *tuple, MemberAccessor_t *accessor) {
+	// An accessor without a datamodel node has not been resolved yet.
+	if (tuple == NULL || accessor->dm == NULL || accessor->slot >= tuple->itemLen || tuple->items[accessor->slot] == NULL) {
+		return NULL;
+	}
+	return tuple->items[accessor->slot]->value + accessor->offset;
+}
+
+/**
+ * The following functions do the same as their counterparts without the Acc suffix.
+ * The member is described by a precompiled {@link accessor} instead of a path.
+ */
+static inline void setItemIntAcc(Tupel_t *tupel, MemberAccessor_t *accessor, int value) {
+	void *valuePtr = getMemberPointerAcc(tupel,accessor);
+	if (valuePtr == NULL) {
+		return;
+	}
+	*(int*)valuePtr = value;
+}
+
+static inline void setItemByteAcc(Tupel_t *tupel, MemberAccessor_t *accessor, char value) {
+	void *valuePtr = getMemberPointerAcc(tupel,accessor);
+	if (valuePtr == NULL) {
+		return;
+	}
+	*(char*)valuePtr = value;
+}
+
+static inline void setItemFloatAcc(Tupel_t *tupel, MemberAccessor_t *accessor, double value) {
+	void *valuePtr = getMemberPointerAcc(tupel,accessor);
+	if (valuePtr == NULL) {
+		return;
+	}
+	*(double*)valuePtr = value;
+}
+
+static inline void setItemStringAcc(Tupel_t *tupel, MemberAccessor_t *accessor, char *value) {
+	void *valuePtr = getMemberPointerAcc(tupel,accessor);
+	if (valuePtr == NULL) {
+		return;
+	}
+	if (TEST_BIT(tupel->flags,TUPLE_COMPACT)) {
+		DEBUG_MSG(1,"Refusing access (%s) to an item, because tuple is compact.\n",__FUNCTION__);
+		return;
+	}
+	*(PTR_TYPE*)valuePtr = (PTR_TYPE)value;
+}
+
+/**
+ * Copies the string {@link value} to the member described by {@link accessor}.
+ * If the tuple was instantiated from a template, the string is stored in the reserved buffer and truncated to its capacity.
+ * Otherwise, a copy is allocated. In contrast to setItemStringAcc(), the caller keeps the ownership of {@link value}.
+ */
+static inline void copyItemStringAcc(Tupel_t *tupel, MemberAccessor_t *accessor, const char *value) {
+	int len = 0, capacity = 0;
+	char *buffer = NULL;
+	void *valuePtr = getMemberPointerAcc(tupel,accessor);
+	if (valuePtr == NULL) {
+		return;
+	}
+	len = strlen(value);
+	if (TEST_BIT(tupel->flags,TUPLE_TEMPLATE)) {
+		buffer = (char*)*(PTR_TYPE*)valuePtr;
+		capacity = *((int*)buffer - 1);
+		if (len >= capacity) {
+			len = capacity - 1;
+		}
+	} else if (TEST_BIT(tupel->flags,TUPLE_COMPACT)) {
+		DEBUG_MSG(1,"Refusing access (%s) to an item, because tuple is compact.\n",__FUNCTION__);
+		return;
+	} else {
+		if ((buffer = ALLOC(len + 1)) == NULL) {
+			DEBUG_MSG(1,"Cannot allocate string: %s\n",accessor->dm->name);
+			return;
+		}
+		*(PTR_TYPE*)valuePtr = (PTR_TYPE)buffer;
+	}
+	memcpy(buffer,value,len);
+	buffer[len] = '\0';
+}
+/**
+ * Allocates an array with {@link num} elements at the member described by {@link accessor}.
+ * If the tuple was instantiated from a template, the reserved buffer is used instead. {@link num} must not exceed its capacity.
+ */
+static inline void setItemArrayAcc(Tupel_t *tupel, MemberAccessor_t *accessor, int num) {
+	void *valuePtr = getMemberPointerAcc(tupel,accessor);
+	if (valuePtr == NULL) {
+		return;
+	}
+	if (TEST_BIT(tupel->flags,TUPLE_TEMPLATE)) {
+		if (num > *((int*)(*(PTR_TYPE*)valuePtr) - 1)) {
+			DEBUG_MSG(1,"Array %s exceeds its capacity\n",accessor->dm->name);
+			return;
+		}
+		*(int*)(*((PTR_TYPE*)valuePtr)) = num;
+		return;
+	}
+	if (TEST_BIT(tupel->flags,TUPLE_COMPACT)) {
+		DEBUG_MSG(1,"Refusing access (%s) to an item, because tupel is compact.\n",__FUNCTION__);
+		return;
+	}
+	if ((*((PTR_TYPE*)valuePtr) = (PTR_TYPE)ALLOC(num * accessor->size + sizeof(int))) == 0) {
+		DEBUG_MSG(1,"Cannot allocate array: %s\n",accessor->dm->name);
+		return;
+	}
+	*(int*)(*((PTR_TYPE*)valuePtr)) = num;
+}
+
+static inline void setArraySlotByteAcc(Tupel_t *tupel, MemberAccessor_t *accessor, int arraySlot, char value) {
+	void *valuePtr = getMemberPointerAcc(tupel,accessor);
+	if (valuePtr == NULL) {
+		return;
+	}
+	if (arraySlot >= *(int*)(*(PTR_TYPE*)valuePtr)) {
+		return;
+	}
+	*(char*)((*(PTR_TYPE*)(valuePtr)) + sizeof(int) + arraySlot * SIZE_BYTE) = value;
+}
+
+static inline void setArraySlotIntAcc(Tupel_t *tupel, MemberAccessor_t *accessor, int arraySlot, int value) {
+	void *valuePtr = getMemberPointerAcc(tupel,accessor);
+	if (valuePtr == NULL) {
+		return;
+	}
+	if (arraySlot >= *(int*)(*(PTR_TYPE*)valuePtr)) {
+		return;
+	}
+	*(int*)((*(PTR_TYPE*)(valuePtr)) + sizeof(int) + arraySlot * SIZE_INT) = value;
+}
+
+static inline void copyArrayByteAcc(Tupel_t *tupel, MemberAccessor_t *accessor, int startingSlot, char *valueArray, int n) {
+	int size = 0, toCopy = 0;
+	void *valuePtr = getMemberPointerAcc(tupel,accessor);
+	if (valuePtr == NULL) {
+		return;
+	}
+	size = *(int*)(*(PTR_TYPE*)valuePtr);
+	if (startingSlot >= size || valueArray == NULL) {
+		return;
+	}
+	toCopy = ((size - startingSlot) > n ? n : (size - startingSlot));
+	memcpy((char*)((*(PTR_TYPE*)(valuePtr)) + sizeof(int) + startingSlot * SIZE_BYTE),valueArray,toCopy);
+}
+
+static inline int getItemIntAcc(Tupel_t *tupel, MemberAccessor_t *accessor) {
+	void *valuePtr = getMemberPointerAcc(tupel,accessor);
+	if (valuePtr == NULL) {
+		return -1;
+	}
+	return *(int*)valuePtr;
+}
+
+static inline char getItemByteAcc(Tupel_t *tupel, MemberAccessor_t *accessor) {
+	void *valuePtr = getMemberPointerAcc(tupel,accessor);
+	if (valuePtr == NULL) {
+		return '\0';
+	}
+	return *(char*)valuePtr;
+}
+#ifndef __KERNEL__
+static inline double getItemFloatAcc(Tupel_t *tupel, MemberAccessor_t *accessor) {
+	void *valuePtr = getMemberPointerAcc(tupel,accessor);
+	if (valuePtr == NULL) {
+		return -1;
+	}
+	return *(double*)valuePtr;
+}
+#endif
+static inline char* getItemStringAcc(Tupel_t *tupel, MemberAccessor_t *accessor) {
+	void *valuePtr = getMemberPointerAcc(tupel,accessor);
+	if (valuePtr == NULL) {
+		return NULL;
+	}
+	return (char*)*(PTR_TYPE*)valuePtr;
+}
+
+static inline char getArraySlotByteAcc(Tupel_t *tupel, MemberAccessor_t *accessor, int arraySlot) {
+	void *valuePtr = getMemberPointerAcc(tupel,accessor);
+	if (valuePtr == NULL) {
+		return '\0';
+	}
+	if (arraySlot >= *(int*)(*(PTR_TYPE*)valuePtr)) {
+		return '\0';
+	}
+	return *(char*)((*(PTR_TYPE*)(valuePtr)) + sizeof(int) + arraySlot * SIZE_BYTE);
+}
+
+static inline int getArraySlotIntAcc(Tupel_t *tupel, MemberAccessor_t *accessor, int arraySlot) {
+	void *valuePtr = getMemberPointerAcc(tupel,accessor);
+	if (valuePtr == NULL) {
+		return -1;
+	}
+	if (arraySlot >= *(int*)(*(PTR_TYPE*)valuePtr)) {
+		return 0;
+	}
+	return *(int*)((*(PTR_TYPE*)(valuePtr)) + sizeof(int) + arraySlot * SIZE_INT);
+}
 /**
  * Allocates a tupel and the item pointer array. It initializes the tupel and item pointer arrray.
  * @param timestamp time in millisecond the tupel was created
@@ -370,11 +649,13 @@ static inline char* getArraySlotString(DataModelElement_t *rootDM,Tupel_t *tupel
 static inline Tupel_t* initTupel(unsigned long long timestamp, int numItems) {
 	int i = 0;
 	Tupel_t *ret = NULL;
-	if ((ret = (Tupel_t*)ALLOC(sizeof(Tupel_t) + numItems * sizeof(Item_t*))) == NULL) {
+	if ((ret = (Tupel_t*)allocObject(sizeof(Tupel_t) + numItems * sizeof(Item_t*))) == NULL) {
 		return NULL;
 	}
 	ret->flags = 0;
 	ret->next = NULL;
+	ret->shared = NULL;
+	ret->refs = 1;
 	ret->timestamp = timestamp;
 #ifdef EVALUATION
 	ret->timestamp2 = 0;
@@ -401,8 +682,8 @@ static inline int allocItem(DataModelElement_t *rootDM, Tupel_t *tupel, int slot
 	char *mem = NULL;
 	int ret = 0;
 
-	if (TEST_BIT(tupel->flags,TUPLE_COMPACT)) {
-		DEBUG_MSG(1,"Refusing access (%s) to an item, because to tupel is compact.\n",__FUNCTION__);
+	if (TEST_BIT(tupel->flags,TUPLE_COMPACT) || TEST_BIT(tupel->flags,TUPLE_SHARED)) {
+		DEBUG_MSG(1,"Refusing access (%s) to an item, because to tupel is compact or shared.\n",__FUNCTION__);
 		return -1;
 	}
 	dm = getDescription(rootDM,itemTypeName);
@@ -413,7 +694,7 @@ static inline int allocItem(DataModelElement_t *rootDM, Tupel_t *tupel, int slot
 	if (ret == -1) {
 		return -1;
 	}
-	mem = ALLOC(sizeof(Item_t) + ret);
+	mem = allocObject(sizeof(Item_t) + ret);
 	if (mem == NULL) {
 		return -1;
 	}
@@ -424,6 +705,33 @@ static inline int allocItem(DataModelElement_t *rootDM, Tupel_t *tupel, int slot
 	return 0;
 }
 
+/**
+ * Allocates the item {@link accessor} belongs to and assigns it to its slot of {@link tupel}.
+ * Any accessor resolved for the same item can be used.
+ * @param tupel a pointer to the tupel
+ * @param accessor a pointer to an accessor resolved by initMemberAccessor()
+ * @return 0 on success. -1 otherwise.
+ */
+static inline int allocItemAcc(Tupel_t *tupel, MemberAccessor_t *accessor) {
+	char *mem = NULL;
+
+	if (TEST_BIT(tupel->flags,TUPLE_COMPACT) || TEST_BIT(tupel->flags,TUPLE_SHARED)) {
+		DEBUG_MSG(1,"Refusing access (%s) to an item, because to tupel is compact or shared.\n",__FUNCTION__);
+		return -1;
+	}
+	if (accessor->dm == NULL || accessor->slot >= tupel->itemLen) {
+		return -1;
+	}
+	mem = allocObject(sizeof(Item_t) + accessor->itemSize);
+	if (mem == NULL) {
+		return -1;
+	}
+	tupel->items[accessor->slot] = (Item_t*)mem;
+	tupel->items[accessor->slot]->value = mem + sizeof(Item_t);
+	memcpy((char*)&tupel->items[accessor->slot]->name,accessor->itemName,MAX_NAME_LEN + 1);
+	return 0;
+}
+
 /**
  * Grows the tupel by {@link newItems} items. {@link tupel} is a pointer pointer, because a realloc may allocate a new
  * memory area and copy the contents to the new location.
@@ -434,11 +742,11 @@ static inline int allocItem(DataModelElement_t *rootDM, Tupel_t *tupel, int slot
 static inline int addItem(Tupel_t **tupel, int newItems) {
 	Tupel_t *temp = NULL;
 	
-	if (TEST_BIT((*tupel)->flags,TUPLE_COMPACT)) {
-		DEBUG_MSG(1,"Refusing access (%s) to an item, because to tupel is compact.\n",__FUNCTION__);
+	if (TEST_BIT((*tupel)->flags,TUPLE_COMPACT) || TEST_BIT((*tupel)->flags,TUPLE_SHARED)) {
+		DEBUG_MSG(1,"Refusing access (%s) to an item, because to tupel is compact or shared.\n",__FUNCTION__);
 		return -1;
 	}
-	if ((temp = REALLOC(*tupel,sizeof(Tupel_t) + sizeof(Item_t**) * ((*tupel)->itemLen + newItems))) == NULL) {
+	if ((temp = reallocObject(*tupel,sizeof(Tupel_t) + sizeof(Item_t**) * ((*tupel)->itemLen + newItems))) == NULL) {
 		return -1;
 	}
 	*tupel = temp;
@@ -453,7 +761,13 @@ int getTupelSize(DataModelElement_t *rootDM, Tupel_t *tupel);
 int copyAndCollectTupel(DataModelElement_t *rootDM, Tupel_t *tupel, void *freeMem, int tupleSize);
 void deleteItem(DataModelElement_t *rootDM, Tupel_t *tupel, int slot);
 Tupel_t* copyTupel(DataModelElement_t *rootDM, Tupel_t *tuple);
+Tupel_t* shareTupel(Tupel_t *tuple);
 void rewriteTupleAddress(DataModelElement_t *rootDM, Tupel_t *tuple, void *oldBaseAddr, void *newBaseAddr);
 int mergeTuple(DataModelElement_t *rootDM, Tupel_t **tupleA, Tupel_t *tupleB);
+int initMemberAccessor(DataModelElement_t *rootDM, MemberAccessor_t *accessor, int slot, char *itemTypeName, char *typeName);
+int initMemberAccessors(DataModelElement_t *rootDM, MemberAccessorDesc_t *desc, int num);
+int initTupleTemplate(DataModelElement_t *rootDM, TupleTemplate_t *tmpl, char **itemTypeNames, int numItems, TupleBufferDesc_t *buffers, int numBuffers);
+void freeTupleTemplate(TupleTemplate_t *tmpl);
+Tupel_t* initTupelFromTemplate(TupleTemplate_t *tmpl, unsigned long long timestamp);
 
 #endif // __RESULTSET_H__
@@ -0,0 +1,83 @@
+#ifndef __TIMERWHEEL_H__
+#define __TIMERWHEEL_H__
+
+#include <common.h>
+
+/**
+ * The resolution of the wheel in nanoseconds. Periods and deadlines are multiples of it.
+ */
+#define TIMER_TICK_NS					1000000ULL
+/**
+ * Each level has TIMER_LEVEL_SIZE slots. A slot of level n spans TIMER_LEVEL_SIZE^n ticks.
+ * Hence, the wheel covers TIMER_LEVEL_SIZE^TIMER_WHEEL_LEVELS ticks, roughly 4.6 hours.
+ * A timer expiring later is put to the last level and cascaded again.
+ */
+#define TIMER_WHEEL_LEVELS				4
+#define TIMER_LEVEL_BITS				6
+#define TIMER_LEVEL_SIZE				(1 << TIMER_LEVEL_BITS)
+
+struct TimerEntry;
+/**
+ * Called by the timing thread, while it holds the lock of the wheel. It must neither block nor add or delete a timer.
+ */
+typedef void (*timerCallback)(struct TimerEntry *timer);
+
+/**
+ * A periodic timer. Its deadlines lie on a fixed grid: a late expiry does not shift the following ones.
+ */
+typedef struct TimerEntry {
+	LIST_ENTRY(TimerEntry) listEntry;
+	/**
+	 * The next deadline in ticks of CLOCK_MONOTONIC
+	 */
+	unsigned long long expires;
+	/**
+	 * The period in ticks
+	 */
+	unsigned int period;
+	/**
+	 * Set, while the timer is linked into the wheel
+	 */
+	int pending;
+	/**
+	 * The level and slot of the wheel the timer is linked into. Only valid, if it is pending.
+	 */
+	unsigned short level;
+	unsigned short slot;
+	timerCallback callback;
+	void *data;
+	/**
+	 * Number of deadlines skipped, because the timing thread fell behind by more than TIMER_MAX_CATCHUP periods
+	 */
+	unsigned long long missed;
+	/**
+	 * Number of expiries fired one tick or more after their deadline
+	 */
+	unsigned long long late;
+} TimerEntry_t;
+
+typedef struct TimerStats {
+	/**
+	 * Number of pending timers
+	 */
+	unsigned int timers;
+	/**
+	 * Number of times the timing thread woke up to fire timers
+	 */
+	unsigned long long wakeups;
+	unsigned long long fired;
+	/**
+	 * Number of timers fired along with another one sharing their deadline
+	 */
+	unsigned long long coalesced;
+	unsigned long long missed;
+	unsigned long long late;
+} TimerStats_t;
+
+int startTimerWheel(void);
+void stopTimerWheel(void);
+int addTimer(TimerEntry_t *timer, unsigned int periodMS, timerCallback callback, void *data);
+void delTimer(TimerEntry_t *timer);
+void getTimerStats(TimerStats_t *stats);
+
+#endif // __TIMERWHEEL_H__
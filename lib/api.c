@@ -14,15 +14,155 @@ EXPORT_SYMBOL(slcLock);
  */
 int debug_level = 0;
 #endif
+
+/**
+ * An object a writer unlinked, which may still be referenced by a reader.
+ * If release is NULL, ptr is a deleted query. See retireQuery().
+ */
+typedef struct RetiredObject {
+	struct RetiredObject *next;
+	void *ptr;
+	releaseRetired release;
+} RetiredObject_t;
+
+/**
+ * All objects retired since the last call to synchronizeSLC().
+ * It has its own lock, because a query might be deleted while the slcLock is temporarily released. See delQueries().
+ */
+static RetiredObject_t *retiredObjects = NULL;
+static DECLARE_OPERATOR_LOCK(retireLock);
+
+/**
+ * Defers the release of {@link ptr} until no reader can reference it anymore.
+ * The caller has to unlink {@link ptr} before. The memory is released by the next call to synchronizeSLC().
+ * If there is no memory left to remember it, {@link ptr} is leaked rather than freed while a reader might use it.
+ * @param ptr the unlinked object
+ * @param release the function releasing {@link ptr}
+ */
+void retireObject(void *ptr, releaseRetired release) {
+	RetiredObject_t *retired = NULL;
+	#ifdef __KERNEL__
+	unsigned long flags;
+	#endif
+
+	if (ptr == NULL) {
+		return;
+	}
+	retired = ALLOC(sizeof(RetiredObject_t));
+	if (retired == NULL) {
+		ERR_MSG("Cannot allocate memory to retire %p. Leaking it.\n",ptr);
+		return;
+	}
+	retired->ptr = ptr;
+	retired->release = release;
+	ACQUIRE_OPERATOR_LOCK(retireLock);
+	retired->next = retiredObjects;
+	retiredObjects = retired;
+	RELEASE_OPERATOR_LOCK(retireLock);
+}
+#ifdef __KERNEL__
+EXPORT_SYMBOL(retireObject);
+#endif
+
+static void releaseMemory(void *ptr) {
+	FREE(ptr);
+}
+
+void retireMemory(void *ptr) {
+	retireObject(ptr,releaseMemory);
+}
+#ifdef __KERNEL__
+EXPORT_SYMBOL(retireMemory);
+#endif
+
+/**
+ * Defers the removal of the pending jobs of {@link query} and the release of its compiled operators.
+ * A reader, which found {@link query} before it got unlinked, may still enqueue a job for it. Hence, its jobs are removed
+ * once all readers left their read section. An executor might still run a job popped before. Thus, the compiled operators
+ * are released after a second grace period.
+ * @param query the deleted query
+ */
+void retireQuery(Query_t *query) {
+	retireObject(query,NULL);
+}
+
+static void releaseQuerySelectors(void *ptr) {
+	QuerySelectors_t *selectors = (QuerySelectors_t*)ptr;
+
+	if (selectors->pushdown != NULL) {
+		freePushdown(selectors->pushdown);
+	}
+	FREE(selectors);
+}
+
+void retireQuerySelectors(QuerySelectors_t *selectors) {
+	retireObject(selectors,releaseQuerySelectors);
+}
+#ifdef __KERNEL__
+EXPORT_SYMBOL(retireQuerySelectors);
+#endif
+
+/**
+ * Waits until no reader can reference any object retired so far and releases them.
+ * The caller must neither hold the slcLock nor be inside a read section.
+ */
+void synchronizeSLC(void) {
+	RetiredObject_t *retired = NULL, *next = NULL, *tmp = NULL;
+	int queries = 0;
+	#ifdef __KERNEL__
+	unsigned long flags;
+	#endif
+
+	ACQUIRE_OPERATOR_LOCK(retireLock);
+	next = retiredObjects;
+	retiredObjects = NULL;
+	RELEASE_OPERATOR_LOCK(retireLock);
+	// Release the objects in the order they were retired, e.g. a query after its compiled operators
+	while (next != NULL) {
+		tmp = next->next;
+		next->next = retired;
+		retired = next;
+		next = tmp;
+	}
+	if (retired == NULL) {
+		return;
+	}
+	SLC_SYNCHRONIZE();
+	for (next = retired; next != NULL; next = next->next) {
+		if (next->release == NULL) {
+			delPendingQuery((Query_t*)next->ptr);
+			queries = 1;
+		}
+	}
+	if (queries) {
+		SLC_SYNCHRONIZE();
+	}
+	while (retired != NULL) {
+		next = retired->next;
+		if (retired->release == NULL) {
+			releaseCompiledOperators(((Query_t*)retired->ptr)->root);
+		} else {
+			retired->release(retired->ptr);
+		}
+		FREE(retired);
+		retired = next;
+	}
+}
+#ifdef __KERNEL__
+EXPORT_SYMBOL(synchronizeSLC);
+#endif
 /**
  * Initializes the global datamodel.
  */
 int initSLCDatamodel(void) {
-	SLC_DATA_MODEL = ALLOC(sizeof(DataModelElement_t));
-	if (SLC_DATA_MODEL == NULL) {
+	DataModelElement_t *root = ALLOC(sizeof(DataModelElement_t));
+
+	if (root == NULL) {
 		return -1;
 	}
-	INIT_MODEL((*SLC_DATA_MODEL),0);
+	INIT_MODEL((*root),0);
+	// Readers do not take the slcLock. Hence, the root has to be initialized, before it gets published.
+	STORE_RELEASE(&SLC_DATA_MODEL,root);
 	return 0;
 }
 
@@ -55,15 +195,18 @@ int registerProvider(DataModelElement_t *dm, Query_t *queries) {
 		ret = mergeDataModel(1,SLC_DATA_MODEL,dm);
 		if (ret < 0) {
 			RELEASE_WRITE_LOCK(slcLock);
+			synchronizeSLC();
 			return ret;
 		}
 		// Now merge it.
 		ret = mergeDataModel(0,SLC_DATA_MODEL,dm);
 		if (ret < 0) {
 			RELEASE_WRITE_LOCK(slcLock);
+			synchronizeSLC();
 			return ret;
 		}
 		RELEASE_WRITE_LOCK(slcLock);
+		synchronizeSLC();
 		do {
 			ret = sendDatamodel(dm,MSG_DM_ADD, &callerCopy);
 			if (ret == -EBUSY) {
@@ -77,6 +220,7 @@ int registerProvider(DataModelElement_t *dm, Query_t *queries) {
 		ret = checkQueries(SLC_DATA_MODEL,queries,NULL,0);
 		if (ret < 0) {
 			RELEASE_WRITE_LOCK(slcLock);
+			synchronizeSLC();
 			return ret;
 		}
 		#ifdef __KERNEL__
@@ -86,9 +230,11 @@ int registerProvider(DataModelElement_t *dm, Query_t *queries) {
 		#endif
 		if (ret < 0) {
 			RELEASE_WRITE_LOCK(slcLock);
+			synchronizeSLC();
 			return ret;
 		}
 		RELEASE_WRITE_LOCK(slcLock);
+		synchronizeSLC();
 	}
 
 	return 0;
@@ -127,9 +273,11 @@ int unregisterProvider(DataModelElement_t *dm, Query_t *queries) {
 		#endif
 		if (ret < 0) {
 			RELEASE_WRITE_LOCK(slcLock);
+			synchronizeSLC();
 			return ret;
 		}
 		RELEASE_WRITE_LOCK(slcLock);
+		synchronizeSLC();
 	}
 	if (dm != NULL) {
 		ret = checkDataModelSyntax(SLC_DATA_MODEL,dm,NULL);
@@ -140,6 +288,7 @@ int unregisterProvider(DataModelElement_t *dm, Query_t *queries) {
 		ret = deleteSubtree(&SLC_DATA_MODEL,dm);
 		if (ret < 0) {
 			RELEASE_WRITE_LOCK(slcLock);
+			synchronizeSLC();
 			return ret;
 		}
 		// If deleteSubtree removes even the root node, it is necessary to reinitialize the global datamodel
@@ -147,6 +296,7 @@ int unregisterProvider(DataModelElement_t *dm, Query_t *queries) {
 			initSLCDatamodel();
 		}
 		RELEASE_WRITE_LOCK(slcLock);
+		synchronizeSLC();
 		do {
 			ret = sendDatamodel(dm,MSG_DM_DEL, &callerCopy);
 			if (ret == -EBUSY) {
@@ -184,9 +334,11 @@ int registerQuery(Query_t *queries) {
 		#endif
 		if (ret < 0) {
 			RELEASE_WRITE_LOCK(slcLock);
+			synchronizeSLC();
 			return ret;
 		}
 		RELEASE_WRITE_LOCK(slcLock);
+		synchronizeSLC();
 	} else {
 		return -EPARAM;
 	}
@@ -219,9 +371,11 @@ int unregisterQuery(Query_t *queries) {
 		#endif
 		if (ret < 0) {
 			RELEASE_WRITE_LOCK(slcLock);
+			synchronizeSLC();
 			return ret;
 		}
 		RELEASE_WRITE_LOCK(slcLock);
+		synchronizeSLC();
 	} else {
 		return -EPARAM;
 	}
@@ -262,54 +416,46 @@ EXPORT_SYMBOL(eventOccuredUnicast);
  */
 void eventOccuredBroadcast(char *datamodelName, Tupel_t *tuple) {
 	DataModelElement_t *dm = NULL;
-	Tupel_t *copyTuple = NULL, *curTuple = NULL;
-	Query_t **queries = NULL;
-	int i = 0, j = 0, numQueries = 0;
-/*	#ifdef __KERNEL__
-	unsigned long flags;
-	#endif
-	ACQUIRE_READ_LOCK(slcLock);*/
+	QueryRegistry_t *registry = NULL;
+	unsigned int num = 0;
+
+	// The datamodel and the registries are read without taking the slcLock
+	SLC_READ_LOCK();
 
 	if (tuple == NULL) {
-//		RELEASE_READ_LOCK(slcLock);
+		SLC_READ_UNLOCK();
 		return;
 	}
 	dm = getDescription(SLC_DATA_MODEL,datamodelName);
 	if (dm == NULL) {
 		freeTupel(SLC_DATA_MODEL,tuple);
-//		RELEASE_READ_LOCK(slcLock);
+		SLC_READ_UNLOCK();
 		return;
 	}
 	if (dm->dataModelType == EVENT) {
-		queries = ((Event_t*)dm->typeInfo)->queries;
-		numQueries = ((Event_t*)dm->typeInfo)->numQueries;
+		registry = LOAD_ACQUIRE(&((Event_t*)dm->typeInfo)->queries);
 	} else {
 		freeTupel(SLC_DATA_MODEL,tuple);
-//		RELEASE_READ_LOCK(slcLock);
+		SLC_READ_UNLOCK();
 		return;
 	}
 
-	curTuple = tuple;
-	for (i = 0; i < MAX_QUERIES_PER_DM; i++) {
-		if (queries[i] != NULL) {
-			if (j + 1 < numQueries) {
-				copyTuple = copyTupel(SLC_DATA_MODEL,curTuple);
-				if (copyTuple == NULL) {
-					ERR_MSG("Cannot copy tuple!\n");
-					freeTupel(SLC_DATA_MODEL,curTuple);
-//					RELEASE_READ_LOCK(slcLock);
-					return;
-				}
-				j++;
-			} else {
-				copyTuple = NULL;
-			}
-			DEBUG_MSG(2,"Executing query(base@%p) %d: %p\n",queries,i,queries[i]);
-			enqueueQuery(queries[i],curTuple,0);
-			curTuple = copyTuple;
-		}
+	if (registry != NULL) {
+		num = LOAD_ACQUIRE(&registry->num);
 	}
-//	RELEASE_READ_LOCK(slcLock);
+	if (num == 1) {
+		DEBUG_MSG(2,"Executing query(base@%p): %p\n",registry,registry->queries[0]);
+		enqueueQuery(registry->queries[0],tuple,0);
+		SLC_READ_UNLOCK();
+		return;
+	}
+	if (num > 1) {
+		// Each query gets its own tuple. All of them share the items of the callers one.
+		broadcastToPlans(SLC_DATA_MODEL,LOAD_ACQUIRE(&((Event_t*)dm->typeInfo)->plans),tuple,0);
+	}
+	// Drop the callers reference. The items are freed along with the last query's tuple.
+	freeTupel(SLC_DATA_MODEL,tuple);
+	SLC_READ_UNLOCK();
 }
 #ifdef __KERNEL__
 EXPORT_SYMBOL(eventOccuredBroadcast);
@@ -323,67 +469,56 @@ EXPORT_SYMBOL(eventOccuredBroadcast);
  * @param event a bitmask describing the event type
  */
 void objectChangedBroadcast(char *datamodelName, Tupel_t *tuple, int event) {
-	int i = 0, j = 0, numQueries;
-/*	#ifdef __KERNEL__
-	unsigned long flags;
-	#endif*/
 	DataModelElement_t *dm = NULL;
-	Query_t **queries = NULL;
+	QueryRegistry_t *registry = NULL;
 	ObjectStream_t *objStream = NULL;
-	Tupel_t *copyTuple = NULL, *curTuple = NULL;
+	unsigned int num = 0;
 
-//	ACQUIRE_READ_LOCK(slcLock);
+	SLC_READ_LOCK();
 
 	if (tuple == NULL) {
-//		RELEASE_READ_LOCK(slcLock);
+		SLC_READ_UNLOCK();
 		return;
 	}
 	dm = getDescription(SLC_DATA_MODEL,datamodelName);
 	if (dm == NULL) {
 		freeTupel(SLC_DATA_MODEL,tuple);
-//		RELEASE_READ_LOCK(slcLock);
+		SLC_READ_UNLOCK();
 		return;
 	}
 	if (dm->dataModelType == OBJECT) {
-		queries = ((Object_t*)dm->typeInfo)->queries;
-		numQueries = ((Object_t*)dm->typeInfo)->numQueries;
+		registry = LOAD_ACQUIRE(&((Object_t*)dm->typeInfo)->queries);
+		if (event & (OBJECT_CREATE | OBJECT_DELETE)) {
+			objectInstancesChanged(dm);
+		}
 	} else {
 		freeTupel(SLC_DATA_MODEL,tuple);
-//		RELEASE_READ_LOCK(slcLock);
+		SLC_READ_UNLOCK();
 		return;
 	}
 
-	curTuple = tuple;
-	for (i = 0; i < MAX_QUERIES_PER_DM; i++) {
-		if (queries[i] != NULL) {
-			if (queries[i]->root->type == GEN_OBJECT) {
-				objStream = (ObjectStream_t*)queries[i]->root;
-			} else {
-				ERR_MSG("Weird! This should not happen! The root operator of a query registered to an object is not of type GEN_OBJECT!\n");
-				continue;
-			}
-			if ((objStream->objectEvents & event) == event) {
-				if (j + 1 < numQueries) {
-					copyTuple = copyTupel(SLC_DATA_MODEL,curTuple);
-					if (copyTuple == NULL) {
-						ERR_MSG("Cannot copy tuple!\n");
-						freeTupel(SLC_DATA_MODEL,curTuple);
-	//					RELEASE_READ_LOCK(slcLock);
-						return;
-					}
-					j++;
-				} else {
-					copyTuple = NULL;
-				}
-				DEBUG_MSG(3,"Executing %d-th query (base@%p) %p\n",i,queries,queries[i]);
-				enqueueQuery(queries[i],curTuple,0);
-				curTuple = copyTuple;
-			} else {
-				DEBUG_MSG(3,"Not executing %d-th query(base@%p) %p, because the event does not match the one the query was registered for (%d != %d).\n",i,queries,queries[i],objStream->objectEvents,event);
-			}
+	if (registry != NULL) {
+		num = LOAD_ACQUIRE(&registry->num);
+	}
+	if (num == 1) {
+		objStream = (ObjectStream_t*)registry->queries[0]->root;
+		if (objStream->st_type != GEN_OBJECT) {
+			ERR_MSG("Weird! This should not happen! The root operator of a query registered to an object is not of type GEN_OBJECT!\n");
+		} else if ((objStream->objectEvents & event) == event) {
+			DEBUG_MSG(3,"Executing query (base@%p) %p\n",registry,registry->queries[0]);
+			enqueueQuery(registry->queries[0],tuple,0);
+			SLC_READ_UNLOCK();
+			return;
+		} else {
+			DEBUG_MSG(3,"Not executing query(base@%p) %p, because the event does not match the one the query was registered for (%d != %d).\n",registry,registry->queries[0],objStream->objectEvents,event);
 		}
+	} else if (num > 1) {
+		// Each query gets its own tuple. All of them share the items of the callers one.
+		broadcastToPlans(SLC_DATA_MODEL,LOAD_ACQUIRE(&((Object_t*)dm->typeInfo)->plans),tuple,event);
 	}
-//	RELEASE_READ_LOCK(slcLock);
+	// Drop the callers reference. The items are freed along with the last query's tuple.
+	freeTupel(SLC_DATA_MODEL,tuple);
+	SLC_READ_UNLOCK();
 }
 #ifdef __KERNEL__
 EXPORT_SYMBOL(objectChangedBroadcast);
@@ -419,7 +554,12 @@ int initSLC(void) {
 	int ret = 0;
 
 	INIT_LOCK(slcLock);
+	INIT_OPERATOR_LOCK(retireLock);
+	if ((ret = initObjPools()) < 0) {
+		return ret;
+	}
 	if ((ret = initSLCDatamodel()) < 0) {
+		destroyObjPools();
 		return ret;
 	}
 	return 0;
@@ -433,4 +573,6 @@ void destroySLC(void) {
 		freeDataModel(SLC_DATA_MODEL, 1);
 		SLC_DATA_MODEL = NULL;
 	}
+	synchronizeSLC();
+	destroyObjPools();
 }
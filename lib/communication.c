@@ -4,10 +4,7 @@
 #include <output.h>
 #include <liballoc.h>
 
-#define isEmpty(var)		((var)->read == (var)->write)
-#define isFull(var)			(((var)->write + 1) % (var)->size == (var)->read)
-//#define FREE_THRESHOLD		(RING_BUFFER_SIZE / 2)
-#define FREE_THRESHOLD		(2)
+#define nextIndex(var,index)	((index) + 1 == (var)->size ? 0 : (index) + 1)
 
 /**
  * Start address of the shared memory within the kernel
@@ -20,31 +17,25 @@ void *sharedMemoryUserBase = NULL;
 Ringbuffer_t *txBuffer = NULL;
 Ringbuffer_t *rxBuffer = NULL;
 /**
- * Determines the number of remaining pages in the txMemory.
- * Used by liballoc.c
+ * One bit per page in the txMemory. A set bit marks a page handed out to liballoc.c.
+ * The page allocator is only called while holding the liballoc lock. Hence, no further lock is needed.
  */
-static int remainingPages = BUFFER_PAGES;
+static unsigned char txPageMap[(BUFFER_PAGES + 7) / 8];
+static unsigned int usedPages = 0, peakPages = 0;
+#define PAGE_USED(page)		(txPageMap[(page) / 8] & (1 << ((page) % 8)))
 static char *txMemory = NULL;
-/**
- * Number of writes to a ringbuffer.
- * Each layer has just on txBuffer. Therefore, only one static writeOps is needed.
- */
-static int writeOps;
 /**
  * Points to a memory location within the shared memory.
  * It gets initialized by ringBufferInit().
  * Each addQuery() fetches and increments this variable atomically.
  */
 unsigned int *globalQueryID;
-/**
- * Used to protect the ringbuffer agains concurrent writes.
- * For now, no write lock is needed. For detailed information have a look at looking.txt
- */
-DECLARE_LOCK(ringBufferLock);
-#define USE_WRITELOCK
-//#undef USER_WRITELOCK
 unsigned int skippedQueryCont;
 unsigned int totalQueryCont;
+/**
+ * The number of MSG_QUERY_CONTINUE_BATCH messages sent
+ */
+unsigned int sentQueryContFrames;
 
 /**
  * Initialize the ring buffer according to the current layer.
@@ -52,30 +43,17 @@ unsigned int totalQueryCont;
  */
 void ringBufferInit(void) {
 #ifdef __KERNEL__
-	int i = 0;
 	txMemory = sharedMemoryKernelBase + 1 * PAGE_SIZE;
 
 	txBuffer = (Ringbuffer_t*)sharedMemoryKernelBase;
-	txBuffer->size = RING_BUFFER_SIZE;
-	txBuffer->read = 0;
-	txBuffer->write = 0;
-	for (i = 0; i < RING_BUFFER_SIZE; i++) {
-		txBuffer->elements[i].type = MSG_EMPTY;
-		txBuffer->elements[i].addr = NULL;
-	}
+	ringBufferReset(txBuffer);
 	/*
 	 * We set up the rxBuffer (a.k.a userspace txBuffer) as well.
 	 * Since the core module is loaded a kernelthread is running and reads from the receive buffer.
 	 * Hence, it has to be initialized.
 	 */
 	rxBuffer = (Ringbuffer_t*)(sharedMemoryKernelBase + sizeof(Ringbuffer_t));
-	rxBuffer->size = RING_BUFFER_SIZE;
-	rxBuffer->read = 0;
-	rxBuffer->write = 0;
-	for (i = 0; i < RING_BUFFER_SIZE; i++) {
-		rxBuffer->elements[i].type = MSG_EMPTY;
-		rxBuffer->elements[i].addr = NULL;
-	}
+	ringBufferReset(rxBuffer);
 
 	globalQueryID = (unsigned int*)(sharedMemoryKernelBase + sizeof(Ringbuffer_t) * 2);
 	*globalQueryID = 1;
@@ -91,34 +69,54 @@ void ringBufferInit(void) {
 
 	DEBUG_MSG(2,"txBuffer=%p (size=%d), rxBuffer=%p (size=%d), txMemory=%p\n",txBuffer,txBuffer->size, rxBuffer, rxBuffer->size, txMemory);
 #endif
-	remainingPages = BUFFER_PAGES;
-	writeOps = 0;
+	memset(txPageMap,0,sizeof(txPageMap));
+	usedPages = 0;
+	peakPages = 0;
 	skippedQueryCont = 0;
 	totalQueryCont = 0;
-	INIT_LOCK(ringBufferLock);
+	sentQueryContFrames = 0;
 
 	DEBUG_MSG(2,"Initialized ring buffer using %d elements\n",RING_BUFFER_SIZE);
 }
+/**
+ * Empties {@link ringBuffer}. Neither a reader nor a writer may use it concurrently.
+ * @param ringBuffer a pointer to the ringbuffer located in the shared memory
+ */
+void ringBufferReset(Ringbuffer_t *ringBuffer) {
+	int i = 0;
+
+	ringBuffer->size = RING_BUFFER_SIZE;
+	ringBuffer->read = 0;
+	ringBuffer->reserve = 0;
+	ringBuffer->reclaimed = 0;
+	ringBuffer->reclaiming = 0;
+	ringBuffer->write = 0;
+	ringBuffer->readerWaiting = 0;
+	for (i = 0; i < RING_BUFFER_SIZE; i++) {
+		ringBuffer->elements[i].type = MSG_EMPTY;
+		ringBuffer->elements[i].addr = NULL;
+	}
+}
 /**
  * Tries to read from {@link ringBuffer}. If it is empty, NULL will be returned.
  * The read index will *not* be updated.
+ * Must only be called by the single reader of {@link ringBuffer}.
  * @param ringBuffer a pointer to the buffer to read from
  * @return a pointer to the next element. Or null, if there is none.
  */
 LayerMessage_t* ringBufferReadBegin(Ringbuffer_t *ringBuffer) {
-	LayerMessage_t *ret = NULL;
-
 	if (ringBuffer == NULL) {
 		return NULL;
 	}
-
-	if (!isEmpty(ringBuffer)) {
-		ret = &ringBuffer->elements[ringBuffer->read];
+	// Pairs with the release in ringBufferWrite(). The message becomes visible not before its index.
+	if (ringBuffer->read == LOAD_ACQUIRE(&ringBuffer->write)) {
+		return NULL;
 	}
-	return ret;
+	return &ringBuffer->elements[ringBuffer->read];
 }
 /**
  * Empties the current message and increments the read index.
+ * The payload is freed later on by a writer, since it belongs to the sending layer.
  * @param ringBuffer a pointer to the ringbuffer to operate on
  */
 void ringBufferReadEnd(Ringbuffer_t *ringBuffer) {
@@ -127,19 +125,48 @@ void ringBufferReadEnd(Ringbuffer_t *ringBuffer) {
 	}
 
 	ringBuffer->elements[ringBuffer->read].type = MSG_EMPTY;
-	ringBuffer->read = (ringBuffer->read + 1 == ringBuffer->size ? 0 : ringBuffer->read + 1);
+	// Pairs with the acquire in reclaimMessages(). A writer must not see the slot as consumed, before the reader is done with it.
+	STORE_RELEASE(&ringBuffer->read,nextIndex(ringBuffer,ringBuffer->read));
+}
+/**
+ * Frees the payload of each message the reader consumed since the last call and hands its slot back to the writers.
+ * Only one writer does so at a time. The others do not wait for it.
+ * @param ringBuffer a pointer to the ringbuffer to operate on
+ */
+static void reclaimMessages(Ringbuffer_t *ringBuffer) {
+	unsigned int i = 0, read = 0;
+
+	if (__sync_lock_test_and_set(&ringBuffer->reclaiming,1) != 0) {
+		return;
+	}
+	read = LOAD_ACQUIRE(&ringBuffer->read);
+	for (i = ringBuffer->reclaimed; i != read; i = nextIndex(ringBuffer,i)) {
+		if (ringBuffer->elements[i].type != MSG_EMPTY) {
+			ERR_MSG("Ringbuffer element is not marked as empty. Although it should be. ringbuffer=0x%lx, element=%d\n",(unsigned long)ringBuffer,i);
+		}
+		if (ringBuffer->elements[i].addr != NULL) {
+			DEBUG_MSG(2,"Freeing memory of unused ringbuffer element %d: %p\n",i,ringBuffer->elements[i].addr);
+			slcfree(ringBuffer->elements[i].addr);
+			ringBuffer->elements[i].addr = NULL;
+		}
+	}
+	// Pairs with the acquire in ringBufferWrite(). A slot must be cleaned up, before it is reserved again.
+	STORE_RELEASE(&ringBuffer->reclaimed,read);
+	__sync_lock_release(&ringBuffer->reclaiming);
 }
 /**
  * Tries to write a message with {@link type} and {@link addr} to the ringbuffer.
  * If it is full, it aborts and returns -1.
- * If writeOps exceeds RING_BUFFER_SIZE / 2, it goes through all unused elements and frees memory used by previous messages.
+ * Any number of writers may call it concurrently without holding a lock. Each one reserves a slot, fills it and publishes it.
+ * Slots are published in the order they were reserved. Hence, a writer might wait for the ones, which reserved a slot before it.
+ * Interrupts are disabled in the meantime. Otherwise, a writer might wait for the one it interrupted.
  * @param ringBuffer a pointer to the ringBuffer to write to
  * @param type the message type
  * @param addr an address pointing to the messages payload
  * @return 0 on success. -1 on failure.
  */
 int ringBufferWrite(Ringbuffer_t *ringBuffer, int type, char *addr) {
-	int i = 0;
+	unsigned int slot = 0, next = 0;
 #ifdef __KERNEL__
 	unsigned long flags;
 #endif
@@ -148,48 +175,131 @@ int ringBufferWrite(Ringbuffer_t *ringBuffer, int type, char *addr) {
 		return -1;
 	}
 
-	ACQUIRE_WRITE_LOCK(ringBufferLock);
-	if (isFull(ringBuffer)) {
-		RELEASE_WRITE_LOCK(ringBufferLock);
-		return -1;
-	} else {
-		if (writeOps >= FREE_THRESHOLD) {
-			DEBUG_MSG(2,"Reached %d write operations. Looking for unfreed memory... (read=%d, write=%d)\n",writeOps,ringBuffer->read,ringBuffer->write);
-			writeOps = 0;
-			for (i = ringBuffer->write; 1 ;) {
-				if (ringBuffer->elements[i].type == MSG_EMPTY) {
-					if (ringBuffer->elements[i].addr != NULL) {
-						DEBUG_MSG(2,"Freeing memory of unused ringbuffer element %d: %p\n",i,ringBuffer->elements[i].addr);
-						slcfree(ringBuffer->elements[i].addr);
-						ringBuffer->elements[i].addr = NULL;
-					}
-				} else {
-					ERR_MSG("Ringbuffer element is not marked as empty. Although it should be. ringbuffer=0x%lx, element=%d\n",(unsigned long)ringBuffer,i);
-				}
-				i = (i + 1 == ringBuffer->size ? 0 : i + 1);
-				if (i == ringBuffer->read) {
-					break;
-				}
-			}
+	if (LOAD_ACQUIRE(&ringBuffer->reclaimed) != LOAD_ACQUIRE(&ringBuffer->read)) {
+		reclaimMessages(ringBuffer);
+	}
+	LOCAL_IRQ_SAVE();
+	do {
+		slot = LOAD_ACQUIRE(&ringBuffer->reserve);
+		next = nextIndex(ringBuffer,slot);
+		if (next == LOAD_ACQUIRE(&ringBuffer->reclaimed)) {
+			LOCAL_IRQ_RESTORE();
+			return -1;
 		}
-		DEBUG_MSG(2,"Wrote message with type 0x%x and addr %p at %d\n",type,addr,ringBuffer->write);
-		ringBuffer->elements[ringBuffer->write].type = type;
-		ringBuffer->elements[ringBuffer->write].addr = addr;
-		writeOps++;
-		ringBuffer->write = (ringBuffer->write + 1 == ringBuffer->size ? 0 : ringBuffer->write + 1);
-		RELEASE_WRITE_LOCK(ringBufferLock);
-		return 0;
+	} while (!__sync_bool_compare_and_swap(&ringBuffer->reserve,slot,next));
+
+	DEBUG_MSG(2,"Wrote message with type 0x%x and addr %p at %d\n",type,addr,slot);
+	ringBuffer->elements[slot].type = type;
+	ringBuffer->elements[slot].addr = addr;
+	// Wait for each writer which reserved a slot before this one.
+	while (LOAD_ACQUIRE(&ringBuffer->write) != slot) {
+		CPU_RELAX();
+	}
+	// Pairs with the acquire in ringBufferReadBegin()
+	STORE_RELEASE(&ringBuffer->write,next);
+	LOCAL_IRQ_RESTORE();
+	// Pairs with the barrier in ringBufferWaitBegin(). Either the reader sees the message or this writer sees the reader waiting.
+	MEMORY_BARRIER();
+	if (LOAD_ACQUIRE(&ringBuffer->readerWaiting)) {
+		ringBufferDoorbell();
 	}
+
+	return 0;
+}
+/**
+ * Checks whether {@link ringBuffer} holds at least one message. It is safe to call it from any context.
+ * @param ringBuffer a pointer to the ringbuffer to check
+ * @return 1, if there is a message to read. 0 otherwise.
+ */
+int ringBufferPending(Ringbuffer_t *ringBuffer) {
+	return LOAD_ACQUIRE(&ringBuffer->read) != LOAD_ACQUIRE(&ringBuffer->write);
+}
+/**
+ * Announces that the reader is about to block until a writer rings the doorbell.
+ * It has to call ringBufferWaitEnd() afterwards, regardless of the return value.
+ * @param ringBuffer a pointer to the ringbuffer the reader waits for
+ * @return 1, if the reader has to block. 0, if a message arrived in the meantime.
+ */
+int ringBufferWaitBegin(Ringbuffer_t *ringBuffer) {
+	STORE_RELEASE(&ringBuffer->readerWaiting,1);
+	// Pairs with the barrier in ringBufferWrite()
+	MEMORY_BARRIER();
+	return !ringBufferPending(ringBuffer);
+}
+/**
+ * Tells the writers that the reader is awake again. They stop ringing the doorbell.
+ * @param ringBuffer a pointer to the ringbuffer the reader waited for
+ */
+void ringBufferWaitEnd(Ringbuffer_t *ringBuffer) {
+	STORE_RELEASE(&ringBuffer->readerWaiting,0);
 }
 
+/**
+ * Hands out the first run of {@link pages} contiguous free pages in the txMemory.
+ * @param pages the number of pages
+ * @return a pointer to the first page on success. NULL otherwise.
+ */
 void* liballoc_alloc(size_t pages) {
-	void *ret = NULL;
+	unsigned int i = 0, first = 0, run = 0;
+
+	if (pages == 0 || pages > BUFFER_PAGES) {
+		return NULL;
+	}
+	for (i = 0; i < BUFFER_PAGES; i++) {
+		if (PAGE_USED(i)) {
+			first = i + 1;
+			run = 0;
+			continue;
+		}
+		run++;
+		if (run == pages) {
+			for (i = first; i < first + pages; i++) {
+				txPageMap[i / 8] |= 1 << (i % 8);
+			}
+			usedPages += pages;
+			if (usedPages > peakPages) {
+				peakPages = usedPages;
+			}
+			return txMemory + PAGE_SIZE * first;
+		}
+	}
 
-	if (remainingPages - (int)pages >= 0) {
-		ret = txMemory + PAGE_SIZE * (BUFFER_PAGES - remainingPages);
-		remainingPages -= pages;
+	return NULL;
+}
+/**
+ * Returns {@link pages} pages starting at {@link ptr} to the txMemory.
+ * @param ptr a pointer previously returned by liballoc_alloc()
+ * @param pages the number of pages passed to liballoc_alloc()
+ * @return 0 on success. -1 otherwise.
+ */
+int liballoc_free(void *ptr, size_t pages) {
+	unsigned int i = 0, first = 0;
+
+	if ((char*)ptr < txMemory || (char*)ptr + PAGE_SIZE * pages > txMemory + PAGE_SIZE * BUFFER_PAGES || ((char*)ptr - txMemory) % PAGE_SIZE != 0) {
+		ERR_MSG("Cannot free %zu pages at %p. It is not part of the txMemory.\n",pages,ptr);
+		return -1;
 	}
+	first = ((char*)ptr - txMemory) / PAGE_SIZE;
+	for (i = first; i < first + pages; i++) {
+		txPageMap[i / 8] &= ~(1 << (i % 8));
+	}
+	usedPages -= pages;
+
+	return 0;
+}
+
+void liballoc_page_stats(SlcAllocStats_t *stats) {
+	unsigned int i = 0, run = 0;
 
-	return ret;
+	stats->totalPages = BUFFER_PAGES;
+	stats->usedPages = usedPages;
+	stats->peakPages = peakPages;
+	stats->largestFreeRun = 0;
+	for (i = 0; i < BUFFER_PAGES; i++) {
+		run = (PAGE_USED(i) ? 0 : run + 1);
+		if (run > stats->largestFreeRun) {
+			stats->largestFreeRun = run;
+		}
+	}
 }
 
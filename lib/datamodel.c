@@ -7,46 +7,41 @@
 
 /**
  * Tries to resolve an element described by {@link name} to an instance of DataModelElement_t.
+ * The datamodel is walked level by level without allocating any memory.
  * @param root The root of a datamodel.
  * @param name Contains a path to the desired element. Each element is separated by a dot.
  * @return A pointer to a DataModelElement_t, if {@link name} describes a valid path. NULL otherwise.
  */
 DataModelElement_t* getDescription(DataModelElement_t *root, char *name) {
-	DataModelElement_t *cur = root;
-	char *token = NULL, *nameCopy = NULL, *nameCopy_ = NULL;
-	int found = 0, i = 0;
+	DataModelElement_t *cur = root, **children = NULL;
+	char *token = name, *tokenEnd = NULL;
+	int found = 0, i = 0, tokenLen = 0, childrenLen = 0;
 	
 	if (root == NULL) {
 		return NULL;
 	}
-	// Copy the search string, because strtok modifies it.
-	nameCopy = (char*)ALLOC(strlen(name) + 1);
-	if (!nameCopy) {
-		return NULL;
-	}
-	nameCopy_ = nameCopy;
-	strcpy(nameCopy,name);
-
-	token = strsep(&nameCopy,".");
-	while (token) {
+	do {
+		// Determine the current token without modifying name.
+		tokenEnd = strchr(token,'.');
+		tokenLen = (tokenEnd == NULL ? strlen(token) : tokenEnd - token);
 		found = 0;
-		// Look up th current token in the current nodes children array.
-		for (i = 0; i < cur->childrenLen; i++) {
-			if (strcmp(token,cur->children[i]->name) == 0) {
+		/*
+		 * Look up th current token in the current nodes children array.
+		 * A writer publishes a new array before its length. Hence, the length has to be read first.
+		 */
+		childrenLen = LOAD_ACQUIRE(&cur->childrenLen);
+		children = LOAD_ACQUIRE(&cur->children);
+		for (i = 0; i < childrenLen; i++) {
+			if (strncmp(token,children[i]->name,tokenLen) == 0 && children[i]->name[tokenLen] == '\0') {
 				// Found it. Step down and proceed with the next token.
-				cur = cur->children[i];
+				cur = children[i];
 				found = 1;
 				break;
 			}
 		}
-		if (found) {
-			// Read the next token. If this was the last one, the loop will terminate and the function returns a pointer to the description.
-			token = strsep(&nameCopy,".");
-		} else {
-			break;
-		}
-	};
-	FREE(nameCopy_);
+		// If this was the last one, the loop will terminate and the function returns a pointer to the description.
+		token = tokenEnd + 1;
+	} while (found && tokenEnd != NULL);
 	if (found) {
 		return cur;
 	}	
@@ -222,6 +217,136 @@ int getComplexTypeOffset(DataModelElement_t *rootDM, DataModelElement_t *parent,
 EXPORT_SYMBOL(getComplexTypeOffset);
 #endif
 
+/**
+ * Returns a pointer to the query registry of {@link node}.
+ * @param node a pointer to an event, object or source
+ * @return a pointer to the registry pointer, or NULL if {@link node} cannot have any queries.
+ */
+QueryRegistry_t** getQueryRegistry(DataModelElement_t *node) {
+	switch (node->dataModelType) {
+		case EVENT:
+			return &((Event_t*)node->typeInfo)->queries;
+
+		case OBJECT:
+			return &((Object_t*)node->typeInfo)->queries;
+
+		case SOURCE:
+			return &((Source_t*)node->typeInfo)->queries;
+	}
+	return NULL;
+}
+#ifdef __KERNEL__
+EXPORT_SYMBOL(getQueryRegistry);
+#endif
+
+/**
+ * Returns a pointer to the shared plans of {@link node}.
+ * @param node a pointer to an event or object
+ * @return a pointer to the first plan pointer, or NULL if the queries of {@link node} are not broadcast.
+ */
+struct PlanNode** getQueryPlans(DataModelElement_t *node) {
+	switch (node->dataModelType) {
+		case EVENT:
+			return &((Event_t*)node->typeInfo)->plans;
+
+		case OBJECT:
+			return &((Object_t*)node->typeInfo)->plans;
+	}
+	return NULL;
+}
+#ifdef __KERNEL__
+EXPORT_SYMBOL(getQueryPlans);
+#endif
+
+/**
+ * Appends {@link query} to {@link registry} and stores its slot in query->idx.
+ * If the registry is full, it is replaced by one twice as large. The caller has to hold the slcLock as a writer.
+ * @param registry a pointer to the registry pointer of a node
+ * @param query a pointer to the query
+ * @return 0 on success. -ENOMEMORY, if the registry cannot be grown.
+ */
+int addQueryToRegistry(QueryRegistry_t **registry, Query_t *query) {
+	QueryRegistry_t *old = *registry, *new = NULL;
+	unsigned int size = 0;
+
+	if (old == NULL || old->num == old->size) {
+		size = (old == NULL ? QUERY_REGISTRY_MIN_SIZE : old->size * 2);
+		new = ALLOC(sizeof(QueryRegistry_t) + sizeof(Query_t*) * size);
+		if (new == NULL) {
+			return -ENOMEMORY;
+		}
+		new->size = size;
+		new->num = 0;
+		if (old != NULL) {
+			memcpy(new->queries,old->queries,sizeof(Query_t*) * old->num);
+			new->num = old->num;
+		}
+		// The new registry has to be completely initialized, before a reader may see it
+		STORE_RELEASE(registry,new);
+		if (old != NULL) {
+			retireMemory(old);
+		}
+	}
+	query->idx = (*registry)->num;
+	(*registry)->queries[query->idx] = query;
+	STORE_RELEASE(&(*registry)->num,query->idx + 1);
+
+	return 0;
+}
+#ifdef __KERNEL__
+EXPORT_SYMBOL(addQueryToRegistry);
+#endif
+
+/**
+ * Removes {@link query} from {@link registry}. The last query takes its slot.
+ * A reader might iterate over the registry meanwhile. Hence, the modified copy is published and the old one is retired.
+ * The caller has to hold the slcLock as a writer.
+ * @param registry a pointer to the registry pointer of a node
+ * @param query a pointer to the query
+ */
+void delQueryFromRegistry(QueryRegistry_t **registry, Query_t *query) {
+	QueryRegistry_t *reg = *registry, *new = NULL;
+	Query_t *last = NULL;
+
+	if (reg == NULL || query->idx >= reg->num || reg->queries[query->idx] != query) {
+		ERR_MSG("Query 0x%lx is not registered\n",(unsigned long)query);
+		return;
+	}
+	new = ALLOC(sizeof(QueryRegistry_t) + sizeof(Query_t*) * reg->size);
+	if (new == NULL) {
+		/*
+		 * Fall back to modify it in place. A reader might visit the last query twice or not at all.
+		 * It is better than keeping a query, which is about to be freed, in the registry.
+		 */
+		ERR_MSG("Cannot allocate memory to copy the registry. Removing query 0x%lx in place.\n",(unsigned long)query);
+		last = reg->queries[reg->num - 1];
+		reg->queries[query->idx] = last;
+		last->idx = query->idx;
+		STORE_RELEASE(&reg->num,reg->num - 1);
+		return;
+	}
+	memcpy(new,reg,sizeof(QueryRegistry_t) + sizeof(Query_t*) * reg->num);
+	last = new->queries[new->num - 1];
+	new->queries[query->idx] = last;
+	last->idx = query->idx;
+	new->num--;
+	STORE_RELEASE(registry,new);
+	retireMemory(reg);
+}
+#ifdef __KERNEL__
+EXPORT_SYMBOL(delQueryFromRegistry);
+#endif
+
+void freeQueryRegistry(QueryRegistry_t **registry) {
+	if (*registry != NULL) {
+		retireMemory(*registry);
+		STORE_RELEASE(registry,NULL);
+	}
+}
+#ifdef __KERNEL__
+EXPORT_SYMBOL(freeQueryRegistry);
+#endif
+
 /**
  * Copies a node and its payload. Children points to a newly allocated memory area.
  * It size will be set according to ChildrenLen. In addition, all elements are set to NULL.
@@ -264,6 +389,8 @@ DataModelElement_t* copyNode(DataModelElement_t *node) {
 			memcpy(src,node->typeInfo,sizeof(Source_t));
 			ret->typeInfo = src;
 			INIT_LOCK(src->lock);
+			// The queries belong to the original node
+			INIT_QUERY_REGISTRY(src->queries);
 			break;
 			
 		case EVENT:
@@ -275,6 +402,8 @@ DataModelElement_t* copyNode(DataModelElement_t *node) {
 			}
 			memcpy(evt,node->typeInfo,sizeof(Event_t));
 			ret->typeInfo = evt;
+			INIT_QUERY_REGISTRY(evt->queries);
+			evt->plans = NULL;
 			break;
 			
 		case OBJECT:
@@ -286,6 +415,8 @@ DataModelElement_t* copyNode(DataModelElement_t *node) {
 			}
 			memcpy(obj,node->typeInfo,sizeof(Object_t));
 			ret->typeInfo = obj;
+			INIT_QUERY_REGISTRY(obj->queries);
+			obj->plans = NULL;
 			break;
 			
 		case REF:
@@ -307,48 +438,43 @@ DataModelElement_t* copyNode(DataModelElement_t *node) {
 	return ret;
 }
 /**
- * Free the node itself, its payload and its children array.
- * @param node
+ * Stops all queries registered to {@link node} and drops its registry as well as its plans.
+ * The caller has to hold the slcLock as a writer.
  */
-void freeNode(DataModelElement_t *node, int freeNodeItself) {
+static void deactivateNode(DataModelElement_t *node) {
 	int i;
-	Query_t **regQueries = NULL;
-
-	if (node->layerCode == LAYER_CODE) {
-		switch (node->dataModelType) {
-			case EVENT:
-				regQueries = ((Event_t*)node->typeInfo)->queries;
-				break;
-
-			case OBJECT:
-				regQueries = ((Object_t*)node->typeInfo)->queries;
-				break;
+	QueryRegistry_t **registry = NULL;
 
-			case SOURCE:
-				regQueries = ((Source_t*)node->typeInfo)->queries;
-				break;
-		}
-		for (i = 0; i < MAX_QUERIES_PER_DM; i++) {
-			if (regQueries[i] != NULL) {
+	// Namespaces, complex types and so forth do not have any queries.
+	registry = (node->typeInfo != NULL ? getQueryRegistry(node) : NULL);
+	if (registry != NULL && *registry != NULL) {
+		for (i = 0; i < (*registry)->num; i++) {
+			if (node->layerCode == LAYER_CODE) {
 				switch (node->dataModelType) {
 					case EVENT:
-						((Event_t*)node->typeInfo)->numQueries--;
-						((Event_t*)node->typeInfo)->deactivate(regQueries[i]);
+						((Event_t*)node->typeInfo)->deactivate((*registry)->queries[i]);
 						break;
 
 					case OBJECT:
-						((Object_t*)node->typeInfo)->numQueries--;
-						((Object_t*)node->typeInfo)->deactivate(regQueries[i]);
+						((Object_t*)node->typeInfo)->deactivate((*registry)->queries[i]);
 						break;
 
 					case SOURCE:
-						stopSourceTimer(regQueries[i]);
-						((Source_t*)node->typeInfo)->numQueries--;
+						stopSourceTimer((*registry)->queries[i]);
 						break;
 				}
 			}
+			// The query cannot be resolved by its id any longer
+			unhashQuery((*registry)->queries[i]);
 		}
+		freeQueryRegistry(registry);
 	}
+	if (node->typeInfo != NULL && getQueryPlans(node) != NULL) {
+		freeQueryPlans(getQueryPlans(node));
+	}
+}
+
+static void releaseNodeMemory(DataModelElement_t *node, int freeNodeItself) {
 	if (node->children != NULL) {
 		FREE(node->children);
 		node->children = NULL;
@@ -361,6 +487,43 @@ void freeNode(DataModelElement_t *node, int freeNodeItself) {
 		FREE(node);
 	}
 }
+
+static void releaseNode(void *ptr) {
+	releaseNodeMemory((DataModelElement_t*)ptr,1);
+}
+
+/**
+ * Free the node itself, its payload and its children array.
+ * @param node
+ */
+void freeNode(DataModelElement_t *node, int freeNodeItself) {
+	deactivateNode(node);
+	releaseNodeMemory(node,freeNodeItself);
+}
+
+/**
+ * Like freeNode(), but the memory is released once no reader can reference {@link node} anymore.
+ * The caller has to unlink {@link node} before.
+ */
+static void retireNode(DataModelElement_t *node) {
+	deactivateNode(node);
+	retireObject(node,releaseNode);
+}
+
+/**
+ * Removes the {@link idx}-th child of {@link parent} without disturbing a concurrent reader.
+ * The last child takes its slot and the removed one is parked behind the new end of the array. Thus, a reader,
+ * which still uses the old length, stays in bounds and finds any child at least once.
+ * The caller has to hold the slcLock as a writer.
+ */
+static void unlinkChild(DataModelElement_t *parent, int idx) {
+	DataModelElement_t *child = parent->children[idx];
+	int last = parent->childrenLen - 1;
+
+	STORE_RELEASE(&parent->children[idx],parent->children[last]);
+	STORE_RELEASE(&parent->children[last],child);
+	STORE_RELEASE(&parent->childrenLen,last);
+}
 /**
  * Deletes all nodes from {@link treePresent} described in {@link treeDelete}.
  * If a node remains without any children, it will be deleted as well.
@@ -369,11 +532,14 @@ void freeNode(DataModelElement_t *node, int freeNodeItself) {
  * set to NULL.
  * @param treePresenet The node root of the datamodel the nodes should be deleted from
  * @param treeDelete the root node of datamodel describing which nodes should be deleted
- * @return -1, if the function cannot reallocate the memory for a children array. 0 on success.
+ * Removed nodes are unlinked at once. Their memory is retired, because a reader might still look at them.
+ * @param treePresenet The node root of the datamodel the nodes should be deleted from
+ * @param treeDelete the root node of datamodel describing which nodes should be deleted
+ * @return 0 on success.
  */
 int deleteSubtree(DataModelElement_t **treePresent, DataModelElement_t *treeDelete) {
-	DataModelElement_t *curPresent = *treePresent, *curDelete = treeDelete, **temp = NULL, *curDeletePrev = NULL;
-	int i = 0, j= 0, children = 0, found = 0;
+	DataModelElement_t *curPresent = *treePresent, *curDelete = treeDelete, *curDeletePrev = NULL;
+	int i = 0, j= 0, found = 0;
 
 	do {
 		if (curDelete->childrenLen > 0) {
@@ -385,38 +551,14 @@ int deleteSubtree(DataModelElement_t **treePresent, DataModelElement_t *treeDele
 					break;
 				}
 			}
-			// All children were processed. Count the remaining children in the tree.
+			// All children were processed. Check, if any child is left in the tree.
 			if (j == curDelete->childrenLen - 1) {
-				children = 0;
-				for (i = 0; i < curPresent->childrenLen; i++) {
-					if (curPresent->children[i] != NULL) {
-						children++;
-					}
-				}
-				// If at least one child is left, a new array must be allocated and its reference must be copied.
-				if (children > 0) {
-					temp = ALLOC_CHILDREN_ARRAY(children);
-					if (temp == NULL) {
-						return -ENOMEMORY;
-					}
-					j = 0;
-					// Copy the childrens references to the recently allocated array.
-					for (i = 0; i < curPresent->childrenLen; i++) {
-						if (curPresent->children[i] != NULL) {
-							temp[j] = curPresent->children[i];
-							j++;
-							
-						}
-					}
-					// Free the old one.
-					FREE(curPresent->children);
-					curPresent->children = temp;
-					curPresent->childrenLen = children;
+				if (curPresent->childrenLen > 0) {
 					curPresent = curPresent->parent;
 				} else {
 					// Reached the root node. Free it and set the pointer to the root node to NULL.
 					if (curPresent->parent == NULL) {
-						freeNode(curPresent,1);
+						retireNode(curPresent);
 						*treePresent = NULL;
 						// We're done.
 						break;
@@ -424,10 +566,10 @@ int deleteSubtree(DataModelElement_t **treePresent, DataModelElement_t *treeDele
 					// No children left. Hence, search for the position of curPresent in the children array of its parent.
 					for (i = 0; i < curPresent->parent->childrenLen; i++) {
 						if (curPresent->parent->children[i] == curPresent) {
-							// Position found. Free the node and set the entry to NULL:
+							// Position found. Unlink the node and retire it.
 							curPresent = curPresent->parent;
-							freeNode(curPresent->children[i],1);
-							curPresent->children[i] = NULL;
+							retireNode(curPresent->children[i]);
+							unlinkChild(curPresent,i);
 							break;
 						}
 					}
@@ -440,10 +582,6 @@ int deleteSubtree(DataModelElement_t **treePresent, DataModelElement_t *treeDele
 				j++;
 				found = 0;
 				for (i = 0; i < curPresent->childrenLen; i++) {
-					// Ommit already deleted children.
-					if (curPresent->children[i] == NULL) {
-						continue;
-					}
 					if (curPresent->children[i]->dataModelType == curDelete->children[j]->dataModelType &&
 						strcmp((char*)&curPresent->children[i]->name,(char*)&curDelete->children[j]->name) == 0) {
 						// Yeah, got it. Step down to process this child.
@@ -466,8 +604,8 @@ int deleteSubtree(DataModelElement_t **treePresent, DataModelElement_t *treeDele
 			for (i = 0; i < curPresent->parent->childrenLen; i++) {
 				if (curPresent->parent->children[i] == curPresent) {
 					curPresent = curPresent->parent;
-					freeNode(curPresent->children[i],1);
-					curPresent->children[i] = NULL;
+					retireNode(curPresent->children[i]);
+					unlinkChild(curPresent,i);
 					curDeletePrev = curDelete;
 					curDelete = curDelete->parent;
 					break;
@@ -523,44 +661,35 @@ DataModelElement_t* copySubtree(DataModelElement_t *rootOrigin) {
 	return rootCopy;
 }
 /**
- * Adds the subtree {@link newTree} as a child to {@link node}. In order to this, the children array
- * of {@link node} has to be reallocated.
+ * Adds the subtree {@link newTree} as a child to {@link node}. In order to this, a children array
+ * with one more slot is published. The old one is retired, because a reader might still iterate over it.
  * @param node the parent node
  * @param newTree the root of the subtree, which should be added to {@link node}
- * @return 0 on succes. -1, if the either the array cannot be reallocated or the tree cannot be copied
+ * @return 0 on succes. -1, if the either the array cannot be allocated or the tree cannot be copied
  */
 int addSubtree(DataModelElement_t  *node, DataModelElement_t *newTree) {
-	DataModelElement_t *copyNewTree = NULL, **temp = NULL;
+	DataModelElement_t *copyNewTree = NULL, **temp = NULL, **old = node->children;
 
-	node->childrenLen++;
-	/*
-	 * Try to avoid wasting memory. There may be some free space behind node->children.
-	 * If not, REALLOC will allocate a new X of bytes and move the contents.
-	 */
-	if (node->children == NULL) {
-		temp = ALLOC_CHILDREN_ARRAY(node->childrenLen);
-	} else {
-		temp = REALLOC_CHILDREN_ARRAY(node->children,node->childrenLen);
-	}
-	if (!temp) {
-		node->childrenLen--;
-		return -1;
-	}
-	node->children = temp;
 	copyNewTree = copySubtree(newTree);
 	if (!copyNewTree) {
-		node->childrenLen--;
-		/*
-		 * It is unlikely that a realloc succeeds and the copy of a subtree (with several calls to malloc) will fail...
-		 * Maybe it's the other way round... :-/
-		 * However, we don't worry about the sizeof(DataModelElement_t**) bytes wasted at the end of node->children.
-		 * It takes more time to shrink this memory again or to malloc a smaller memory area, copy the contents and free the old one.
-		 * The letter case would be the worst.... 
-		 */
 		return -1;
 	}
-	node->children[node->childrenLen - 1] = copyNewTree;
 	copyNewTree->parent = node;
+	temp = ALLOC_CHILDREN_ARRAY(node->childrenLen + 1);
+	if (!temp) {
+		freeDataModel(copyNewTree,1);
+		return -1;
+	}
+	if (old != NULL) {
+		memcpy(temp,old,sizeof(DataModelElement_t*) * node->childrenLen);
+	}
+	temp[node->childrenLen] = copyNewTree;
+	// A reader loads the length first. Hence, the array has to be published before.
+	STORE_RELEASE(&node->children,temp);
+	STORE_RELEASE(&node->childrenLen,node->childrenLen + 1);
+	if (old != NULL) {
+		retireMemory(old);
+	}
 
 	return 0;
 }
@@ -576,7 +705,7 @@ int addSubtree(DataModelElement_t  *node, DataModelElement_t *newTree) {
 int mergeDataModel(int justCheckSyntax, DataModelElement_t *oldTree, DataModelElement_t *newTree) {
 	DataModelElement_t *curNodeOld = oldTree, *curNodeNew = newTree;
 	Object_t *objOld = NULL, *objNew = NULL;
-	int found = 0, i = 0, j = 0;
+	int found = 0, i = 0, j = 0, ret = 0;
 
 	do {
 		// Different handling for the root node. The other nodes will continue her.
@@ -661,8 +790,8 @@ int mergeDataModel(int justCheckSyntax, DataModelElement_t *oldTree, DataModelEl
 			}
 		}
 	} while(curNodeNew != newTree);
-	
-	return 0;
+
+	return ret;
 }
 /**
  * Check the syntax of {@link rootToCheck}. {@link rootCurrent} is used to look up the names of complex datatypes used
@@ -948,6 +1077,13 @@ static int copyNodeAdjacent(void *freeMem, DataModelElement_t *origin, DataModel
 		(*copy)->typeInfo = freeMem;
 		memcpy((*copy)->typeInfo,origin->typeInfo,toCopy);
 		freeMem += toCopy;
+		// The registered queries are not part of the copy. The remote layer registers its own ones.
+		if (getQueryRegistry(*copy) != NULL) {
+			*getQueryRegistry(*copy) = NULL;
+		}
+		if (getQueryPlans(*copy) != NULL) {
+			*getQueryPlans(*copy) = NULL;
+		}
 	}
 	return freeMem - (void*)(*copy);
 }
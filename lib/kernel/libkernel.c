@@ -1,12 +1,16 @@
 #define MSG_FMT(fmt) "[slc-kernel] " fmt
 #include <linux/module.h>
 #include <linux/kthread.h>
+#include <linux/percpu.h>
+#include <linux/cpumask.h>
 #include <linux/list.h>
 #include <linux/mutex.h>
 #include <linux/spinlock.h>
 #include <linux/wait.h>
 #include <linux/ktime.h>
+#include <linux/gcd.h>
 #include <linux/proc_fs.h>
+#include <linux/poll.h>
 #include <linux/completion.h>
 #include <linux/delay.h>
 #include <linux/mm.h>
@@ -24,8 +28,6 @@
 #include <communication.h>
 
 #define PROCFS_READ_BUFFER_SIZE		10
-#define CALC_SLEEP_TIME
-#undef CALC_SLEEP_TIME
 
 #ifndef VM_RESERVED
 # define VM_RESERVED				(VM_DONTEXPAND | VM_DONTDUMP)
@@ -39,63 +41,143 @@ typedef struct DataModelMmap_t {
 static struct proc_dir_entry *procfsSlcDir = NULL;
 static struct proc_dir_entry *procfsSlcDMFile = NULL;
 atomic_t communicationFileMmapRef;
-static struct task_struct *queryExecThread = NULL;
 static struct task_struct *commThread = NULL;
 /*
  * An array of pointers to the NUM_PAGES instances of struct page.
  * Each represents on physical page.
  */
 static struct page **sharedMemoryPages = NULL;
-static LIST_HEAD(queriesToExecList);
-// Synchronize access to queriesToExecList
-static DEFINE_SPINLOCK(listLock);
 /**
- * Account for the number of missed timers - have a look at hrtimerHandler()
+ * The jobs of one query executor thread. Each online CPU has its own instance.
  */
-static atomic_t missedTimer;
-static DECLARE_WAIT_QUEUE_HEAD(waitQueue);
-/*
- * Using list_empty() as a condition for wait_event() may lead to a race condition, especially on a smp system.
- * One processor executes enqueueQuery() while another one checks the condition '!list_empty(queriesToExecList)'.
- * So, we have to use a datatype which allows us atomically acesses *and* represents the lists status.
- * The waitingQueries variable holds the number of outstanding queries.
- */ 
-static atomic_t waitingQueries;
-#ifdef CALC_SLEEP_TIME
+typedef struct ExecQueue {
+	// Synchronize access to jobs
+	spinlock_t lock;
+	struct list_head jobs;
+	/*
+	 * Using list_empty() as a condition for wait_event() may lead to a race condition, especially on a smp system.
+	 * One processor executes enqueueQuery() while another one checks the condition '!list_empty(jobs)'.
+	 * So, we have to use a datatype which allows us atomically acesses *and* represents the lists status.
+	 * The waiting variable holds the number of outstanding jobs.
+	 */
+	atomic_t waiting;
+	/**
+	 * Set, if the queue of another executor has a backlog. The executor tries to steal jobs from it.
+	 */
+	atomic_t kicked;
+	wait_queue_head_t waitQueue;
+	struct task_struct *thread;
+	int cpu;
+	unsigned long executed;
+	unsigned long stolen;
+} ExecQueue_t;
+static DEFINE_PER_CPU(ExecQueue_t, execQueues);
 /**
- * Number of successfull reads from the rx buffer
+ * The jobs of urgent queries. Its executor, the urgent lane, is not bound to a CPU and always runs at real-time priority.
+ * It neither steals bulk jobs nor gets robbed. Hence, it runs the jobs in the order they were enqueued.
  */
-static int successfullReads;
+static ExecQueue_t urgentQueue;
 /**
- * Number of failed reads from the rx buffer
+ * Each enqueueQuery() takes a QueryJob_t from this cache. The executors return it.
  */
-static int failedReads;
-#endif
+static struct kmem_cache *queryJobCache = NULL;
+/**
+ * The CPUs running an executor thread
+ */
+static struct cpumask execCPUs;
+static unsigned int numExecutors = 0;
+/**
+ * Account for the number of missed timers - have a look at hrtimerHandler()
+ */
+static atomic_t missedTimer;
+/**
+ * commThread waits here for userspace to ring the doorbell of the rxBuffer
+ */
+static DECLARE_WAIT_QUEUE_HEAD(commWaitQueue);
 /**
- * Amount of time to sleep after a failed read from the rx buffer
+ * The userspace communication thread polls the communication file. It waits here for the doorbell of the txBuffer.
  */
-static int sleepTime;
+static DECLARE_WAIT_QUEUE_HEAD(commPollQueue);
 /**
  * Evaluate the maximum of waiting queries
  */
 static unsigned long maxWaitingQueries;
 static int useRTPrio = 0;
 module_param(useRTPrio,int,S_IRUGO);
+/**
+ * Binds each executor thread to the CPU its queue belongs to
+ */
+static int pinExecutors = 1;
+module_param(pinExecutors,int,S_IRUGO);
+/**
+ * If a queue holds more jobs, enqueueQuery() kicks the executor of the next CPU to steal some of them
+ */
+static unsigned int stealThreshold = 8;
+module_param(stealThreshold,uint,S_IRUGO);
+/**
+ * The maximum number of jobs a thief looks at in a foreign queue while searching for one it may run
+ */
+#define STEAL_SCAN_DEPTH			16
+/**
+ * Number of microseconds commThread polls an empty rxBuffer before it blocks. Trades CPU time for latency.
+ */
+static unsigned int commSpinUS = 0;
+module_param(commSpinUS,uint,S_IRUGO);
+
+/**
+ * Selects the queue for a job of {@link query}. The jobs of an ordered query always go to the same queue. Hence,
+ * a single executor runs them in the order they were enqueued. Any other job stays on the current CPU.
+ * The caller has to disable interrupts.
+ */
+static ExecQueue_t* selectExecQueue(Query_t *query) {
+	unsigned int cpu = 0, n = 0;
+
+	if (TEST_BIT(query->flags,ORDERED)) {
+		n = query->queryID % numExecutors;
+		for_each_cpu(cpu,&execCPUs) {
+			if (n == 0) {
+				break;
+			}
+			n--;
+		}
+	} else {
+		cpu = smp_processor_id();
+		if (!cpumask_test_cpu(cpu,&execCPUs)) {
+			cpu = cpumask_first(&execCPUs);
+		}
+	}
+	return per_cpu_ptr(&execQueues,cpu);
+}
+/**
+ * Asks the executor next to {@link queue} to steal jobs from it
+ */
+static void kickNextExecutor(ExecQueue_t *queue) {
+	ExecQueue_t *next = NULL;
+	unsigned int cpu = 0;
+
+	cpu = cpumask_next(queue->cpu,&execCPUs);
+	if (cpu >= nr_cpu_ids) {
+		cpu = cpumask_first(&execCPUs);
+	}
+	next = per_cpu_ptr(&execQueues,cpu);
+	if (next != queue && atomic_xchg(&next->kicked,1) == 0) {
+		wake_up(&next->waitQueue);
+	}
+}
 
 void enqueueQuery(Query_t *query, Tupel_t *tuple, int step) {
 	QueryJob_t *job = NULL;
+	ExecQueue_t *queue = NULL;
 	unsigned long flags;
+	int waiting = 0;
 
 	/*
-	 * Honestly, it is not necessary to check, if the execution thread is running.
+	 * Honestly, it is not necessary to check, if the execution threads are running.
 	 * The module cannot be unloaded while there is at least one registered provider remaining.
-	 * Therefore, it's impossible that neither the lock (listLock) nor the list (queriesToExecList)
-	 * are NULL.
+	 * Therefore, it's impossible that the queues are gone.
 	 */
-	spin_lock_irqsave(&listLock,flags);
-	job = ALLOC(sizeof(QueryJob_t));
+	job = kmem_cache_alloc(queryJobCache,ALLOC_GFP);
 	if (job == NULL) {
-		spin_unlock(&listLock);
 		ERR_MSG("Cannot allocate memory for QueryJob_t\n");
 		return;
 	}
@@ -106,13 +188,20 @@ void enqueueQuery(Query_t *query, Tupel_t *tuple, int step) {
 	job->tuple->timestamp2 = getCycles();
 #endif
 	// Enqueue it
-	list_add_tail(&job->list,&queriesToExecList);
-	atomic_inc(&waitingQueries);
-	spin_unlock_irqrestore(&listLock,flags);
-
-	DEBUG_MSG(2,"Enqueued query 0x%x with tuple %p for execution\n",job->query->queryID,job->tuple);
-	// Notify the query execution about the outstanding query
-	wake_up(&waitQueue);
+	local_irq_save(flags);
+	queue = (isQueryUrgent(query) ? &urgentQueue : selectExecQueue(query));
+	spin_lock(&queue->lock);
+	list_add_tail(&job->list,&queue->jobs);
+	waiting = atomic_inc_return(&queue->waiting);
+	spin_unlock(&queue->lock);
+	local_irq_restore(flags);
+
+	DEBUG_MSG(2,"Enqueued query 0x%x with tuple %p for execution on cpu %d\n",job->query->queryID,job->tuple,queue->cpu);
+	// Notify the query executor about the outstanding query
+	wake_up(&queue->waitQueue);
+	if (waiting > stealThreshold && numExecutors > 1 && queue != &urgentQueue) {
+		kickNextExecutor(queue);
+	}
 }
 EXPORT_SYMBOL(enqueueQuery);
 
@@ -141,21 +230,37 @@ static int generateObjectStatus(void *data) {
 	return 0;
 }
 
-void delPendingQuery(Query_t *query) {
+static void delPendingJobs(ExecQueue_t *queue, Query_t *query) {
 	QueryJob_t *cur = NULL;
 	struct list_head *pos = NULL, *next = NULL;
-	
-	spin_lock(&listLock);
-	list_for_each_safe(pos, next, &queriesToExecList) {
+	unsigned long flags;
+
+	// enqueueQuery() takes the lock from interrupt context, e.g. the hrtimerHandler()
+	spin_lock_irqsave(&queue->lock,flags);
+	list_for_each_safe(pos, next, &queue->jobs) {
 		cur = list_entry(pos, QueryJob_t, list);
 		if (cur->query == query) {
 			DEBUG_MSG(1,"Found query 0x%lx. Removing it from list.\n",(unsigned long)cur->query);
 			freeTupel(SLC_DATA_MODEL,cur->tuple);
 			list_del(&cur->list);
-			FREE(cur);
+			atomic_dec(&queue->waiting);
+			kmem_cache_free(queryJobCache,cur);
 		}
 	}
-	spin_unlock(&listLock);
+	spin_unlock_irqrestore(&queue->lock,flags);
+}
+
+void delPendingQuery(Query_t *query) {
+	unsigned int cpu = 0;
+
+	if (isQueryUrgent(query)) {
+		delPendingJobs(&urgentQueue,query);
+		return;
+	}
+	// A job of an unordered query might wait in any queue
+	for_each_cpu(cpu,&execCPUs) {
+		delPendingJobs(per_cpu_ptr(&execQueues,cpu),query);
+	}
 }
 
 void startObjStatusThread(Query_t *query, generateStatus statusFn, unsigned long *__flags) {
@@ -193,34 +298,102 @@ void startObjStatusThread(Query_t *query, generateStatus statusFn, unsigned long
 	*__flags = flags;
 }
 
-static enum hrtimer_restart hrtimerHandler(struct hrtimer *curTimer) {
-	// Obtain the surrounding datatype
-	QueryTimerJob_t *timerJob = container_of(curTimer,QueryTimerJob_t,timer);
-	Source_t *src = (Source_t*)timerJob->dm->typeInfo;
-	GenStream_t *stream = (GenStream_t*)timerJob->query->root;
-	Tupel_t *curTuple= NULL, *tempTuple = NULL;
-	
-	unsigned long flags;
-	
-	/*
-	 * It is possible that the component deletes queries thus stopping a timer while a timer expires.
-	 * Hence, the hrtimerHandler while stall at src->callback(), because the source wants to acquire the slcLock in order to create a tuple.
-	 * After deleting the queries the lock will be release and the handler will acquire it.
-	 * It is likeley that this timer was canceled. Therefore, the instance of TimerJob_t was freed. Further access to the recently freed memory location
-	 * will lead to unpredictable behavior.
-	 * To avoid this, each call to hrtimerHandler() will try to acquire the read lock. If it fails, the handler will abort.
-	 * The delQuery() function will acquire a write lock.
+/**
+ * The source queries sharing a source, its selectors and a harmonic period. A single hrtimer fires for all of them.
+ * The period of the group divides the period of each member. On each tick, the source gets called once, if at least one member is due,
+ * and once more per sample a late member catches up on.
+ * The ticks of the group and the deadlines of each member are multiples of their period on CLOCK_MONOTONIC. Thus, a late tick does not
+ * shift the following ones and a member joining the group is due on the ticks of the group.
+ * Each due member gets its own tuples, which share the items of the ones returned by the source.
+ */
+typedef struct SourceTimerGroup {
+	struct list_head list;
+	/**
+	 * The instances of QueryTimerJob_t polling the source
+	 */
+	struct list_head members;
+	DataModelElement_t *dm;
+	/**
+	 * The period of the hrtimer in ms, i.e. the greatest common divisor of the members periods
 	 */
-	if (TRY_READ_LOCK(slcLock) == 0) {
-		ERR_MSG("Cannot acquire read slc lock\n");
-		atomic_inc(&missedTimer);
-		return HRTIMER_RESTART;
+	unsigned int period;
+	struct hrtimer timer;
+} SourceTimerGroup_t;
+/**
+ * All instances of SourceTimerGroup_t. It is only altered by startSourceTimer() and stopSourceTimer(), which are called with
+ * the slcLock held as a writer. The hrtimerHandler() walks the members of its group inside an RCU read section.
+ */
+static LIST_HEAD(sourceTimerGroups);
+/**
+ * Account for the number of source calls saved by grouping the timers
+ */
+static atomic_t coalescedTimer;
+/**
+ * Account for the number of samples taken one ms or more after their deadline
+ */
+static atomic_t lateTimer;
+
+/**
+ * Returns the first multiple of {@link periodNS} after {@link time}
+ */
+static inline u64 nextPeriodBoundary(u64 time, u64 periodNS) {
+	return (DIV_U64(time,periodNS) + 1) * periodNS;
+}
+
+/**
+ * Looks for a group {@link timerJob} may join. Its period has to be a multiple or a divisor of the groups one.
+ * Otherwise, the group would have to fire more often than any of its members.
+ */
+static SourceTimerGroup_t* findTimerGroup(QueryTimerJob_t *timerJob) {
+	SourceTimerGroup_t *group = NULL;
+	QueryTimerJob_t *member = NULL;
+	unsigned int period = timerJob->period;
+
+	list_for_each_entry(group,&sourceTimerGroups,list) {
+		if (group->dm != timerJob->dm || (period % group->period != 0 && group->period % period != 0)) {
+			continue;
+		}
+		member = list_first_entry(&group->members,QueryTimerJob_t,list);
+		if (isSameSelectors((GenStream_t*)member->query->root,(GenStream_t*)timerJob->query->root)) {
+			return group;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Samples the source of {@link group} once and forwards the tuples to each member owing more than {@link round} samples.
+ * The last of them gets the tuples themselves. Any other one gets tuples sharing their items.
+ * The caller has to be inside a read section.
+ */
+static void sampleTimerGroup(SourceTimerGroup_t *group, int round) {
+	Source_t *src = (Source_t*)group->dm->typeInfo;
+	QueryTimerJob_t *member = NULL, *first = NULL;
+	GenStream_t *stream = NULL;
+	Tupel_t *curTuple= NULL, *tempTuple = NULL, *sharedTuple = NULL;
+	int due = 0, remaining = 0;
+
+	unsigned long flags;
+
+	list_for_each_entry_rcu(member,&group->members,list) {
+		if (member->due > round) {
+			if (first == NULL) {
+				first = member;
+			}
+			due++;
+		}
+	}
+	if (due == 0) {
+		return;
 	}
-	DEBUG_MSG(2,"%s: Creating tuple\n",__FUNCTION__);
+	DEBUG_MSG(2,"%s: Creating tuple for %d queries\n",__FUNCTION__,due);
+	// All members share the selectors
+	stream = (GenStream_t*)first->query->root;
 	// Only one timer at a time is allowed to access this source
 	ACQUIRE_WRITE_LOCK(src->lock);
 	curTuple = src->callback(stream->selectors,stream->selectorsLen,NULL);
 	RELEASE_WRITE_LOCK(src->lock);
+	atomic_add(due - 1,&coalescedTimer);
 	while (curTuple != NULL) {
 		tempTuple = curTuple->next;
 		/*
@@ -230,15 +403,80 @@ static enum hrtimer_restart hrtimerHandler(struct hrtimer *curTimer) {
 		 */
 		curTuple->next = NULL;
 		// Forward any query to the execution thread
-		enqueueQuery(timerJob->query,curTuple,0);
+		remaining = due;
+		member = first;
+		list_for_each_entry_from(member,&group->members,list) {
+			if (member->due <= round) {
+				continue;
+			}
+			if (--remaining == 0) {
+				enqueueQuery(member->query,curTuple,0);
+				break;
+			}
+			sharedTuple = shareTupel(curTuple);
+			if (sharedTuple == NULL) {
+				ERR_MSG("Cannot share tuple!\n");
+				continue;
+			}
+			enqueueQuery(member->query,sharedTuple,0);
+		}
 		curTuple = tempTuple;
 	}
+}
+
+static enum hrtimer_restart hrtimerHandler(struct hrtimer *curTimer) {
+	// Obtain the surrounding datatype
+	SourceTimerGroup_t *group = container_of(curTimer,SourceTimerGroup_t,timer);
+	QueryTimerJob_t *member = NULL;
+	u64 expires = ktime_to_ns(hrtimer_get_expires(curTimer)), now = ktime_get_ns(), periodNS = 0, skipped = 0;
+	int round = 0, rounds = 0;
+	
+	/*
+	 * The component might delete a query, thus removing its member from the group, while the timer expires.
+	 * stopSourceTimer() unlinks the member and retires it. The group itself is freed after the timer got canceled.
+	 * Hence, walking the members inside a read section is sufficient. The handler never has to skip a tick for the slcLock.
+	 */
+	SLC_READ_LOCK();
+	/*
+	 * Each member is due, if its deadline lies on this tick or if the handler fell behind it. A late member catches up:
+	 * it gets one sample per deadline passed, but at most TIMER_MAX_CATCHUP ones. The remaining deadlines are skipped.
+	 * Its following deadlines stay on the grid of its period.
+	 */
+	list_for_each_entry_rcu(member,&group->members,list) {
+		member->due = 0;
+		if (member->next > expires) {
+			continue;
+		}
+		periodNS = (u64)member->period * NSEC_PER_MSEC;
+		do {
+			if (now >= member->next + NSEC_PER_MSEC) {
+				member->late++;
+				atomic_inc(&lateTimer);
+			}
+			member->next += periodNS;
+			member->due++;
+		} while (member->next <= now && member->due < TIMER_MAX_CATCHUP);
+		if (member->next <= now) {
+			skipped = DIV_U64(now - member->next,periodNS) + 1;
+			member->next += skipped * periodNS;
+			member->missed += skipped;
+			atomic_add(skipped,&missedTimer);
+		}
+		if (member->due > rounds) {
+			rounds = member->due;
+		}
+	}
+	// Sample the source once per round. Each round serves the members still owing a sample.
+	for (round = 0; round < rounds; round++) {
+		sampleTimerGroup(group,round);
+	}
 	/*
-	 * Restart the timer. Do *not* return HRTIMER_RESTART. It will force the kernel to *immediately* restart this timer and 
-	 * will block at least one core. It will slow down the whole system.
+	 * Restart the timer on the next boundary of the groups period. Do *not* return HRTIMER_RESTART with an expiry in the past.
+	 * It will force the kernel to *immediately* restart this timer and will block at least one core. It will slow down the whole system.
+	 * The period might have changed meanwhile. Hence, the boundary is calculated rather than forwarding the current expiry.
 	 */
-	hrtimer_forward_now(&timerJob->timer,ns_to_ktime(timerJob->period * NSEC_PER_MSEC));
-	RELEASE_READ_LOCK(slcLock);
+	hrtimer_set_expires(curTimer,ns_to_ktime(nextPeriodBoundary(ktime_get_ns(),(u64)group->period * NSEC_PER_MSEC)));
+	SLC_READ_UNLOCK();
 
 	return HRTIMER_RESTART;
 }
@@ -246,72 +484,223 @@ static enum hrtimer_restart hrtimerHandler(struct hrtimer *curTimer) {
 void startSourceTimer(DataModelElement_t *dm, Query_t *query) {
 	SourceStream_t *srcStream = (SourceStream_t*)query->root;
 	QueryTimerJob_t *timerJob = NULL;
+	SourceTimerGroup_t *group = NULL;
 	// Allocate memory for the job-specific information; job-specific = (query,datamodel,period)
 	timerJob = ALLOC(sizeof(QueryTimerJob_t));
 	if (timerJob == NULL) {
 		ERR_MSG("Cannot allocate QueryTimerJob_t\n");
 		return;
 	}
-
-	DEBUG_MSG(2,"%s: Init hrtimer for node %s\n",__FUNCTION__,srcStream->st_name);
-	// Setup the timer using timing information relative to the current clock which will be the monotonic one.
-	hrtimer_init(&timerJob->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
 	timerJob->period = srcStream->period;
 	timerJob->query = query;
 	timerJob->dm = dm;
-	timerJob->timer.function = &hrtimerHandler;
-	srcStream->timerInfo = timerJob;
+	timerJob->due = 0;
+	timerJob->missed = 0;
+	timerJob->late = 0;
 
-	DEBUG_MSG(2,"%s: Starting hrtimer for node %s. Will fire in %u ms.\n",__FUNCTION__,srcStream->st_name,srcStream->period);
+	group = findTimerGroup(timerJob);
+	if (group != NULL) {
+		/*
+		 * The first deadline of the query is the first multiple of its period not before the next tick of the group.
+		 * Both periods are harmonic. Hence, it lies on a tick of the group.
+		 * A shorter period replaces the one of the group. The next tick is a multiple of it, too.
+		 */
+		DEBUG_MSG(2,"%s: Adding node %s to the hrtimer firing every %u ms\n",__FUNCTION__,srcStream->st_name,group->period);
+		if (timerJob->period < group->period) {
+			group->period = timerJob->period;
+		}
+		timerJob->group = group;
+		timerJob->next = nextPeriodBoundary(ktime_to_ns(hrtimer_get_expires(&group->timer)) - 1,(u64)timerJob->period * NSEC_PER_MSEC);
+		list_add_tail_rcu(&timerJob->list,&group->members);
+		STORE_RELEASE(&srcStream->timerInfo,timerJob);
+		return;
+	}
+
+	group = ALLOC(sizeof(SourceTimerGroup_t));
+	if (group == NULL) {
+		ERR_MSG("Cannot allocate SourceTimerGroup_t\n");
+		FREE(timerJob);
+		return;
+	}
+	DEBUG_MSG(2,"%s: Init hrtimer for node %s\n",__FUNCTION__,srcStream->st_name);
+	INIT_LIST_HEAD(&group->members);
+	group->dm = dm;
+	group->period = timerJob->period;
+	// Setup the timer using absolute deadlines of the monotonic clock. Each one is a multiple of the period.
+	hrtimer_init(&group->timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
+	group->timer.function = &hrtimerHandler;
+	timerJob->group = group;
+	list_add_tail(&timerJob->list,&group->members);
+	list_add_tail(&group->list,&sourceTimerGroups);
+	STORE_RELEASE(&srcStream->timerInfo,timerJob);
+
+	DEBUG_MSG(2,"%s: Starting hrtimer for node %s. Will fire every %u ms.\n",__FUNCTION__,srcStream->st_name,srcStream->period);
+	timerJob->next = nextPeriodBoundary(ktime_get_ns(),(u64)srcStream->period * NSEC_PER_MSEC);
 	// Fire it up.... :-)
-	hrtimer_start(&timerJob->timer,ns_to_ktime(srcStream->period * NSEC_PER_MSEC),HRTIMER_MODE_REL);
+	hrtimer_start(&group->timer,ns_to_ktime(timerJob->next),HRTIMER_MODE_ABS);
 }
 
 void stopSourceTimer(Query_t *query) {
 	int ret = 0;
+	unsigned int period = 0;
 	SourceStream_t *srcStream = (SourceStream_t*)query->root;
-	QueryTimerJob_t *timerJob = (QueryTimerJob_t*)srcStream->timerInfo;
+	QueryTimerJob_t *timerJob = (QueryTimerJob_t*)srcStream->timerInfo, *member = NULL;
+	SourceTimerGroup_t *group = NULL;
 
 	if (timerJob == NULL) {
 		ERR_MSG("No timer registered for query 0x%p\n",query);
 		return;
 	}
+	group = timerJob->group;
+	DEBUG_MSG(2,"%s: Node %s missed %llu deadlines and took %llu samples late.\n",__FUNCTION__,srcStream->st_name,timerJob->missed,timerJob->late);
+	list_del_rcu(&timerJob->list);
+	// The hrtimerHandler() might still look at the timer information
+	retireMemory(timerJob);
+	STORE_RELEASE(&srcStream->timerInfo,NULL);
+	if (!list_empty(&group->members)) {
+		// The remaining members may allow for a longer period. The deadlines of the members are multiples of it anyway.
+		list_for_each_entry(member,&group->members,list) {
+			period = gcd(period,member->period);
+		}
+		DEBUG_MSG(2,"%s: Removed node %s from its hrtimer. It fires every %u ms now.\n",__FUNCTION__,srcStream->st_name,period);
+		group->period = period;
+		return;
+	}
 	DEBUG_MSG(2,"%s: Canceling hrtimer for node %s...\n",__FUNCTION__,srcStream->st_name);
 	// Cancel the timer. Blocks until the timer handler terminates.
-	ret = hrtimer_cancel(&timerJob->timer);
+	ret = hrtimer_cancel(&group->timer);
 	DEBUG_MSG(2,"%s: hrtimer for node %s canceled. Was active: %d\n",__FUNCTION__,srcStream->st_name,ret);
-	// Free the timer information
-	FREE(timerJob);
-	srcStream->timerInfo = NULL;
+	list_del(&group->list);
+	retireMemory(group);
+}
+
+int getSourceTimerStats(Query_t *query, SourceTimerStats_t *stats) {
+	QueryTimerJob_t *timerJob = NULL;
+	int ret = 0;
+
+	if (query == NULL || stats == NULL || query->root->type != GEN_SOURCE) {
+		return -EPARAM;
+	}
+	// stopSourceTimer() retires the job
+	SLC_READ_LOCK();
+	timerJob = LOAD_ACQUIRE((QueryTimerJob_t**)&((SourceStream_t*)query->root)->timerInfo);
+	if (timerJob == NULL) {
+		ret = -EPARAM;
+	} else {
+		stats->missed = timerJob->missed;
+		stats->late = timerJob->late;
+	}
+	SLC_READ_UNLOCK();
+
+	return ret;
+}
+EXPORT_SYMBOL(getSourceTimerStats);
+
+/**
+ * Dequeues the oldest job of {@link queue}
+ * @return a pointer to the job or NULL, if the queue is empty
+ */
+static QueryJob_t* dequeueJob(ExecQueue_t *queue) {
+	QueryJob_t *job = NULL;
+	unsigned long flags;
+
+	spin_lock_irqsave(&queue->lock,flags);
+	if (!list_empty(&queue->jobs)) {
+		job = list_first_entry(&queue->jobs,QueryJob_t,list);
+		list_del(&job->list);
+		atomic_dec(&queue->waiting);
+	}
+	spin_unlock_irqrestore(&queue->lock,flags);
+
+	return job;
+}
+/**
+ * Takes a job from the queue of another executor. Jobs of ordered queries are never stolen.
+ * Otherwise two executors might run them concurrently.
+ * @param thief a pointer to the queue of the calling executor
+ * @return a pointer to the job or NULL, if there is none to steal
+ */
+static QueryJob_t* stealJob(ExecQueue_t *thief) {
+	QueryJob_t *job = NULL;
+	ExecQueue_t *victim = NULL;
+	unsigned long flags;
+	unsigned int cpu = 0;
+	int scanned = 0;
+
+	for_each_cpu(cpu,&execCPUs) {
+		victim = per_cpu_ptr(&execQueues,cpu);
+		if (victim == thief || atomic_read(&victim->waiting) == 0) {
+			continue;
+		}
+		scanned = 0;
+		spin_lock_irqsave(&victim->lock,flags);
+		list_for_each_entry(job,&victim->jobs,list) {
+			if (scanned++ >= STEAL_SCAN_DEPTH) {
+				break;
+			}
+			if (!TEST_BIT(job->query->flags,ORDERED)) {
+				list_del(&job->list);
+				atomic_dec(&victim->waiting);
+				spin_unlock_irqrestore(&victim->lock,flags);
+				thief->stolen++;
+				return job;
+			}
+		}
+		spin_unlock_irqrestore(&victim->lock,flags);
+	}
+
+	return NULL;
 }
 
 static int queryExecutorWork(void *data) {
+	ExecQueue_t *queue = (ExecQueue_t*)data;
 	QueryJob_t *cur = NULL;
-	unsigned long flags;
-	DEBUG_MSG(2,"Started execution thread\n");
+	unsigned long long flushWait = 0;
+	DEBUG_MSG(2,"Started execution thread on cpu %d\n",queue->cpu);
 
 	while (1) {
 		DEBUG_MSG(3,"%s: Waiting for incoming queries...\n",__FUNCTION__);
 		
-		wait_event_interruptible(waitQueue,kthread_should_stop() || atomic_read(&waitingQueries) > 0);
-		while (atomic_read(&waitingQueries) > 0) {
-			if (atomic_read(&waitingQueries) > maxWaitingQueries) {
-				maxWaitingQueries = atomic_read(&waitingQueries);
+		// The urgent lane wakes up on its own to flush the windows of quiet streams, even if no job arrives
+		if (queue == &urgentQueue && flushWait != 0) {
+			wait_event_interruptible_timeout(queue->waitQueue,kthread_should_stop() || atomic_read(&queue->waiting) > 0 || atomic_read(&queue->kicked) > 0,
+				nsecs_to_jiffies(flushWait));
+		} else {
+			wait_event_interruptible(queue->waitQueue,kthread_should_stop() || atomic_read(&queue->waiting) > 0 || atomic_read(&queue->kicked) > 0);
+		}
+		atomic_set(&queue->kicked,0);
+		while (1) {
+			if (atomic_read(&queue->waiting) > maxWaitingQueries) {
+				maxWaitingQueries = atomic_read(&queue->waiting);
+			}
+			/*
+			 * A deleted query is released two grace periods after delPendingQuery() removed its jobs. See synchronizeSLC().
+			 * Hence, a job has to be dequeued and executed inside a read section. Otherwise, its query might be gone.
+			 */
+			SLC_READ_LOCK();
+			// Dequeue the head. If our queue is empty, help out another executor.
+			cur = dequeueJob(queue);
+			if (cur == NULL && numExecutors > 1 && queue != &urgentQueue) {
+				cur = stealJob(queue);
+			}
+			if (cur == NULL) {
+				SLC_READ_UNLOCK();
+				break;
 			}
-			read_lock(&slcLock);
-			spin_lock_irqsave(&listLock,flags);
-			// Dequeue the head and execute the query
-			cur = list_first_entry(&queriesToExecList,QueryJob_t,list);
-			list_del(&cur->list);
-			atomic_dec(&waitingQueries);
-			spin_unlock_irqrestore(&listLock,flags);
 
 			DEBUG_MSG(3,"%s: Executing query 0x%x with tuple %p\n",__FUNCTION__,cur->query->queryID,cur->tuple);
 			// A queries execution just reads from the datamodel. No write lock is needed.
 			executeQuery(SLC_DATA_MODEL,cur->query,cur->tuple,cur->step);
-			read_unlock(&slcLock);
-			FREE(cur);
+			SLC_READ_UNLOCK();
+			queue->executed++;
+			kmem_cache_free(queryJobCache,cur);
+			// A long backlog must not hold back the windows of quiet streams and the continuations collected so far either
+			flushExpiredWindows();
+			flushExpiredQueryContinues();
 		}
+		// No more queries to execute. Do not hold back the windows of quiet streams and the continuations collected so far.
+		flushWait = flushExpiredWindows();
+		flushQueryContinues();
 		if (kthread_should_stop()) {
 			DEBUG_MSG(3,"%s: Were asked to terminate.\n",__FUNCTION__);
 			break;
@@ -320,47 +709,161 @@ static int queryExecutorWork(void *data) {
 
 	return 0;
 }
+/**
+ * Stops all executor threads. Each one finishes the job it is currently running.
+ */
+static void stopExecutors(void) {
+	ExecQueue_t *queue = NULL;
+	QueryJob_t *cur = NULL, *next = NULL;
+	unsigned int cpu = 0;
+
+	for_each_cpu(cpu,&execCPUs) {
+		queue = per_cpu_ptr(&execQueues,cpu);
+		if (queue->thread != NULL) {
+			kthread_stop(queue->thread);
+			queue->thread = NULL;
+		}
+		INFO_MSG("Executor on cpu %d: executed %lu jobs, %lu of them stolen\n",cpu,queue->executed,queue->stolen);
+	}
+	if (urgentQueue.thread != NULL) {
+		kthread_stop(urgentQueue.thread);
+		urgentQueue.thread = NULL;
+		INFO_MSG("Urgent lane: executed %lu jobs\n",urgentQueue.executed);
+	}
+	list_for_each_entry_safe(cur,next,&urgentQueue.jobs,list) {
+		list_del(&cur->list);
+		freeTupel(SLC_DATA_MODEL,cur->tuple);
+		kmem_cache_free(queryJobCache,cur);
+	}
+	// The job cache can only be destroyed, if all jobs were returned
+	for_each_cpu(cpu,&execCPUs) {
+		queue = per_cpu_ptr(&execQueues,cpu);
+		list_for_each_entry_safe(cur,next,&queue->jobs,list) {
+			list_del(&cur->list);
+			freeTupel(SLC_DATA_MODEL,cur->tuple);
+			kmem_cache_free(queryJobCache,cur);
+		}
+	}
+	if (queryJobCache != NULL) {
+		kmem_cache_destroy(queryJobCache);
+		queryJobCache = NULL;
+	}
+}
+/**
+ * Sets up a queue and an executor thread for each online CPU as well as the urgent lane.
+ * @return 0 on success. A value below zero otherwise.
+ */
+static int startExecutors(struct sched_param *param) {
+	ExecQueue_t *queue = NULL;
+	unsigned int cpu = 0;
+	int ret = 0;
 
-#ifdef CALC_SLEEP_TIME
-static int calcSleepTime(int sleepTime, int readSuccess) {
-	int ret = sleepTime, temp = 0;
-
-	if (readSuccess > 0) {
-		successfullReads++;
-		failedReads = 0;
-	} else {
-		successfullReads = 0;
-		failedReads++;
+	queryJobCache = KMEM_CACHE(QueryJob,0);
+	if (queryJobCache == NULL) {
+		ERR_MSG("Cannot create the query job cache\n");
+		return -ENOMEM;
 	}
-	if (successfullReads > SLEEP_THRESH_SUCESS) {
-		temp = INIT_SLEEP_TIME - (successfullReads - SLEEP_THRESH_SUCESS) * SLEEP_STEP;
-		ret = (temp < SLEEP_MIN ? SLEEP_MIN : temp);
+	cpumask_clear(&execCPUs);
+	numExecutors = 0;
+	spin_lock_init(&urgentQueue.lock);
+	INIT_LIST_HEAD(&urgentQueue.jobs);
+	atomic_set(&urgentQueue.waiting,0);
+	atomic_set(&urgentQueue.kicked,0);
+	init_waitqueue_head(&urgentQueue.waitQueue);
+	urgentQueue.cpu = -1;
+	urgentQueue.executed = 0;
+	urgentQueue.stolen = 0;
+	urgentQueue.thread = (struct task_struct*)kthread_create(queryExecutorWork,&urgentQueue,"queryUrgentThread");
+	if (IS_ERR(urgentQueue.thread)) {
+		ret = PTR_ERR(urgentQueue.thread);
+		urgentQueue.thread = NULL;
+		stopExecutors();
+		return ret;
 	}
-	if (failedReads > SLEEP_THRESH_FAILED) {
-		temp = INIT_SLEEP_TIME + (failedReads - SLEEP_THRESH_FAILED) * SLEEP_STEP;
-		ret = (temp > SLEEP_MAX ? SLEEP_MAX : temp);
+	for_each_online_cpu(cpu) {
+		queue = per_cpu_ptr(&execQueues,cpu);
+		spin_lock_init(&queue->lock);
+		INIT_LIST_HEAD(&queue->jobs);
+		atomic_set(&queue->waiting,0);
+		atomic_set(&queue->kicked,0);
+		init_waitqueue_head(&queue->waitQueue);
+		queue->cpu = cpu;
+		queue->executed = 0;
+		queue->stolen = 0;
+		queue->thread = (struct task_struct*)kthread_create_on_node(queryExecutorWork,queue,cpu_to_node(cpu),"queryExecThread/%u",cpu);
+		if (IS_ERR(queue->thread)) {
+			ret = PTR_ERR(queue->thread);
+			queue->thread = NULL;
+			stopExecutors();
+			return ret;
+		}
+		if (pinExecutors) {
+			kthread_bind(queue->thread,cpu);
+		}
+		cpumask_set_cpu(cpu,&execCPUs);
+		numExecutors++;
 	}
-	ret = 100000;
-	return ret;
+	// ... and start the query execution threads
+	for_each_cpu(cpu,&execCPUs) {
+		queue = per_cpu_ptr(&execQueues,cpu);
+		wake_up_process(queue->thread);
+		if (useRTPrio && sched_setscheduler(queue->thread, SCHED_FIFO, param) != 0) {
+			ERR_MSG("Cannot assign real-time priority to queryExecThread/%u\n",cpu);
+		}
+	}
+	wake_up_process(urgentQueue.thread);
+	if (sched_setscheduler(urgentQueue.thread, SCHED_FIFO, param) != 0) {
+		ERR_MSG("Cannot assign real-time priority to queryUrgentThread\n");
+	}
+	INFO_MSG("Started %u query executors (%s, %s priority)\n",numExecutors,(pinExecutors ? "pinned" : "unpinned"),(useRTPrio ? "real-time" : "normal"));
+
+	return 0;
+}
+
+void ringBufferDoorbell(void) {
+	wake_up_interruptible(&commPollQueue);
+}
+
+/**
+ * Blocks until userspace published a message to the rxBuffer or the thread should stop.
+ * If commSpinUS is set, the rxBuffer is polled that long before.
+ */
+static void waitForMessages(void) {
+	u64 deadline = 0;
+
+	if (commSpinUS > 0) {
+		deadline = ktime_get_ns() + (u64)commSpinUS * NSEC_PER_USEC;
+		while (!ringBufferPending(rxBuffer) && !kthread_should_stop() && ktime_get_ns() < deadline) {
+			cpu_relax();
+		}
+	}
+	if (ringBufferWaitBegin(rxBuffer)) {
+		wait_event_interruptible_timeout(commWaitQueue,ringBufferPending(rxBuffer) || kthread_should_stop(),msecs_to_jiffies(COMM_WAIT_TIMEOUT_MS));
+	}
+	ringBufferWaitEnd(rxBuffer);
+}
+
+/**
+ * Frees a query the remote layer handed over. It is retired along with the query itself. See retireQuery().
+ */
+static void releaseRemoteQuery(void *ptr) {
+	freeQuery((Query_t*)ptr);
 }
-#else
-#define calcSleepTime(x,y)		(100000)
-#endif
 
 static int commThreadWork(void *data) {
 	LayerMessage_t *msg = NULL;
 	DataModelElement_t *dm = NULL;
 	Query_t *query = NULL, *queryCopy = NULL;
 	QueryContinue_t *queryCont = NULL;
+	QueryContinueFrame_t *queryContFrame = NULL;
 	QueryID_t *queryID = NULL;
-	Tupel_t *curTupleShm = NULL, *curTupleCopy = NULL, *headTupleCopy = NULL, *prevTupleCopy = NULL;
 	int ret = 0;
 	unsigned long flags;
 
 	while (!kthread_should_stop()) {
 		msg = ringBufferReadBegin(rxBuffer);
 		if (msg == NULL) {
-			usleep_range(sleepTime,sleepTime+500);
+			waitForMessages();
 		} else {
 			DEBUG_MSG(3,"Read msg with type 0x%x and addr 0x%p (rewritten addr = 0x%p)\n",msg->type,msg->addr,REWRITE_ADDR(msg->addr,sharedMemoryUserBase,sharedMemoryKernelBase));
 			switch (msg->type) {
@@ -375,6 +878,7 @@ static int commThreadWork(void *data) {
 						ERR_MSG("Weird! Cannot merge datamodel received by userspace!\n");
 					}
 					RELEASE_WRITE_LOCK(slcLock);
+					synchronizeSLC();
 					break;
 
 				case MSG_DM_DEL:
@@ -390,6 +894,7 @@ static int commThreadWork(void *data) {
 						initSLCDatamodel();
 					}
 					RELEASE_WRITE_LOCK(slcLock);
+					synchronizeSLC();
 					break;
 
 				case MSG_QUERY_ADD:
@@ -405,10 +910,13 @@ static int commThreadWork(void *data) {
 					rewriteQueryAddress(queryCopy,msg->addr,queryCopy);
 					ACQUIRE_WRITE_LOCK(slcLock);
 					if (addQueries(SLC_DATA_MODEL,queryCopy,&flags) != 0) {
-						freeQuery(queryCopy);
+						// addQueries() retired the queries it had registered already. Readers may still see them.
+						retireObject(queryCopy,releaseRemoteQuery);
+					} else {
+						DEBUG_MSG(2,"Registered remote query with id %d\n",queryCopy->queryID);
 					}
-					DEBUG_MSG(2,"Registered remote query with id %d\n",queryCopy->queryID);
 					RELEASE_WRITE_LOCK(slcLock);
+					synchronizeSLC();
 					break;
 
 				case MSG_QUERY_DEL:
@@ -418,7 +926,7 @@ static int commThreadWork(void *data) {
 					query = resolveQuery(SLC_DATA_MODEL,queryID);
 					if (query == NULL) {
 						ERR_MSG("No such query: name=%s, id=%d\n",queryID->name, queryID->id);
-						RELEASE_READ_LOCK(slcLock);
+						RELEASE_WRITE_LOCK(slcLock);
 						break;
 					}
 					delQueries(SLC_DATA_MODEL,query,&flags);
@@ -426,58 +934,27 @@ static int commThreadWork(void *data) {
 					 * delQueries() does *not* free the query itself.
 					 * Normally a query is handed over by a module/shared library and directly registered.
 					 * Therefore, the module/shared library has to free. In this case the query was handed over by the remote layer.
-					 * So, it is freed now.
+					 * So, it is freed, once no reader or executor can reference it anymore.
 					 */
-					freeQuery(query);
+					retireObject(query,releaseRemoteQuery);
 					RELEASE_WRITE_LOCK(slcLock);
+					synchronizeSLC();
 					break;
 
 				case MSG_QUERY_CONTINUE:
 					queryCont = (QueryContinue_t*)REWRITE_ADDR(msg->addr,sharedMemoryUserBase,sharedMemoryKernelBase);
-					ACQUIRE_READ_LOCK(slcLock);
-					// Try to resolve queryID to a pointer to a real query
-					query = resolveQuery(SLC_DATA_MODEL,&queryCont->qID);
-					if (query == NULL) {
-						ERR_MSG("No such query: name=%s, id=%d\n",queryCont->qID.name, queryCont->qID.id);
-						RELEASE_READ_LOCK(slcLock);
-						break;
-					}
-					curTupleShm = (Tupel_t*)(queryCont + 1);
-					headTupleCopy = NULL;
-					prevTupleCopy = NULL;
-					ret = 0;
-					// Basically a MSG_QUERY_CONTINUE can have one or more tuples attached
-					do {
-						rewriteTupleAddress(SLC_DATA_MODEL,curTupleShm,sharedMemoryUserBase,sharedMemoryKernelBase);
-						curTupleCopy = copyTupel(SLC_DATA_MODEL,curTupleShm);
-						if (curTupleCopy == NULL) {
-							ERR_MSG("Cannot copy tuple from shared memory. Freeing all previous copied tuples. Query: name=%s, id=%d\n", queryCont->qID.name, queryCont->qID.id);
-							curTupleCopy = headTupleCopy;
-							// There was an error during copying curTupleShm --> free all tuples copied so far
-							while (curTupleCopy != NULL) {
-								prevTupleCopy = curTupleCopy->next;
-								freeTupel(SLC_DATA_MODEL,curTupleCopy);
-								curTupleCopy = prevTupleCopy;
-							}
-							headTupleCopy = NULL;
-							break;
-						}
-						if (prevTupleCopy != NULL) {
-							prevTupleCopy->next = curTupleCopy;
-						}
-						if (headTupleCopy == NULL) {
-							headTupleCopy = curTupleCopy;
-						}
-						prevTupleCopy = curTupleCopy;
-						curTupleShm = curTupleShm->next;
-						ret++;
-					} while (curTupleShm != NULL);
-					if (headTupleCopy != NULL) {
-						// Handover the tuples and the query to the executor
-						DEBUG_MSG(2,"Enqueueing %d remote tuple(s) for execution.\n",ret);
-						enqueueQuery(query,headTupleCopy,queryCont->steps);
-					}
-					RELEASE_READ_LOCK(slcLock);
+					SLC_READ_LOCK();
+					dispatchQueryContinue(SLC_DATA_MODEL,queryCont,sharedMemoryUserBase,sharedMemoryKernelBase);
+					SLC_READ_UNLOCK();
+					break;
+
+				case MSG_QUERY_CONTINUE_BATCH:
+					queryContFrame = (QueryContinueFrame_t*)REWRITE_ADDR(msg->addr,sharedMemoryUserBase,sharedMemoryKernelBase);
+					// Enter the read section once for all continuations within the frame
+					SLC_READ_LOCK();
+					ret = dispatchQueryContinueFrame(SLC_DATA_MODEL,queryContFrame,sharedMemoryUserBase,sharedMemoryKernelBase);
+					SLC_READ_UNLOCK();
+					DEBUG_MSG(3,"Dispatched %d of %u continuations from a frame\n",ret,queryContFrame->entries);
 					break;
 
 				case MSG_DM_SNAPSHOT:
@@ -506,8 +983,6 @@ static int commThreadWork(void *data) {
 			}
 			ringBufferReadEnd(rxBuffer);
 		}
-		sleepTime = calcSleepTime(sleepTime,msg != NULL);
-		DEBUG_MSG(3,"sleepTime = %d us\n",sleepTime);
 	}
 
 	return 0;
@@ -645,15 +1120,40 @@ static int communicationFileOpen(struct inode *inode, struct file *filp) {
 	return 0;
 }
 
+/**
+ * Userspace rings the doorbell by writing to the communication file. It does so, if commThread waits for the rxBuffer.
+ */
+static ssize_t communicationFileWrite(struct file *filp, const char __user *buffer, size_t length, loff_t *pos) {
+	wake_up_interruptible(&commWaitQueue);
+	return length;
+}
+
+/**
+ * The file becomes readable as soon as the txBuffer holds a message.
+ */
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,16,0)
+static __poll_t communicationFilePoll(struct file *filp, poll_table *wait) {
+#else
+static unsigned int communicationFilePoll(struct file *filp, poll_table *wait) {
+#endif
+	poll_wait(filp,&commPollQueue,wait);
+	if (ringBufferPending(txBuffer)) {
+		return POLLIN | POLLRDNORM;
+	}
+	return 0;
+}
+
 static const struct file_operations proc_datamodel_operations = {
 	.open		=	communicationFileOpen,
 	.read		=	communicationFileRead,
+	.write		=	communicationFileWrite,
+	.poll		=	communicationFilePoll,
 	.release	=	communicationFileClose,
 	.mmap		=	communicationFileMmap,
 };
 
 static int __init slc_init(void) {
-	int i = 0, j = 0;
+	int i = 0, j = 0, ret = 0;
 	kuid_t fileUID;
 	kgid_t fileGID;
 	struct sched_param param = { .sched_priority = MAX_RT_PRIO - 1 };
@@ -712,35 +1212,20 @@ static int __init slc_init(void) {
 		return -1;
 	}
 
-	atomic_set(&waitingQueries,0);
 	atomic_set(&missedTimer,0);
+	atomic_set(&coalescedTimer,0);
+	atomic_set(&lateTimer,0);
 	maxWaitingQueries = 0;
-#ifdef CALC_SLEEP_TIME
-	successfullReads = 0;
-	failedReads = 0;
-#endif
-	sleepTime = INIT_SLEEP_TIME;
-	// Init ...
-	queryExecThread = (struct task_struct*)kthread_create(queryExecutorWork,NULL,"queryExecThread");
-	if (IS_ERR(queryExecThread)) {
-		return PTR_ERR(queryExecThread);
-	}
-	// ... and start the query execution thread
-	wake_up_process(queryExecThread);
-	if (useRTPrio) {
-		if (sched_setscheduler(queryExecThread, SCHED_FIFO, &param) == 0) {
-			INFO_MSG("Assigend real-time priority to queryExecThread\n");
-		} else {
-			ERR_MSG("Cannot assign real-time priority to queryExecThread\n");
-		}
-	} else {
-		INFO_MSG("Running queryExecThread at normal priority\n");
+	// Init and start the query executors
+	ret = startExecutors(&param);
+	if (ret < 0) {
+		return ret;
 	}
 
 	// Init ...
 	commThread = (struct task_struct*)kthread_create(commThreadWork,NULL,"commThread");
 	if (IS_ERR(commThread)) {
-		kthread_stop(queryExecThread);
+		stopExecutors();
 		return PTR_ERR(commThread);
 	}
 	// ... and start the communication thread which reads from the rxBuffer and processes the received messages.
@@ -752,10 +1237,11 @@ static int __init slc_init(void) {
 
 static void __exit slc_exit(void) {
 	int i = 0;
+	SlcAllocStats_t allocStats;
+	ObjPoolStats_t poolStats;
 	
-	// Signal the query execution thread to terminate and wait for it
-	kthread_stop(queryExecThread);
-	queryExecThread = NULL;
+	// Signal the query execution threads to terminate and wait for them
+	stopExecutors();
 	// Signal the communication execution thread to terminate and wait for it
 	kthread_stop(commThread);
 	commThread = NULL;
@@ -772,8 +1258,14 @@ static void __exit slc_exit(void) {
 	kfree(sharedMemoryPages);
 
 	INFO_MSG("Max amount of outstanding queries: %lu\n",maxWaitingQueries);
-	INFO_MSG("Missed %d timer\n", atomic_read(&missedTimer));
-	INFO_MSG("Skipped the sending of %u/%u query continue message\n",skippedQueryCont,totalQueryCont);
+	INFO_MSG("Missed %d timer, %d late\n", atomic_read(&missedTimer), atomic_read(&lateTimer));
+	INFO_MSG("Saved %d source calls by sharing timers\n", atomic_read(&coalescedTimer));
+	INFO_MSG("Skipped the sending of %u/%u query continue message (%u frames sent)\n",skippedQueryCont,totalQueryCont,sentQueryContFrames);
+	slcallocstats(&allocStats);
+	INFO_MSG("txMemory: %u/%u pages used (peak %u), %llu bytes allocated (peak %llu), %u%% fragmented, %llu failed allocations\n",
+		allocStats.usedPages,allocStats.totalPages,allocStats.peakPages,allocStats.inUse,allocStats.peakInUse,ALLOC_FRAGMENTATION(allocStats),allocStats.failed);
+	getObjPoolStats(&poolStats);
+	INFO_MSG("%llu objects too large for any pool\n",poolStats.large);
 	INFO_MSG("Destroyed SLC\n");
 }
 
@@ -110,6 +110,8 @@ unsigned int l_pageSize;			///< The size of an individual page. Set up in liball
 unsigned int l_pageCount;			///< The number of pages to request per chunk. Set up in liballoc_init.
 unsigned long long l_allocated;		///< Running total of allocated memory.
 unsigned long long l_inuse;			///< Running total of used memory.
+unsigned long long l_peakInuse;		///< The highest value l_inuse ever had.
+unsigned long long l_failed;		///< Number of allocations which returned NULL.
 long long l_warningCount;			///< Number of warnings encountered
 long long l_errorCount;				///< Number of actual errors
 long long l_possibleOverruns;		///< Number of possible overruns
@@ -121,6 +123,8 @@ static struct liballoc_meta liballocMeta = {
 	.l_pageCount = 16,
 	.l_allocated = 0,
 	.l_inuse = 0,
+	.l_peakInuse = 0,
+	.l_failed = 0,
 	.l_warningCount = 0,
 	.l_errorCount = 0,
 	.l_possibleOverruns = 0,
@@ -315,6 +319,7 @@ void *PREFIX(malloc)(size_t req_size)
 		liballocMeta.l_memRoot = allocate_new_page( size );
 		if ( liballocMeta.l_memRoot == NULL )
 		{
+		  liballocMeta.l_failed += 1;
 		  liballoc_unlock();
 		  #ifdef LIBALLOC_DEBUG
 		  PRINT_MSG( "liballoc: initial l_memRoot initialization failed\n"); 
@@ -420,6 +425,7 @@ void *PREFIX(malloc)(size_t req_size)
 
 
 			liballocMeta.l_inuse += size;
+			if ( liballocMeta.l_inuse > liballocMeta.l_peakInuse ) liballocMeta.l_peakInuse = liballocMeta.l_inuse;
 			
 			
 			p = (void*)((uintptr_t)(maj->first) + sizeof( struct liballoc_minor ));
@@ -458,6 +464,7 @@ void *PREFIX(malloc)(size_t req_size)
 			maj->usage 			+= size + sizeof( struct liballoc_minor );
 
 			liballocMeta.l_inuse += size;
+			if ( liballocMeta.l_inuse > liballocMeta.l_peakInuse ) liballocMeta.l_peakInuse = liballocMeta.l_inuse;
 
 			p = (void*)((uintptr_t)(maj->first) + sizeof( struct liballoc_minor ));
 			ALIGN( p );
@@ -505,6 +512,7 @@ void *PREFIX(malloc)(size_t req_size)
 						maj->usage += size + sizeof( struct liballoc_minor );
 
 						liballocMeta.l_inuse += size;
+						if ( liballocMeta.l_inuse > liballocMeta.l_peakInuse ) liballocMeta.l_peakInuse = liballocMeta.l_inuse;
 						
 						p = (void*)((uintptr_t)min + sizeof( struct liballoc_minor ));
 						ALIGN( p );
@@ -546,6 +554,7 @@ void *PREFIX(malloc)(size_t req_size)
 						maj->usage += size + sizeof( struct liballoc_minor );
 						
 						liballocMeta.l_inuse += size;
+						if ( liballocMeta.l_inuse > liballocMeta.l_peakInuse ) liballocMeta.l_peakInuse = liballocMeta.l_inuse;
 						
 						p = (void*)((uintptr_t)new_min + sizeof( struct liballoc_minor ));
 						ALIGN( p );
@@ -598,6 +607,7 @@ void *PREFIX(malloc)(size_t req_size)
 
 
 	
+	liballocMeta.l_failed += 1;
 	liballoc_unlock();		// release the lock
 
 	#ifdef LIBALLOC_DEBUG
@@ -719,13 +729,14 @@ void PREFIX(free)(void *ptr)
 
 	if ( maj->first == NULL )	// Block completely unused.
 	{
-		//if ( liballocMeta.l_memRoot == maj ) liballocMeta.l_memRoot = maj->next;
+		// Hand its pages back. Otherwise, the tx memory only ever shrinks.
+		if ( liballocMeta.l_memRoot == maj ) liballocMeta.l_memRoot = maj->next;
 		if ( liballocMeta.l_bestBet == maj ) liballocMeta.l_bestBet = NULL;
-		//if ( maj->prev != NULL ) maj->prev->next = maj->next;
-		//if ( maj->next != NULL ) maj->next->prev = maj->prev;
-		//l_allocated -= maj->size;
+		if ( maj->prev != NULL ) maj->prev->next = maj->next;
+		if ( maj->next != NULL ) maj->next->prev = maj->prev;
+		liballocMeta.l_allocated -= maj->size;
 
-		//liballoc_free( maj, maj->pages );
+		liballoc_free( maj, maj->pages );
 	}
 	else
 	{
@@ -752,6 +763,23 @@ void PREFIX(free)(void *ptr)
 
 
 
+/**
+ * Fills in {@link stats} with the current usage and the high-water marks of the allocator.
+ * @param stats a pointer to the snapshot to fill in
+ */
+void PREFIX(allocstats)(SlcAllocStats_t *stats)
+{
+	liballoc_lock();
+	stats->inUse = liballocMeta.l_inuse;
+	stats->peakInUse = liballocMeta.l_peakInuse;
+	stats->failed = liballocMeta.l_failed;
+	liballoc_page_stats(stats);
+	liballoc_unlock();
+}
+#ifdef __KERNEL__
+EXPORT_SYMBOL(PREFIX(allocstats));
+#endif
+
 void* PREFIX(calloc)(size_t nobj, size_t size)
 {
        int real_size;
@@ -859,14 +887,34 @@ void*   PREFIX(realloc)(void *p, size_t size)
 	return ptr;
 }
 
+/**
+ * Serializes the allocator. Any thread of this layer may allocate a payload, while another one frees a consumed one in ringBufferWrite().
+ */
+#ifdef __KERNEL__
+static DEFINE_SPINLOCK(liballocLock);
+static unsigned long liballocFlags;
+#else
+static pthread_mutex_t liballocLock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
 int liballoc_lock(void) {
+#ifdef __KERNEL__
+	unsigned long flags;
+
+	spin_lock_irqsave(&liballocLock,flags);
+	liballocFlags = flags;
+#else
+	pthread_mutex_lock(&liballocLock);
+#endif
 	return 0;
 }
 
 int liballoc_unlock(void) {
+#ifdef __KERNEL__
+	spin_unlock_irqrestore(&liballocLock,liballocFlags);
+#else
+	pthread_mutex_unlock(&liballocLock);
+#endif
 	return 0;
 }
 
-int liballoc_free(void *ptr, size_t pages) {
-	return 0;
-}
@@ -0,0 +1,348 @@
+#define MSG_FMT(fmt) "[slc-objpool] " fmt
+#include <common.h>
+#include <output.h>
+#include <objpool.h>
+
+/**
+ * Returns the class an object of {@link size} bytes, including its header, belongs to.
+ */
+static inline unsigned int sizeToClass(unsigned int size) {
+	unsigned int cls = 0;
+
+	size += sizeof(ObjHeader_t);
+	if (size > OBJ_POOL_MAX_SIZE) {
+		return OBJ_POOL_LARGE;
+	}
+	while ((OBJ_POOL_MIN_SIZE << cls) < size) {
+		cls++;
+	}
+	return cls;
+}
+
+static unsigned long long objPoolGrown[OBJ_POOL_CLASSES];
+static unsigned long long objPoolLarge = 0;
+
+static void* allocLarge(unsigned int size) {
+	ObjHeader_t *header = NULL;
+
+	header = ALLOC(sizeof(ObjHeader_t) + size);
+	if (header == NULL) {
+		return NULL;
+	}
+	header->cls = OBJ_POOL_LARGE;
+	header->size = size;
+	__sync_fetch_and_add(&objPoolLarge,1);
+	return header + 1;
+}
+
+#ifdef __KERNEL__
+/**
+ * The slab allocator already keeps per-cpu freelists. Hence, one cache per class suffices.
+ */
+static struct kmem_cache *objCaches[OBJ_POOL_CLASSES];
+static char objCacheNames[OBJ_POOL_CLASSES][20];
+
+int initObjPools(void) {
+	int i = 0;
+
+	for (i = 0; i < OBJ_POOL_CLASSES; i++) {
+		snprintf(objCacheNames[i],sizeof(objCacheNames[i]),"slc_obj_%d",OBJ_POOL_MIN_SIZE << i);
+		objCaches[i] = kmem_cache_create(objCacheNames[i],OBJ_POOL_MIN_SIZE << i,0,0,NULL);
+		if (objCaches[i] == NULL) {
+			ERR_MSG("Cannot create kmem_cache %s\n",objCacheNames[i]);
+			destroyObjPools();
+			return -ENOMEMORY;
+		}
+	}
+	objPoolLarge = 0;
+
+	return 0;
+}
+EXPORT_SYMBOL(initObjPools);
+
+/**
+ * All objects have to be returned before.
+ */
+void destroyObjPools(void) {
+	int i = 0;
+
+	for (i = 0; i < OBJ_POOL_CLASSES; i++) {
+		if (objCaches[i] != NULL) {
+			kmem_cache_destroy(objCaches[i]);
+			objCaches[i] = NULL;
+		}
+	}
+}
+EXPORT_SYMBOL(destroyObjPools);
+
+void* allocObject(unsigned int size) {
+	ObjHeader_t *header = NULL;
+	unsigned int cls = sizeToClass(size);
+
+	// Fall back to kmalloc, if the caches are not set up yet
+	if (cls == OBJ_POOL_LARGE || objCaches[cls] == NULL) {
+		return allocLarge(size);
+	}
+	header = kmem_cache_alloc(objCaches[cls],ALLOC_GFP);
+	if (header == NULL) {
+		return NULL;
+	}
+	header->cls = cls;
+	return header + 1;
+}
+EXPORT_SYMBOL(allocObject);
+
+void freeObject(void *ptr) {
+	ObjHeader_t *header = (ObjHeader_t*)ptr - 1;
+
+	if (ptr == NULL) {
+		return;
+	}
+	if (header->cls == OBJ_POOL_LARGE) {
+		FREE(header);
+		return;
+	}
+	kmem_cache_free(objCaches[header->cls],header);
+}
+EXPORT_SYMBOL(freeObject);
+#else
+/**
+ * The free objects of one class owned by a single thread. No locking is needed to access them.
+ */
+typedef struct ObjCache {
+	ObjHeader_t *head;
+	unsigned int count;
+} ObjCache_t;
+
+/**
+ * Takes the objects threads do not need at the moment, e.g. the ones freed by an executor, which were allocated by a provider.
+ */
+typedef struct ObjDepot {
+	pthread_mutex_t lock;
+	ObjHeader_t *head;
+	unsigned int count;
+} ObjDepot_t;
+
+/**
+ * Precedes the objects carved from one slab. Slabs are never returned to malloc().
+ */
+typedef union ObjSlab {
+	union ObjSlab *next;
+	char pad[16];
+} ObjSlab_t;
+
+static __thread ObjCache_t objCaches[OBJ_POOL_CLASSES];
+static __thread int objCacheRegistered = 0;
+static ObjDepot_t objDepots[OBJ_POOL_CLASSES] = { [0 ... OBJ_POOL_CLASSES - 1] = { PTHREAD_MUTEX_INITIALIZER, NULL, 0 } };
+static pthread_mutex_t objSlabLock = PTHREAD_MUTEX_INITIALIZER;
+static ObjSlab_t *objSlabs = NULL;
+/**
+ * Its destructor hands the cached objects of a terminating thread over to the depots
+ */
+static pthread_key_t objCacheKey;
+static pthread_once_t objCacheKeyOnce = PTHREAD_ONCE_INIT;
+
+/**
+ * Moves up to {@link num} objects from the head of {@link cache} to the depot of class {@link cls}
+ */
+static void drainCache(ObjCache_t *cache, unsigned int cls, unsigned int num) {
+	ObjHeader_t *first = cache->head, *last = cache->head;
+	unsigned int moved = 1;
+
+	if (first == NULL || num == 0) {
+		return;
+	}
+	while (moved < num && last->next != NULL) {
+		last = last->next;
+		moved++;
+	}
+	cache->head = last->next;
+	cache->count -= moved;
+
+	pthread_mutex_lock(&objDepots[cls].lock);
+	last->next = objDepots[cls].head;
+	objDepots[cls].head = first;
+	objDepots[cls].count += moved;
+	pthread_mutex_unlock(&objDepots[cls].lock);
+}
+
+static void releaseCaches(void *data) {
+	ObjCache_t *caches = (ObjCache_t*)data;
+	unsigned int i = 0;
+
+	for (i = 0; i < OBJ_POOL_CLASSES; i++) {
+		drainCache(&caches[i],i,caches[i].count);
+	}
+}
+
+static void createCacheKey(void) {
+	if (pthread_key_create(&objCacheKey,releaseCaches) != 0) {
+		ERR_MSG("Cannot create the object cache key\n");
+	}
+}
+
+/**
+ * Allocates a new slab and puts all its objects to {@link cache}
+ */
+static int growCache(ObjCache_t *cache, unsigned int cls) {
+	ObjSlab_t *slab = NULL;
+	ObjHeader_t *obj = NULL;
+	unsigned int i = 0, size = OBJ_POOL_MIN_SIZE << cls;
+
+	slab = ALLOC(sizeof(ObjSlab_t) + OBJ_POOL_SLAB_OBJECTS * size);
+	if (slab == NULL) {
+		return -ENOMEMORY;
+	}
+	pthread_mutex_lock(&objSlabLock);
+	slab->next = objSlabs;
+	objSlabs = slab;
+	objPoolGrown[cls]++;
+	pthread_mutex_unlock(&objSlabLock);
+	for (i = 0; i < OBJ_POOL_SLAB_OBJECTS; i++) {
+		obj = (ObjHeader_t*)((char*)(slab + 1) + i * size);
+		obj->next = cache->head;
+		cache->head = obj;
+	}
+	cache->count += OBJ_POOL_SLAB_OBJECTS;
+
+	return 0;
+}
+
+/**
+ * Makes sure the cached objects of the calling thread are not lost, once it terminates
+ */
+static void registerCaches(void) {
+	pthread_once(&objCacheKeyOnce,createCacheKey);
+	pthread_setspecific(objCacheKey,objCaches);
+	objCacheRegistered = 1;
+}
+
+/**
+ * Fetches a batch of objects from the depot. Only if it is empty, a new slab will be allocated.
+ */
+static int refillCache(ObjCache_t *cache, unsigned int cls) {
+	ObjDepot_t *depot = &objDepots[cls];
+	ObjHeader_t *obj = NULL;
+
+	if (objCacheRegistered == 0) {
+		registerCaches();
+	}
+	pthread_mutex_lock(&depot->lock);
+	while (depot->head != NULL && cache->count < OBJ_POOL_BATCH) {
+		obj = depot->head;
+		depot->head = obj->next;
+		depot->count--;
+		obj->next = cache->head;
+		cache->head = obj;
+		cache->count++;
+	}
+	pthread_mutex_unlock(&depot->lock);
+	if (cache->head != NULL) {
+		return 0;
+	}
+	return growCache(cache,cls);
+}
+
+/**
+ * Userspace does not need any setup. The pools are ready to use right from the start.
+ */
+int initObjPools(void) {
+	return 0;
+}
+
+/**
+ * The slabs are kept until the process terminates. An executor might still free its objects.
+ */
+void destroyObjPools(void) {
+
+}
+
+void* allocObject(unsigned int size) {
+	ObjCache_t *cache = NULL;
+	ObjHeader_t *header = NULL;
+	unsigned int cls = sizeToClass(size);
+
+	if (cls == OBJ_POOL_LARGE) {
+		return allocLarge(size);
+	}
+	cache = &objCaches[cls];
+	if (cache->head == NULL && refillCache(cache,cls) < 0) {
+		return NULL;
+	}
+	header = cache->head;
+	cache->head = header->next;
+	cache->count--;
+	header->cls = cls;
+	return header + 1;
+}
+
+void freeObject(void *ptr) {
+	ObjCache_t *cache = NULL;
+	ObjHeader_t *header = (ObjHeader_t*)ptr - 1;
+	unsigned int cls = 0;
+
+	if (ptr == NULL) {
+		return;
+	}
+	cls = header->cls;
+	if (cls == OBJ_POOL_LARGE) {
+		FREE(header);
+		return;
+	}
+	if (objCacheRegistered == 0) {
+		registerCaches();
+	}
+	cache = &objCaches[cls];
+	header->next = cache->head;
+	cache->head = header;
+	cache->count++;
+	if (cache->count > OBJ_POOL_CACHE_MAX) {
+		// Objects freed by a consumer thread have to get back to the producers
+		drainCache(cache,cls,OBJ_POOL_BATCH);
+	}
+}
+#endif
+
+/**
+ * Resizes the object {@link ptr} points to. The contents will be moved to a new object, if it does not fit its class any longer.
+ */
+void* reallocObject(void *ptr, unsigned int size) {
+	ObjHeader_t *header = (ObjHeader_t*)ptr - 1;
+	unsigned int oldSize = 0;
+	void *ret = NULL;
+
+	if (ptr == NULL) {
+		return allocObject(size);
+	}
+	if (header->cls == OBJ_POOL_LARGE) {
+		oldSize = header->size;
+	} else {
+		oldSize = (OBJ_POOL_MIN_SIZE << header->cls) - sizeof(ObjHeader_t);
+	}
+	if (size <= oldSize) {
+		return ptr;
+	}
+	ret = allocObject(size);
+	if (ret == NULL) {
+		return NULL;
+	}
+	memcpy(ret,ptr,oldSize);
+	freeObject(ptr);
+
+	return ret;
+}
+#ifdef __KERNEL__
+EXPORT_SYMBOL(reallocObject);
+#endif
+
+void getObjPoolStats(ObjPoolStats_t *stats) {
+	int i = 0;
+
+	for (i = 0; i < OBJ_POOL_CLASSES; i++) {
+		stats->grown[i] = objPoolGrown[i];
+	}
+	stats->large = objPoolLarge;
+}
+#ifdef __KERNEL__
+EXPORT_SYMBOL(getObjPoolStats);
+#endif
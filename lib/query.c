@@ -6,6 +6,49 @@
 #include <communication.h>
 
 extern unsigned int *globalQueryID;
+/**
+ * All queries registered on this layer hashed by their id. The chains are linked by Query_t->hashNext.
+ * Like the registries of the nodes, it is modified while holding the slcLock as a writer and read without any lock.
+ */
+#define QUERY_HASH_SIZE		256
+static Query_t *queryHash[QUERY_HASH_SIZE];
+
+static inline unsigned int hashQueryID(unsigned short id) {
+	return (id ^ (id >> 8)) & (QUERY_HASH_SIZE - 1);
+}
+
+/**
+ * Adds {@link query} to the query id hash. Its id has to be assigned before.
+ * The caller has to hold the slcLock as a writer.
+ */
+void hashQuery(Query_t *query) {
+	unsigned int bucket = hashQueryID(query->queryID);
+
+	query->hashNext = queryHash[bucket];
+	STORE_RELEASE(&queryHash[bucket],query);
+}
+#ifdef __KERNEL__
+EXPORT_SYMBOL(hashQuery);
+#endif
+/**
+ * Removes {@link query} from the query id hash. Afterwards resolveQuery() does not find it anymore.
+ * A reader might still stand on {@link query}. Hence, its hashNext is left untouched.
+ * The caller has to hold the slcLock as a writer.
+ */
+void unhashQuery(Query_t *query) {
+	Query_t **cur = &queryHash[hashQueryID(query->queryID)];
+
+	while (*cur != NULL) {
+		if (*cur == query) {
+			STORE_RELEASE(cur,query->hashNext);
+			return;
+		}
+		cur = &(*cur)->hashNext;
+	}
+}
+#ifdef __KERNEL__
+EXPORT_SYMBOL(unhashQuery);
+#endif
 
 /**
  * Applies a certain {@link predicate} to a {@link tupleStream} and a second tuple {@link tupleJoin}.
@@ -181,8 +224,2024 @@ static int applyPredicate(DataModelElement_t *rootDM, Predicate_t *predicate, Tu
 			break;
 	}
 
-	return 0;
+	return 0;
+}
+/**
+ * The maximum number of item names a stream operand can be resolved with. Each one is a prefix of the operands path,
+ * e.g. "net.packetType" and "net.packetType.macHdr" for the path "net.packetType.macHdr.source".
+ */
+#define MAX_OPERAND_PREFIXES					8
+
+typedef int (*CompareFunction_t)(void *left, void *right);
+
+/**
+ * A predicate operand lowered by compileOperand(). Constants are parsed once. For a stream operand
+ * all item names which are a valid prefix of its path are stored alongside the offset of the member
+ * relative to the items value. Hence, locating its value inside a tuple does not touch the datamodel anymore.
+ */
+typedef struct CompiledOperand {
+	unsigned short type;						// OP_STREAM, OP_POD or OP_JOIN
+	char *path;									// Points to the operands value within the predicate
+	int pathLen;
+	int numPrefixes;
+	struct {
+		int len;								// The length of an item name which is a prefix of path
+		int offset;								// The offset of the member relative to the items value
+	} prefixes[MAX_OPERAND_PREFIXES];
+	union {
+		int intValue;
+		char byteValue;
+		#ifndef __KERNEL__
+		double floatValue;
+		#endif
+		PTR_TYPE stringValue;					// Stored the same way a STRING is stored inside a tuple
+	} constant;
+} CompiledOperand_t;
+
+/**
+ * A predicate lowered by compilePredicate(). If {@link result} is not -1, the outcome of the
+ * predicate does not depend on a tuple at all. Otherwise, {@link compare} gets called with the
+ * resolved values of both operands.
+ */
+typedef struct CompiledPredicate {
+	int result;
+	CompareFunction_t compare;
+	CompiledOperand_t left;
+	CompiledOperand_t right;
+} CompiledPredicate_t;
+
+#define DEFINE_COMPARATORS(typeName,cType) \
+	static int compare##typeName##Equal(void *left, void *right) { return *(cType*)left == *(cType*)right; } \
+	static int compare##typeName##Neq(void *left, void *right) { return *(cType*)left != *(cType*)right; } \
+	static int compare##typeName##Le(void *left, void *right) { return *(cType*)left < *(cType*)right; } \
+	static int compare##typeName##Leq(void *left, void *right) { return *(cType*)left <= *(cType*)right; } \
+	static int compare##typeName##Ge(void *left, void *right) { return *(cType*)left > *(cType*)right; } \
+	static int compare##typeName##Geq(void *left, void *right) { return *(cType*)left >= *(cType*)right; } \
+	static CompareFunction_t compare##typeName[PREDICATETYPE_END] = { \
+		compare##typeName##Equal, compare##typeName##Neq, compare##typeName##Le, \
+		compare##typeName##Leq, compare##typeName##Ge, compare##typeName##Geq };
+
+DEFINE_COMPARATORS(Int,int)
+DEFINE_COMPARATORS(Byte,char)
+#ifndef __KERNEL__
+// It is not easy to compare a double inside the kernel. A predicate on a FLOAT is compiled to a constant 0 there.
+DEFINE_COMPARATORS(Float,double)
+#endif
+
+static int compareStringEqual(void *left, void *right) {
+	return strcmp((char*)*(PTR_TYPE*)left,(char*)*(PTR_TYPE*)right) == 0;
+}
+
+static int compareStringNeq(void *left, void *right) {
+	return strcmp((char*)*(PTR_TYPE*)left,(char*)*(PTR_TYPE*)right) != 0;
+}
+
+/**
+ * Resolves the element {@link path} of a stream or join operand against the datamodel. For each prefix of the path
+ * naming a node, the member offset is calculated by initMemberAccessor(). The last prefix found determines the type.
+ * @param rootDM a pointer to the slc datamodel
+ * @param path the path of the element, e.g. the value of an operand. It has to stay valid as long as {@link compiled} is used.
+ * @param compiled a pointer to the compiled operand
+ * @return the type of the operand or -1, if it cannot be resolved at all
+ */
+static int compileStreamOperand(DataModelElement_t *rootDM, char *path, CompiledOperand_t *compiled) {
+	MemberAccessor_t accessor;
+	DECLARE_BUFFER(itemName)
+	int len = 0, type = -1;
+
+	compiled->path = path;
+	compiled->pathLen = strlen(path);
+	compiled->numPrefixes = 0;
+	for (len = 1; len <= compiled->pathLen && compiled->numPrefixes < MAX_OPERAND_PREFIXES; len++) {
+		if (path[len] != '.' && path[len] != '\0') {
+			continue;
+		}
+		memcpy(itemName,path,len);
+		itemName[len] = '\0';
+		if (initMemberAccessor(rootDM,&accessor,0,itemName,path) < 0) {
+			continue;
+		}
+		compiled->prefixes[compiled->numPrefixes].len = len;
+		compiled->prefixes[compiled->numPrefixes].offset = accessor.offset;
+		compiled->numPrefixes++;
+		type = accessor.type;
+	}
+
+	return type;
+}
+
+/**
+ * Parses the constant stored in {@link operand} according to {@link type}.
+ * @param operand a pointer to the POD operand
+ * @param compiled a pointer to the compiled operand
+ * @param type the type of the other operand
+ * @return 0 on success. -EPARAM, if the string cannot be converted.
+ */
+static int compileConstOperand(Operand_t *operand, CompiledOperand_t *compiled, int type) {
+	char *value = (char*)&operand->value;
+
+	switch (type) {
+		case STRING:
+			compiled->constant.stringValue = (PTR_TYPE)value;
+			break;
+
+		case INT:
+			#ifdef __KERNEL__
+			if (STRTOINT(value,compiled->constant.intValue) < 0) {
+				return -EPARAM;
+			}
+			#else
+			STRTOINT(value,compiled->constant.intValue);
+			#endif
+			break;
+
+		case BYTE:
+			#ifdef __KERNEL__
+			if (STRTOCHAR(value,compiled->constant.byteValue) < 0) {
+				return -EPARAM;
+			}
+			#else
+			STRTOCHAR(value,compiled->constant.byteValue);
+			#endif
+			break;
+
+		#ifndef __KERNEL__
+		case FLOAT:
+			compiled->constant.floatValue = atof(value);
+			break;
+		#endif
+
+		default:
+			return -EPARAM;
+	}
+
+	return 0;
+}
+
+/**
+ * Lowers {@link predicate} into {@link compiled}. It follows the same rules as applyPredicate(), but
+ * does everything independent of a tuple exactly once: resolving the operand types, parsing the constants
+ * and choosing a type-specific comparator.
+ * @param rootDM a pointer to the slc datamodel
+ * @param predicate the predicate which should be compiled
+ * @param compiled a pointer to the compiled predicate
+ */
+static void compilePredicate(DataModelElement_t *rootDM, Predicate_t *predicate, CompiledPredicate_t *compiled) {
+	int type = -1, typeLeft = -1, typeRight = -1;
+
+	memset(compiled,0,sizeof(CompiledPredicate_t));
+	compiled->result = 0;
+	if (TEST_BIT(predicate->flags,PRED_SELEC)) {
+		compiled->result = 1;
+		return;
+	}
+	if (predicate->type >= PREDICATETYPE_END || predicate->left.type >= OPERANDTYPE_END || predicate->right.type >= OPERANDTYPE_END) {
+		return;
+	}
+	compiled->left.type = predicate->left.type;
+	compiled->right.type = predicate->right.type;
+	if (predicate->left.type != OP_POD) {
+		typeLeft = compileStreamOperand(rootDM,(char*)&predicate->left.value,&compiled->left);
+		if (typeLeft == -1) {
+			return;
+		}
+	}
+	if (predicate->right.type != OP_POD) {
+		typeRight = compileStreamOperand(rootDM,(char*)&predicate->right.value,&compiled->right);
+		if (typeRight == -1) {
+			return;
+		}
+	}
+
+	type = (typeLeft == -1 ? typeRight : typeLeft);
+	if (type == -1) {
+		// Two constants. The result will never change.
+		if (predicate->type == EQUAL) {
+			compiled->result = memcmp(&predicate->left.value,&predicate->right.value,MAX_NAME_LEN) == 0;
+		} else if (predicate->type == NEQ) {
+			compiled->result = memcmp(&predicate->left.value,&predicate->right.value,MAX_NAME_LEN) != 0;
+		}
+		return;
+	}
+	// For now, comparison of arrays is forbidden
+	if (type & ARRAY) {
+		return;
+	}
+	if (predicate->left.type == OP_POD && compileConstOperand(&predicate->left,&compiled->left,type) < 0) {
+		return;
+	}
+	if (predicate->right.type == OP_POD && compileConstOperand(&predicate->right,&compiled->right,type) < 0) {
+		return;
+	}
+
+	switch (type) {
+		case STRING:
+			if (predicate->type == EQUAL) {
+				compiled->compare = compareStringEqual;
+			} else if (predicate->type == NEQ) {
+				compiled->compare = compareStringNeq;
+			}
+			break;
+
+		case INT:
+			compiled->compare = compareInt[predicate->type];
+			break;
+
+		case BYTE:
+			compiled->compare = compareByte[predicate->type];
+			break;
+
+		#ifndef __KERNEL__
+		case FLOAT:
+			compiled->compare = compareFloat[predicate->type];
+			break;
+		#endif
+	}
+	if (compiled->compare != NULL) {
+		compiled->result = -1;
+	}
+}
+
+/**
+ * Locates the value of {@link operand} inside the tuple it refers to. An item whose name equals the
+ * operands path wins. Otherwise, the last item whose name is a resolved prefix of it is taken. This matches the way getMemberPointer() works.
+ * @param operand a pointer to the compiled operand
+ * @param tupleStream a pointer to the tuple of the stream
+ * @param tupleJoin a pointer to the tuple which should be joined. Might be NULL.
+ * @return a pointer to the value or NULL, if no suitable item exists
+ */
+static inline void* resolveCompiledOperand(CompiledOperand_t *operand, Tupel_t *tupleStream, Tupel_t *tupleJoin) {
+	Tupel_t *tuple = (operand->type == OP_STREAM ? tupleStream : tupleJoin);
+	Item_t *item = NULL;
+	void *value = NULL;
+	int i = 0, j = 0, len = 0;
+
+	if (operand->type == OP_POD) {
+		return &operand->constant;
+	}
+	if (tuple == NULL) {
+		return NULL;
+	}
+	for (i = 0; i < tuple->itemLen; i++) {
+		item = tuple->items[i];
+		if (item == NULL) {
+			continue;
+		}
+		for (j = 0; j < operand->numPrefixes; j++) {
+			len = operand->prefixes[j].len;
+			if (strncmp(item->name,operand->path,len) == 0 && item->name[len] == '\0') {
+				value = item->value + operand->prefixes[j].offset;
+				if (len == operand->pathLen) {
+					return value;
+				}
+				break;
+			}
+		}
+	}
+
+	return value;
+}
+
+/**
+ * Evaluates a compiled predicate. It is the counterpart of applyPredicate().
+ * @param compiled a pointer to the compiled predicate
+ * @param tupleStream a pointer to the tuple of the stream
+ * @param tupleJoin a pointer to the tuple which should be joined. Might be NULL.
+ * @return 1 on success. 0 otherwise.
+ */
+static inline int applyCompiledPredicate(CompiledPredicate_t *compiled, Tupel_t *tupleStream, Tupel_t *tupleJoin) {
+	void *valueLeft = NULL, *valueRight = NULL;
+
+	if (compiled->result != -1) {
+		return compiled->result;
+	}
+	valueLeft = resolveCompiledOperand(&compiled->left,tupleStream,tupleJoin);
+	if (valueLeft == NULL) {
+		return 0;
+	}
+	valueRight = resolveCompiledOperand(&compiled->right,tupleStream,tupleJoin);
+	if (valueRight == NULL) {
+		return 0;
+	}
+
+	return compiled->compare(valueLeft,valueRight);
+}
+
+/**
+ * Compiles all predicates of {@link filter} and stores them at filter->compiled.
+ * The compiled predicates belong to the layer which calls this function. They are released by releaseCompiledOperators().
+ * @param rootDM a pointer to the slc datamodel
+ * @param filter a pointer to the filter operator
+ * @return 0 on success. -ENOMEMORY otherwise.
+ */
+static int compileFilter(DataModelElement_t *rootDM, Filter_t *filter) {
+	CompiledPredicate_t *compiled = NULL;
+	int i = 0;
+
+	compiled = ALLOC(sizeof(CompiledPredicate_t) * filter->predicateLen);
+	if (compiled == NULL) {
+		filter->compiled = NULL;
+		return -ENOMEMORY;
+	}
+	for (i = 0; i < filter->predicateLen; i++) {
+		compilePredicate(rootDM,filter->predicates[i],&compiled[i]);
+	}
+	filter->compiled = compiled;
+
+	return 0;
+}
+
+/**
+ * The maximum number of panes a window can be split into. See initWindow().
+ */
+#define MAX_WINDOW_PANES						4096
+
+/**
+ * Gets called by a window each time a pane ends. If {@link windowEnd} is not zero, the pane completes a window
+ * and the operator should emit its result. Afterwards, the operator has to reset the pane which follows the current one.
+ */
+typedef void (*PaneEndFunction_t)(void *context, int windowEnd, unsigned long long timestamp);
+
+/**
+ * A window of size {@link size} which moves forward by {@link advance}. Both are measured in tuples (EVENTS) or
+ * microseconds, the unit of Tupel_t.timestamp. A window is split into panes of equal length, which is the greatest common
+ * divisor of its size and its advance. Each tuple is accounted to the current pane only. Whenever a pane ends at a multiple
+ * of advance, the last numPanes panes make up one window. Hence, an operator does a constant amount of work per tuple and
+ * combines numPanes panes at a window boundary. If size equals advance, the window is a tumbling one and numPanes is 1.
+ * Time-based windows are aligned to multiples of their advance. A window ends with the first tuple behind it or,
+ * if the stream went quiet, once flushQueryWindows() finds it expired.
+ */
+typedef struct Window {
+	int timeBased;
+	unsigned long long paneLen;
+	unsigned int numPanes;						// size / paneLen
+	unsigned int panesPerAdvance;				// advance / paneLen
+	unsigned int curSlot;						// The slot of the current pane. It is in [0,numPanes).
+	unsigned long long paneNumber;				// The absolute number of the current pane
+	unsigned long long paneEnd;					// Time-based windows only: the end of the current pane
+	unsigned long long paneEvents;				// Event-based windows only: the number of tuples accounted to the current pane
+	unsigned long long lastTimestamp;			// Time-based windows only: the timestamp of the latest tuple
+	unsigned long long lastArrival;				// Time-based windows only: getTimeNS() upon the arrival of the latest tuple
+	int started;
+} Window_t;
+
+/**
+ * The number of time-based windows on this layer. flushExpiredWindows() does not look for expired ones, as long as it is zero.
+ */
+static int timeWindows = 0;
+/**
+ * The time of the next call to flushQueryWindows() by flushExpiredWindows() in ns. See getTimeNS().
+ */
+static unsigned long long nextWindowFlush = 0;
+
+static unsigned long long gcd64(unsigned long long a, unsigned long long b) {
+	unsigned long long temp = 0;
+
+	while (b != 0) {
+		temp = a - DIV_U64(a,b) * b;
+		a = b;
+		b = temp;
+	}
+	return a;
+}
+
+static unsigned long long unitToBase(unsigned short unit, unsigned int value) {
+	switch (unit) {
+		case TIME_MS:
+			return (unsigned long long)value * USEC_PER_MSEC;
+
+		case TIME_SEC:
+			return (unsigned long long)value * USEC_PER_SEC;
+	}
+	return value;
+}
+
+/**
+ * Initializes {@link window}. The caller has to reset all numPanes panes.
+ * @param window a pointer to the window
+ * @return 0 on success. -EUNIT, if the units cannot be mixed. -ESIZE, if the window needs too many panes.
+ */
+static int initWindow(Window_t *window, unsigned short sizeUnit, unsigned int size, unsigned short advanceUnit, unsigned int advance) {
+	unsigned long long sizeBase = 0, advanceBase = 0;
+
+	if (sizeUnit >= SIZEUNIT_END || advanceUnit >= SIZEUNIT_END || (sizeUnit == EVENTS) != (advanceUnit == EVENTS)) {
+		return -EUNIT;
+	}
+	if (size == 0 || advance == 0) {
+		return -ESIZE;
+	}
+	sizeBase = unitToBase(sizeUnit,size);
+	advanceBase = unitToBase(advanceUnit,advance);
+	memset(window,0,sizeof(Window_t));
+	window->timeBased = (sizeUnit != EVENTS);
+	window->paneLen = gcd64(sizeBase,advanceBase);
+	if (DIV_U64(sizeBase,window->paneLen) > MAX_WINDOW_PANES || DIV_U64(advanceBase,window->paneLen) > MAX_WINDOW_PANES) {
+		return -ESIZE;
+	}
+	window->numPanes = DIV_U64(sizeBase,window->paneLen);
+	window->panesPerAdvance = DIV_U64(advanceBase,window->paneLen);
+
+	return 0;
+}
+
+/**
+ * Accounts a window, whose state was created. It has to be released by releaseWindow().
+ */
+static inline void holdWindow(Window_t *window) {
+	if (window->timeBased) {
+		__sync_fetch_and_add(&timeWindows,1);
+	}
+}
+
+static inline void releaseWindow(Window_t *window) {
+	if (window->timeBased) {
+		__sync_fetch_and_sub(&timeWindows,1);
+	}
+}
+
+static void closePane(Window_t *window, unsigned long long timestamp, PaneEndFunction_t paneEnd, void *context) {
+	unsigned long long panes = window->paneNumber + 1;
+	int windowEnd = 0;
+
+	windowEnd = panes >= window->numPanes && panes - DIV_U64(panes,window->panesPerAdvance) * window->panesPerAdvance == 0;
+	paneEnd(context,windowEnd,timestamp);
+	window->paneNumber++;
+	window->curSlot = (window->curSlot + 1) % window->numPanes;
+	window->paneEvents = 0;
+	window->paneEnd += window->paneLen;
+}
+
+/**
+ * Closes all panes of a time-based window ending at or before {@link time}.
+ */
+static void closePanesBefore(Window_t *window, unsigned long long time, PaneEndFunction_t paneEnd, void *context) {
+	unsigned int closed = 0;
+
+	for (closed = 0; time >= window->paneEnd; closed++) {
+		if (closed == window->numPanes) {
+			// Every pane is empty by now. So is each window ending before time. Skip them.
+			window->paneNumber = DIV_U64(time,window->paneLen);
+			window->paneEnd = (window->paneNumber + 1) * window->paneLen;
+			break;
+		}
+		closePane(window,window->paneEnd,paneEnd,context);
+	}
+}
+
+/**
+ * Has to be called before {@link tuple} is accounted to the current pane, i.e. window->curSlot.
+ * A time-based window closes all panes ending before the tuples timestamp.
+ */
+static void windowBeforeTuple(Window_t *window, Tupel_t *tuple, PaneEndFunction_t paneEnd, void *context) {
+	if (!window->timeBased) {
+		return;
+	}
+	window->lastArrival = getTimeNS();
+	if (!window->started) {
+		window->paneNumber = DIV_U64(tuple->timestamp,window->paneLen);
+		window->paneEnd = (window->paneNumber + 1) * window->paneLen;
+		window->lastTimestamp = tuple->timestamp;
+		window->started = 1;
+		return;
+	}
+	if (tuple->timestamp > window->lastTimestamp) {
+		window->lastTimestamp = tuple->timestamp;
+	}
+	closePanesBefore(window,tuple->timestamp,paneEnd,context);
+}
+
+/**
+ * Closes the panes of a time-based window, which ended by now, although no tuple arrived behind them.
+ * The time of the stream is estimated by the timestamp of its latest tuple plus the time passed since its arrival.
+ * A tuple arriving later on with an older timestamp is accounted to the current pane.
+ */
+static void windowFlush(Window_t *window, PaneEndFunction_t paneEnd, void *context) {
+	if (!window->timeBased || !window->started) {
+		return;
+	}
+	closePanesBefore(window,window->lastTimestamp + DIV_U64(getTimeNS() - window->lastArrival,NSEC_PER_USEC),paneEnd,context);
+}
+
+/**
+ * Has to be called after a tuple was accounted to the current pane. An event-based window closes the pane if it is full.
+ * {@link timestamp} is the one of the tuple.
+ */
+static void windowAfterTuple(Window_t *window, unsigned long long timestamp, PaneEndFunction_t paneEnd, void *context) {
+	if (window->timeBased) {
+		return;
+	}
+	window->paneEvents++;
+	if (window->paneEvents >= window->paneLen) {
+		closePane(window,timestamp,paneEnd,context);
+	}
+}
+
+static void appendTuple(Tupel_t **headTuple, Tupel_t *tuple) {
+	while (*headTuple != NULL) {
+		headTuple = &(*headTuple)->next;
+	}
+	*headTuple = tuple;
+}
+
+/**
+ * The accumulator of one element within one pane. Integers and floats are accumulated side by side. Only the one
+ * matching the elements type is used later on.
+ */
+typedef struct AggregateValue {
+	unsigned int count;
+	long long intValue;
+	#ifndef __KERNEL__
+	double floatValue;
+	#endif
+} AggregateValue_t;
+
+/**
+ * The layer-specific state of a MIN, MAX or AVG operator. It holds numPanes * numElements accumulators.
+ */
+typedef struct AggregateState {
+	DECLARE_OPERATOR_LOCK(lock);
+	Window_t window;
+	int numElements;
+	AggregateValue_t *values;
+	CompiledOperand_t *elements;
+	int *types;
+} AggregateState_t;
+
+typedef struct AggregateContext {
+	DataModelElement_t *rootDM;
+	Aggregate_t *aggregate;
+	AggregateState_t *state;
+	Tupel_t *headTuple;
+} AggregateContext_t;
+
+static inline void mergeAggregateValue(unsigned short opType, AggregateValue_t *dst, AggregateValue_t *src) {
+	if (src->count == 0) {
+		return;
+	}
+	if (dst->count == 0) {
+		*dst = *src;
+		return;
+	}
+	switch (opType) {
+		case MIN:
+			if (src->intValue < dst->intValue) {
+				dst->intValue = src->intValue;
+			}
+			#ifndef __KERNEL__
+			if (src->floatValue < dst->floatValue) {
+				dst->floatValue = src->floatValue;
+			}
+			#endif
+			break;
+
+		case MAX:
+			if (src->intValue > dst->intValue) {
+				dst->intValue = src->intValue;
+			}
+			#ifndef __KERNEL__
+			if (src->floatValue > dst->floatValue) {
+				dst->floatValue = src->floatValue;
+			}
+			#endif
+			break;
+
+		case AVG:
+			dst->intValue += src->intValue;
+			#ifndef __KERNEL__
+			dst->floatValue += src->floatValue;
+			#endif
+			break;
+	}
+	dst->count += src->count;
+}
+
+/**
+ * Initializes {@link current} with the single value stored at {@link value}.
+ */
+static inline void loadAggregateValue(int type, void *value, AggregateValue_t *current) {
+	memset(current,0,sizeof(AggregateValue_t));
+	current->count = 1;
+	switch (type) {
+		case INT:
+			current->intValue = *(int*)value;
+			break;
+
+		case BYTE:
+			current->intValue = *(char*)value;
+			break;
+
+		#ifndef __KERNEL__
+		case FLOAT:
+			current->floatValue = *(double*)value;
+			break;
+		#endif
+	}
+}
+
+/**
+ * Stores the final value of the accumulator {@link result} at {@link value}, e.g. the value of an item.
+ */
+static inline void storeAggregateValue(unsigned short opType, int type, AggregateValue_t *result, void *value) {
+	switch (type) {
+		case INT:
+			*(int*)value = (opType == AVG ? DIV_S64(result->intValue,result->count) : result->intValue);
+			break;
+
+		case BYTE:
+			*(char*)value = (opType == AVG ? DIV_S64(result->intValue,result->count) : result->intValue);
+			break;
+
+		#ifndef __KERNEL__
+		case FLOAT:
+			*(double*)value = (opType == AVG ? result->floatValue / result->count : result->floatValue);
+			break;
+		#endif
+	}
+}
+
+/**
+ * Compiles the aggregated elements of {@link aggregate}. Each element has to be an INT, a BYTE or, outside the kernel, a FLOAT.
+ * @return 0 on success. -ENOTCOMPARABLE, if an element cannot be aggregated.
+ */
+static int compileAggregateElements(DataModelElement_t *rootDM, Aggregate_t *aggregate, CompiledOperand_t *elements, int *types) {
+	int i = 0;
+
+	for (i = 0; i < aggregate->elementsLen; i++) {
+		elements[i].type = OP_STREAM;
+		types[i] = compileStreamOperand(rootDM,aggregate->elements[i]->name,&elements[i]);
+		switch (types[i]) {
+			case INT:
+			case BYTE:
+			#ifndef __KERNEL__
+			case FLOAT:
+			#endif
+				break;
+
+			default:
+				return -ENOTCOMPARABLE;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Creates the state of {@link aggregate}: its window and the compiled elements. Each element has to be an INT, a BYTE or,
+ * outside the kernel, a FLOAT.
+ * @param rootDM a pointer to the slc datamodel
+ * @param aggregate a pointer to the MIN, MAX or AVG operator
+ * @return 0 on success. A value below zero otherwise.
+ */
+static int initAggregateState(DataModelElement_t *rootDM, Aggregate_t *aggregate) {
+	AggregateState_t *state = NULL;
+	Window_t window;
+	int ret = 0, numValues = 0;
+
+	aggregate->state = NULL;
+	ret = initWindow(&window,aggregate->sizeUnit,aggregate->size,aggregate->advanceUnit,aggregate->advance);
+	if (ret < 0) {
+		return ret;
+	}
+	numValues = window.numPanes * aggregate->elementsLen;
+	state = ALLOC(sizeof(AggregateState_t) + numValues * sizeof(AggregateValue_t) + aggregate->elementsLen * (sizeof(CompiledOperand_t) + sizeof(int)));
+	if (state == NULL) {
+		return -ENOMEMORY;
+	}
+	state->window = window;
+	state->numElements = aggregate->elementsLen;
+	state->values = (AggregateValue_t*)(state + 1);
+	state->elements = (CompiledOperand_t*)(state->values + numValues);
+	state->types = (int*)(state->elements + state->numElements);
+	memset(state->values,0,numValues * sizeof(AggregateValue_t));
+	ret = compileAggregateElements(rootDM,aggregate,state->elements,state->types);
+	if (ret < 0) {
+		FREE(state);
+		return ret;
+	}
+	INIT_OPERATOR_LOCK(state->lock);
+	holdWindow(&state->window);
+	aggregate->state = state;
+
+	return 0;
+}
+
+static void freeAggregateState(Aggregate_t *aggregate) {
+	AggregateState_t *state = (AggregateState_t*)aggregate->state;
+
+	if (state == NULL) {
+		return;
+	}
+	releaseWindow(&state->window);
+	DESTROY_OPERATOR_LOCK(state->lock);
+	FREE(state);
+	aggregate->state = NULL;
+}
+
+/**
+ * Emits the result of a window, if it is complete. Resets the pane following the current one.
+ */
+static void aggregatePaneEnd(void *context, int windowEnd, unsigned long long timestamp) {
+	AggregateContext_t *ctx = (AggregateContext_t*)context;
+	AggregateState_t *state = ctx->state;
+	AggregateValue_t *result = NULL;
+	Tupel_t *tuple = NULL;
+	unsigned short opType = ctx->aggregate->op_type;
+	unsigned int slot = 0, nextSlot = (state->window.curSlot + 1) % state->window.numPanes;
+	int i = 0, empty = 1;
+
+	if (windowEnd) {
+		// The accumulators of the pane following the current one are reset anyway. Reuse them for the result.
+		result = &state->values[nextSlot * state->numElements];
+		for (slot = (nextSlot + 1) % state->window.numPanes; slot != nextSlot; slot = (slot + 1) % state->window.numPanes) {
+			for (i = 0; i < state->numElements; i++) {
+				mergeAggregateValue(opType,&result[i],&state->values[slot * state->numElements + i]);
+			}
+		}
+		for (i = 0; i < state->numElements; i++) {
+			if (result[i].count > 0) {
+				empty = 0;
+				break;
+			}
+		}
+		if (!empty) {
+			tuple = initTupel(timestamp,state->numElements);
+		}
+		for (i = 0; tuple != NULL && i < state->numElements; i++) {
+			if (result[i].count == 0 || allocItem(ctx->rootDM,tuple,i,ctx->aggregate->elements[i]->name) < 0) {
+				continue;
+			}
+			storeAggregateValue(opType,state->types[i],&result[i],tuple->items[i]->value);
+		}
+		if (tuple != NULL) {
+			appendTuple(&ctx->headTuple,tuple);
+		}
+	}
+	memset(&state->values[nextSlot * state->numElements],0,state->numElements * sizeof(AggregateValue_t));
+}
+
+/**
+ * Accounts each tuple in the list {@link headTuple} to the window of {@link aggregate} and frees it.
+ * Afterwards, {@link headTuple} points to the results of all windows ending in the meantime. It might be NULL.
+ * If the operator has no state, e.g. because executeQuery() got called directly, the tuples are passed through untouched.
+ * @param rootDM a pointer to the slc datamodel
+ * @param aggregate a pointer to the MIN, MAX or AVG operator
+ * @param headTuple a pointer to the head of the tuple list
+ */
+static void applyAggregate(DataModelElement_t *rootDM, Aggregate_t *aggregate, Tupel_t **headTuple) {
+	AggregateState_t *state = (AggregateState_t*)aggregate->state;
+	AggregateContext_t context;
+	AggregateValue_t current, *values = NULL;
+	Tupel_t *curTuple = NULL, *nextTuple = NULL;
+	void *value = NULL;
+	int i = 0;
+	#ifdef __KERNEL__
+	unsigned long flags;
+	#endif
+
+	if (state == NULL) {
+		DEBUG_MSG(2,"%s: No state for aggregate 0x%x. Passing tuples through.\n",__FUNCTION__,aggregate->op_type);
+		return;
+	}
+	context.rootDM = rootDM;
+	context.aggregate = aggregate;
+	context.state = state;
+	context.headTuple = NULL;
+
+	ACQUIRE_OPERATOR_LOCK(state->lock);
+	for (curTuple = *headTuple; curTuple != NULL; curTuple = curTuple->next) {
+		windowBeforeTuple(&state->window,curTuple,aggregatePaneEnd,&context);
+		values = &state->values[state->window.curSlot * state->numElements];
+		for (i = 0; i < state->numElements; i++) {
+			value = resolveCompiledOperand(&state->elements[i],curTuple,NULL);
+			if (value == NULL) {
+				continue;
+			}
+			loadAggregateValue(state->types[i],value,&current);
+			mergeAggregateValue(aggregate->op_type,&values[i],&current);
+		}
+		windowAfterTuple(&state->window,curTuple->timestamp,aggregatePaneEnd,&context);
+	}
+	RELEASE_OPERATOR_LOCK(state->lock);
+
+	for (curTuple = *headTuple; curTuple != NULL; curTuple = nextTuple) {
+		nextTuple = curTuple->next;
+		freeTupel(rootDM,curTuple);
+	}
+	*headTuple = context.headTuple;
+}
+
+/**
+ * Closes the panes of the window of {@link aggregate}, which ended by now. See windowFlush().
+ * @return the results of all windows ending in the meantime. It might be NULL.
+ */
+static Tupel_t* flushAggregate(DataModelElement_t *rootDM, Aggregate_t *aggregate) {
+	AggregateState_t *state = (AggregateState_t*)aggregate->state;
+	AggregateContext_t context;
+	#ifdef __KERNEL__
+	unsigned long flags;
+	#endif
+
+	if (state == NULL || !state->window.timeBased) {
+		return NULL;
+	}
+	context.rootDM = rootDM;
+	context.aggregate = aggregate;
+	context.state = state;
+	context.headTuple = NULL;
+
+	ACQUIRE_OPERATOR_LOCK(state->lock);
+	windowFlush(&state->window,aggregatePaneEnd,&context);
+	RELEASE_OPERATOR_LOCK(state->lock);
+
+	return context.headTuple;
+}
+
+/**
+ * The maximum number of groups a GROUP operator keeps per window. If a window contains more groups, one group is evicted:
+ * its partial result is emitted immediately and it starts over.
+ */
+#define MAX_GROUPS								256
+#define GROUP_TABLE_SIZE						(2 * MAX_GROUPS)
+/**
+ * The maximum number of grouping elements of a GROUP operator
+ */
+#define MAX_GROUP_KEYS							8
+
+/**
+ * The value of one grouping element. A string is borrowed from a tuple as long as it is just looked up.
+ * It is copied as soon as it is stored within a group.
+ */
+typedef union GroupKey {
+	long long intValue;
+	#ifndef __KERNEL__
+	double floatValue;
+	#endif
+	char *stringValue;
+} GroupKey_t;
+
+/**
+ * A slot of the open-addressing hash table of a GROUP operator. Its keys and values point to storage
+ * reserved for this slot. If an entry is moved to another slot, it takes its storage along.
+ */
+typedef struct GroupEntry {
+	unsigned int hash;
+	unsigned int count;							// The number of tuples of this group. 0 marks an empty slot.
+	GroupKey_t *keys;
+	AggregateValue_t *values;
+} GroupEntry_t;
+
+/**
+ * The layer-specific state of a GROUP operator. The table is probed linearly. Since it never holds more than
+ * MAX_GROUPS entries, it is at most half full.
+ */
+typedef struct GroupState {
+	DECLARE_OPERATOR_LOCK(lock);
+	Window_t window;
+	int numKeys;
+	CompiledOperand_t *keys;
+	int *keyTypes;
+	Aggregate_t *aggregate;						// The MIN, MAX or AVG operator evaluated per group. Might be NULL.
+	int numValues;
+	CompiledOperand_t *values;
+	int *valueTypes;
+	unsigned int numGroups;
+	unsigned long long evicted;
+	GroupEntry_t *entries;
+} GroupState_t;
+
+typedef struct GroupContext {
+	DataModelElement_t *rootDM;
+	Group_t *group;
+	GroupState_t *state;
+	Tupel_t *headTuple;
+} GroupContext_t;
+
+static inline unsigned int hashBytes(unsigned int hash, const unsigned char *data, int len) {
+	int i = 0;
+
+	for (i = 0; i < len; i++) {
+		hash ^= data[i];
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
+static unsigned int hashGroupKeys(GroupState_t *state, GroupKey_t *keys) {
+	unsigned int hash = 2166136261U;
+	int i = 0;
+
+	for (i = 0; i < state->numKeys; i++) {
+		if (state->keyTypes[i] == STRING) {
+			hash = hashBytes(hash,(unsigned char*)keys[i].stringValue,strlen(keys[i].stringValue));
+		} else {
+			hash = hashBytes(hash,(unsigned char*)&keys[i],sizeof(GroupKey_t));
+		}
+	}
+	return hash;
+}
+
+static int equalGroupKeys(GroupState_t *state, GroupKey_t *left, GroupKey_t *right) {
+	int i = 0;
+
+	for (i = 0; i < state->numKeys; i++) {
+		switch (state->keyTypes[i]) {
+			case STRING:
+				if (strcmp(left[i].stringValue,right[i].stringValue) != 0) {
+					return 0;
+				}
+				break;
+
+			#ifndef __KERNEL__
+			case FLOAT:
+				if (left[i].floatValue != right[i].floatValue) {
+					return 0;
+				}
+				break;
+			#endif
+
+			default:
+				if (left[i].intValue != right[i].intValue) {
+					return 0;
+				}
+				break;
+		}
+	}
+	return 1;
+}
+
+/**
+ * Reads the values of all grouping elements from {@link tuple}.
+ * @return 0 on success. -1, if the tuple lacks at least one of them.
+ */
+static int loadGroupKeys(GroupState_t *state, Tupel_t *tuple, GroupKey_t *keys) {
+	void *value = NULL;
+	int i = 0;
+
+	for (i = 0; i < state->numKeys; i++) {
+		value = resolveCompiledOperand(&state->keys[i],tuple,NULL);
+		if (value == NULL) {
+			return -1;
+		}
+		memset(&keys[i],0,sizeof(GroupKey_t));
+		switch (state->keyTypes[i]) {
+			case INT:
+				keys[i].intValue = *(int*)value;
+				break;
+
+			case BYTE:
+				keys[i].intValue = *(char*)value;
+				break;
+
+			#ifndef __KERNEL__
+			case FLOAT:
+				keys[i].floatValue = *(double*)value;
+				break;
+			#endif
+
+			case STRING:
+				keys[i].stringValue = (char*)*(PTR_TYPE*)value;
+				if (keys[i].stringValue == NULL) {
+					return -1;
+				}
+				break;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Looks up the group identified by {@link keys}.
+ * @return the slot of the group, if it exists. Otherwise the empty slot where it has to be inserted.
+ */
+static unsigned int findGroup(GroupState_t *state, GroupKey_t *keys, unsigned int hash) {
+	unsigned int slot = hash & (GROUP_TABLE_SIZE - 1);
+
+	while (state->entries[slot].count != 0) {
+		if (state->entries[slot].hash == hash && equalGroupKeys(state,state->entries[slot].keys,keys)) {
+			break;
+		}
+		slot = (slot + 1) & (GROUP_TABLE_SIZE - 1);
+	}
+	return slot;
+}
+
+static void clearGroup(GroupState_t *state, GroupEntry_t *entry) {
+	int i = 0;
+
+	for (i = 0; i < state->numKeys; i++) {
+		if (state->keyTypes[i] == STRING && entry->keys[i].stringValue != NULL) {
+			FREE(entry->keys[i].stringValue);
+			entry->keys[i].stringValue = NULL;
+		}
+	}
+	entry->count = 0;
+}
+
+/**
+ * Removes the group at {@link slot}. Each following entry of the probe sequence which would not be found anymore is shifted back.
+ */
+static void deleteGroup(GroupState_t *state, unsigned int slot) {
+	GroupEntry_t temp;
+	unsigned int next = slot, home = 0;
+
+	clearGroup(state,&state->entries[slot]);
+	state->numGroups--;
+	for (;;) {
+		next = (next + 1) & (GROUP_TABLE_SIZE - 1);
+		if (state->entries[next].count == 0) {
+			break;
+		}
+		home = state->entries[next].hash & (GROUP_TABLE_SIZE - 1);
+		// Is home cyclically within (slot,next]? Then, the entry can stay where it is.
+		if ((slot <= next) ? (slot < home && home <= next) : (slot < home || home <= next)) {
+			continue;
+		}
+		// Swap both entries. The empty one takes the storage of the moved one.
+		temp = state->entries[slot];
+		state->entries[slot] = state->entries[next];
+		state->entries[next] = temp;
+		slot = next;
+	}
+}
+
+/**
+ * Creates a tuple holding the grouping elements and the aggregated ones of {@link entry} and appends it to the result list.
+ */
+static void emitGroup(GroupContext_t *ctx, GroupEntry_t *entry, unsigned long long timestamp) {
+	GroupState_t *state = ctx->state;
+	Tupel_t *tuple = NULL;
+	char *string = NULL;
+	void *value = NULL;
+	int i = 0;
+
+	tuple = initTupel(timestamp,state->numKeys + state->numValues);
+	if (tuple == NULL) {
+		return;
+	}
+	for (i = 0; i < state->numKeys; i++) {
+		if (allocItem(ctx->rootDM,tuple,i,ctx->group->elements[i]->name) < 0) {
+			continue;
+		}
+		value = tuple->items[i]->value;
+		switch (state->keyTypes[i]) {
+			case INT:
+				*(int*)value = entry->keys[i].intValue;
+				break;
+
+			case BYTE:
+				*(char*)value = entry->keys[i].intValue;
+				break;
+
+			#ifndef __KERNEL__
+			case FLOAT:
+				*(double*)value = entry->keys[i].floatValue;
+				break;
+			#endif
+
+			case STRING:
+				string = ALLOC(strlen(entry->keys[i].stringValue) + 1);
+				if (string != NULL) {
+					strcpy(string,entry->keys[i].stringValue);
+				}
+				*(PTR_TYPE*)value = (PTR_TYPE)string;
+				break;
+		}
+	}
+	for (i = 0; i < state->numValues; i++) {
+		if (entry->values[i].count == 0 || allocItem(ctx->rootDM,tuple,state->numKeys + i,ctx->state->aggregate->elements[i]->name) < 0) {
+			continue;
+		}
+		storeAggregateValue(state->aggregate->op_type,state->valueTypes[i],&entry->values[i],tuple->items[state->numKeys + i]->value);
+	}
+	appendTuple(&ctx->headTuple,tuple);
+}
+
+/**
+ * Inserts a new group into the table. If the table holds MAX_GROUPS groups, the one occupying the home slot of the new
+ * group, or the next one following it, is evicted.
+ * @return the slot of the new group or -1, if a string cannot be copied
+ */
+static int insertGroup(GroupContext_t *ctx, GroupKey_t *keys, unsigned int hash, unsigned long long timestamp) {
+	GroupState_t *state = ctx->state;
+	GroupEntry_t *entry = NULL;
+	unsigned int slot = 0, victim = 0;
+	int i = 0;
+
+	if (state->numGroups >= MAX_GROUPS) {
+		victim = hash & (GROUP_TABLE_SIZE - 1);
+		while (state->entries[victim].count == 0) {
+			victim = (victim + 1) & (GROUP_TABLE_SIZE - 1);
+		}
+		emitGroup(ctx,&state->entries[victim],timestamp);
+		deleteGroup(state,victim);
+		state->evicted++;
+	}
+	slot = findGroup(state,keys,hash);
+	entry = &state->entries[slot];
+	entry->hash = hash;
+	for (i = 0; i < state->numKeys; i++) {
+		entry->keys[i] = keys[i];
+		if (state->keyTypes[i] != STRING) {
+			continue;
+		}
+		entry->keys[i].stringValue = ALLOC(strlen(keys[i].stringValue) + 1);
+		if (entry->keys[i].stringValue == NULL) {
+			clearGroup(state,entry);
+			return -1;
+		}
+		strcpy(entry->keys[i].stringValue,keys[i].stringValue);
+	}
+	memset(entry->values,0,state->numValues * sizeof(AggregateValue_t));
+	state->numGroups++;
+
+	return slot;
+}
+
+/**
+ * Emits every group at the end of a window and empties the table.
+ */
+static void groupPaneEnd(void *context, int windowEnd, unsigned long long timestamp) {
+	GroupContext_t *ctx = (GroupContext_t*)context;
+	GroupState_t *state = ctx->state;
+	int i = 0;
+
+	for (i = 0; i < GROUP_TABLE_SIZE && state->numGroups > 0; i++) {
+		if (state->entries[i].count == 0) {
+			continue;
+		}
+		if (windowEnd) {
+			emitGroup(ctx,&state->entries[i],timestamp);
+		}
+		clearGroup(state,&state->entries[i]);
+		state->numGroups--;
+	}
+}
+
+/**
+ * Creates the state of {@link group}: a tumbling window, the compiled grouping elements and the hash table.
+ * If the next operator is a MIN, MAX or AVG, its elements are compiled as well. It is evaluated per group from now on.
+ * @param rootDM a pointer to the slc datamodel
+ * @param group a pointer to the GROUP operator
+ * @return 0 on success. A value below zero otherwise.
+ */
+static int initGroupState(DataModelElement_t *rootDM, Group_t *group) {
+	GroupState_t *state = NULL;
+	Aggregate_t *aggregate = NULL;
+	Window_t window;
+	int ret = 0, i = 0, numValues = 0;
+
+	group->state = NULL;
+	if (group->elementsLen > MAX_GROUP_KEYS) {
+		return -EPARAM;
+	}
+	ret = initWindow(&window,group->sizeUnit,group->size,group->sizeUnit,group->size);
+	if (ret < 0) {
+		return ret;
+	}
+	if (group->op_child != NULL && (group->op_child->type & (MIN | MAX | AVG)) != 0) {
+		aggregate = (Aggregate_t*)group->op_child;
+		numValues = aggregate->elementsLen;
+	}
+	state = ALLOC(sizeof(GroupState_t) + GROUP_TABLE_SIZE * (sizeof(GroupEntry_t) + numValues * sizeof(AggregateValue_t) + group->elementsLen * sizeof(GroupKey_t)) +
+		(group->elementsLen + numValues) * (sizeof(CompiledOperand_t) + sizeof(int)));
+	if (state == NULL) {
+		return -ENOMEMORY;
+	}
+	state->window = window;
+	state->numKeys = group->elementsLen;
+	state->aggregate = aggregate;
+	state->numValues = numValues;
+	state->numGroups = 0;
+	state->evicted = 0;
+	state->entries = (GroupEntry_t*)(state + 1);
+	state->entries[0].values = (AggregateValue_t*)(state->entries + GROUP_TABLE_SIZE);
+	state->entries[0].keys = (GroupKey_t*)(state->entries[0].values + GROUP_TABLE_SIZE * numValues);
+	state->keys = (CompiledOperand_t*)(state->entries[0].keys + GROUP_TABLE_SIZE * state->numKeys);
+	state->values = state->keys + state->numKeys;
+	state->keyTypes = (int*)(state->values + numValues);
+	state->valueTypes = state->keyTypes + state->numKeys;
+	for (i = 0; i < GROUP_TABLE_SIZE; i++) {
+		state->entries[i].count = 0;
+		state->entries[i].values = state->entries[0].values + i * numValues;
+		state->entries[i].keys = state->entries[0].keys + i * state->numKeys;
+		memset(state->entries[i].keys,0,state->numKeys * sizeof(GroupKey_t));
+	}
+	for (i = 0; i < state->numKeys; i++) {
+		state->keys[i].type = OP_STREAM;
+		state->keyTypes[i] = compileStreamOperand(rootDM,group->elements[i]->name,&state->keys[i]);
+		switch (state->keyTypes[i]) {
+			case INT:
+			case BYTE:
+			case STRING:
+			#ifndef __KERNEL__
+			case FLOAT:
+			#endif
+				break;
+
+			default:
+				FREE(state);
+				return -ENOTCOMPARABLE;
+		}
+	}
+	if (aggregate != NULL) {
+		ret = compileAggregateElements(rootDM,aggregate,state->values,state->valueTypes);
+		if (ret < 0) {
+			FREE(state);
+			return ret;
+		}
+	}
+	INIT_OPERATOR_LOCK(state->lock);
+	holdWindow(&state->window);
+	group->state = state;
+
+	return 0;
+}
+
+static void freeGroupState(Group_t *group) {
+	GroupState_t *state = (GroupState_t*)group->state;
+	int i = 0;
+
+	if (state == NULL) {
+		return;
+	}
+	for (i = 0; i < GROUP_TABLE_SIZE; i++) {
+		if (state->entries[i].count != 0) {
+			clearGroup(state,&state->entries[i]);
+		}
+	}
+	releaseWindow(&state->window);
+	DESTROY_OPERATOR_LOCK(state->lock);
+	FREE(state);
+	group->state = NULL;
+}
+
+/**
+ * Accounts each tuple in the list {@link headTuple} to its group and frees it. Tuples lacking a grouping element are dropped.
+ * Afterwards, {@link headTuple} points to the groups emitted in the meantime. It might be NULL.
+ * If the operator has no state, e.g. because executeQuery() got called directly, the tuples are passed through untouched.
+ * @param rootDM a pointer to the slc datamodel
+ * @param group a pointer to the GROUP operator
+ * @param headTuple a pointer to the head of the tuple list
+ * @return 1, if the next operator was evaluated per group and has to be skipped. 0 otherwise.
+ */
+static int applyGroup(DataModelElement_t *rootDM, Group_t *group, Tupel_t **headTuple) {
+	GroupState_t *state = (GroupState_t*)group->state;
+	GroupContext_t context;
+	GroupEntry_t *entry = NULL;
+	GroupKey_t keys[MAX_GROUP_KEYS];
+	AggregateValue_t current;
+	Tupel_t *curTuple = NULL, *nextTuple = NULL;
+	unsigned int hash = 0;
+	int slot = 0, i = 0;
+	void *value = NULL;
+	#ifdef __KERNEL__
+	unsigned long flags;
+	#endif
+
+	if (state == NULL) {
+		DEBUG_MSG(2,"%s: No state for group. Passing tuples through.\n",__FUNCTION__);
+		return 0;
+	}
+	context.rootDM = rootDM;
+	context.group = group;
+	context.state = state;
+	context.headTuple = NULL;
+
+	ACQUIRE_OPERATOR_LOCK(state->lock);
+	for (curTuple = *headTuple; curTuple != NULL; curTuple = curTuple->next) {
+		windowBeforeTuple(&state->window,curTuple,groupPaneEnd,&context);
+		if (loadGroupKeys(state,curTuple,keys) == 0) {
+			hash = hashGroupKeys(state,keys);
+			slot = findGroup(state,keys,hash);
+			if (state->entries[slot].count == 0) {
+				slot = insertGroup(&context,keys,hash,curTuple->timestamp);
+			}
+			if (slot >= 0) {
+				entry = &state->entries[slot];
+				entry->count++;
+				for (i = 0; i < state->numValues; i++) {
+					value = resolveCompiledOperand(&state->values[i],curTuple,NULL);
+					if (value == NULL) {
+						continue;
+					}
+					loadAggregateValue(state->valueTypes[i],value,&current);
+					mergeAggregateValue(state->aggregate->op_type,&entry->values[i],&current);
+				}
+			}
+		}
+		windowAfterTuple(&state->window,curTuple->timestamp,groupPaneEnd,&context);
+	}
+	RELEASE_OPERATOR_LOCK(state->lock);
+
+	for (curTuple = *headTuple; curTuple != NULL; curTuple = nextTuple) {
+		nextTuple = curTuple->next;
+		freeTupel(rootDM,curTuple);
+	}
+	*headTuple = context.headTuple;
+
+	return state->aggregate != NULL;
+}
+
+/**
+ * Closes the window of {@link group}, if it ended by now. See windowFlush().
+ * @param headTuple set to the groups emitted in the meantime. It might be NULL.
+ * @return 1, if the next operator is evaluated per group and has to be skipped. 0 otherwise.
+ */
+static int flushGroup(DataModelElement_t *rootDM, Group_t *group, Tupel_t **headTuple) {
+	GroupState_t *state = (GroupState_t*)group->state;
+	GroupContext_t context;
+	#ifdef __KERNEL__
+	unsigned long flags;
+	#endif
+
+	*headTuple = NULL;
+	if (state == NULL) {
+		return 0;
+	}
+	context.rootDM = rootDM;
+	context.group = group;
+	context.state = state;
+	context.headTuple = NULL;
+
+	ACQUIRE_OPERATOR_LOCK(state->lock);
+	windowFlush(&state->window,groupPaneEnd,&context);
+	RELEASE_OPERATOR_LOCK(state->lock);
+	*headTuple = context.headTuple;
+
+	return state->aggregate != NULL;
+}
+
+/**
+ * The maximum number of elements a SORT operator sorts by
+ */
+#define MAX_SORT_KEYS							8
+
+/**
+ * The layer-specific state of a SORT operator. The tuples of the current window are kept in a binary heap
+ * whose root is the tuple, which would be emitted last. Hence, a new tuple either replaces the root or is dropped
+ * as soon as {@link capacity} tuples are kept. Only the tuple pointers are moved.
+ */
+typedef struct SortState {
+	DECLARE_OPERATOR_LOCK(lock);
+	DataModelElement_t *rootDM;
+	Window_t window;
+	unsigned short order;
+	int numKeys;
+	CompiledOperand_t keys[MAX_SORT_KEYS];
+	int keyTypes[MAX_SORT_KEYS];
+	unsigned int capacity;
+	unsigned int count;
+	unsigned long long dropped;
+	Tupel_t **heap;
+} SortState_t;
+
+typedef struct SortContext {
+	SortState_t *state;
+	Tupel_t *headTuple;
+} SortContext_t;
+
+/**
+ * Compares both tuples by the sort elements.
+ * @return a value below zero, if {@link left} has to be emitted before {@link right}. A value above zero, if it has to be emitted after it. 0 otherwise.
+ */
+static int compareSortKeys(SortState_t *state, Tupel_t *left, Tupel_t *right) {
+	void *leftValue = NULL, *rightValue = NULL;
+	int i = 0, ret = 0;
+
+	for (i = 0; i < state->numKeys && ret == 0; i++) {
+		leftValue = resolveCompiledOperand(&state->keys[i],left,NULL);
+		rightValue = resolveCompiledOperand(&state->keys[i],right,NULL);
+		switch (state->keyTypes[i]) {
+			case INT:
+				ret = (*(int*)leftValue > *(int*)rightValue) - (*(int*)leftValue < *(int*)rightValue);
+				break;
+
+			case BYTE:
+				ret = (*(char*)leftValue > *(char*)rightValue) - (*(char*)leftValue < *(char*)rightValue);
+				break;
+
+			#ifndef __KERNEL__
+			case FLOAT:
+				ret = (*(double*)leftValue > *(double*)rightValue) - (*(double*)leftValue < *(double*)rightValue);
+				break;
+			#endif
+
+			case STRING:
+				ret = strcmp((char*)*(PTR_TYPE*)leftValue,(char*)*(PTR_TYPE*)rightValue);
+				break;
+		}
+	}
+	return (state->order == SORT_DESCENDING ? -ret : ret);
+}
+
+/**
+ * @return 1, if {@link tuple} provides each sort element. 0 otherwise.
+ */
+static int hasSortKeys(SortState_t *state, Tupel_t *tuple) {
+	void *value = NULL;
+	int i = 0;
+
+	for (i = 0; i < state->numKeys; i++) {
+		value = resolveCompiledOperand(&state->keys[i],tuple,NULL);
+		if (value == NULL || (state->keyTypes[i] == STRING && *(PTR_TYPE*)value == 0)) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static void siftUp(SortState_t *state, unsigned int pos) {
+	Tupel_t *tuple = state->heap[pos];
+	unsigned int parent = 0;
+
+	while (pos > 0) {
+		parent = (pos - 1) / 2;
+		if (compareSortKeys(state,state->heap[parent],tuple) >= 0) {
+			break;
+		}
+		state->heap[pos] = state->heap[parent];
+		pos = parent;
+	}
+	state->heap[pos] = tuple;
+}
+
+static void siftDown(SortState_t *state, unsigned int pos) {
+	Tupel_t *tuple = state->heap[pos];
+	unsigned int child = 0;
+
+	for (;;) {
+		child = 2 * pos + 1;
+		if (child >= state->count) {
+			break;
+		}
+		if (child + 1 < state->count && compareSortKeys(state,state->heap[child + 1],state->heap[child]) > 0) {
+			child++;
+		}
+		if (compareSortKeys(state,tuple,state->heap[child]) >= 0) {
+			break;
+		}
+		state->heap[pos] = state->heap[child];
+		pos = child;
+	}
+	state->heap[pos] = tuple;
+}
+
+/**
+ * Takes over {@link tuple}. It is either kept or freed.
+ */
+static void pushSortTuple(SortState_t *state, Tupel_t *tuple) {
+	tuple->next = NULL;
+	if (state->count < state->capacity) {
+		state->heap[state->count] = tuple;
+		siftUp(state,state->count++);
+	} else if (compareSortKeys(state,tuple,state->heap[0]) < 0) {
+		freeTupel(state->rootDM,state->heap[0]);
+		state->heap[0] = tuple;
+		siftDown(state,0);
+		state->dropped++;
+	} else {
+		freeTupel(state->rootDM,tuple);
+		state->dropped++;
+	}
+}
+
+/**
+ * Empties the heap at the end of a window. Since the root is the tuple emitted last, the list is built back to front.
+ */
+static void sortPaneEnd(void *context, int windowEnd, unsigned long long timestamp) {
+	SortContext_t *ctx = (SortContext_t*)context;
+	SortState_t *state = ctx->state;
+	Tupel_t *headTuple = NULL, *tuple = NULL;
+
+	while (state->count > 0) {
+		tuple = state->heap[0];
+		state->heap[0] = state->heap[--state->count];
+		if (state->count > 0) {
+			siftDown(state,0);
+		}
+		if (windowEnd) {
+			tuple->next = headTuple;
+			headTuple = tuple;
+		} else {
+			freeTupel(state->rootDM,tuple);
+		}
+	}
+	appendTuple(&ctx->headTuple,headTuple);
+}
+
+/**
+ * Creates the state of {@link sort}: a tumbling window, the compiled sort elements and the heap.
+ * @param rootDM a pointer to the slc datamodel
+ * @param sort a pointer to the SORT operator
+ * @return 0 on success. A value below zero otherwise.
+ */
+static int initSortState(DataModelElement_t *rootDM, Sort_t *sort) {
+	SortState_t *state = NULL;
+	Window_t window;
+	unsigned int capacity = 0;
+	int ret = 0, i = 0;
+
+	sort->state = NULL;
+	if (sort->elementsLen > MAX_SORT_KEYS) {
+		return -EPARAM;
+	}
+	ret = initWindow(&window,sort->sizeUnit,sort->size,sort->sizeUnit,sort->size);
+	if (ret < 0) {
+		return ret;
+	}
+	capacity = (sort->limit == 0 ? MAX_SORT_TUPLES : sort->limit);
+	// A window measured in events never holds more tuples than its size
+	if (sort->sizeUnit == EVENTS && sort->size < capacity) {
+		capacity = sort->size;
+	}
+	state = ALLOC(sizeof(SortState_t) + capacity * sizeof(Tupel_t*));
+	if (state == NULL) {
+		return -ENOMEMORY;
+	}
+	state->rootDM = rootDM;
+	state->window = window;
+	state->order = sort->order;
+	state->numKeys = sort->elementsLen;
+	state->capacity = capacity;
+	state->count = 0;
+	state->dropped = 0;
+	state->heap = (Tupel_t**)(state + 1);
+	for (i = 0; i < state->numKeys; i++) {
+		state->keys[i].type = OP_STREAM;
+		state->keyTypes[i] = compileStreamOperand(rootDM,sort->elements[i]->name,&state->keys[i]);
+		switch (state->keyTypes[i]) {
+			case INT:
+			case BYTE:
+			case STRING:
+			#ifndef __KERNEL__
+			case FLOAT:
+			#endif
+				break;
+
+			default:
+				FREE(state);
+				return -ENOTCOMPARABLE;
+		}
+	}
+	INIT_OPERATOR_LOCK(state->lock);
+	holdWindow(&state->window);
+	sort->state = state;
+
+	return 0;
+}
+
+static void freeSortState(Sort_t *sort) {
+	SortState_t *state = (SortState_t*)sort->state;
+
+	if (state == NULL) {
+		return;
+	}
+	while (state->count > 0) {
+		freeTupel(state->rootDM,state->heap[--state->count]);
+	}
+	releaseWindow(&state->window);
+	DESTROY_OPERATOR_LOCK(state->lock);
+	FREE(state);
+	sort->state = NULL;
+}
+
+/**
+ * Moves each tuple in the list {@link headTuple} into the heap of {@link sort}. Tuples lacking a sort element are dropped.
+ * Afterwards, {@link headTuple} points to the sorted tuples of the windows completed in the meantime. It might be NULL.
+ * If the operator has no state, e.g. because executeQuery() got called directly, the tuples are passed through untouched.
+ * @param rootDM a pointer to the slc datamodel
+ * @param sort a pointer to the SORT operator
+ * @param headTuple a pointer to the head of the tuple list
+ */
+static void applySort(DataModelElement_t *rootDM, Sort_t *sort, Tupel_t **headTuple) {
+	SortState_t *state = (SortState_t*)sort->state;
+	SortContext_t context;
+	Tupel_t *curTuple = NULL, *nextTuple = NULL;
+	unsigned long long timestamp = 0;
+	#ifdef __KERNEL__
+	unsigned long flags;
+	#endif
+
+	if (state == NULL) {
+		DEBUG_MSG(2,"%s: No state for sort. Passing tuples through.\n",__FUNCTION__);
+		return;
+	}
+	context.state = state;
+	context.headTuple = NULL;
+
+	ACQUIRE_OPERATOR_LOCK(state->lock);
+	for (curTuple = *headTuple; curTuple != NULL; curTuple = nextTuple) {
+		nextTuple = curTuple->next;
+		timestamp = curTuple->timestamp;
+		windowBeforeTuple(&state->window,curTuple,sortPaneEnd,&context);
+		// The tuple is either kept or freed. Do not touch it afterwards.
+		if (hasSortKeys(state,curTuple)) {
+			pushSortTuple(state,curTuple);
+		} else {
+			freeTupel(rootDM,curTuple);
+		}
+		windowAfterTuple(&state->window,timestamp,sortPaneEnd,&context);
+	}
+	RELEASE_OPERATOR_LOCK(state->lock);
+	*headTuple = context.headTuple;
+}
+
+/**
+ * Closes the window of {@link sort}, if it ended by now. See windowFlush().
+ * @return the sorted tuples of the window. It might be NULL.
+ */
+static Tupel_t* flushSort(Sort_t *sort) {
+	SortState_t *state = (SortState_t*)sort->state;
+	SortContext_t context;
+	#ifdef __KERNEL__
+	unsigned long flags;
+	#endif
+
+	if (state == NULL || !state->window.timeBased) {
+		return NULL;
+	}
+	context.state = state;
+	context.headTuple = NULL;
+
+	ACQUIRE_OPERATOR_LOCK(state->lock);
+	windowFlush(&state->window,sortPaneEnd,&context);
+	RELEASE_OPERATOR_LOCK(state->lock);
+
+	return context.headTuple;
+}
+
+/**
+ * The smallest number of buckets of a join snapshot. It has at least twice as many buckets as tuples.
+ */
+#define JOIN_MIN_BUCKETS						16
+
+typedef struct JoinEntry {
+	struct JoinEntry *next;
+	unsigned int hash;
+	Tupel_t *tuple;
+} JoinEntry_t;
+
+/**
+ * The tuples a provider returned for a join at one point in time. They are hashed by the value of the join operand of the key predicate.
+ * Entries of the same bucket keep the order of the tuples the provider returned.
+ */
+typedef struct JoinSnapshot {
+	unsigned long long built;					// getTimeNS() right before the provider got called
+	unsigned int generation;					// The generation of the object the joined node belongs to. See objectInstancesChanged().
+	unsigned int numBuckets;
+	JoinEntry_t **buckets;
+	Tupel_t *tuples;							// All tuples of the snapshot, linked by their next pointer
+	JoinEntry_t entries[];
+} JoinSnapshot_t;
+
+/**
+ * The layer-specific state of a join with a cacheTTL. It is created by initJoinState(), if one of its predicates
+ * compares a stream and a join operand of the same INT, BYTE or STRING type for equality.
+ */
+typedef struct JoinState {
+	DECLARE_OPERATOR_LOCK(lock);
+	DataModelElement_t *rootDM;
+	DataModelElement_t *dm;						// The joined node
+	Object_t *object;							// The object the joined node belongs to. Might be NULL.
+	int keyType;
+	CompiledOperand_t streamKey;
+	CompiledOperand_t joinKey;
+	char perTuple;								// 1, if the selectors for the provider depend on the stream tuple. Each one needs its own call then.
+	JoinSnapshot_t *snapshot;					// NULL, as long as the provider was not called
+} JoinState_t;
+
+/**
+ * Chooses the predicate whose values are hashed. The join operand of the first predicate comparing
+ * a stream and a join operand for equality is used. It has to be an INT, a BYTE or a STRING.
+ * A join without such a predicate or without a cacheTTL keeps using the nested loop in doJoin().
+ * @param rootDM a pointer to the slc datamodel
+ * @param join a pointer to the join
+ * @return 0 on success. -ENOMEMORY, if the state cannot be allocated.
+ */
+static int initJoinState(DataModelElement_t *rootDM, Join_t *join) {
+	JoinState_t *state = NULL;
+	CompiledOperand_t streamKey, joinKey;
+	DataModelElement_t *dm = NULL, *cur = NULL;
+	Predicate_t *predicate = NULL;
+	Operand_t *stream = NULL, *joined = NULL;
+	int i = 0, streamType = -1, joinType = -1;
+
+	join->state = NULL;
+	if (join->cacheTTL == 0) {
+		return 0;
+	}
+	dm = getDescription(rootDM,join->element.name);
+	if (dm == NULL || dm->layerCode != LAYER_CODE) {
+		return 0;
+	}
+	for (i = 0; i < join->predicateLen; i++) {
+		predicate = join->predicates[i];
+		if (predicate->type != EQUAL) {
+			continue;
+		}
+		if (predicate->left.type == OP_STREAM && predicate->right.type == OP_JOIN) {
+			stream = &predicate->left;
+			joined = &predicate->right;
+		} else if (predicate->left.type == OP_JOIN && predicate->right.type == OP_STREAM) {
+			stream = &predicate->right;
+			joined = &predicate->left;
+		} else {
+			continue;
+		}
+		streamType = compileStreamOperand(rootDM,(char*)&stream->value,&streamKey);
+		joinType = compileStreamOperand(rootDM,(char*)&joined->value,&joinKey);
+		if (streamType == joinType && (streamType == INT || streamType == BYTE || streamType == STRING)) {
+			break;
+		}
+	}
+	if (i == join->predicateLen) {
+		DEBUG_MSG(2,"Join on %s has no predicate to hash. Using a nested loop.\n",join->element.name);
+		return 0;
+	}
+
+	state = ALLOC(sizeof(JoinState_t));
+	if (state == NULL) {
+		return -ENOMEMORY;
+	}
+	INIT_OPERATOR_LOCK(state->lock);
+	state->rootDM = rootDM;
+	state->dm = dm;
+	state->object = NULL;
+	for (cur = dm; cur != NULL; cur = cur->parent) {
+		if (cur->dataModelType == OBJECT) {
+			state->object = (Object_t*)cur->typeInfo;
+			break;
+		}
+	}
+	state->keyType = streamType;
+	state->streamKey = streamKey;
+	state->streamKey.type = OP_STREAM;
+	state->joinKey = joinKey;
+	state->joinKey.type = OP_JOIN;
+	state->perTuple = 0;
+	state->snapshot = NULL;
+	join->state = state;
+
+	return 0;
+}
+
+static void freeJoinSnapshot(DataModelElement_t *rootDM, JoinSnapshot_t *snapshot) {
+	Tupel_t *cur = NULL, *next = NULL;
+
+	if (snapshot == NULL) {
+		return;
+	}
+	for (cur = snapshot->tuples; cur != NULL; cur = next) {
+		next = cur->next;
+		freeTupel(rootDM,cur);
+	}
+	FREE(snapshot);
+}
+
+static void freeJoinState(Join_t *join) {
+	JoinState_t *state = (JoinState_t*)join->state;
+
+	if (state == NULL) {
+		return;
+	}
+	freeJoinSnapshot(state->rootDM,state->snapshot);
+	DESTROY_OPERATOR_LOCK(state->lock);
+	FREE(state);
+	join->state = NULL;
+}
+
+/**
+ * Releases everything compileOperators() set up for the operators starting at {@link op} up to, but not including, {@link end}.
+ * @param op a pointer to the first operator
+ * @param end a pointer to the operator where to stop. NULL releases the whole chain.
+ */
+static void releaseCompiledOperatorsUntil(Operator_t *op, Operator_t *end) {
+	Operator_t *cur = NULL;
+
+	for (cur = op; cur != end; cur = cur->child) {
+		switch (cur->type) {
+			case FILTER:
+				if (((Filter_t*)cur)->compiled != NULL) {
+					FREE(((Filter_t*)cur)->compiled);
+					((Filter_t*)cur)->compiled = NULL;
+				}
+				break;
+
+			case MIN:
+			case MAX:
+			case AVG:
+				freeAggregateState((Aggregate_t*)cur);
+				break;
+
+			case SORT:
+				freeSortState((Sort_t*)cur);
+				break;
+
+			case GROUP:
+				freeGroupState((Group_t*)cur);
+				break;
+
+			case JOIN:
+				freeJoinState((Join_t*)cur);
+				break;
+		}
+	}
+}
+
+/**
+ * Prepares all operators starting at {@link op} for their execution on this layer, e.g. by compiling the predicates of a filter.
+ * addQueries() calls it for each query. On failure, nothing stays allocated.
+ * @param rootDM a pointer to the slc datamodel
+ * @param op a pointer to the first operator
+ * @return 0 on success. A value below zero otherwise.
+ */
+int compileOperators(DataModelElement_t *rootDM, Operator_t *op) {
+	Operator_t *cur = NULL;
+	int ret = 0;
+
+	for (cur = op; cur != NULL; cur = cur->child) {
+		switch (cur->type) {
+			case FILTER:
+				ret = compileFilter(rootDM,(Filter_t*)cur);
+				break;
+
+			case MIN:
+			case MAX:
+			case AVG:
+				ret = initAggregateState(rootDM,(Aggregate_t*)cur);
+				break;
+
+			case SORT:
+				ret = initSortState(rootDM,(Sort_t*)cur);
+				break;
+
+			case GROUP:
+				ret = initGroupState(rootDM,(Group_t*)cur);
+				// A fused aggregate is evaluated by the group. It does not need a state on its own.
+				if (ret == 0 && ((GroupState_t*)((Group_t*)cur)->state)->aggregate != NULL) {
+					cur = cur->child;
+				}
+				break;
+
+			case JOIN:
+				ret = initJoinState(rootDM,(Join_t*)cur);
+				break;
+		}
+		if (ret < 0) {
+			releaseCompiledOperatorsUntil(op,cur);
+			return ret;
+		}
+	}
+
+	return 0;
+}
+#ifdef __KERNEL__
+EXPORT_SYMBOL(compileOperators);
+#endif
+
+/**
+ * Checks, if one of the operators starting at {@link op} keeps state across tuples.
+ * The result of such an operator depends on the order its tuples are processed in.
+ * @param op a pointer to the first operator
+ * @return 1, if the order matters. 0 otherwise.
+ */
+static int isOrderedQuery(Operator_t *op) {
+	Operator_t *cur = NULL;
+
+	for (cur = op; cur != NULL; cur = cur->child) {
+		switch (cur->type) {
+			case MIN:
+			case MAX:
+			case AVG:
+			case SORT:
+			case GROUP:
+				return 1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Releases everything compileOperators() set up for the operators starting at {@link op}.
+ * delQueries() calls it for each query.
+ * @param op a pointer to the first operator
+ */
+void releaseCompiledOperators(Operator_t *op) {
+	releaseCompiledOperatorsUntil(op,NULL);
+}
+#ifdef __KERNEL__
+EXPORT_SYMBOL(releaseCompiledOperators);
+#endif
+
+/**
+ * Lowers {@link predicate} into {@link compiled}, if it compares a constant to one of {@link fields}.
+ * @return 1, if the predicate can be evaluated by the provider. 0 otherwise.
+ */
+static int compilePushdownPredicate(Predicate_t *predicate, PushdownField_t *fields, int numFields, PushdownPredicate_t *compiled) {
+	CompiledOperand_t constant;
+	Operand_t *stream = NULL, *pod = NULL;
+	int i = 0;
+
+	if (TEST_BIT(predicate->flags,PRED_SELEC) || predicate->type >= PREDICATETYPE_END) {
+		return 0;
+	}
+	if (predicate->left.type == OP_STREAM && predicate->right.type == OP_POD) {
+		stream = &predicate->left;
+		pod = &predicate->right;
+		compiled->constLeft = 0;
+	} else if (predicate->left.type == OP_POD && predicate->right.type == OP_STREAM) {
+		stream = &predicate->right;
+		pod = &predicate->left;
+		compiled->constLeft = 1;
+	} else {
+		return 0;
+	}
+	for (i = 0; i < numFields; i++) {
+		if (strncmp(stream->value,fields[i].path,MAX_NAME_LEN) == 0) {
+			break;
+		}
+	}
+	if (i == numFields || compileConstOperand(pod,&constant,fields[i].type) < 0) {
+		return 0;
+	}
+	compiled->field = i;
+	compiled->compare = NULL;
+	switch (fields[i].type) {
+		case STRING:
+			compiled->constant.stringValue = constant.constant.stringValue;
+			if (predicate->type == EQUAL) {
+				compiled->compare = compareStringEqual;
+			} else if (predicate->type == NEQ) {
+				compiled->compare = compareStringNeq;
+			}
+			break;
+
+		case INT:
+			compiled->constant.intValue = constant.constant.intValue;
+			compiled->compare = compareInt[predicate->type];
+			break;
+
+		case BYTE:
+			compiled->constant.byteValue = constant.constant.byteValue;
+			compiled->compare = compareByte[predicate->type];
+			break;
+	}
+
+	return compiled->compare != NULL;
+}
+
+/**
+ * Collects the predicates of the leading filters of {@link query}, which compare a constant to one of {@link fields}.
+ * A provider evaluates them by calling matchPushdown() before it builds a tuple. If one of them fails, the query would drop the tuple anyway.
+ * The query still applies all of its filters. Usually, a provider calls this function, while a query gets activated.
+ * @param query a pointer to the query
+ * @param fields the members the provider knows before building a tuple
+ * @param numFields the number of fields
+ * @return the predicates or NULL, if there are none
+ */
+Pushdown_t* compilePushdown(Query_t *query, PushdownField_t *fields, int numFields) {
+	Pushdown_t *pushdown = NULL;
+	Operator_t *cur = NULL;
+	int i = 0, num = 0;
+
+	for (cur = query->root->child; cur != NULL && cur->type == FILTER; cur = cur->child) {
+		num += ((Filter_t*)cur)->predicateLen;
+	}
+	if (num == 0) {
+		return NULL;
+	}
+	pushdown = ALLOC(sizeof(Pushdown_t) + sizeof(PushdownPredicate_t) * num);
+	if (pushdown == NULL) {
+		return NULL;
+	}
+	pushdown->num = 0;
+	for (cur = query->root->child; cur != NULL && cur->type == FILTER; cur = cur->child) {
+		for (i = 0; i < ((Filter_t*)cur)->predicateLen; i++) {
+			if (compilePushdownPredicate(((Filter_t*)cur)->predicates[i],fields,numFields,&pushdown->predicates[pushdown->num])) {
+				pushdown->num++;
+			}
+		}
+	}
+	if (pushdown->num == 0) {
+		FREE(pushdown);
+		return NULL;
+	}
+	DEBUG_MSG(2,"Provider evaluates %u predicates of query 0x%x\n",pushdown->num,query->queryID);
+
+	return pushdown;
+}
+#ifdef __KERNEL__
+EXPORT_SYMBOL(compilePushdown);
+#endif
+
+void freePushdown(Pushdown_t *pushdown) {
+	if (pushdown != NULL) {
+		FREE(pushdown);
+	}
 }
+#ifdef __KERNEL__
+EXPORT_SYMBOL(freePushdown);
+#endif
 /**
  * An object or source nested within one or more objects need selectors for the provider. A provider must know which instances of the parent objects
  * should be queried for the requested information, e.g. providing a device name for txBytes.
@@ -336,18 +2395,41 @@ static int buildSelectorsArray(DataModelElement_t *rootDM, DataModelElement_t *j
 	return 0;
 }
 
-static void applyFilter(DataModelElement_t *rootDM, Filter_t *filterOperator, Tupel_t **headTuple) {
-	Tupel_t *prevTuple = NULL, *curTuple = *headTuple, *nextTuple = NULL;
+/**
+ * Checks, if {@link tuple} satisfies all predicates of {@link filterOperator}.
+ * @param rootDM a pointer to the slc datamodel
+ * @param filterOperator a pointer to the filter
+ * @param tuple a pointer to the tuple. It is not modified.
+ * @return 1, if it does. 0 otherwise.
+ */
+static int matchFilter(DataModelElement_t *rootDM, Filter_t *filterOperator, Tupel_t *tuple) {
+	CompiledPredicate_t *compiled = (CompiledPredicate_t*)filterOperator->compiled;
 	int i = 0;
 
-	while (curTuple != NULL) {
+	if (compiled != NULL) {
 		for (i = 0; i < filterOperator->predicateLen; i++) {
-			if (applyPredicate(rootDM,filterOperator->predicates[i],curTuple,NULL) == 0) {
-				break;
+			if (applyCompiledPredicate(&compiled[i],tuple,NULL) == 0) {
+				return 0;
+			}
+		}
+	} else {
+		// The query was not registered by addQueries(), e.g. executeQuery() got called directly. Interpret the predicates.
+		for (i = 0; i < filterOperator->predicateLen; i++) {
+			if (applyPredicate(rootDM,filterOperator->predicates[i],tuple,NULL) == 0) {
+				return 0;
 			}
 		}
+	}
+
+	return 1;
+}
+
+static void applyFilter(DataModelElement_t *rootDM, Filter_t *filterOperator, Tupel_t **headTuple) {
+	Tupel_t *prevTuple = NULL, *curTuple = *headTuple, *nextTuple = NULL;
+
+	while (curTuple != NULL) {
 		nextTuple = curTuple->next;
-		if (i < filterOperator->predicateLen) {
+		if (matchFilter(rootDM,filterOperator,curTuple) == 0) {
 			if (prevTuple == NULL) {
 				*headTuple = nextTuple;
 			} else {
@@ -360,6 +2442,305 @@ static void applyFilter(DataModelElement_t *rootDM, Filter_t *filterOperator, Tu
 		curTuple = nextTuple;
 	}
 }
+
+/**
+ * Compares the selectors of two streams.
+ * An integer selector does not clear the rest of its buffer. At worst, two equal selectors are considered different.
+ * @return 1, if both streams have the same selectors. 0 otherwise.
+ */
+int isSameSelectors(GenStream_t *left, GenStream_t *right) {
+	int i = 0;
+
+	if (left->selectorsLen != right->selectorsLen) {
+		return 0;
+	}
+	for (i = 0; i < left->selectorsLen; i++) {
+		if (memcmp(&left->selectors[i].value,&right->selectors[i].value,MAX_NAME_LEN) != 0) {
+			return 0;
+		}
+	}
+	return 1;
+}
+#ifdef __KERNEL__
+EXPORT_SYMBOL(isSameSelectors);
+#endif
+
+/**
+ * Two streams can share a plan, if they deliver the same tuples.
+ */
+static int isSameStream(GenStream_t *left, GenStream_t *right) {
+	if (left->op_type != right->op_type || left->urgent != right->urgent) {
+		return 0;
+	}
+	if (left->op_type == GEN_OBJECT && ((ObjectStream_t*)left)->objectEvents != ((ObjectStream_t*)right)->objectEvents) {
+		return 0;
+	}
+	return isSameSelectors(left,right);
+}
+
+static int isSameFilter(Filter_t *left, Filter_t *right) {
+	Predicate_t *predLeft = NULL, *predRight = NULL;
+	int i = 0;
+
+	if (left->predicateLen != right->predicateLen) {
+		return 0;
+	}
+	for (i = 0; i < left->predicateLen; i++) {
+		predLeft = left->predicates[i];
+		predRight = right->predicates[i];
+		if (predLeft->type != predRight->type || predLeft->flags != predRight->flags ||
+			predLeft->left.type != predRight->left.type || predLeft->right.type != predRight->right.type ||
+			strncmp(predLeft->left.value,predRight->left.value,MAX_NAME_LEN) != 0 ||
+			strncmp(predLeft->right.value,predRight->right.value,MAX_NAME_LEN) != 0) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/**
+ * Returns the {@link pos}-th operator of {@link query}. The stream is at position 0.
+ */
+static Operator_t* getOperatorAt(Query_t *query, int pos) {
+	Operator_t *cur = query->root;
+
+	while (pos > 0 && cur != NULL) {
+		cur = cur->child;
+		pos--;
+	}
+	return cur;
+}
+
+/**
+ * Returns any query attached to {@link node} or one of the nodes below.
+ */
+static Query_t* getPlanQuery(PlanNode_t *node) {
+	PlanNode_t *child = NULL;
+
+	while (node->members == NULL) {
+		// Skip a node, which is about to be pruned
+		for (child = node->children; child != NULL && child->count == 0; child = child->sibling);
+		if (child == NULL) {
+			return NULL;
+		}
+		node = child;
+	}
+	return node->members;
+}
+
+static PlanNode_t* allocPlanNode(PlanNode_t **list, PlanNode_t *parent, Operator_t *op) {
+	PlanNode_t *node = NULL;
+
+	node = ALLOC(sizeof(PlanNode_t));
+	if (node == NULL) {
+		return NULL;
+	}
+	node->parent = parent;
+	node->children = NULL;
+	node->op = op;
+	node->depth = (parent == NULL ? 1 : parent->depth + 1);
+	node->count = 0;
+	node->members = NULL;
+	node->sibling = *list;
+	// A reader may walk the plans at any time
+	STORE_RELEASE(list,node);
+
+	return node;
+}
+
+/**
+ * Unlinks {@link node} and its ancestors, as long as no query is attached to them. They are retired, because a reader
+ * might still walk them.
+ */
+static void prunePlan(PlanNode_t **plans, PlanNode_t *node) {
+	PlanNode_t *parent = NULL, **cur = NULL;
+
+	while (node != NULL && node->count == 0) {
+		parent = node->parent;
+		for (cur = (parent == NULL ? plans : &parent->children); *cur != NULL; cur = &(*cur)->sibling) {
+			if (*cur == node) {
+				STORE_RELEASE(cur,node->sibling);
+				break;
+			}
+		}
+		retireMemory(node);
+		node = parent;
+	}
+}
+
+/**
+ * Merges the stream and the leading filters of {@link query} into {@link plans}. If another query starts with the same
+ * operators, their nodes are reused. Afterwards, query->plan points to the node of its last leading filter.
+ * The caller has to hold the slcLock as a writer.
+ * @param plans a pointer to the first plan of the node {@link query} is registered to
+ * @param query a pointer to the query
+ * @return 0 on success. -ENOMEMORY otherwise.
+ */
+int addQueryToPlan(PlanNode_t **plans, Query_t *query) {
+	PlanNode_t *node = NULL, *child = NULL;
+	Operator_t *op = NULL;
+
+	for (node = *plans; node != NULL; node = node->sibling) {
+		if (isSameStream((GenStream_t*)node->op,(GenStream_t*)query->root)) {
+			break;
+		}
+	}
+	if (node == NULL) {
+		node = allocPlanNode(plans,NULL,query->root);
+		if (node == NULL) {
+			return -ENOMEMORY;
+		}
+	}
+	for (op = query->root->child; op != NULL && op->type == FILTER; op = op->child) {
+		for (child = node->children; child != NULL; child = child->sibling) {
+			if (isSameFilter((Filter_t*)child->op,(Filter_t*)op)) {
+				break;
+			}
+		}
+		if (child == NULL) {
+			child = allocPlanNode(&node->children,node,op);
+			if (child == NULL) {
+				// Drop the nodes just allocated for this query
+				prunePlan(plans,node);
+				return -ENOMEMORY;
+			}
+		}
+		node = child;
+	}
+	query->plan = node;
+	query->planNext = node->members;
+	STORE_RELEASE(&node->members,query);
+	for (; node != NULL; node = node->parent) {
+		node->count++;
+	}
+
+	return 0;
+}
+#ifdef __KERNEL__
+EXPORT_SYMBOL(addQueryToPlan);
+#endif
+
+/**
+ * Detaches {@link query} from {@link plans}. Nodes no query is attached to any longer are freed.
+ * A node, which still refers to an operator of {@link query}, takes the one of another query below it.
+ * The caller has to hold the slcLock as a writer.
+ * @param plans a pointer to the first plan of the node {@link query} is registered to
+ * @param query a pointer to the query
+ */
+void delQueryFromPlan(PlanNode_t **plans, Query_t *query) {
+	PlanNode_t *node = query->plan, *cur = NULL;
+	Query_t **member = NULL;
+
+	if (node == NULL) {
+		return;
+	}
+	for (member = &node->members; *member != NULL; member = &(*member)->planNext) {
+		if (*member == query) {
+			STORE_RELEASE(member,query->planNext);
+			break;
+		}
+	}
+	for (cur = node; cur != NULL; cur = cur->parent) {
+		cur->count--;
+		if (cur->count > 0 && cur->op == getOperatorAt(query,cur->depth - 1)) {
+			cur->op = getOperatorAt(getPlanQuery(cur),cur->depth - 1);
+		}
+	}
+	prunePlan(plans,node);
+	// A reader might still stand on query. Hence, planNext is left untouched.
+	query->plan = NULL;
+}
+#ifdef __KERNEL__
+EXPORT_SYMBOL(delQueryFromPlan);
+#endif
+
+static void freePlanNodes(PlanNode_t *node) {
+	PlanNode_t *next = NULL;
+	Query_t *member = NULL;
+
+	while (node != NULL) {
+		next = node->sibling;
+		freePlanNodes(node->children);
+		for (member = node->members; member != NULL; member = member->planNext) {
+			member->plan = NULL;
+		}
+		retireMemory(node);
+		node = next;
+	}
+}
+
+/**
+ * Frees all plans of a node at once, e.g. if the node gets removed from the datamodel.
+ * The nodes are retired, because a reader might still walk them.
+ */
+void freeQueryPlans(PlanNode_t **plans) {
+	PlanNode_t *nodes = *plans;
+
+	STORE_RELEASE(plans,NULL);
+	freePlanNodes(nodes);
+}
+#ifdef __KERNEL__
+EXPORT_SYMBOL(freeQueryPlans);
+#endif
+
+/**
+ * Enqueues {@link query} with a tuple sharing the items of {@link tuple}. The executor skips the first {@link steps} operators.
+ */
+static void enqueueSharedTuple(Query_t *query, Tupel_t *tuple, int steps) {
+	Tupel_t *curTuple = NULL;
+
+	curTuple = shareTupel(tuple);
+	if (curTuple == NULL) {
+		ERR_MSG("Cannot share tuple!\n");
+		return;
+	}
+	DEBUG_MSG(3,"Executing query %p from step %d\n",query,steps);
+	enqueueQuery(query,curTuple,steps);
+}
+
+static void fanOutPlan(DataModelElement_t *rootDM, PlanNode_t *node, Tupel_t *tuple) {
+	PlanNode_t *child = NULL;
+	Query_t *member = NULL;
+
+	for (member = LOAD_ACQUIRE(&node->members); member != NULL; member = LOAD_ACQUIRE(&member->planNext)) {
+		enqueueSharedTuple(member,tuple,node->depth);
+	}
+	for (child = LOAD_ACQUIRE(&node->children); child != NULL; child = LOAD_ACQUIRE(&child->sibling)) {
+		// Nothing to share. The executor applies the filters of the query as usual.
+		if (child->count == 1) {
+			// A writer might just detach the last query from child
+			if ((member = getPlanQuery(child)) != NULL) {
+				enqueueSharedTuple(member,tuple,node->depth);
+			}
+		} else if (matchFilter(rootDM,(Filter_t*)child->op,tuple)) {
+			fanOutPlan(rootDM,child,tuple);
+		}
+	}
+}
+
+/**
+ * Hands {@link tuple} over to each query in {@link plans} whose stream listens to {@link event}.
+ * The filters several queries start with are applied right here, once for all of them. Each query gets its own tuple,
+ * which shares the items of {@link tuple}. The caller keeps its reference.
+ * The caller has to be inside a read section. See SLC_READ_LOCK().
+ * @param rootDM a pointer to the slc datamodel
+ * @param plans the first plan of an event or object
+ * @param tuple a pointer to the tuple
+ * @param event the object event, e.g. OBJECT_CREATE. 0 for an event.
+ */
+void broadcastToPlans(DataModelElement_t *rootDM, PlanNode_t *plans, Tupel_t *tuple, int event) {
+	PlanNode_t *cur = NULL;
+
+	for (cur = plans; cur != NULL; cur = LOAD_ACQUIRE(&cur->sibling)) {
+		if (cur->op->type == GEN_OBJECT && (((ObjectStream_t*)cur->op)->objectEvents & event) != event) {
+			continue;
+		}
+		fanOutPlan(rootDM,cur,tuple);
+	}
+}
+#ifdef __KERNEL__
+EXPORT_SYMBOL(broadcastToPlans);
+#endif
 /**
  * Deletes all items from {@link tupel} which are *not* listed in {@link selectOperator}.
  * @param rootDM a pointer to the slc datamodel
@@ -387,18 +2768,153 @@ static void applySelect(DataModelElement_t *rootDM, Select_t *selectOperator, Tu
 				deleteItem(rootDM,curTuple,i);
 			}
 		}
-		curTuple = curTuple->next;
+		curTuple = curTuple->next;
+	}
+}
+/**
+ * Set, if continuations are collected in frames. Otherwise each continuation is sent on its own.
+ */
+int queryContBatching = 1;
+/**
+ * The frame currently collecting continuations. It lives in the tx memory and is protected by contFrameLock.
+ */
+static QueryContinueFrame_t *contFrame = NULL;
+/**
+ * The time the first continuation was put in contFrame
+ */
+static unsigned long long contFrameOpened = 0;
+#ifdef __KERNEL__
+static DEFINE_SPINLOCK(contFrameLock);
+#else
+static pthread_mutex_t contFrameLock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/**
+ * Fills in a QueryContinue_t at {@link freeMem} and copies all tuples starting at {@link tuple} right behind it.
+ * @param freeMem a pointer to at least {@link size} bytes of tx memory
+ * @param query a pointer to the query that should be processed at the remote layer
+ * @param tuple a pointer to the first tuple
+ * @param steps the number of operators to skip before continuing execution
+ * @param size the number of bytes the continuation occupies
+ */
+static void writeQueryContinue(void *freeMem, Query_t *query, Tupel_t *tuple, int steps, int size) {
+	QueryContinue_t *queryCont = (QueryContinue_t*)freeMem;
+	Tupel_t *curTuple = NULL, *tempTuple = NULL;
+
+	strncpy((char*)&queryCont->qID.name,(char*)&((GenStream_t*)query->root)->name,MAX_NAME_LEN);
+	queryCont->qID.id = query->queryID;
+	queryCont->steps = steps;
+	queryCont->size = size;
+	freeMem += sizeof(QueryContinue_t);
+
+	curTuple = tuple;
+	// Copy all tuple to the tx memory
+	do {
+		tempTuple = (Tupel_t*)freeMem;
+		freeMem += copyAndCollectTupel(SLC_DATA_MODEL,curTuple,tempTuple,0);
+		curTuple = curTuple->next;
+		if (curTuple != NULL) {
+			tempTuple->next = (Tupel_t*)freeMem;
+		}
+	} while(curTuple != NULL);
+}
+/**
+ * Hands contFrame over to the remote layer. If the txBuffer is full, all of its continuations are dropped.
+ * The caller has to hold contFrameLock.
+ */
+static void sendQueryContinueFrame(void) {
+	if (contFrame == NULL) {
+		return;
+	}
+	if (ringBufferWrite(txBuffer,MSG_QUERY_CONTINUE_BATCH,(char*)contFrame) == -1) {
+		__sync_fetch_and_add(&skippedQueryCont,contFrame->entries);
+		slcfree(contFrame);
+	} else {
+		sentQueryContFrames++;
+	}
+	contFrame = NULL;
+}
+/**
+ * Sends the frame collecting continuations, even if it is not full yet.
+ * Each executor calls it, as soon as it runs out of queries. Hence, a continuation never waits for further ones for long.
+ */
+void flushQueryContinues(void) {
+#ifdef __KERNEL__
+	unsigned long flags;
+#endif
+
+	ACQUIRE_OPERATOR_LOCK(contFrameLock);
+	sendQueryContinueFrame();
+	RELEASE_OPERATOR_LOCK(contFrameLock);
+}
+/**
+ * Sends the frame collecting continuations, if its first continuation is older than QUERY_CONT_DEADLINE_NS.
+ * appendQueryContinue() checks the deadline only, if another continuation arrives. The executors call it between their jobs.
+ */
+void flushExpiredQueryContinues(void) {
+#ifdef __KERNEL__
+	unsigned long flags;
+#endif
+
+	// Most of the time, no frame is open. Do not take the lock in this case.
+	if (LOAD_ACQUIRE(&contFrame) == NULL) {
+		return;
+	}
+	ACQUIRE_OPERATOR_LOCK(contFrameLock);
+	if (contFrame != NULL && getTimeNS() - contFrameOpened >= QUERY_CONT_DEADLINE_NS) {
+		sendQueryContinueFrame();
+	}
+	RELEASE_OPERATOR_LOCK(contFrameLock);
+}
+/**
+ * Appends a continuation occupying {@link size} bytes to contFrame. A new frame is started, if it does not fit.
+ * The frame is sent, if it is full or its first continuation is older than QUERY_CONT_DEADLINE_NS.
+ * @param query a pointer to the query that should be processed at the remote layer
+ * @param tuple a pointer to the first tuple
+ * @param steps the number of operators to skip before continuing execution
+ * @param size the number of bytes the continuation occupies including its padding
+ */
+static void appendQueryContinue(Query_t *query, Tupel_t *tuple, int steps, int size) {
+	unsigned long long now = 0;
+#ifdef __KERNEL__
+	unsigned long flags;
+#endif
+
+	ACQUIRE_OPERATOR_LOCK(contFrameLock);
+	if (contFrame != NULL && contFrame->size + size > QUERY_CONT_FRAME_SIZE) {
+		sendQueryContinueFrame();
+	}
+	if (contFrame == NULL) {
+		contFrame = slcmalloc(QUERY_CONT_FRAME_SIZE);
+		if (contFrame == NULL) {
+			RELEASE_OPERATOR_LOCK(contFrameLock);
+			DEBUG_MSG(2,"Cannot allocate txMemory for QueryContinueFrame_t\n");
+			__sync_fetch_and_add(&skippedQueryCont,1);
+			return;
+		}
+		contFrame->entries = 0;
+		contFrame->size = QUERY_CONT_ALIGN(sizeof(QueryContinueFrame_t));
+		contFrameOpened = getTimeNS();
 	}
+	writeQueryContinue((void*)contFrame + contFrame->size,query,tuple,steps,size);
+	contFrame->size += size;
+	contFrame->entries++;
+	now = getTimeNS();
+	if (contFrame->size + QUERY_CONT_ALIGN(sizeof(QueryContinue_t)) > QUERY_CONT_FRAME_SIZE || now - contFrameOpened >= QUERY_CONT_DEADLINE_NS) {
+		sendQueryContinueFrame();
+	}
+	RELEASE_OPERATOR_LOCK(contFrameLock);
 }
 /**
- * Allocates enough tx memory to store the tuple list starting at {@link tuple} and an instance of QueryContinue_t.
- * Collects and copies all tuples to the memory. 
+ * Hands the tuple list starting at {@link tuple} over to the remote layer.
+ * If batching is enabled, the query is not urgent and the continuation fits in a frame, it is collected with others. Otherwise,
+ * it allocates enough tx memory to store the tuples and an instance of QueryContinue_t and sends it on its own.
+ * The tuples are freed in any case.
  * @param query a pointer to the query that should be processed at the remote layer
  * @param tuple a pointer to the first tuple
  * @param steps the number of operators to skip before continuing execution 
  */
 static void sendQueryContinue(Query_t *query, Tupel_t *tuple, int steps) {
-	QueryContinue_t *queryCont = NULL;
 	Tupel_t *curTuple= NULL, *tempTuple = NULL;
 	void *freeMem = NULL;
 	int temp = 0, size = sizeof(QueryContinue_t);
@@ -418,39 +2934,26 @@ static void sendQueryContinue(Query_t *query, Tupel_t *tuple, int steps) {
 		size += temp;
 		curTuple = curTuple->next;
 	} while (curTuple != NULL);
+	size = QUERY_CONT_ALIGN(size);
+	__sync_fetch_and_add(&totalQueryCont,1);
 
+	// An urgent continuation must not wait for the frame to fill up
+	if (queryContBatching && !isQueryUrgent(query) && size <= QUERY_CONT_FRAME_SIZE - QUERY_CONT_ALIGN(sizeof(QueryContinueFrame_t))) {
+		appendQueryContinue(query,tuple,steps,size);
+		goto out;
+	}
 	freeMem = slcmalloc(size);
 	if (freeMem == NULL) {
-		ERR_MSG("Cannot allocate txMemory for QueryContinue_t\n");
+		DEBUG_MSG(2,"Cannot allocate txMemory for QueryContinue_t\n");
+		__sync_fetch_and_add(&skippedQueryCont,1);
 		goto out;
 	}
-
-	queryCont = (QueryContinue_t*)freeMem;
-	strncpy((char*)&queryCont->qID.name,(char*)&((GenStream_t*)query->root)->name,MAX_NAME_LEN);
-	queryCont->qID.id = query->queryID;
-	queryCont->steps = steps;
-	freeMem += sizeof(QueryContinue_t);
-
-	curTuple = tuple;
-	// Copy all tuple to the tx memory
-	do {
-		tempTuple = (Tupel_t*)freeMem;
-		temp = copyAndCollectTupel(SLC_DATA_MODEL,curTuple,tempTuple,0);
-		freeMem += temp;
-		curTuple = curTuple->next;
-		if (curTuple != NULL) {
-			tempTuple->next = (Tupel_t*)freeMem;
-		}
-	} while(curTuple != NULL);
-	totalQueryCont++;
-	//do {
-		temp = ringBufferWrite(txBuffer,MSG_QUERY_CONTINUE,(char*)queryCont);
-		if (temp == -1) {
-			//MSLEEP(100);
-			slcfree(queryCont);
-			skippedQueryCont++;
-		}
-	//} while (temp == -1);
+	writeQueryContinue(freeMem,query,tuple,steps,size);
+	temp = ringBufferWrite(txBuffer,MSG_QUERY_CONTINUE,(char*)freeMem);
+	if (temp == -1) {
+		slcfree(freeMem);
+		__sync_fetch_and_add(&skippedQueryCont,1);
+	}
 	//Freeing origin tuple... They are no longer needed.
 out:curTuple = tuple;
 	while (curTuple != NULL) {
@@ -459,6 +2962,235 @@ out:curTuple = tuple;
 		curTuple = tempTuple;
 	}
 }
+/**
+ * Hashes the key located at {@link value}. A STRING is hashed by its content.
+ */
+static inline unsigned int hashJoinKey(JoinState_t *state, void *value) {
+	char *string = NULL;
+
+	switch (state->keyType) {
+		case STRING:
+			string = (char*)*(PTR_TYPE*)value;
+			return hashBytes(2166136261U,(unsigned char*)string,(string == NULL ? 0 : strlen(string)));
+
+		case BYTE:
+			return hashBytes(2166136261U,(unsigned char*)value,sizeof(char));
+
+		default:
+			return hashBytes(2166136261U,(unsigned char*)value,sizeof(int));
+	}
+}
+
+/**
+ * Calls the joined node once and hashes all tuples it returns.
+ * @param join a pointer to the join
+ * @param state a pointer to its state
+ * @param selecs the selectors for the provider. They must not depend on a stream tuple.
+ * @param len the number of selectors
+ * @return a pointer to the new snapshot or NULL, if there is not enough memory
+ */
+static JoinSnapshot_t* buildJoinSnapshot(Join_t *join, JoinState_t *state, Selector_t *selecs, int len) {
+	JoinSnapshot_t *snapshot = NULL;
+	JoinEntry_t **bucket = NULL;
+	Tupel_t *tuples = NULL, *cur = NULL;
+	unsigned long long built = getTimeNS();
+	unsigned int generation = 0, numTuples = 0, numBuckets = JOIN_MIN_BUCKETS;
+	void *value = NULL;
+	int i = 0;
+	#ifdef __KERNEL__
+	unsigned long flags;
+	#endif
+
+	if (state->object != NULL) {
+		generation = LOAD_ACQUIRE(&state->object->generation);
+	}
+	// Without a stream tuple, a provider returns all tuples matching the selectors
+	if (state->dm->dataModelType == OBJECT) {
+		tuples = ((Object_t*)state->dm->typeInfo)->status(selecs,len,NULL);
+	} else {
+		ACQUIRE_WRITE_LOCK(((Source_t*)state->dm->typeInfo)->lock);
+		tuples = ((Source_t*)state->dm->typeInfo)->callback(selecs,len,NULL);
+		RELEASE_WRITE_LOCK(((Source_t*)state->dm->typeInfo)->lock);
+	}
+	for (cur = tuples; cur != NULL; cur = cur->next) {
+		numTuples++;
+	}
+	while (numBuckets < 2 * numTuples) {
+		numBuckets <<= 1;
+	}
+	snapshot = ALLOC(sizeof(JoinSnapshot_t) + numTuples * sizeof(JoinEntry_t) + numBuckets * sizeof(JoinEntry_t*));
+	if (snapshot == NULL) {
+		for (cur = tuples; cur != NULL; cur = tuples) {
+			tuples = cur->next;
+			freeTupel(state->rootDM,cur);
+		}
+		return NULL;
+	}
+	snapshot->built = built;
+	snapshot->generation = generation;
+	snapshot->numBuckets = numBuckets;
+	snapshot->buckets = (JoinEntry_t**)&snapshot->entries[numTuples];
+	memset(snapshot->buckets,0,numBuckets * sizeof(JoinEntry_t*));
+	snapshot->tuples = tuples;
+	for (cur = tuples, i = 0; cur != NULL; cur = cur->next, i++) {
+		snapshot->entries[i].tuple = cur;
+	}
+	// Walk backwards. Hence, each bucket lists its tuples in the order the provider returned them.
+	for (i = numTuples - 1; i >= 0; i--) {
+		value = resolveCompiledOperand(&state->joinKey,NULL,snapshot->entries[i].tuple);
+		if (value == NULL) {
+			continue;
+		}
+		snapshot->entries[i].hash = hashJoinKey(state,value);
+		bucket = &snapshot->buckets[snapshot->entries[i].hash & (numBuckets - 1)];
+		snapshot->entries[i].next = *bucket;
+		*bucket = &snapshot->entries[i];
+	}
+	DEBUG_MSG(2,"Cached %u tuples of %s in %u buckets\n",numTuples,join->element.name,numBuckets);
+
+	return snapshot;
+}
+
+/**
+ * Checks, if {@link snapshot} can still be used: its cacheTTL did not expire and no instance of the object it belongs to was created or deleted since.
+ */
+static inline int isJoinSnapshotValid(Join_t *join, JoinState_t *state, JoinSnapshot_t *snapshot) {
+	if (snapshot == NULL) {
+		return 0;
+	}
+	if (state->object != NULL && LOAD_ACQUIRE(&state->object->generation) != snapshot->generation) {
+		return 0;
+	}
+	return getTimeNS() - snapshot->built < (unsigned long long)join->cacheTTL * 1000000ULL;
+}
+
+static inline int matchJoinPredicates(DataModelElement_t *rootDM, Join_t *join, Tupel_t *tupleStream, Tupel_t *tupleJoin) {
+	int i = 0;
+
+	for (i = 0; i < join->predicateLen; i++) {
+		if (applyPredicate(rootDM,join->predicates[i],tupleStream,tupleJoin) == 0) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/**
+ * Merges a copy of {@link joinTuple} into {@link streamTuple} and appends the result to {@link tail}.
+ * @return 0 on success. -1 otherwise. {@link streamTuple} is freed in the latter case.
+ */
+static int emitJoinedTuple(DataModelElement_t *rootDM, Tupel_t *streamTuple, Tupel_t *joinTuple, Tupel_t ***tail) {
+	Tupel_t *copy = NULL;
+
+	copy = copyTupel(rootDM,joinTuple);
+	if (copy == NULL || mergeTuple(rootDM,&streamTuple,copy) < 0) {
+		freeTupel(rootDM,streamTuple);
+		return -1;
+	}
+	streamTuple->next = NULL;
+	**tail = streamTuple;
+	*tail = &streamTuple->next;
+
+	return 0;
+}
+
+/**
+ * Joins the tuples starting at {@link headTupleStream} with the cached tuples of the joined node. Each stream tuple
+ * is looked up by the value of its key. All predicates are still checked on each candidate.
+ * Each pair of matching tuples yields a merged tuple. They are ordered by the stream tuples first and by the
+ * order the provider returned its tuples second. A stream tuple without a match is freed.
+ * Only, if the snapshot is out of date, the provider gets called.
+ * @param rootDM a pointer to the root of the datamodel
+ * @param join a pointer to the join operator
+ * @param headTupleStream a pointer pointer to the first tuple in the stream
+ * @return the same values as doJoin() does. -1, if the selectors for the provider depend on the stream tuple. The nested loop has to be used then.
+ */
+static int doHashJoin(DataModelElement_t *rootDM, Join_t *join, Tupel_t **headTupleStream) {
+	JoinState_t *state = (JoinState_t*)join->state;
+	JoinSnapshot_t *snapshot = NULL, *stale = NULL;
+	JoinEntry_t *entry = NULL, *match = NULL;
+	Selector_t *selecs = NULL;
+	Tupel_t *curTupleStream = NULL, *nextTupleStream = NULL, *result = NULL, **tail = &result, *copy = NULL;
+	unsigned int hash = 0;
+	int len = 0, applied = 0;
+	char createSelecOnce = 0;
+	void *value = NULL;
+	#ifdef __KERNEL__
+	unsigned long flags;
+	#endif
+
+	if (LOAD_ACQUIRE(&state->perTuple)) {
+		return -1;
+	}
+	ACQUIRE_OPERATOR_LOCK(state->lock);
+	if (!isJoinSnapshotValid(join,state,state->snapshot)) {
+		// Do not hold the lock while the provider collects its tuples
+		RELEASE_OPERATOR_LOCK(state->lock);
+		if (buildSelectorsArray(rootDM,state->dm,join,*headTupleStream,&selecs,&len,&createSelecOnce) == -1) {
+			goto out_error;
+		}
+		if (createSelecOnce == 0) {
+			DEBUG_MSG(2,"Selectors for %s depend on the stream. Using a nested loop.\n",join->element.name);
+			STORE_RELEASE(&state->perTuple,1);
+			FREE(selecs);
+			return -1;
+		}
+		snapshot = buildJoinSnapshot(join,state,selecs,len);
+		FREE(selecs);
+		if (snapshot == NULL) {
+			goto out_error;
+		}
+		ACQUIRE_OPERATOR_LOCK(state->lock);
+		stale = state->snapshot;
+		state->snapshot = snapshot;
+	}
+	snapshot = state->snapshot;
+	curTupleStream = *headTupleStream;
+	while (curTupleStream != NULL) {
+		nextTupleStream = curTupleStream->next;
+		match = NULL;
+		value = resolveCompiledOperand(&state->streamKey,curTupleStream,NULL);
+		if (value != NULL) {
+			hash = hashJoinKey(state,value);
+			for (entry = snapshot->buckets[hash & (snapshot->numBuckets - 1)]; entry != NULL; entry = entry->next) {
+				if (entry->hash != hash || matchJoinPredicates(rootDM,join,curTupleStream,entry->tuple) == 0) {
+					continue;
+				}
+				// Each but the last match gets a copy of the stream tuple
+				if (match != NULL) {
+					copy = copyTupel(rootDM,curTupleStream);
+					if (copy == NULL || emitJoinedTuple(rootDM,copy,match->tuple,&tail) < 0) {
+						break;
+					}
+					applied++;
+				}
+				match = entry;
+			}
+		}
+		if (match == NULL || entry != NULL) {
+			freeTupel(rootDM,curTupleStream);
+		} else if (emitJoinedTuple(rootDM,curTupleStream,match->tuple,&tail) == 0) {
+			applied++;
+		}
+		curTupleStream = nextTupleStream;
+	}
+	*headTupleStream = result;
+	RELEASE_OPERATOR_LOCK(state->lock);
+	// Nobody else can use the replaced snapshot anymore. Each one holds the lock while probing.
+	freeJoinSnapshot(rootDM,stale);
+
+	return applied > 0;
+
+out_error:
+	curTupleStream = *headTupleStream;
+	while (curTupleStream != NULL) {
+		nextTupleStream = curTupleStream->next;
+		freeTupel(rootDM,curTupleStream);
+		curTupleStream = nextTupleStream;
+	}
+	*headTupleStream = NULL;
+	return 0;
+}
 /**
  * Uses the callback of the datamodel node which should be joined to retrieve the new tuples.
  * The datamodel node is resolved by using the element.name field of {@link  join}.
@@ -473,7 +3205,7 @@ static int doJoin(DataModelElement_t *rootDM,Join_t *join, Tupel_t **headTupleSt
 	DataModelElement_t *dm = NULL;
 	Selector_t *selecs = NULL;
 	Tupel_t *curTupleJoin = NULL, *nextTupleJoin = NULL, *lastTupleJoin = NULL, *curTupleStream = NULL, *prevTupleStream = NULL, *tempTuple = NULL, *nextTupleStream = NULL;
-	int i = 0, len = 0, shouldMerge = 0, applied = 0, moreStreamTuple = 0, moreJoinTuple = 0;
+	int i = 0, len = 0, shouldMerge = 0, applied = 0, moreStreamTuple = 0, moreJoinTuple = 0, ret = 0;
 	char createSelecOnce = 0; 
 	#ifdef __KERNEL__
 	unsigned long flags;
@@ -487,6 +3219,12 @@ static int doJoin(DataModelElement_t *rootDM,Join_t *join, Tupel_t **headTupleSt
 	if (dm->layerCode != LAYER_CODE) {
 		return 2;
 	}
+	if (join->state != NULL) {
+		ret = doHashJoin(rootDM,join,headTupleStream);
+		if (ret >= 0) {
+			return ret;
+		}
+	}
 
 	nextTupleStream = *headTupleStream;
 	// Now do the actual join...
@@ -780,7 +3518,21 @@ void executeQuery(DataModelElement_t *rootDM, Query_t *query, Tupel_t *tupleStre
 					break;
 
 				case SORT:
+					applySort(rootDM,(Sort_t*)cur,&headTupleStream);
+					if (headTupleStream == NULL) {
+						return;
+					}
+					break;
+
 				case GROUP:
+					if (applyGroup(rootDM,(Group_t*)cur,&headTupleStream)) {
+						// The aggregate got evaluated per group. Skip it.
+						cur = cur->child;
+						counter++;
+					}
+					if (headTupleStream == NULL) {
+						return;
+					}
 					break;
 
 				case JOIN:
@@ -788,7 +3540,11 @@ void executeQuery(DataModelElement_t *rootDM, Query_t *query, Tupel_t *tupleStre
 					if (ret == 0) {
 						return;
 					} else if (ret == 2) {
-						sendQueryContinue(query,tupleStream,steps);
+						/*
+						 * The joined node is at the remote layer. It resumes at the join with the tuples as they are now.
+						 * The operators in front of it might have consumed tupleStream and must not run twice.
+						 */
+						sendQueryContinue(query,headTupleStream,counter);
 						return;
 					}
 					break;
@@ -796,6 +3552,10 @@ void executeQuery(DataModelElement_t *rootDM, Query_t *query, Tupel_t *tupleStre
 				case MAX:
 				case MIN:
 				case AVG:
+					applyAggregate(rootDM,(Aggregate_t*)cur,&headTupleStream);
+					if (headTupleStream == NULL) {
+						return;
+					}
 					break;
 			}
 			cur = cur->child;
@@ -819,6 +3579,81 @@ void executeQuery(DataModelElement_t *rootDM, Query_t *query, Tupel_t *tupleStre
 		sendQueryContinue(query,headTupleStream,-1);
 	}
 }
+/**
+ * Closes each time-based window of {@link query}, which ended by now, even if no tuple arrived behind it.
+ * Otherwise, the last window of a stream, which went quiet, would not be emitted until the stream resumes.
+ * The results pass the remaining operators just like the ones emitted upon the arrival of a tuple.
+ * @param rootDM a pointer to the slc datamodel
+ * @param query the query whose windows should be flushed
+ */
+void flushQueryWindows(DataModelElement_t *rootDM, Query_t *query) {
+	Operator_t *cur = NULL;
+	Tupel_t *headTuple = NULL;
+	int counter = 0, skip = 0;
+
+	for (cur = query->root; cur != NULL; cur = cur->child) {
+		headTuple = NULL;
+		skip = 0;
+		switch (cur->type) {
+			case MAX:
+			case MIN:
+			case AVG:
+				headTuple = flushAggregate(rootDM,(Aggregate_t*)cur);
+				break;
+
+			case SORT:
+				headTuple = flushSort((Sort_t*)cur);
+				break;
+
+			case GROUP:
+				// The aggregate evaluated per group has no window on its own
+				skip = flushGroup(rootDM,(Group_t*)cur,&headTuple);
+				break;
+		}
+		if (skip && cur->child != NULL) {
+			cur = cur->child;
+			counter++;
+		}
+		counter++;
+		if (headTuple != NULL) {
+			executeQuery(rootDM,query,headTuple,counter);
+		}
+	}
+}
+/**
+ * Flushes the time-based windows of all queries registered on this layer every WINDOW_FLUSH_NS. See flushQueryWindows().
+ * The executors call it between their jobs and once they run out of jobs. Only one of them flushes at a time.
+ * @return the time until the next flush is due in ns. 0, if there is no time-based window.
+ */
+unsigned long long flushExpiredWindows(void) {
+	Query_t *cur = NULL;
+	unsigned long long now = 0, next = 0;
+	int i = 0;
+
+	if (LOAD_ACQUIRE(&timeWindows) == 0) {
+		return 0;
+	}
+	now = getTimeNS();
+	next = LOAD_ACQUIRE(&nextWindowFlush);
+	if (now < next) {
+		return next - now;
+	}
+	if (!__sync_bool_compare_and_swap(&nextWindowFlush,next,now + WINDOW_FLUSH_NS)) {
+		return WINDOW_FLUSH_NS;
+	}
+	SLC_READ_LOCK();
+	for (i = 0; i < QUERY_HASH_SIZE; i++) {
+		for (cur = LOAD_ACQUIRE(&queryHash[i]); cur != NULL; cur = LOAD_ACQUIRE(&cur->hashNext)) {
+			// Only a query with a window is an ordered one
+			if (TEST_BIT(cur->flags,ORDERED)) {
+				flushQueryWindows(SLC_DATA_MODEL,cur);
+			}
+		}
+	}
+	SLC_READ_UNLOCK();
+
+	return WINDOW_FLUSH_NS;
+}
 /**
  * By default the function will just the memory which is definitely allocated by a *malloc, e.g.
  * a predicates pointer array. If {@link freeOperator} is not zero, the operator itself will be freed, too.
@@ -843,6 +3678,10 @@ void freeOperator(Operator_t *op, int freeOperator) {
 				if (((Filter_t*)cur)->predicates != NULL) {
 					FREE(((Filter_t*)cur)->predicates);
 				}
+				if (((Filter_t*)cur)->compiled != NULL) {
+					FREE(((Filter_t*)cur)->compiled);
+					((Filter_t*)cur)->compiled = NULL;
+				}
 				break;
 				
 			case SELECT:
@@ -855,26 +3694,30 @@ void freeOperator(Operator_t *op, int freeOperator) {
 				if (((Sort_t*)cur)->elements != NULL) {
 					FREE(((Sort_t*)cur)->elements);
 				}
+				freeSortState((Sort_t*)cur);
 				break;
 				
 			case GROUP:
 				if (((Group_t*)cur)->elements != NULL) {
 					FREE(((Group_t*)cur)->elements);
 				}
+				freeGroupState((Group_t*)cur);
 				break;
 				
 			case JOIN:
 				if (((Join_t*)cur)->predicates != NULL) {
 					FREE(((Join_t*)cur)->predicates);
 				}
+				freeJoinState((Join_t*)cur);
 				break;
 				
 			case MIN:
 			case MAX:
 			case AVG:
-				if (((Group_t*)cur)->elements != NULL) {
-					FREE(((Group_t*)cur)->elements);
+				if (((Aggregate_t*)cur)->elements != NULL) {
+					FREE(((Aggregate_t*)cur)->elements);
 				}
+				freeAggregateState((Aggregate_t*)cur);
 				break;
 		}
 		prev = cur;
@@ -1097,6 +3940,17 @@ int checkQuerySyntax(DataModelElement_t *rootDM, Operator_t *rootQuery, Operator
 					return -ENOELEMENTS;
 				}
 				CHECK_ELEMENTS(sort,rootDM)
+				if (cur->type == SORT && (sort->order >= SORTORDER_END || sort->limit > MAX_SORT_TUPLES)) {
+					return -EPARAM;
+				}
+				// A MIN, MAX or AVG following a GROUP is evaluated per group. Hence, it has to use the tumbling window of the group.
+				if (cur->type == GROUP && cur->child != NULL && (cur->child->type & (MIN | MAX | AVG)) != 0) {
+					aggregate = (Aggregate_t*)cur->child;
+					if (aggregate->sizeUnit != sort->sizeUnit || aggregate->advanceUnit != sort->sizeUnit ||
+						aggregate->size != sort->size || aggregate->advance != sort->size) {
+						return -ESIZE;
+					}
+				}
 				break;
 
 			case JOIN:
@@ -1135,6 +3989,10 @@ int checkQuerySyntax(DataModelElement_t *rootDM, Operator_t *rootQuery, Operator
 				if (aggregate->sizeUnit >= SIZEUNIT_END || aggregate->advanceUnit >= SIZEUNIT_END) {
 					return -EUNIT;
 				}
+				// A window cannot be measured in tuples and advance in time or vice versa
+				if ((aggregate->sizeUnit == EVENTS) != (aggregate->advanceUnit == EVENTS)) {
+					return -EUNIT;
+				}
 				if (aggregate->size == 0 || aggregate->advance == 0) {
 					return -ESIZE;
 				}
@@ -1277,10 +4135,11 @@ int addQueries(DataModelElement_t *rootDM, Query_t *queries, unsigned long *__fl
 int addQueries(DataModelElement_t *rootDM, Query_t *queries) {
 #endif
 	DataModelElement_t *dm = NULL;
-	Query_t *cur = queries, **regQueries = NULL;
+	Query_t *cur = queries;
+	QueryRegistry_t **registry = NULL;
 	GenStream_t *stream = NULL;
 	char *name = NULL;
-	int i = 0, events = 0, statusQuery = 0, temp = 0;
+	int events = 0, statusQuery = 0, temp = 0, ret = 0;
 	#ifdef __KERNEL__
 	unsigned long flags = *__flags;
 	#endif
@@ -1301,35 +4160,37 @@ int addQueries(DataModelElement_t *rootDM, Query_t *queries) {
 
 		dm = getDescription(rootDM,name);
 		// This function just gets called from an api method. Hence, the lock is already acquired.
-		// We can safely operate on the numQueries var.
-		switch (dm->dataModelType) {
-			case EVENT:
-				regQueries = ((Event_t*)dm->typeInfo)->queries;
-				break;
-
-			case OBJECT:
-				regQueries = ((Object_t*)dm->typeInfo)->queries;
-				break;
-
-			case SOURCE:
-				regQueries = ((Source_t*)dm->typeInfo)->queries;
-				break;
+		// We can safely operate on the registry of the node.
+		registry = getQueryRegistry(dm);
+		ret = compileOperators(rootDM,cur->root);
+		if (ret < 0) {
+			return ret;
 		}
-		for (i = 0; i < MAX_QUERIES_PER_DM; i++) {
-			if (regQueries[i] == NULL) {
-				break;
-			}
+		if (isOrderedQuery(cur->root)) {
+			SET_BIT(cur->flags,ORDERED);
+		} else {
+			cur->flags &= ~ORDERED;
+		}
+		ret = addQueryToRegistry(registry,cur);
+		if (ret < 0) {
+			releaseCompiledOperators(cur->root);
+			return ret;
 		}
-		if (i >= MAX_QUERIES_PER_DM) {
-			return -EMAXQUERIES;
+		if (getQueryPlans(dm) != NULL) {
+			ret = addQueryToPlan(getQueryPlans(dm),cur);
+			if (ret < 0) {
+				delQueryFromRegistry(registry,cur);
+				// A reader might have found it in the registry meanwhile
+				retireQuery(cur);
+				return ret;
+			}
 		}
-		regQueries[i] = cur;
 		// Only assign a new global id, if we are on its origin layer
 		if (cur->layerCode == LAYER_CODE) {
 			temp = __sync_fetch_and_add(globalQueryID,1);
 			cur->queryID = temp;
 		}
-		cur->idx = i;
+		hashQuery(cur);
 
 		if (shouldTransferQuery(rootDM,dm,cur) == 1) {
 			DEBUG_MSG(2,"Transfering query to other layer: 0x%lx\n",(unsigned long)cur);
@@ -1366,7 +4227,6 @@ int addQueries(DataModelElement_t *rootDM, Query_t *queries) {
 							*__flags = flags;
 							#endif
 						//}
-						((Event_t*)dm->typeInfo)->numQueries++;
 						break;
 
 					case OBJECT:
@@ -1379,11 +4239,9 @@ int addQueries(DataModelElement_t *rootDM, Query_t *queries) {
 							*__flags = flags;
 							#endif
 						//}
-						((Object_t*)dm->typeInfo)->numQueries++;
 						break;
 
 					case SOURCE:
-						((Source_t*)dm->typeInfo)->numQueries++;
 						startSourceTimer(dm,cur);
 						break;
 				}
@@ -1408,7 +4266,8 @@ int delQueries(DataModelElement_t *rootDM, Query_t *queries, unsigned long *__fl
 int delQueries(DataModelElement_t *rootDM, Query_t *queries) {
 #endif 
 	DataModelElement_t *dm = NULL;
-	Query_t *cur = queries, **regQueries = NULL;
+	Query_t *cur = queries;
+	QueryRegistry_t **registry = NULL;
 	GenStream_t *stream = NULL;
 	char *name = NULL;
 	#ifdef __KERNEL__
@@ -1421,10 +4280,6 @@ int delQueries(DataModelElement_t *rootDM, Query_t *queries) {
 			ERR_MSG("Query does not have a valid id. Skipping its unregistration!\n");
 			continue;
 		}
-		if (cur->idx >= MAX_QUERIES_PER_DM) {
-			ERR_MSG("Query does not have a valid idx. Skipping its unregistration!\n");
-			continue;
-		}
 		stream = (GenStream_t*)cur->root;
 		switch (stream->op_type) {
 			case GEN_EVENT:
@@ -1435,24 +4290,15 @@ int delQueries(DataModelElement_t *rootDM, Query_t *queries) {
 		}
 
 		dm = getDescription(rootDM,name);
-		switch (dm->dataModelType) {
-			case EVENT:
-				regQueries = ((Event_t*)dm->typeInfo)->queries;
-				break;
-
-			case OBJECT:
-				regQueries = ((Object_t*)dm->typeInfo)->queries;
-				break;
-
-			case SOURCE:
-				regQueries = ((Source_t*)dm->typeInfo)->queries;
-				break;
+		registry = getQueryRegistry(dm);
+		if (*registry == NULL || cur->idx >= (*registry)->num || (*registry)->queries[cur->idx] != cur) {
+			ERR_MSG("Query does not have a valid idx. Skipping its unregistration!\n");
+			continue;
 		}
 		if (dm->layerCode == LAYER_CODE) {
 			DEBUG_MSG(2,"Stream origin (%s) is at our layer. Stopping it...\n",dm->name);
 			switch (dm->dataModelType) {
 				case EVENT:
-					((Event_t*)dm->typeInfo)->numQueries--;
 					//if (((Event_t*)dm->typeInfo)->numQueries == 0) {
 						/*
 						 * The slc-core component does *not* know, which steps are necessary to 'deactivate'
@@ -1474,7 +4320,6 @@ int delQueries(DataModelElement_t *rootDM, Query_t *queries) {
 					break;
 
 				case OBJECT:
-					((Object_t*)dm->typeInfo)->numQueries--;
 					//if (((Object_t*)dm->typeInfo)->numQueries == 0) {
 						// Same applies here for an object.
 						RELEASE_WRITE_LOCK(slcLock);
@@ -1488,15 +4333,22 @@ int delQueries(DataModelElement_t *rootDM, Query_t *queries) {
 
 				case SOURCE:
 					stopSourceTimer(cur);
-					((Source_t*)dm->typeInfo)->numQueries--;
 					break;
 			}
 		} else {
 			DEBUG_MSG(2,"Stream origin (%s) is at the remote layer. Doing nothing.\n",dm->name);
 		}
-		DEBUG_MSG(2,"Removing all pending query: 0x%lx\n",(unsigned long)regQueries[cur->idx]);
-		delPendingQuery(regQueries[cur->idx]);
-		regQueries[cur->idx] = NULL;
+		delQueryFromRegistry(registry,cur);
+		if (getQueryPlans(dm) != NULL) {
+			delQueryFromPlan(getQueryPlans(dm),cur);
+		}
+		unhashQuery(cur);
+		/*
+		 * A reader, which found the query before, might still enqueue a job for it. Hence, its pending jobs are removed
+		 * and its compiled operators are released by synchronizeSLC().
+		 */
+		DEBUG_MSG(2,"Retiring query: 0x%lx\n",(unsigned long)cur);
+		retireQuery(cur);
 		// Query was registered on this layer and transfered to the remote layer
 		if (cur->layerCode == LAYER_CODE && (cur->flags & TRANSFERED) == TRANSFERED) {
 			DEBUG_MSG(2,"Query was transfered to the remote layer. Sending a DEL_QUERY: 0x%lx\n",(unsigned long)cur);
@@ -1673,6 +4525,8 @@ static int copyOperatorAdjacent(void *freeMem, Operator_t *origin, Operator_t **
 			filterCopy = ((Filter_t*)*copy);
 			freeMem_ += sizeof(Filter_t);
 			memcpy(filterCopy,filterOrigin,sizeof(Filter_t));
+			// Compiled predicates are only valid on the layer which compiled them
+			filterCopy->compiled = NULL;
 			filterCopy->predicates = freeMem_;
 			freeMem_ += filterCopy->predicateLen * sizeof(Predicate_t*);
 			for (i = 0; i < filterOrigin->predicateLen; i++) {
@@ -1701,6 +4555,7 @@ static int copyOperatorAdjacent(void *freeMem, Operator_t *origin, Operator_t **
 			sortCopy = ((Sort_t*)*copy);
 			freeMem_ += sizeof(Sort_t);
 			memcpy(sortCopy,sortOrigin,sizeof(Sort_t));
+			sortCopy->state = NULL;
 			sortCopy->elements = freeMem_;
 			freeMem_ += sortCopy->elementsLen * sizeof(Element_t*);
 			for (i = 0; i < sortOrigin->elementsLen; i++) {
@@ -1715,6 +4570,7 @@ static int copyOperatorAdjacent(void *freeMem, Operator_t *origin, Operator_t **
 			groupCopy = ((Group_t*)*copy);
 			freeMem_ += sizeof(Group_t);
 			memcpy(groupCopy,groupOrigin,sizeof(Group_t));
+			groupCopy->state = NULL;
 			groupCopy->elements = freeMem_;
 			freeMem_ += groupCopy->elementsLen * sizeof(Element_t*);
 			for (i = 0; i < groupOrigin->elementsLen; i++) {
@@ -1736,6 +4592,8 @@ static int copyOperatorAdjacent(void *freeMem, Operator_t *origin, Operator_t **
 				memcpy(joinCopy->predicates[i],joinOrigin->predicates[i],sizeof(Predicate_t));
 				freeMem_ += sizeof(Predicate_t);
 			}
+			// The cached tuples are only valid on the layer which fetched them
+			joinCopy->state = NULL;
 			break;
 
 		case MAX:
@@ -1745,6 +4603,8 @@ static int copyOperatorAdjacent(void *freeMem, Operator_t *origin, Operator_t **
 			aggregateCopy = ((Aggregate_t*)*copy);
 			freeMem_ += sizeof(Aggregate_t);
 			memcpy(aggregateCopy,aggregateOrigin,sizeof(Aggregate_t));
+			// The state of an aggregate is only valid on the layer which created it
+			aggregateCopy->state = NULL;
 			aggregateCopy->elements = freeMem_;
 			freeMem_ += aggregateCopy->elementsLen * sizeof(Element_t*);
 			for (i = 0; i < aggregateOrigin->elementsLen; i++) {
@@ -1878,44 +4738,102 @@ void rewriteQueryAddress(Query_t *query, void *oldBaseAddr, void *newBaseAddr) {
 }
 /**
  * Resolves the meta description of a query (a.k.a QueryID_t) to a pointer to a Query_t.
+ * The query is looked up in the query id hash. Neither the datamodel nor the registry of a node is searched.
+ * The caller has to be inside a read section. See SLC_READ_LOCK().
  * @param rootDm a pointer to the datamodel which should be used to resolve id->name
  * @param id a pointer to QueryID_t
  * @return a pointer to the real query on success, or NULL on failure.
  */
 Query_t* resolveQuery(DataModelElement_t *rootDM, QueryID_t *id) {
-	DataModelElement_t *dm = NULL;
-	Query_t **regQueries = NULL;
-	int i = 0;
+	Query_t *cur = NULL;
 
-	dm = getDescription(rootDM,id->name);
-	if (dm == NULL) {
-		return NULL;
+	for (cur = LOAD_ACQUIRE(&queryHash[hashQueryID(id->id)]); cur != NULL; cur = LOAD_ACQUIRE(&cur->hashNext)) {
+		// id and node name match. Got it! \o/
+		if ((unsigned short)cur->queryID == id->id && strcmp(id->name,((GenStream_t*)cur->root)->name) == 0) {
+			return cur;
+		}
 	}
-	switch (dm->dataModelType) {
-		case EVENT:
-			regQueries = ((Event_t*)dm->typeInfo)->queries;
-			break;
 
-		case OBJECT:
-			regQueries = ((Object_t*)dm->typeInfo)->queries;
-			break;
-
-		case SOURCE:
-			regQueries = ((Source_t*)dm->typeInfo)->queries;
-			break;
+	return NULL;
+}
+/**
+ * Copies the tuples of the continuation {@link queryCont} from the shared memory and hands them over to the executor.
+ * All pointers within the tuples are rewritten from {@link oldBaseAddr} to {@link newBaseAddr} beforehand.
+ * The caller has to be inside a read section. See SLC_READ_LOCK().
+ * @param rootDM a pointer to the slc datamodel
+ * @param queryCont a pointer to the continuation located in the shared memory
+ * @param oldBaseAddr the base address of the shared memory at the sending layer
+ * @param newBaseAddr the base address of the shared memory at this layer
+ * @return the number of enqueued tuples on success. -1 otherwise.
+ */
+int dispatchQueryContinue(DataModelElement_t *rootDM, QueryContinue_t *queryCont, void *oldBaseAddr, void *newBaseAddr) {
+	Query_t *query = NULL;
+	Tupel_t *curTupleShm = NULL, *curTupleCopy = NULL, *headTupleCopy = NULL, *prevTupleCopy = NULL;
+	int ret = 0;
 
-		// wrong datamodel type
-		default:
-			return NULL;
+	// Try to resolve queryID to a pointer to a real query
+	query = resolveQuery(rootDM,&queryCont->qID);
+	if (query == NULL) {
+		ERR_MSG("No such query: name=%s, id=%d\n",queryCont->qID.name, queryCont->qID.id);
+		return -1;
 	}
-	for (i = 0; i < MAX_QUERIES_PER_DM; i++) {
-		if (regQueries[i] != NULL) {
-			// id and node name match. Got it! \o/
-			if (regQueries[i]->queryID == id->id && strcmp(id->name,((GenStream_t*)regQueries[i]->root)->name) == 0) {
-				return regQueries[i];
+	curTupleShm = (Tupel_t*)(queryCont + 1);
+	// Basically, a continuation can have one or more tuples attached
+	do {
+		rewriteTupleAddress(rootDM,curTupleShm,oldBaseAddr,newBaseAddr);
+		curTupleCopy = copyTupel(rootDM,curTupleShm);
+		if (curTupleCopy == NULL) {
+			ERR_MSG("Cannot copy tuple from shared memory. Freeing all previous copied tuples. Query: name=%s, id=%d\n", queryCont->qID.name, queryCont->qID.id);
+			curTupleCopy = headTupleCopy;
+			// There was an error during copying curTupleShm --> free all tuples copied so far
+			while (curTupleCopy != NULL) {
+				prevTupleCopy = curTupleCopy->next;
+				freeTupel(rootDM,curTupleCopy);
+				curTupleCopy = prevTupleCopy;
 			}
+			return -1;
+		}
+		if (prevTupleCopy != NULL) {
+			prevTupleCopy->next = curTupleCopy;
+		}
+		if (headTupleCopy == NULL) {
+			headTupleCopy = curTupleCopy;
+		}
+		prevTupleCopy = curTupleCopy;
+		curTupleShm = curTupleShm->next;
+		ret++;
+	} while (curTupleShm != NULL);
+	// Handover the tuples and the query to the executor
+	DEBUG_MSG(2,"Enqueueing %d remote tuple(s) for execution.\n",ret);
+	enqueueQuery(query,headTupleCopy,queryCont->steps);
+
+	return ret;
+}
+/**
+ * Dispatches each continuation carried by {@link frame}. See dispatchQueryContinue().
+ * The caller has to be inside a read section. See SLC_READ_LOCK().
+ * @param rootDM a pointer to the slc datamodel
+ * @param frame a pointer to the frame located in the shared memory
+ * @param oldBaseAddr the base address of the shared memory at the sending layer
+ * @param newBaseAddr the base address of the shared memory at this layer
+ * @return the number of dispatched continuations
+ */
+int dispatchQueryContinueFrame(DataModelElement_t *rootDM, QueryContinueFrame_t *frame, void *oldBaseAddr, void *newBaseAddr) {
+	QueryContinue_t *queryCont = NULL;
+	unsigned int offset = QUERY_CONT_ALIGN(sizeof(QueryContinueFrame_t));
+	int i = 0, ret = 0;
+
+	for (i = 0; i < frame->entries; i++) {
+		queryCont = (QueryContinue_t*)((void*)frame + offset);
+		if (queryCont->size < sizeof(QueryContinue_t) || offset + queryCont->size > frame->size) {
+			ERR_MSG("Malformed frame: continuation %d of %u exceeds the frame\n",i,frame->entries);
+			break;
 		}
+		if (dispatchQueryContinue(rootDM,queryCont,oldBaseAddr,newBaseAddr) >= 0) {
+			ret++;
+		}
+		offset += queryCont->size;
 	}
 
-	return NULL;
+	return ret;
 }
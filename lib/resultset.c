@@ -90,7 +90,23 @@ static void freeItem(DataModelElement_t *rootDM, void *value, DataModelElement_t
  */
 void freeTupel(DataModelElement_t *rootDM, Tupel_t *tupel) {
 	DataModelElement_t *element = NULL;
+	Tupel_t *shared = NULL;
 	int i = 0;
+	// Just the owner holds a reference, if it is 1. Hence, no one else can change it concurrently.
+	if (tupel->refs > 1 && __sync_sub_and_fetch(&tupel->refs,1) > 0) {
+		return;
+	}
+	// The items belong to another tuple. Drop the reference to it.
+	if (TEST_BIT(tupel->flags,TUPLE_SHARED)) {
+		shared = tupel->shared;
+		freeObject(tupel);
+		freeTupel(rootDM,shared);
+		return;
+	}	// The tupel was instantiated from a template. It resides in one object.
+	if (TEST_BIT(tupel->flags,TUPLE_TEMPLATE)) {
+		freeObject(tupel);
+		return;
+	}
 	// The tupel is compact. Just one free is needed.
 	if (TEST_BIT(tupel->flags,TUPLE_COMPACT)) {
 		FREE(tupel);
@@ -103,17 +119,17 @@ void freeTupel(DataModelElement_t *rootDM, Tupel_t *tupel) {
 		if ((element = getDescription(rootDM,tupel->items[i]->name)) == NULL) {
 			//if (tupel->items[i]->value != NULL) {
 				// No need to free itmes[i]->value. Interested why? Look at allocItem@resultset.h:361-366
-				FREE(tupel->items[i]);
+				freeObject(tupel->items[i]);
 			//}
 			continue;
 		}
 		DEBUG_MSG(2,"Freeing %s (%p)\n",element->name,tupel->items[i]->value);
 		freeItem(rootDM,tupel->items[i]->value,element);
-		FREE(tupel->items[i]);
+		freeObject(tupel->items[i]);
 	}
 
 	//FREE(tupel->items);
-	FREE(tupel);
+	freeObject(tupel);
 }
 #ifdef __KERNEL__
 EXPORT_SYMBOL(freeTupel);
@@ -128,10 +144,11 @@ EXPORT_SYMBOL(freeTupel);
 void deleteItem(DataModelElement_t *rootDM, Tupel_t *tupel, int slot) {
 	DataModelElement_t *dm = NULL;
 	
-	if (!TEST_BIT(tupel->flags,TUPLE_COMPACT)) {
+	// A shared item is freed along with the tuple it belongs to
+	if (!TEST_BIT(tupel->flags,TUPLE_COMPACT) && !TEST_BIT(tupel->flags,TUPLE_SHARED)) {
 		dm = getDescription(rootDM,tupel->items[slot]->name);
 		freeItem(rootDM,tupel->items[slot]->value,dm);
-		FREE(tupel->items[slot]);
+		freeObject(tupel->items[slot]);
 	}
 	tupel->items[slot] = NULL;
 }
@@ -393,6 +410,10 @@ int copyAndCollectTupel(DataModelElement_t *rootDM, Tupel_t *tupel, void *freeMe
 	memcpy(ret,tupel,sizeof(Tupel_t));
 	// Mark it as compact and store its size
 	SET_BIT(ret->flags,TUPLE_COMPACT);
+	// The copy does not reserve any buffer. Hence, it cannot be treated like a tuple instantiated from a template.
+	ret->flags &= ~(TUPLE_TEMPLATE | TUPLE_SHARED | TUPLE_SIZE_MASK);
+	ret->shared = NULL;
+	ret->refs = 1;
 	ret->next = NULL;
 	ret->items = (Item_t**)(((void*)ret) + sizeof(Tupel_t));
 	// First, count the number of really present items. Due to delete operations one or more items might be deleted.
@@ -555,13 +576,13 @@ static int copyAdditionalMem(DataModelElement_t *rootDM, void *oldValue, void *n
 	return 0;
 }
 /**
- * Copies a tuple, its items and all indirect used memory. The necessary memory will be allocated dynamically.
+ * Copies a tuple, its items and all indirect used memory. Each item and all indirect memory will be allocated on its own.
  * @param rootDM a pointer to the slc datamodel
  * @param tupel a pointer to Tupel
  * @return a pointer to the new tupel on success. NULL otherwise
  * @see copyAdditionalMem()
  */
-Tupel_t* copyTupel(DataModelElement_t *rootDM, Tupel_t *tuple) {
+static Tupel_t* expandTupel(DataModelElement_t *rootDM, Tupel_t *tuple) {
 	int size = 0, i = 0, j = 0, numItems = 0;
 	Tupel_t *ret = NULL;
 	DataModelElement_t *element = NULL;
@@ -589,7 +610,7 @@ Tupel_t* copyTupel(DataModelElement_t *rootDM, Tupel_t *tuple) {
 		element = getDescription(rootDM,tuple->items[i]->name);
 		size = getDataModelSize(rootDM,element,0);
 		// Allocate memory for the item as well for the value
-		ret->items[j] = ALLOC(sizeof(Item_t) + size);
+		ret->items[j] = allocObject(sizeof(Item_t) + size);
 		if (ret->items[j] == NULL) {
 			freeTupel(rootDM,ret);
 			return NULL;
@@ -611,6 +632,60 @@ Tupel_t* copyTupel(DataModelElement_t *rootDM, Tupel_t *tuple) {
 
 	return ret;
 }
+/**
+ * Copies a tuple, its items and all indirect used memory. The necessary memory will be allocated dynamically.
+ * A tuple instantiated from a template is copied as a whole, including its reserved buffers.
+ * @param rootDM a pointer to the slc datamodel
+ * @param tupel a pointer to Tupel
+ * @return a pointer to the new tupel on success. NULL otherwise
+ */
+Tupel_t* copyTupel(DataModelElement_t *rootDM, Tupel_t *tuple) {
+	Tupel_t *ret = NULL;
+
+	if (!TEST_BIT(tuple->flags,TUPLE_TEMPLATE)) {
+		return expandTupel(rootDM,tuple);
+	}
+	ret = allocObject(GET_TUPLE_SIZE(tuple));
+	if (ret == NULL) {
+		return NULL;
+	}
+	memcpy(ret,tuple,GET_TUPLE_SIZE(tuple));
+	rewriteTupleAddress(rootDM,ret,tuple,ret);
+	ret->next = NULL;
+	ret->refs = 1;
+
+	return ret;
+}
+/**
+ * Creates a tuple sharing the items of {@link tuple}, e.g. to hand one tuple over to several queries. Just the header and the item pointer array are allocated.
+ * The items are read-only for all sharers. deleteItem() only removes an item from the sharer, mergeTuple() works on a private copy.
+ * The items are freed along with the last tuple referencing them. {@link tuple} itself has to be freed by its owner as usual.
+ * @param tuple a pointer to the tuple whose items should be shared
+ * @return a pointer to the new tupel on success. NULL otherwise
+ */
+Tupel_t* shareTupel(Tupel_t *tuple) {
+	Tupel_t *ret = NULL, *shared = NULL;
+
+	// Do not build chains. Refer to the tuple owning the items.
+	shared = (TEST_BIT(tuple->flags,TUPLE_SHARED) ? tuple->shared : tuple);
+	ret = initTupel(tuple->timestamp,tuple->itemLen);
+	if (ret == NULL) {
+		return NULL;
+	}
+#ifdef EVALUATION
+	ret->timestamp2 = tuple->timestamp2;
+	ret->timestamp3 = tuple->timestamp3;
+#endif
+	memcpy(ret->items,tuple->items,sizeof(Item_t*) * tuple->itemLen);
+	SET_BIT(ret->flags,TUPLE_SHARED);
+	ret->shared = shared;
+	__sync_fetch_and_add(&shared->refs,1);
+
+	return ret;
+}
+#ifdef __KERNEL__
+EXPORT_SYMBOL(shareTupel);
+#endif
 /**
  * Depending on the memory layout which is derived from the {@link element} the function traverses all indirect allocated memory and rewrites all
  * addresses.
@@ -747,6 +822,23 @@ void rewriteTupleAddress(DataModelElement_t *rootDM, Tupel_t *tuple, void *oldBa
 int mergeTuple(DataModelElement_t *rootDM, Tupel_t **tupleA, Tupel_t *tupleB) {
 	int i = 0, j = 0, newItems = 0, newIdx = 0, deleted = 0;
 	DataModelElement_t *element = NULL;
+	Tupel_t *temp = NULL;
+
+	// The items of a compact or shared tuple cannot be moved or freed one by one. Expand it to a private copy first.
+	if (TEST_BIT((*tupleA)->flags,TUPLE_COMPACT) || TEST_BIT((*tupleA)->flags,TUPLE_SHARED)) {
+		if ((temp = expandTupel(rootDM,*tupleA)) == NULL) {
+			return -1;
+		}
+		freeTupel(rootDM,*tupleA);
+		*tupleA = temp;
+	}
+	if (TEST_BIT(tupleB->flags,TUPLE_COMPACT) || TEST_BIT(tupleB->flags,TUPLE_SHARED)) {
+		if ((temp = expandTupel(rootDM,tupleB)) == NULL) {
+			return -1;
+		}
+		freeTupel(rootDM,tupleB);
+		tupleB = temp;
+	}
 
 	// count the number of mergeable items
 	for (i = 0; i < tupleB->itemLen; i++) {
@@ -758,13 +850,13 @@ int mergeTuple(DataModelElement_t *rootDM, Tupel_t **tupleA, Tupel_t *tupleB) {
 				element = getDescription(rootDM,tupleB->items[i]->name);
 				if (element == NULL) {
 					// No need to free itmes[i]->value. Interested why? Look at allocItem@resultset.h:361-366
-					FREE(tupleB->items[i]);
+					freeObject(tupleB->items[i]);
 					break;
 				}
 				// Yes! Delete it.
 				DEBUG_MSG(2,"Freeing %s (%p)\n",element->name,tupleB->items[i]->value);
 				freeItem(rootDM,tupleB->items[i]->value,element);
-				FREE(tupleB->items[i]);
+				freeObject(tupleB->items[i]);
 				tupleB->items[i] = NULL;
 				deleted = 1;
 				break;
@@ -788,7 +880,241 @@ int mergeTuple(DataModelElement_t *rootDM, Tupel_t **tupleA, Tupel_t *tupleB) {
 		(*tupleA)->items[newIdx] = tupleB->items[i];
 		newIdx++;
 	}
-	FREE(tupleB);
+	freeObject(tupleB);
+
+	return 0;
+}
+
+/**
+ * Resolves the path {@link typeName} once into an accessor. {@link typeName} has to be located within the item
+ * {@link itemTypeName}, which resides at position {@link slot} in the item pointer array, e.g. "net.packetType.dataLength" within "net.packetType".
+ * If {@link typeName} is equal to {@link itemTypeName}, the accessor describes the item itself.
+ * The datamodel providing {@link itemTypeName} has to be registered before. Any change to the layout of this datamodel invalidates the accessor.
+ * @param rootDM a pointer to the slc datamodel
+ * @param accessor a pointer to the accessor which should be initialized
+ * @param slot the position of the item within the item pointer array
+ * @param itemTypeName a path description for the item
+ * @param typeName a path description for the member
+ * @return 0 on success. A value below 0 indicates an error.
+ */
+int initMemberAccessor(DataModelElement_t *rootDM, MemberAccessor_t *accessor, int slot, char *itemTypeName, char *typeName) {
+	DataModelElement_t *dm = NULL;
+	char *childName = NULL, *tokenEnd = NULL;
+	DECLARE_BUFFER(token)
+	int offset = 0, ret = 0, i = 0, len = 0;
+
+	if (accessor == NULL || itemTypeName == NULL || typeName == NULL || slot < 0) {
+		return -EPARAM;
+	}
+	len = strlen(itemTypeName);
+	if (len > MAX_NAME_LEN || strncmp(typeName,itemTypeName,len) != 0 || (typeName[len] != '\0' && typeName[len] != '.')) {
+		return -EPARAM;
+	}
+	dm = getDescription(rootDM,itemTypeName);
+	if (dm == NULL) {
+		return -ENOELEMENT;
+	}
+	accessor->itemSize = getDataModelSize(rootDM,dm,1);
+	if (accessor->itemSize == -1) {
+		return -ENOELEMENT;
+	}
+	childName = typeName + len;
+	if (*childName == '.') {
+		if (dm->dataModelType != COMPLEX) {
+			return -ENOELEMENT;
+		}
+		childName++;
+	}
+	// Walk down the complex type and sum up the offset of each member. The same way getMemberPointer() does.
+	while (*childName != '\0') {
+		tokenEnd = strchr(childName,'.');
+		len = (tokenEnd == NULL ? strlen(childName) : tokenEnd - childName);
+		if (len > MAX_NAME_LEN) {
+			return -ENOELEMENT;
+		}
+		memcpy(token,childName,len);
+		token[len] = '\0';
+		ret = getComplexTypeOffset(rootDM,dm,token);
+		if (ret == -1) {
+			return -ENOELEMENT;
+		}
+		offset += ret;
+		for (i = 0; i < dm->childrenLen; i++) {
+			if (strcmp(dm->children[i]->name,token) == 0) {
+				break;
+			}
+		}
+		if (i >= dm->childrenLen) {
+			return -ENOELEMENT;
+		}
+		dm = dm->children[i];
+		childName += len + (tokenEnd == NULL ? 0 : 1);
+	}
+
+	memset(accessor->itemName,0,MAX_NAME_LEN + 1);
+	strncpy(accessor->itemName,itemTypeName,MAX_NAME_LEN);
+	accessor->slot = slot;
+	accessor->offset = offset;
+	accessor->type = resolveType(rootDM,dm);
+	accessor->size = getDataModelSize(rootDM,dm,1);
+	accessor->dm = dm;
+	DEBUG_MSG(2,"Resolved %s to slot %d, offset %d, type 0x%x\n",typeName,slot,offset,accessor->type);
+
+	return 0;
+}
+#ifdef __KERNEL__
+EXPORT_SYMBOL(initMemberAccessor);
+#endif
+
+/**
+ * Resolves {@link num} accessors described by {@link desc}. See initMemberAccessor().
+ * @param rootDM a pointer to the slc datamodel
+ * @param desc an array of accessor descriptions
+ * @param num the number of elements in {@link desc}
+ * @return 0 on success. Otherwise the error of the first accessor which cannot be resolved.
+ */
+int initMemberAccessors(DataModelElement_t *rootDM, MemberAccessorDesc_t *desc, int num) {
+	int i = 0, ret = 0;
+
+	for (i = 0; i < num; i++) {
+		ret = initMemberAccessor(rootDM,desc[i].accessor,desc[i].slot,desc[i].itemTypeName,desc[i].typeName);
+		if (ret < 0) {
+			ERR_MSG("Cannot resolve accessor for %s: %d\n",desc[i].typeName,-ret);
+			return ret;
+		}
+	}
+	return 0;
+}
+#ifdef __KERNEL__
+EXPORT_SYMBOL(initMemberAccessors);
+#endif
+
+/**
+ * Computes the layout of the tuples consisting of the items {@link itemTypeNames} and builds the image each tuple is copied from.
+ * The i-th item resides at position i in the item pointer array. The accessors used by {@link buffers} have to be resolved for these slots.
+ * @param rootDM a pointer to the slc datamodel
+ * @param tmpl a pointer to the template which should be initialized
+ * @param itemTypeNames an array of path descriptions, one for each item
+ * @param numItems the number of elements in {@link itemTypeNames}
+ * @param buffers an array describing a buffer for each string and array member of the items
+ * @param numBuffers the number of elements in {@link buffers}
+ * @return 0 on success. A value below 0 indicates an error.
+ */
+int initTupleTemplate(DataModelElement_t *rootDM, TupleTemplate_t *tmpl, char **itemTypeNames, int numItems, TupleBufferDesc_t *buffers, int numBuffers) {
+	DataModelElement_t *dm = NULL;
+	MemberAccessor_t *accessor = NULL;
+	Tupel_t *tuple = NULL;
+	int i = 0, size = 0, offset = 0, type = 0;
+
+	if (tmpl == NULL || itemTypeNames == NULL || numItems <= 0 || numItems > MAX_TEMPLATE_ITEMS || numBuffers < 0 || numBuffers > MAX_TEMPLATE_BUFFERS || (numBuffers > 0 && buffers == NULL)) {
+		return -EPARAM;
+	}
+	memset(tmpl,0,sizeof(TupleTemplate_t));
+	offset = TUPLE_TEMPLATE_ALIGN(sizeof(Tupel_t) + numItems * sizeof(Item_t*));
+	for (i = 0; i < numItems; i++) {
+		if (strlen(itemTypeNames[i]) > MAX_NAME_LEN) {
+			return -EPARAM;
+		}
+		dm = getDescription(rootDM,itemTypeNames[i]);
+		if (dm == NULL) {
+			return -ENOELEMENT;
+		}
+		size = getDataModelSize(rootDM,dm,1);
+		if (size == -1) {
+			return -ENOELEMENT;
+		}
+		tmpl->itemOffset[i] = offset;
+		offset += TUPLE_TEMPLATE_ALIGN(sizeof(Item_t) + size);
+	}
+	for (i = 0; i < numBuffers; i++) {
+		accessor = buffers[i].accessor;
+		if (accessor == NULL || accessor->dm == NULL || accessor->slot >= numItems || buffers[i].capacity <= 0 || strcmp(accessor->itemName,itemTypeNames[accessor->slot]) != 0) {
+			return -EPARAM;
+		}
+		type = accessor->type;
+		// A string array would need a buffer for each string
+		if ((type & (STRING | ARRAY)) == (STRING | ARRAY) || (type & (STRING | ARRAY)) == 0) {
+			return -EPARAM;
+		}
+		tmpl->pointerOffset[i] = tmpl->itemOffset[accessor->slot] + sizeof(Item_t) + accessor->offset;
+		// The capacity precedes the buffer
+		offset += sizeof(int);
+		tmpl->bufferOffset[i] = offset;
+		if (type & ARRAY) {
+			offset += TUPLE_TEMPLATE_ALIGN(sizeof(int) + buffers[i].capacity * accessor->size + sizeof(int)) - sizeof(int);
+		} else {
+			offset += TUPLE_TEMPLATE_ALIGN(buffers[i].capacity + sizeof(int)) - sizeof(int);
+		}
+	}
+	if (offset > (TUPLE_SIZE_MASK >> TUPLE_SIZE_SHIFT)) {
+		return -EPARAM;
+	}
+	tmpl->size = offset;
+	tmpl->itemLen = numItems;
+	tmpl->bufferLen = numBuffers;
+	tmpl->image = ALLOC(tmpl->size);
+	if (tmpl->image == NULL) {
+		return -ENOMEMORY;
+	}
+	memset(tmpl->image,0,tmpl->size);
+
+	tuple = (Tupel_t*)tmpl->image;
+	tuple->flags = TUPLE_COMPACT | TUPLE_TEMPLATE | (tmpl->size << TUPLE_SIZE_SHIFT);
+	tuple->refs = 1;
+	tuple->itemLen = numItems;
+	for (i = 0; i < numItems; i++) {
+		strncpy(((Item_t*)(tmpl->image + tmpl->itemOffset[i]))->name,itemTypeNames[i],MAX_NAME_LEN);
+	}
+	for (i = 0; i < numBuffers; i++) {
+		*(int*)(tmpl->image + tmpl->bufferOffset[i] - sizeof(int)) = buffers[i].capacity;
+	}
+	DEBUG_MSG(2,"Compiled a template with %d items and %d buffers into %d bytes\n",numItems,numBuffers,tmpl->size);
 
 	return 0;
 }
+#ifdef __KERNEL__
+EXPORT_SYMBOL(initTupleTemplate);
+#endif
+
+void freeTupleTemplate(TupleTemplate_t *tmpl) {
+	if (tmpl->image != NULL) {
+		FREE(tmpl->image);
+		tmpl->image = NULL;
+	}
+}
+#ifdef __KERNEL__
+EXPORT_SYMBOL(freeTupleTemplate);
+#endif
+
+/**
+ * Allocates a tuple laid out by {@link tmpl} and copies its image. All strings are empty and all arrays have zero elements.
+ * Neither the items nor any string or array have to be allocated afterwards.
+ * @param tmpl a pointer to a template initialized by initTupleTemplate()
+ * @param timestamp time in millisecond the tupel was created
+ * @return a pointer to a newly allocated tupel or NULL if allocation fails.
+ */
+Tupel_t* initTupelFromTemplate(TupleTemplate_t *tmpl, unsigned long long timestamp) {
+	Tupel_t *ret = NULL;
+	void *base = NULL;
+	int i = 0;
+
+	if ((ret = allocObject(tmpl->size)) == NULL) {
+		return NULL;
+	}
+	memcpy(ret,tmpl->image,tmpl->size);
+	base = ret;
+	ret->timestamp = timestamp;
+	ret->items = (Item_t**)(ret + 1);
+	for (i = 0; i < tmpl->itemLen; i++) {
+		ret->items[i] = (Item_t*)(base + tmpl->itemOffset[i]);
+		ret->items[i]->value = ret->items[i] + 1;
+	}
+	for (i = 0; i < tmpl->bufferLen; i++) {
+		*(PTR_TYPE*)(base + tmpl->pointerOffset[i]) = (PTR_TYPE)(base + tmpl->bufferOffset[i]);
+	}
+
+	return ret;
+}
+#ifdef __KERNEL__
+EXPORT_SYMBOL(initTupelFromTemplate);
+#endif
@@ -0,0 +1,108 @@
+#define MSG_FMT(fmt) "[slc-epoch] " fmt
+#include <common.h>
+#include <output.h>
+#include <epoch.h>
+#include <sys/syscall.h>
+#include <linux/membarrier.h>
+
+__thread EpochReader_t epochReader = { 0, 0, NULL };
+__thread int epochRegistered = 0;
+/**
+ * Starts at 1. Hence, 0 always means "outside of a read section".
+ */
+unsigned long globalEpoch = 1;
+int epochMembarrier = 0;
+
+/**
+ * All threads which ever entered a read section. A thread unlinks itself, once it terminates.
+ * synchronizeEpoch() holds epochLock while it walks the list. Hence, only one grace period is awaited at a time.
+ */
+static EpochReader_t *epochReaders = NULL;
+static pthread_mutex_t epochLock = PTHREAD_MUTEX_INITIALIZER;
+static int epochMembarrierChecked = 0;
+/**
+ * Its destructor unlinks the EpochReader_t of a terminating thread
+ */
+static pthread_key_t epochKey;
+static pthread_once_t epochKeyOnce = PTHREAD_ONCE_INIT;
+
+static void unregisterEpochReader(void *data) {
+	EpochReader_t *reader = (EpochReader_t*)data, **cur = NULL;
+
+	pthread_mutex_lock(&epochLock);
+	for (cur = &epochReaders; *cur != NULL; cur = &(*cur)->next) {
+		if (*cur == reader) {
+			*cur = reader->next;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&epochLock);
+}
+
+static void createEpochKey(void) {
+	if (pthread_key_create(&epochKey,unregisterEpochReader) != 0) {
+		ERR_MSG("Cannot create the epoch key\n");
+	}
+}
+
+void registerEpochReader(void) {
+	pthread_once(&epochKeyOnce,createEpochKey);
+	pthread_setspecific(epochKey,&epochReader);
+	pthread_mutex_lock(&epochLock);
+	epochReader.next = epochReaders;
+	epochReaders = &epochReader;
+	pthread_mutex_unlock(&epochLock);
+	epochRegistered = 1;
+}
+
+/**
+ * Registers the process for expedited membarrier(2) calls. If it succeeds, readers omit their memory barrier.
+ * The caller has to hold epochLock. Thus, no grace period is awaited without the barrier, while a reader already omits it.
+ */
+static void checkMembarrier(void) {
+	long cmds = 0;
+
+	epochMembarrierChecked = 1;
+	cmds = syscall(__NR_membarrier,MEMBARRIER_CMD_QUERY,0);
+	if (cmds < 0 || (cmds & MEMBARRIER_CMD_PRIVATE_EXPEDITED) == 0) {
+		DEBUG_MSG(1,"membarrier(2) is not available. Readers issue a memory barrier.\n");
+		return;
+	}
+	if (syscall(__NR_membarrier,MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED,0) < 0) {
+		DEBUG_MSG(1,"Cannot register for membarrier(2): %s\n",strerror(errno));
+		return;
+	}
+	__atomic_store_n(&epochMembarrier,1,__ATOMIC_RELEASE);
+}
+
+/**
+ * Waits until each thread, which was inside a read section upon the call, left it.
+ * The calling thread must not be inside a read section. Otherwise, it would wait for itself. In this case, it is skipped.
+ */
+void synchronizeEpoch(void) {
+	EpochReader_t *reader = NULL;
+	unsigned long epoch = 0, cur = 0;
+
+	pthread_mutex_lock(&epochLock);
+	if (!epochMembarrierChecked) {
+		checkMembarrier();
+	}
+	// Anything the caller unlinked has to be visible before the new epoch
+	epoch = __atomic_add_fetch(&globalEpoch,1,__ATOMIC_SEQ_CST);
+	if (epochMembarrier) {
+		// Each reader issues the memory barrier it omitted in epochReadLock()
+		syscall(__NR_membarrier,MEMBARRIER_CMD_PRIVATE_EXPEDITED,0);
+	} else {
+		MEMORY_BARRIER();
+	}
+	for (reader = epochReaders; reader != NULL; reader = reader->next) {
+		if (reader == &epochReader && epochReader.depth > 0) {
+			ERR_MSG("Waiting for a grace period inside a read section\n");
+			continue;
+		}
+		while ((cur = LOAD_ACQUIRE(&reader->epoch)) != 0 && cur < epoch) {
+			sched_yield();
+		}
+	}
+	pthread_mutex_unlock(&epochLock);
+}
@@ -0,0 +1,502 @@
+#define MSG_FMT(fmt) "[slc-exec] " fmt
+#include <api.h>
+#include <executor.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sched.h>
+#include <limits.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+/**
+ * A single executor thread. Besides the shared queue, each one owns a queue for the jobs of ORDERED queries.
+ * Those queries are mapped to an executor by their id. Hence, their tuples are executed one after another in
+ * the order they were enqueued.
+ * The urgent lane is an executor of its own. It only runs the jobs of urgent queries, which are put to its ordered queue.
+ */
+typedef struct Executor {
+	ExecQueue_t ordered;
+	pthread_t thread;
+	/**
+	 * Set while the executor waits for jobs. Producers only issue a futex wake, if it is set.
+	 */
+	int sleeping __attribute__((aligned(RING_CACHELINE_SIZE)));
+	/**
+	 * The futex word. Each wakeup increments it.
+	 */
+	int wakeSeq;
+	unsigned long long executed __attribute__((aligned(RING_CACHELINE_SIZE)));
+	unsigned long long sleeps;
+} Executor_t;
+
+/**
+ * Holds the jobs of all queries, which are not ORDERED. Any executor may run them.
+ */
+static ExecQueue_t *sharedQueue = NULL;
+static Executor_t *executors = NULL;
+/**
+ * Lives right behind the other executors. It never touches the shared queue. Hence, bulk traffic cannot delay an urgent query.
+ */
+static Executor_t *urgentExecutor = NULL;
+static unsigned int numExecutors = 0;
+static int executorsRunning = 0;
+static unsigned int maxWaiting = 0;
+static unsigned long long wakeups = 0, queueFull = 0, droppedJobs = 0;
+/**
+ * stopExecutors() adds the counters of the terminated executors
+ */
+static unsigned long long executedTotal = 0, urgentTotal = 0, sleepsTotal = 0;
+/**
+ * Points to the executor the calling thread belongs to. NULL for any other thread.
+ */
+static __thread Executor_t *currentExecutor = NULL;
+
+static void initExecQueue(ExecQueue_t *queue) {
+	unsigned long i = 0;
+
+	queue->enqueuePos = 0;
+	queue->dequeuePos = 0;
+	for (i = 0; i < EXEC_QUEUE_SIZE; i++) {
+		queue->slots[i].seq = i;
+		queue->slots[i].query = NULL;
+		queue->slots[i].tuple = NULL;
+	}
+}
+
+/**
+ * A slot is free for the producer claiming position pos, if its sequence equals pos.
+ * The producer publishes the job by setting it to pos + 1. The consumer frees the slot for the next lap by setting it to pos + EXEC_QUEUE_SIZE.
+ * @return 0 on success. -1, if the queue is full.
+ */
+static int execQueuePush(ExecQueue_t *queue, Query_t *query, Tupel_t *tuple, int step) {
+	ExecSlot_t *slot = NULL;
+	unsigned long pos = __atomic_load_n(&queue->enqueuePos,__ATOMIC_RELAXED);
+	long diff = 0;
+
+	for (;;) {
+		slot = &queue->slots[pos & (EXEC_QUEUE_SIZE - 1)];
+		diff = (long)LOAD_ACQUIRE(&slot->seq) - (long)pos;
+		if (diff == 0) {
+			if (__atomic_compare_exchange_n(&queue->enqueuePos,&pos,pos + 1,1,__ATOMIC_RELAXED,__ATOMIC_RELAXED)) {
+				break;
+			}
+		} else if (diff < 0) {
+			// The slot still holds a job from the previous lap
+			return -1;
+		} else {
+			pos = __atomic_load_n(&queue->enqueuePos,__ATOMIC_RELAXED);
+		}
+	}
+	slot->tuple = tuple;
+	slot->step = step;
+	// cancelQueuedJobs() may clear the query, once it is visible. The tuple stays with the slot until it is dequeued.
+	STORE_RELEASE(&slot->query,query);
+	STORE_RELEASE(&slot->seq,pos + 1);
+
+	return 0;
+}
+
+/**
+ * @return 0 on success. -1, if the queue is empty.
+ */
+static int execQueuePop(ExecQueue_t *queue, ExecSlot_t *job) {
+	ExecSlot_t *slot = NULL;
+	unsigned long pos = __atomic_load_n(&queue->dequeuePos,__ATOMIC_RELAXED);
+	long diff = 0;
+
+	for (;;) {
+		slot = &queue->slots[pos & (EXEC_QUEUE_SIZE - 1)];
+		diff = (long)LOAD_ACQUIRE(&slot->seq) - (long)(pos + 1);
+		if (diff == 0) {
+			if (__atomic_compare_exchange_n(&queue->dequeuePos,&pos,pos + 1,1,__ATOMIC_RELAXED,__ATOMIC_RELAXED)) {
+				break;
+			}
+		} else if (diff < 0) {
+			return -1;
+		} else {
+			pos = __atomic_load_n(&queue->dequeuePos,__ATOMIC_RELAXED);
+		}
+	}
+	// The job got canceled, if its query is gone. Only the consumer knows, which lap the tuple belongs to. Hence, it frees it.
+	job->query = __atomic_exchange_n(&slot->query,NULL,__ATOMIC_ACQ_REL);
+	job->tuple = slot->tuple;
+	job->step = slot->step;
+	if (job->query == NULL && job->tuple != NULL) {
+		freeTupel(SLC_DATA_MODEL,job->tuple);
+		job->tuple = NULL;
+	}
+	STORE_RELEASE(&slot->seq,pos + EXEC_QUEUE_SIZE);
+
+	return 0;
+}
+
+static unsigned int execQueueWaiting(ExecQueue_t *queue) {
+	// Read the consumer position first. It never overtakes the producer position read afterwards.
+	unsigned long dequeuePos = LOAD_ACQUIRE(&queue->dequeuePos);
+
+	return LOAD_ACQUIRE(&queue->enqueuePos) - dequeuePos;
+}
+
+static void wakeExecutor(Executor_t *executor) {
+	__sync_fetch_and_add(&executor->wakeSeq,1);
+	syscall(SYS_futex,&executor->wakeSeq,FUTEX_WAKE_PRIVATE,1,NULL,NULL,0);
+	__sync_fetch_and_add(&wakeups,1);
+}
+
+/**
+ * Claims {@link executor}, if it is sleeping. Otherwise, concurrent producers would wake it up over and over again.
+ * @return 1, if the executor was woken up. 0 otherwise.
+ */
+static int claimAndWake(Executor_t *executor) {
+	if (LOAD_ACQUIRE(&executor->sleeping) == 1 && __sync_bool_compare_and_swap(&executor->sleeping,1,0)) {
+		wakeExecutor(executor);
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * Blocks until a producer wakes up the executor {@link self} or, if {@link timeoutNS} is not zero, the timeout expires.
+ * The executor announces itself as sleeping before it checks its queues a last time. A producer checks the flag after
+ * publishing its job. Either the executor sees the job or the producer sees the flag. The futex wait fails, if the wakeup came in between.
+ */
+static void waitForJobs(Executor_t *self, unsigned long long timeoutNS) {
+	struct timespec timeout = { .tv_sec = timeoutNS / 1000000000ULL, .tv_nsec = timeoutNS % 1000000000ULL };
+	int seq = LOAD_ACQUIRE(&self->wakeSeq);
+
+	__atomic_store_n(&self->sleeping,1,__ATOMIC_SEQ_CST);
+	MEMORY_BARRIER();
+	if (execQueueWaiting(&self->ordered) == 0 && (self == urgentExecutor || execQueueWaiting(sharedQueue) == 0) && LOAD_ACQUIRE(&executorsRunning) == 1) {
+		self->sleeps++;
+		if (syscall(SYS_futex,&self->wakeSeq,FUTEX_WAIT_PRIVATE,seq,(timeoutNS != 0 ? &timeout : NULL),NULL,0) < 0 && errno != EAGAIN && errno != EINTR && errno != ETIMEDOUT) {
+			ERR_MSG("futex wait failed: %s\n",strerror(errno));
+		}
+	}
+	STORE_RELEASE(&self->sleeping,0);
+}
+
+static int dequeueJob(Executor_t *self, ExecSlot_t *job) {
+	if (execQueuePop(&self->ordered,job) == 0) {
+		return 0;
+	}
+	if (self == urgentExecutor) {
+		return -1;
+	}
+	return execQueuePop(sharedQueue,job);
+}
+
+static void runJob(ExecSlot_t *job) {
+	// cancelQueryJobs() clears the query of a job, if its query got deleted
+	if (job->query != NULL && job->tuple == NULL) {
+		runSourceTimer(job->query);
+	} else if (job->query != NULL) {
+		DEBUG_MSG(3,"%s: Executing query 0x%x with tuple %p\n",__FUNCTION__,job->query->queryID,job->tuple);
+		executeQuery(SLC_DATA_MODEL,job->query,job->tuple,job->step);
+	}
+}
+
+static void* executorWork(void *data) {
+	Executor_t *self = (Executor_t*)data;
+	ExecSlot_t job;
+	unsigned long long flushWait = 0;
+	int executed = 0;
+
+	currentExecutor = self;
+	DEBUG_MSG(3,"Started executor %ld\n",(long)(self - executors));
+	for (;;) {
+		executed = 0;
+		// A queries execution just reads from the datamodel. A writer waits for the read section to end, before it frees anything.
+		SLC_READ_LOCK();
+		while (executed < EXEC_BATCH_SIZE && dequeueJob(self,&job) == 0) {
+			runJob(&job);
+			executed++;
+		}
+		SLC_READ_UNLOCK();
+		self->executed += executed;
+		if (executed == EXEC_BATCH_SIZE) {
+			// A long backlog must not hold back the windows of quiet streams and the continuations collected so far either
+			flushExpiredWindows();
+			flushExpiredQueryContinues();
+			// Do not let a writer wait for a grace period until the whole backlog is done
+			continue;
+		}
+		// No more queries to execute. Do not hold back the windows of quiet streams and the continuations collected so far.
+		flushWait = flushExpiredWindows();
+		flushQueryContinues();
+		if (LOAD_ACQUIRE(&executorsRunning) == 0) {
+			break;
+		}
+		// The urgent lane wakes up on its own to flush the windows of quiet streams, even if no job arrives
+		waitForJobs(self,(self == urgentExecutor ? flushWait : 0));
+	}
+	DEBUG_MSG(3,"%s: Were asked to terminate.\n",__FUNCTION__);
+
+	return NULL;
+}
+
+/**
+ * Starts {@link numThreads} executors and the urgent lane. If it is 0, one executor per online CPU will be started.
+ */
+int startExecutors(unsigned int numThreads) {
+	unsigned int i = 0;
+	void *mem = NULL;
+
+	if (numThreads == 0) {
+		numThreads = sysconf(_SC_NPROCESSORS_ONLN);
+	}
+	if (numThreads == 0 || numThreads > MAX_EXEC_THREADS) {
+		numThreads = MAX_EXEC_THREADS;
+	}
+	if (posix_memalign(&mem,RING_CACHELINE_SIZE,sizeof(ExecQueue_t)) != 0) {
+		ERR_MSG("Cannot allocate memory for the shared queue\n");
+		return -ENOMEMORY;
+	}
+	sharedQueue = (ExecQueue_t*)mem;
+	if (posix_memalign(&mem,RING_CACHELINE_SIZE,sizeof(Executor_t) * (numThreads + 1)) != 0) {
+		ERR_MSG("Cannot allocate memory for %u executors\n",numThreads);
+		FREE(sharedQueue);
+		sharedQueue = NULL;
+		return -ENOMEMORY;
+	}
+	executors = (Executor_t*)mem;
+	initExecQueue(sharedQueue);
+	memset(executors,0,sizeof(Executor_t) * (numThreads + 1));
+	for (i = 0; i <= numThreads; i++) {
+		initExecQueue(&executors[i].ordered);
+	}
+	maxWaiting = 0;
+	wakeups = 0;
+	queueFull = 0;
+	droppedJobs = 0;
+	executedTotal = 0;
+	urgentTotal = 0;
+	sleepsTotal = 0;
+	numExecutors = 0;
+	executorsRunning = 1;
+	// The urgent lane must know it is one right from the start. Otherwise, it would take jobs from the shared queue.
+	urgentExecutor = &executors[numThreads];
+	if (pthread_create(&urgentExecutor->thread,NULL,executorWork,urgentExecutor) != 0) {
+		ERR_MSG("Cannot create the urgent lane: %s\n",strerror(errno));
+		executorsRunning = 0;
+		urgentExecutor = NULL;
+		FREE(executors);
+		FREE(sharedQueue);
+		executors = NULL;
+		sharedQueue = NULL;
+		return -EPARAM;
+	}
+	numExecutors = numThreads;
+	for (i = 0; i < numThreads; i++) {
+		if (pthread_create(&executors[i].thread,NULL,executorWork,&executors[i]) != 0) {
+			ERR_MSG("Cannot create executor %u: %s\n",i,strerror(errno));
+			// Jobs mapped to a missing executor would never run
+			numExecutors = i;
+			stopExecutors();
+			return -EPARAM;
+		}
+	}
+	INFO_MSG("Started %u executor threads and the urgent lane\n",numThreads);
+
+	return 0;
+}
+
+/**
+ * Waits for all executors to run the remaining jobs and terminate.
+ */
+void stopExecutors(void) {
+	unsigned int i = 0;
+
+	STORE_RELEASE(&executorsRunning,0);
+	MEMORY_BARRIER();
+	for (i = 0; i < numExecutors; i++) {
+		wakeExecutor(&executors[i]);
+	}
+	if (urgentExecutor != NULL) {
+		wakeExecutor(urgentExecutor);
+	}
+	for (i = 0; i < numExecutors; i++) {
+		pthread_join(executors[i].thread,NULL);
+		executedTotal += executors[i].executed;
+		sleepsTotal += executors[i].sleeps;
+	}
+	if (urgentExecutor != NULL) {
+		pthread_join(urgentExecutor->thread,NULL);
+		executedTotal += urgentExecutor->executed;
+		urgentTotal += urgentExecutor->executed;
+		sleepsTotal += urgentExecutor->sleeps;
+	}
+	FREE(executors);
+	urgentExecutor = NULL;
+	FREE(sharedQueue);
+	executors = NULL;
+	sharedQueue = NULL;
+	numExecutors = 0;
+}
+
+/**
+ * Selects the queue for a job of {@link query}. The jobs of an ORDERED query always go to the same executor, the ones of an urgent query to the urgent lane.
+ * @param executor set to the executor owning the queue. NULL for the shared queue.
+ */
+static ExecQueue_t* selectExecQueue(Query_t *query, Executor_t **executor) {
+	*executor = NULL;
+	if (isQueryUrgent(query)) {
+		*executor = urgentExecutor;
+	} else if ((query->flags & ORDERED) != 0) {
+		*executor = &executors[query->queryID % numExecutors];
+	}
+	return (*executor != NULL ? &(*executor)->ordered : sharedQueue);
+}
+
+/**
+ * Wakes up an executor for the job just pushed to {@link queue}. A sleeping executor will only be woken up, if there is one.
+ */
+static void notifyExecutors(ExecQueue_t *queue, Executor_t *executor) {
+	unsigned int i = 0, waiting = 0;
+
+	// Just a statistic. A lost update does not matter.
+	waiting = execQueueWaiting(queue);
+	if (waiting > __atomic_load_n(&maxWaiting,__ATOMIC_RELAXED)) {
+		__atomic_store_n(&maxWaiting,waiting,__ATOMIC_RELAXED);
+	}
+	// Pairs with the barrier in waitForJobs()
+	MEMORY_BARRIER();
+	if (executor != NULL) {
+		claimAndWake(executor);
+		return;
+	}
+	for (i = 0; i < numExecutors; i++) {
+		if (claimAndWake(&executors[i])) {
+			break;
+		}
+	}
+}
+
+/**
+ * Runs the jobs queued for the calling executor {@link self} in its own ordered queue, until it is empty.
+ * The caller is inside a read section already.
+ */
+static void drainOrderedQueue(Executor_t *self) {
+	ExecSlot_t job;
+
+	while (execQueuePop(&self->ordered,&job) == 0) {
+		runJob(&job);
+		self->executed++;
+	}
+}
+
+/**
+ * Enqueues a job for any executor. If the queue is full, it waits for the executors to catch up.
+ * An executor would wait for itself. Hence, it runs a job for the shared queue by itself.
+ * The jobs of an ORDERED or urgent query must not overtake the ones queued before. An executor
+ * runs its own ordered queue first. It drops a job for the ordered queue of another executor.
+ */
+void submitQueryJob(Query_t *query, Tupel_t *tuple, int step) {
+	Executor_t *executor = NULL;
+	ExecQueue_t *queue = selectExecQueue(query,&executor);
+	ExecSlot_t job;
+
+	while (execQueuePush(queue,query,tuple,step) < 0) {
+		__sync_fetch_and_add(&queueFull,1);
+		if (currentExecutor == NULL) {
+			sched_yield();
+		} else if (executor == NULL) {
+			job.query = query;
+			job.tuple = tuple;
+			job.step = step;
+			runJob(&job);
+			return;
+		} else if (executor == currentExecutor) {
+			drainOrderedQueue(currentExecutor);
+		} else {
+			// The other executor might be waiting for this one. Do not wait for it.
+			__sync_fetch_and_add(&droppedJobs,1);
+			ERR_MSG("Ordered queue of query 0x%x is full. Dropping job.\n",query->queryID);
+			if (tuple != NULL) {
+				freeTupel(SLC_DATA_MODEL,tuple);
+			}
+			return;
+		}
+	}
+	notifyExecutors(queue,executor);
+}
+
+/**
+ * Works like submitQueryJob(), but never blocks. The timing thread uses it.
+ * @return 0 on success. -1, if the queue is full.
+ */
+int trySubmitQueryJob(Query_t *query, Tupel_t *tuple, int step) {
+	Executor_t *executor = NULL;
+	ExecQueue_t *queue = selectExecQueue(query,&executor);
+
+	if (execQueuePush(queue,query,tuple,step) < 0) {
+		__sync_fetch_and_add(&queueFull,1);
+		return -1;
+	}
+	notifyExecutors(queue,executor);
+
+	return 0;
+}
+
+static void cancelQueuedJobs(ExecQueue_t *queue, Query_t *query) {
+	ExecSlot_t *slot = NULL;
+	unsigned long pos = 0, end = LOAD_ACQUIRE(&queue->enqueuePos);
+	Query_t *expected = NULL;
+
+	for (pos = LOAD_ACQUIRE(&queue->dequeuePos); pos != end; pos++) {
+		slot = &queue->slots[pos & (EXEC_QUEUE_SIZE - 1)];
+		if (LOAD_ACQUIRE(&slot->seq) != pos + 1) {
+			continue;
+		}
+		/*
+		 * An executor might dequeue the job concurrently. Whoever clears the query of the slot first owns the job.
+		 * If an executor won, it runs the job as usual. The caller waits for it by synchronizeSLC().
+		 * The slot might have been reused for a later job of the same query meanwhile. The CAS cancels that one instead.
+		 * Either way, the executor dequeueing the canceled job frees its tuple. The tuple of this lap is not touched here.
+		 */
+		expected = query;
+		if (__atomic_compare_exchange_n(&slot->query,&expected,NULL,0,__ATOMIC_ACQ_REL,__ATOMIC_RELAXED)) {
+			DEBUG_MSG(1,"Found query 0x%lx. Removing it from queue.\n",(unsigned long)query);
+		}
+	}
+}
+
+/**
+ * Drops all pending jobs of {@link query}. The executors keep on dequeueing jobs meanwhile.
+ */
+void cancelQueryJobs(Query_t *query) {
+	unsigned int i = 0;
+
+	if (sharedQueue == NULL) {
+		return;
+	}
+	cancelQueuedJobs(sharedQueue,query);
+	for (i = 0; i < numExecutors; i++) {
+		cancelQueuedJobs(&executors[i].ordered,query);
+	}
+	if (urgentExecutor != NULL) {
+		cancelQueuedJobs(&urgentExecutor->ordered,query);
+	}
+}
+
+void getExecStats(ExecStats_t *stats) {
+	unsigned int i = 0;
+
+	memset(stats,0,sizeof(ExecStats_t));
+	stats->threads = numExecutors;
+	stats->maxWaiting = maxWaiting;
+	stats->wakeups = wakeups;
+	stats->queueFull = queueFull;
+	stats->dropped = droppedJobs;
+	stats->executed = executedTotal;
+	stats->urgent = urgentTotal;
+	stats->sleeps = sleepsTotal;
+	for (i = 0; i < numExecutors; i++) {
+		stats->executed += executors[i].executed;
+		stats->sleeps += executors[i].sleeps;
+	}
+	if (urgentExecutor != NULL) {
+		stats->executed += urgentExecutor->executed;
+		stats->urgent += urgentExecutor->executed;
+		stats->sleeps += urgentExecutor->sleeps;
+	}
+}
@@ -1,23 +1,24 @@
 #define MSG_FMT(fmt) "[slc-layer] " fmt
 #include <api.h>
-#include <sys/queue.h>
 #include <sys/types.h>
-#include <sys/ipc.h>
-#include <sys/sem.h>
 #include <sys/syscall.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <errno.h>
-#include <signal.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/eventfd.h>
 #include <communication.h>
+#include <executor.h>
+#include <timerwheel.h>
 #include <api.h>
 
-#define SEM_KEY 0xcaffee
-#define TIMER_SIGNAL SIGRTMIN
-#define CALC_SLEEP_TIME
-#undef CALC_SLEEP_TIME
+/**
+ * Names the environment variable holding the number of microseconds the communication thread polls an empty rxBuffer before it blocks
+ */
+#define COMM_SPIN_ENV "SLC_COMM_SPIN_US"
 
 static int fdCommunicationFile  = 0;
 /**
@@ -30,87 +31,50 @@ static pthread_t commThread;
 static pthread_attr_t commThreadAttr;
 static int commThreadRunning = 0;
 /**
- * A descriptor of the executor thread
- */
-static pthread_t queryExecThread;
-/**
- * pthread attributes: needed to mark a thread as joinable
- */
-static pthread_attr_t queryExecThreadAttr;
-static int queryExecThreadRunning = 0;
-/**
- * ID of the semaphore to synchronize enqueueQuery() and the execution thread
- * enqueueQuery() will execute a v() and the thread a p().
- */
-static int waitingQueriesSemID = 0;
-/**
- * A simple mutex to synchronize the access to the list holding all remaining queries
- */
-static pthread_mutex_t listLock;
-/**
- * A list head for the list of remaining queries
- */
-STAILQ_HEAD(QueryExecListHead,QueryJob) queriesToExecList;
-#ifdef CALC_SLEEP_TIME
-/**
- * Number of successfull reads from the rx buffer
+ * exitLayer() wakes up the communication thread by writing to this eventfd
  */
-static int successfullReads = 0;
+static int commStopFd = -1;
 /**
- * Number of failed reads from the rx buffer
+ * Number of microseconds the communication thread polls an empty rxBuffer before it blocks. Trades CPU time for latency.
  */
-static int failedReads = 0;
-#endif
-/**
- * Amount of time to sleep after a failed read from the rx buffer
- */
-static int sleepTime = INIT_SLEEP_TIME;
+static unsigned int commSpinUS = 0;
 /**
- * Account for the number of missed timers - have a look at timerHandler()
+ * Account for the number of missed timers - have a look at timerExpired()
  */
 static int missedTimer;
+
 /**
- * Count the queued queries
- */
-static int waitingQueries;
-/**
- * Evaluate the maximum of waiting queries
+ * Called by the timing thread on each deadline of a source query. The source is called by an executor rather than the timing thread.
+ * If the executors fall behind, the expiry is dropped and accounted to the query.
  */
-static int maxWaitingQueries;
-
- union semun {
-	int val;					/* Value for SETVAL */
-	struct semid_ds *buf;		/* Buffer for IPC_STAT, IPC_SET */
-	unsigned short  *array;		/* Array for GETALL, SETALL */
-	struct seminfo  *__buf;		/* Buffer for IPC_INFO (Linux-specific) */
-};
-
-//static void timerHandler(int sig, siginfo_t *si, void *uc) {
-static void timerHandler(union sigval data) {
-	QueryTimerJob_t *timerJob = (QueryTimerJob_t*)data.sival_ptr;
-	Source_t *src = (Source_t*)timerJob->dm->typeInfo;
-	GenStream_t *stream = (GenStream_t*)timerJob->query->root;
+static void timerExpired(TimerEntry_t *timer) {
+	QueryTimerJob_t *timerJob = (QueryTimerJob_t*)timer->data;
+
+	if (trySubmitQueryJob(timerJob->query,NULL,0) < 0) {
+		// Only the timing thread writes it
+		timerJob->dropped++;
+		__sync_fetch_and_add(&missedTimer,1);
+	}
+}
+
+void runSourceTimer(Query_t *query) {
+	SourceStream_t *srcStream = (SourceStream_t*)query->root;
+	QueryTimerJob_t *timerJob = LOAD_ACQUIRE((QueryTimerJob_t**)&srcStream->timerInfo);
+	Source_t *src = NULL;
 	Tupel_t *curTuple= NULL, *tempTuple = NULL;
 
-	/**
-	 * It is possible that the component deletes queries thus stopping a timer while a timer expires.
-	 * Hence, the hrtimerHandler while stall at src->callback(), because the source wants to acquire the slcLock in order to create a tuple.
-	 * After deleting the queries the lock will be release and the handler will acquire it.
-	 * It is likeley that this timer was canceled. Therefore, the instance of TimerJob_t was freed. Further access to the recently freed memory location
-	 * will lead to unpredictable behavior.
-	 * To avoid this, each call to hrtimerHandler() will try to acquire the read lock. If it fails, the handler will abort.
-	 * The delQuery() function will acquire a write lock.
+	/*
+	 * The executor calls us inside a read section. stopSourceTimer() retires the job. Hence, it cannot be freed meanwhile.
+	 * But the timer might have been stopped after the job was enqueued.
 	 */
-	if (TRY_READ_LOCK(slcLock) != 0) {
-		ERR_MSG("Cannot acquire read timer lock\n");
-		__sync_fetch_and_add(&missedTimer,1);
+	if (timerJob == NULL) {
 		return;
 	}
-	DEBUG_MSG(3,"Context of timerHandler, tid=%ld\n",syscall(SYS_gettid));
+	src = (Source_t*)timerJob->dm->typeInfo;
 	DEBUG_MSG(3,"%s: Creating tuple\n",__FUNCTION__);
 	// Only one timer at a time is allowed to access this source
 	ACQUIRE_WRITE_LOCK(src->lock);
-	curTuple = src->callback(stream->selectors,stream->selectorsLen,NULL);
+	curTuple = src->callback(srcStream->st_selectors,srcStream->st_selectorsLen,NULL);
 	RELEASE_WRITE_LOCK(src->lock);
 	while (curTuple != NULL) {
 		tempTuple = curTuple->next;
@@ -121,102 +85,68 @@ static void timerHandler(union sigval data) {
 		 */
 		curTuple->next = NULL;
 		// Forward any query to the execution thread
-		enqueueQuery(timerJob->query,curTuple,0);
+		enqueueQuery(query,curTuple,0);
 		curTuple = tempTuple;
 	}
-	RELEASE_READ_LOCK(slcLock);
 }
 
-static void* queryExecutorWork(void *data) {
-	int ret = 0;
-	struct sembuf operation;
-	QueryJob_t *cur = NULL;
-	
-	operation.sem_num = 0;
-	operation.sem_flg = 0;
-	operation.sem_op = -1;
-	DEBUG_MSG(3,"Started execution thread\n");
-
-	while (1) {
-		DEBUG_MSG(3,"%s: Waiting for incoming queries...\n",__FUNCTION__);
-		ret = semop(waitingQueriesSemID,&operation,1);
-		if (ret < 0) {
-			if (queryExecThreadRunning == 0) {
-				DEBUG_MSG(3,"%s: Were asked to terminate.\n",__FUNCTION__);
-				break;
-			} else if (errno == EINTR) {
-				// Nothing to do
-				continue;
-			} else {
-				ERR_MSG("Semop failed: %s\n",strerror(errno));
-				continue;
-			}
-		}
-		ret =__sync_fetch_and_sub(&waitingQueries,1);
-		if (ret > maxWaitingQueries) {
-			maxWaitingQueries = ret;
-		}
-		ACQUIRE_READ_LOCK(slcLock);
-		pthread_mutex_lock(&listLock);
-		// Dequeue the head and execute the query
-		cur = STAILQ_FIRST(&queriesToExecList);
-		if (cur == NULL) {
-			pthread_mutex_unlock(&listLock);
-			continue;
-		}
-		STAILQ_REMOVE_HEAD(&queriesToExecList,listEntry);
-		pthread_mutex_unlock(&listLock);
-
-		DEBUG_MSG(3,"%s: Executing query 0x%x with tuple %p\n",__FUNCTION__,cur->query->queryID,cur->tuple);
-		// A queries execution just reads from the datamodel. No write lock is needed.
-		executeQuery(SLC_DATA_MODEL,cur->query,cur->tuple,cur->step);
-		RELEASE_READ_LOCK(slcLock);
-		FREE(cur);
-	}
+void ringBufferDoorbell(void) {
+	char doorbell = 1;
 
-	pthread_exit(0);
-	return NULL;
+	if (write(fdCommunicationFile,&doorbell,1) < 0) {
+		ERR_MSG("Cannot ring the doorbell: %s\n",strerror(errno));
+	}
 }
 
-#ifdef CALC_SLEEP_TIME
-static int calcSleepTime(int sleepTime, int readSuccess) {
-	int ret = sleepTime, temp = 0;
-
-	if (readSuccess > 0) {
-		successfullReads++;
-		failedReads = 0;
-	} else {
-		successfullReads = 0;
-		failedReads++;
-	}
-	if (successfullReads > SLEEP_THRESH_SUCESS) {
-		temp = INIT_SLEEP_TIME - (successfullReads - SLEEP_THRESH_SUCESS) * SLEEP_STEP;
-		ret = (temp < SLEEP_MIN ? SLEEP_MIN : temp);
+/**
+ * Blocks until the kernel published a message to the rxBuffer or exitLayer() got called.
+ * If commSpinUS is set, the rxBuffer is polled that long before.
+ */
+static void waitForMessages(void) {
+	struct pollfd fds[2];
+	struct timespec start, now;
+
+	if (commSpinUS > 0) {
+		clock_gettime(CLOCK_MONOTONIC,&start);
+		do {
+			if (ringBufferPending(rxBuffer)) {
+				return;
+			}
+			clock_gettime(CLOCK_MONOTONIC,&now);
+		} while ((now.tv_sec - start.tv_sec) * USEC_PER_SEC + (now.tv_nsec - start.tv_nsec) / 1000 < commSpinUS);
 	}
-	if (failedReads > SLEEP_THRESH_FAILED) {
-		temp = INIT_SLEEP_TIME + (failedReads - SLEEP_THRESH_FAILED) * SLEEP_STEP;
-		ret = (temp > SLEEP_MAX ? SLEEP_MAX : temp);
+	if (ringBufferWaitBegin(rxBuffer)) {
+		fds[0].fd = fdCommunicationFile;
+		fds[0].events = POLLIN;
+		fds[1].fd = commStopFd;
+		fds[1].events = POLLIN;
+		if (poll(fds,2,COMM_WAIT_TIMEOUT_MS) < 0 && errno != EINTR) {
+			ERR_MSG("Cannot poll the communication file: %s\n",strerror(errno));
+		}
 	}
-	ret = 1000;
-	return ret;
+	ringBufferWaitEnd(rxBuffer);
+}
+
+/**
+ * Frees a query the remote layer handed over. It is retired along with the query itself. See retireQuery().
+ */
+static void releaseRemoteQuery(void *ptr) {
+	freeQuery((Query_t*)ptr);
 }
-#else
-#define calcSleepTime(x,y)		(INIT_SLEEP_TIME)
-#endif
 
 static void* commThreadWork(void *data) {
 	LayerMessage_t *msg = NULL;
 	DataModelElement_t *dm = NULL;
 	Query_t *query = NULL, *queryCopy = NULL;
 	QueryContinue_t *queryCont = NULL;
+	QueryContinueFrame_t *queryContFrame = NULL;
 	QueryID_t *queryID = NULL;
-	Tupel_t *curTupleShm = NULL, *curTupleCopy = NULL, *headTupleCopy = NULL, *prevTupleCopy = NULL;
 	int ret = 0;
 
 	while (commThreadRunning == 1) {
 		msg = ringBufferReadBegin(rxBuffer);
 		if (msg == NULL) {
-			usleep(sleepTime);
+			waitForMessages();
 		} else {
 			DEBUG_MSG(3,"Read msg with type 0x%x and addr %p (rewritten addr = %p)\n",msg->type,msg->addr,REWRITE_ADDR(msg->addr,sharedMemoryUserBase,sharedMemoryKernelBase));
 			switch (msg->type) {
@@ -233,6 +163,7 @@ static void* commThreadWork(void *data) {
 						ERR_MSG("Weird! Cannot merge datamodel received by kernel!\n");
 					}
 					RELEASE_WRITE_LOCK(slcLock);
+					synchronizeSLC();
 					break;
 
 				case MSG_DM_DEL:
@@ -248,6 +179,7 @@ static void* commThreadWork(void *data) {
 						initSLCDatamodel();
 					}
 					RELEASE_WRITE_LOCK(slcLock);
+					synchronizeSLC();
 					break;
 
 				case MSG_QUERY_ADD:
@@ -262,10 +194,13 @@ static void* commThreadWork(void *data) {
 					rewriteQueryAddress(queryCopy,msg->addr,queryCopy);
 					ACQUIRE_WRITE_LOCK(slcLock);
 					if (addQueries(SLC_DATA_MODEL,queryCopy) != 0) {
-						freeQuery(queryCopy);
+						// addQueries() retired the queries it had registered already. Readers may still see them.
+						retireObject(queryCopy,releaseRemoteQuery);
+					} else {
+						DEBUG_MSG(2,"Registered remote query with id %d\n",queryCopy->queryID);
 					}
-					DEBUG_MSG(2,"Registered remote query with id %d\n",queryCopy->queryID);
 					RELEASE_WRITE_LOCK(slcLock);
+					synchronizeSLC();
 					break;
 
 				case MSG_QUERY_DEL:
@@ -275,7 +210,7 @@ static void* commThreadWork(void *data) {
 					query = resolveQuery(SLC_DATA_MODEL,queryID);
 					if (query == NULL) {
 						ERR_MSG("No such query: name=%s, id=%d\n",queryID->name, queryID->id);
-						RELEASE_READ_LOCK(slcLock);
+						RELEASE_WRITE_LOCK(slcLock);
 						break;
 					}
 					delQueries(SLC_DATA_MODEL,query);
@@ -283,58 +218,27 @@ static void* commThreadWork(void *data) {
 					 * delQueries() does *not* free the query itself.
 					 * Normally a query is handed over by a module/shared library and directly registered.
 					 * Therefore, the module/shared library has to free it. In this case, the query was handed over by the remote layer.
-					 * So, it is up to us to free it now.
+					 * So, it is up to us to free it, once no reader or executor can reference it anymore.
 					 */
-					freeQuery(query);
+					retireObject(query,releaseRemoteQuery);
 					RELEASE_WRITE_LOCK(slcLock);
+					synchronizeSLC();
 					break;
 
 				case MSG_QUERY_CONTINUE:
 					queryCont = (QueryContinue_t*)REWRITE_ADDR(msg->addr,sharedMemoryKernelBase,sharedMemoryUserBase);
-					ACQUIRE_READ_LOCK(slcLock);
-					// Try to resolve queryID to a pointer to a real query
-					query = resolveQuery(SLC_DATA_MODEL,&queryCont->qID);
-					if (query == NULL) {
-						ERR_MSG("No such query: name=%s, id=%d\n",queryCont->qID.name, queryCont->qID.id);
-						RELEASE_READ_LOCK(slcLock);
-						break;
-					}
-					curTupleShm = (Tupel_t*)(queryCont + 1);
-					headTupleCopy = NULL;
-					prevTupleCopy = NULL;
-					ret = 0;
-					// Basically, a MSG_QUERY_CONTINUE can have one or more tuples attached
-					do {
-						rewriteTupleAddress(SLC_DATA_MODEL,curTupleShm,sharedMemoryKernelBase,sharedMemoryUserBase);
-						curTupleCopy = copyTupel(SLC_DATA_MODEL,curTupleShm);
-						if (curTupleCopy == NULL) {
-							ERR_MSG("Cannot copy tuple from shared memory. Freeing all previous copied tuples. Query: name=%s, id=%d\n", queryCont->qID.name, queryCont->qID.id);
-							curTupleCopy = headTupleCopy;
-							// There was an error during copying curTupleShm --> free all tuples copied so far
-							while (curTupleCopy != NULL) {
-								prevTupleCopy = curTupleCopy->next;
-								freeTupel(SLC_DATA_MODEL,curTupleCopy);
-								curTupleCopy = prevTupleCopy;
-							}
-							headTupleCopy = NULL;
-							break;
-						}
-						if (prevTupleCopy != NULL) {
-							prevTupleCopy->next = curTupleCopy;
-						}
-						if (headTupleCopy == NULL) {
-							headTupleCopy = curTupleCopy;
-						}
-						prevTupleCopy = curTupleCopy;
-						curTupleShm = curTupleShm->next;
-						ret++;
-					} while (curTupleShm != NULL);
-					if (headTupleCopy != NULL) {
-						// Handover the tuples and the query to the executor
-						DEBUG_MSG(2,"Enqueueing %d remote tuple(s) for execution.\n",ret);
-						enqueueQuery(query,headTupleCopy,queryCont->steps);
-					}
-					RELEASE_READ_LOCK(slcLock);
+					SLC_READ_LOCK();
+					dispatchQueryContinue(SLC_DATA_MODEL,queryCont,sharedMemoryKernelBase,sharedMemoryUserBase);
+					SLC_READ_UNLOCK();
+					break;
+
+				case MSG_QUERY_CONTINUE_BATCH:
+					queryContFrame = (QueryContinueFrame_t*)REWRITE_ADDR(msg->addr,sharedMemoryKernelBase,sharedMemoryUserBase);
+					// Enter the read section once for all continuations within the frame
+					SLC_READ_LOCK();
+					ret = dispatchQueryContinueFrame(SLC_DATA_MODEL,queryContFrame,sharedMemoryKernelBase,sharedMemoryUserBase);
+					SLC_READ_UNLOCK();
+					DEBUG_MSG(3,"Dispatched %d of %u continuations from a frame\n",ret,queryContFrame->entries);
 					break;
 
 				case MSG_EMPTY:
@@ -346,73 +250,34 @@ static void* commThreadWork(void *data) {
 			}
 			ringBufferReadEnd(rxBuffer);
 		}
-		sleepTime = calcSleepTime(sleepTime,msg != NULL);
-		DEBUG_MSG(3,"sleepTime = %d us\n",sleepTime);
 	}
 
 	INFO_MSG("Flushing rx buffer...\n");
 	ret = 0;
-	do {
-		msg = ringBufferReadBegin(rxBuffer);
+	while ((msg = ringBufferReadBegin(rxBuffer)) != NULL) {
 		ringBufferReadEnd(rxBuffer);
 		ret++;
-	} while (msg != NULL);
-	INFO_MSG("Discarded %d messages from rx buffer while flushing.\n", --ret);
+	}
+	INFO_MSG("Discarded %d messages from rx buffer while flushing.\n", ret);
 
 	pthread_exit(0);
 	return NULL;
 }
 
 void enqueueQuery(Query_t *query, Tupel_t *tuple, int step) {
-	QueryJob_t *job = NULL;
-	struct sembuf operation;
-	operation.sem_num = 0;
-	operation.sem_flg = 0;
-	operation.sem_op = 1;
-
+#ifdef EVALUATION
+	tuple->timestamp3 = getCycles();
+#endif
+	DEBUG_MSG(3,"Enqueued query 0x%x with tuple %p for execution\n",query->queryID,tuple);
 	/*
-	 * Honestly, it is not necessary to check, if the execution thread is running.
+	 * Honestly, it is not necessary to check, if the executors are running.
 	 * The module cannot be unloaded while there is at least one registered provider remaining.
-	 * Therefore, it's impossible that neither the lock (listLock) nor the list (queriesToExecList)
-	 * are NULL.
 	 */
-	job = ALLOC(sizeof(QueryJob_t));
-	if (job == NULL) {
-		ERR_MSG("Cannot allocate memory for QueryJob_t\n");
-		return;
-	}
-	job->query = query;
-	job->tuple = tuple;
-	job->step = step;
-#ifdef EVALUATION
-	job->tuple->timestamp3 = getCycles();
-#endif
-	// Enqueue it
-	DEBUG_MSG(3,"Enqueued query 0x%x with tuple %p for execution\n",job->query->queryID,job->tuple);
-	pthread_mutex_lock(&listLock);
-	STAILQ_INSERT_TAIL(&queriesToExecList,job,listEntry);
-	pthread_mutex_unlock(&listLock);
-	__sync_add_and_fetch(&waitingQueries,1);
-	// Signal the execution thread a query is ready for execution
-	if (semop(waitingQueriesSemID,&operation,1) < 0) {
-		ERR_MSG("Error executing p() von semaphore: %s\n",strerror(errno));
-	}
+	submitQueryJob(query,tuple,step);
 }
 
 void delPendingQuery(Query_t *query) {
-	QueryJob_t *cur = NULL, *curTmp = NULL;
-	
-	pthread_mutex_lock(&listLock);
-	for (cur = STAILQ_FIRST(&queriesToExecList); cur != NULL; cur = curTmp) {
-		curTmp = STAILQ_NEXT(cur,listEntry);
-		if (cur->query == query) {
-			DEBUG_MSG(1,"Found query 0x%lx. Removing it from list.\n",(unsigned long)cur->query);
-			freeTupel(SLC_DATA_MODEL,cur->tuple);
-			STAILQ_REMOVE(&queriesToExecList,cur,QueryJob,listEntry);
-			FREE(cur);
-		}
-	}
-	pthread_mutex_unlock(&listLock);
+	cancelQueryJobs(query);
 }
 
 static void* generateObjectStatus(void *data) {
@@ -464,78 +329,70 @@ void startObjStatusThread(Query_t *query, generateStatus statusFn) {
 void startSourceTimer(DataModelElement_t *dm, Query_t *query) {
 	SourceStream_t *srcStream = (SourceStream_t*)query->root;
 	QueryTimerJob_t *timerJob = NULL;
+	int ret = 0;
 	// Allocate memory for the job-specific information; job-specific = (query,datamodel,period)
 	timerJob = ALLOC(sizeof(QueryTimerJob_t));
 	if (timerJob == NULL) {
 		ERR_MSG("Cannot allocate memory for QueryTimerJob_t\n");
 		return;
 	}
-
-	DEBUG_MSG(2,"%s: Init posix timer for node %s\n",__FUNCTION__,srcStream->st_name);
 	timerJob->period = srcStream->period;
 	timerJob->query = query;
 	timerJob->dm = dm;
-	/*
-	 * the timer will generate the TIMER_SIGNAL signal upon expiration.
-	 * Each pending signal will be processed in a dedicated thread.
-	 * This will avoid race conditions between subsequent calls to timerHandler.
-	 * The letter would be the case, if sigev_notify is set to SIGEV_SIGNAL.
-	 */
-	timerJob->timerNotify.sigev_notify = SIGEV_THREAD;
-	timerJob->timerNotify.sigev_signo = TIMER_SIGNAL;
-	// Pass a pointer to QueryTimerJob_t to enable the handler to access the query and the source function pointer.
-	timerJob->timerNotify.sigev_value.sival_ptr = timerJob;
-	timerJob->timerNotify.sigev_notify_function = timerHandler;
-	timerJob->timerValue.it_value.tv_sec = timerJob->period / 1000;
-	timerJob->timerValue.it_value.tv_nsec = (timerJob->period % 1000) * 1000000;
-	timerJob->timerValue.it_interval.tv_sec = timerJob->timerValue.it_value.tv_sec;
-	timerJob->timerValue.it_interval.tv_nsec = timerJob->timerValue.it_value.tv_nsec;
-	// Setup the timer using timing information relative to the current clock which will be the monotonic one.
-	if (timer_create(CLOCK_REALTIME,&timerJob->timerNotify,&timerJob->timerID) < 0) {
-		ERR_MSG("timer_create failed: %s\n",strerror(errno));
-		FREE(timerJob);
-		return;
-	}
-	DEBUG_MSG(2,"%s: Starting posixtimer for node %s. Will fire in %u ms.\n",__FUNCTION__,srcStream->st_name,srcStream->period);
-	// Fire it up.... :-)
-	if (timer_settime(timerJob->timerID, 0, &timerJob->timerValue, NULL) < 0) {
-		ERR_MSG("timer_settime failed: %s\n",strerror(errno));
+	timerJob->dropped = 0;
+	// An executor reaches the job through the query. It has to be set before the timer fires the first time.
+	STORE_RELEASE(&srcStream->timerInfo,timerJob);
+	DEBUG_MSG(2,"%s: Starting timer for node %s. Will fire every %u ms.\n",__FUNCTION__,srcStream->st_name,srcStream->period);
+	ret = addTimer(&timerJob->timer,timerJob->period,timerExpired,timerJob);
+	if (ret < 0) {
+		ERR_MSG("Cannot start the timer for node %s: %d\n",srcStream->st_name,-ret);
+		srcStream->timerInfo = NULL;
 		FREE(timerJob);
-		return;
 	}
-	srcStream->timerInfo = timerJob;
 }
 
 void stopSourceTimer(Query_t *query) {
-	int ret = 0;
 	SourceStream_t *srcStream = (SourceStream_t*)query->root;
 	QueryTimerJob_t *timerJob = (QueryTimerJob_t*)srcStream->timerInfo;
-	struct itimerspec timerValue; 
-
-	timerValue.it_value.tv_sec = 0;
-	timerValue.it_value.tv_nsec = 0;
-	timerValue.it_interval.tv_sec = 0;
-	timerValue.it_interval.tv_nsec = 0;
-	// Setting the next expiration to 0 will cancel the timer
-	if (timer_settime(timerJob->timerID,0,&timerValue,NULL) < 0) {
-		ERR_MSG("timer_settime - delete - failed: %s\n",strerror(errno));
+
+	if (timerJob == NULL) {
 		return;
 	}
-	DEBUG_MSG(2,"%s: Canceling posix timer for node %s...\n",__FUNCTION__,srcStream->st_name);
-	// Delete the timer
-	ret = timer_delete(timerJob->timerID);
-	if (ret < 0) {
-		ERR_MSG("timer_delete failed: %s\n",strerror(errno));
+	DEBUG_MSG(2,"%s: Canceling timer for node %s...\n",__FUNCTION__,srcStream->st_name);
+	// Afterwards, the timing thread does not enqueue any job for the query
+	delTimer(&timerJob->timer);
+	DEBUG_MSG(2,"%s: Timer for node %s canceled. Missed %llu deadlines, dropped %llu and took %llu samples late.\n",__FUNCTION__,srcStream->st_name,
+		timerJob->timer.missed,timerJob->dropped,timerJob->timer.late);
+	// An executor might still run the source. Hence, the timer information is retired.
+	STORE_RELEASE(&srcStream->timerInfo,NULL);
+	retireMemory(timerJob);
+}
+
+int getSourceTimerStats(Query_t *query, SourceTimerStats_t *stats) {
+	QueryTimerJob_t *timerJob = NULL;
+	int ret = 0;
+
+	if (query == NULL || stats == NULL || query->root->type != GEN_SOURCE) {
+		return -EPARAM;
 	}
-	DEBUG_MSG(2,"%s: posix timer for node %s canceled. Was active: %d\n",__FUNCTION__,srcStream->st_name,ret);
-	// Free the timer information
-	FREE(timerJob);
-	srcStream->timerInfo = NULL;
+	// stopSourceTimer() retires the job
+	SLC_READ_LOCK();
+	timerJob = LOAD_ACQUIRE((QueryTimerJob_t**)&((SourceStream_t*)query->root)->timerInfo);
+	if (timerJob == NULL) {
+		ret = -EPARAM;
+	} else {
+		// A sample dropped by the executors is missed as well
+		stats->missed = timerJob->timer.missed + timerJob->dropped;
+		stats->late = timerJob->timer.late;
+	}
+	SLC_READ_UNLOCK();
+
+	return ret;
 }
 
 int initLayer(void) {
-	union semun cmdval;
 	char buffer[20];
+	unsigned int execThreads = 0;
 	unsigned long addr = 0;
 	int ret = 0;
 
@@ -563,33 +420,26 @@ int initLayer(void) {
 	sharedMemoryKernelBase = (void*)addr;
 	ringBufferInit();
 
-#ifdef CALC_SLEEP_TIME
-	successfullReads = 0;
-	failedReads = 0;
-#endif
-	sleepTime = INIT_SLEEP_TIME;
-	waitingQueries = 0;
-	// Create the semaphore for the query list and ...
-	waitingQueriesSemID = semget(SEM_KEY,1,IPC_CREAT|IPC_EXCL|0600);
-	if (waitingQueriesSemID < 0) {
-		ERR_MSG("semget failed: %s\n",strerror(errno));
+	if (getenv(COMM_SPIN_ENV) != NULL) {
+		commSpinUS = strtoul(getenv(COMM_SPIN_ENV),NULL,10);
+		INFO_MSG("Polling the rx buffer for %u us before blocking\n",commSpinUS);
+	}
+	commStopFd = eventfd(0,EFD_NONBLOCK);
+	if (commStopFd < 0) {
+		ERR_MSG("Cannot create eventfd: %s\n",strerror(errno));
 		return -1;
 	}
-	cmdval.val = 0;
-	// ... initialize it to 0.
-	if (semctl(waitingQueriesSemID,0,SETVAL,cmdval) < 0) {
-		ERR_MSG("semctl failed: %s\n",strerror(errno));
+	// By default, one executor per online CPU is started
+	if (getenv(EXEC_THREADS_ENV) != NULL) {
+		execThreads = strtoul(getenv(EXEC_THREADS_ENV),NULL,10);
+	}
+	if (startExecutors(execThreads) < 0) {
+		ERR_MSG("Cannot start the executors\n");
 		return -1;
 	}
-	// Init list lock and the list itself
-	pthread_mutex_init(&listLock,NULL);
-	STAILQ_INIT(&queriesToExecList);
-	// Set up the query execution thread as joinable and start it.
-	queryExecThreadRunning = 1;
-	pthread_attr_init(&queryExecThreadAttr);
-	pthread_attr_setdetachstate(&queryExecThreadAttr, PTHREAD_CREATE_JOINABLE);
-	if (pthread_create(&queryExecThread,&queryExecThreadAttr,queryExecutorWork,NULL) < 0) {
-		ERR_MSG("Cannot create queryExecThread: %s\n",strerror(errno));
+	if (startTimerWheel() < 0) {
+		ERR_MSG("Cannot start the timer wheel\n");
+		stopExecutors();
 		return -1;
 	}
 	// Set up the communication thread as joinable and start it.
@@ -598,9 +448,8 @@ int initLayer(void) {
 	pthread_attr_setdetachstate(&commThreadAttr, PTHREAD_CREATE_JOINABLE);
 	if (pthread_create(&commThread,&commThreadAttr,commThreadWork,NULL) < 0) {
 		ERR_MSG("Cannot create commThread: %s\n",strerror(errno));
-		queryExecThreadRunning = 0;
-		semctl(waitingQueriesSemID,0,IPC_RMID);
-		pthread_join(queryExecThread,NULL);
+		stopTimerWheel();
+		stopExecutors();
 		return -1;
 	}
 	DEBUG_MSG(1,"Requesting a complete snapshot of the datamodel from the kernel\n");
@@ -616,17 +465,40 @@ int initLayer(void) {
 }
 
 void exitLayer(void) {
-	queryExecThreadRunning = 0;
+	uint64_t stop = 1;
+	SlcAllocStats_t allocStats;
+	ExecStats_t execStats;
+	TimerStats_t timerStats;
+	ObjPoolStats_t poolStats;
+	int i = 0;
+
 	commThreadRunning = 0;
-	// Destroy the semaphore and wait for the execution thread to terminate
-	semctl(waitingQueriesSemID,0,IPC_RMID);
-	pthread_join(queryExecThread,NULL);
+	// Wake up the communication thread, if it is blocked, and wait for it
+	if (write(commStopFd,&stop,sizeof(stop)) < 0) {
+		ERR_MSG("Cannot wake up the communication thread: %s\n",strerror(errno));
+	}
 	pthread_join(commThread,NULL);
+	// Neither the communication thread nor the timers enqueue queries any longer. Let the executors run the remaining ones.
+	stopTimerWheel();
+	stopExecutors();
+	close(commStopFd);
 	munmap(sharedMemoryUserBase, NUM_PAGES * PAGE_SIZE);
 	close(fdCommunicationFile);
-	
-	pthread_mutex_destroy(&listLock);
-	INFO_MSG("Max amount of outstanding queries: %d\n",maxWaitingQueries);
+
+	getExecStats(&execStats);
+	INFO_MSG("Max amount of outstanding queries: %u\n",execStats.maxWaiting);
+	INFO_MSG("Executed %llu queries (%llu urgent), executors slept %llu times, %llu wakeups, %llu times a full queue (%llu jobs dropped)\n",
+		execStats.executed,execStats.urgent,execStats.sleeps,execStats.wakeups,execStats.queueFull,execStats.dropped);
+	getTimerStats(&timerStats);
+	INFO_MSG("Fired %llu timers in %llu wakeups (%llu coalesced), missed %llu deadlines\n",timerStats.fired,timerStats.wakeups,timerStats.coalesced,timerStats.missed);
 	INFO_MSG("Missed %d timer\n", missedTimer);
-	INFO_MSG("Skipped the sending of %u/%u query continue message\n",skippedQueryCont,totalQueryCont);
+	INFO_MSG("Skipped the sending of %u/%u query continue message (%u frames sent)\n",skippedQueryCont,totalQueryCont,sentQueryContFrames);
+	slcallocstats(&allocStats);
+	INFO_MSG("txMemory: %u/%u pages used (peak %u), %llu bytes allocated (peak %llu), %u%% fragmented, %llu failed allocations\n",
+		allocStats.usedPages,allocStats.totalPages,allocStats.peakPages,allocStats.inUse,allocStats.peakInUse,ALLOC_FRAGMENTATION(allocStats),allocStats.failed);
+	getObjPoolStats(&poolStats);
+	for (i = 0; i < OBJ_POOL_CLASSES; i++) {
+		INFO_MSG("Object pool of %d bytes: %llu slabs\n",OBJ_POOL_MIN_SIZE << i,poolStats.grown[i]);
+	}
+	INFO_MSG("%llu objects too large for any pool\n",poolStats.large);
 }
@@ -87,7 +87,7 @@ void printQuery(Operator_t *rootQuery) {
 
 			case SORT:
 				sort = (Sort_t*)cur;
-				printf("Sort(size=%u %s,",sort->size,sizeUnitToString(sort->sizeUnit));
+				printf("Sort(size=%u %s,%s,limit=%u,",sort->size,sizeUnitToString(sort->sizeUnit),(sort->order == SORT_DESCENDING ? "desc" : "asc"),sort->limit);
 				PRINT_ELEMENTS(sort);
 				printf(")(x)\n");
 				break;
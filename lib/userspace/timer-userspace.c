@@ -0,0 +1,387 @@
+#define MSG_FMT(fmt) "[slc-timer] " fmt
+#include <common.h>
+#include <output.h>
+#include <timerwheel.h>
+#include <limits.h>
+#include <poll.h>
+#include <stdint.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+
+#define LEVEL_MASK						(TIMER_LEVEL_SIZE - 1)
+#define LEVEL_SHIFT(level)				((level) * TIMER_LEVEL_BITS)
+#define MAX_DELTA						((1ULL << LEVEL_SHIFT(TIMER_WHEEL_LEVELS)) - 1)
+#define NO_EXPIRY						ULLONG_MAX
+
+LIST_HEAD(TimerList,TimerEntry);
+
+/**
+ * A hierarchical timer wheel. Level 0 holds the timers expiring within the next TIMER_LEVEL_SIZE ticks, one slot per tick.
+ * Whenever the lower levels wrap around, the current slot of the next level is cascaded, i.e. its timers are put to the lower levels again.
+ * Each level has a bitmap of its occupied slots. Hence, the timing thread sleeps until the next tick it has to process.
+ */
+typedef struct TimerWheel {
+	struct TimerList slots[TIMER_WHEEL_LEVELS][TIMER_LEVEL_SIZE];
+	unsigned long long occupied[TIMER_WHEEL_LEVELS];
+	/**
+	 * The next tick to process
+	 */
+	unsigned long long now;
+	/**
+	 * The tick the timerfd is armed for. NO_EXPIRY, if it is disarmed.
+	 */
+	unsigned long long armed;
+	unsigned int timers;
+} TimerWheel_t;
+
+static TimerWheel_t wheel;
+static pthread_mutex_t wheelLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t timerThread;
+static int timerThreadRunning = 0;
+static int timerFd = -1;
+/**
+ * stopTimerWheel() wakes up the timing thread by writing to this eventfd
+ */
+static int timerStopFd = -1;
+static unsigned long long timerWakeups = 0, timerFired = 0, timerCoalesced = 0, timerMissed = 0, timerLate = 0;
+
+static inline unsigned long long currentTick(void) {
+	return getTimeNS() / TIMER_TICK_NS;
+}
+
+/**
+ * Links {@link timer} into the slot its deadline belongs to. The caller has to hold wheelLock.
+ */
+static void enqueueTimer(TimerEntry_t *timer) {
+	unsigned long long expires = timer->expires, delta = 0;
+	unsigned int level = 0, slot = 0;
+
+	if (expires < wheel.now) {
+		expires = wheel.now;
+	}
+	delta = expires - wheel.now;
+	// Too far in the future. It will be cascaded from the last level once more.
+	if (delta > MAX_DELTA) {
+		expires = wheel.now + MAX_DELTA;
+		delta = MAX_DELTA;
+	}
+	for (level = 0; level < TIMER_WHEEL_LEVELS - 1; level++) {
+		if (delta < (1ULL << LEVEL_SHIFT(level + 1))) {
+			break;
+		}
+	}
+	slot = (expires >> LEVEL_SHIFT(level)) & LEVEL_MASK;
+	LIST_INSERT_HEAD(&wheel.slots[level][slot],timer,listEntry);
+	wheel.occupied[level] |= 1ULL << slot;
+	timer->level = level;
+	timer->slot = slot;
+	timer->pending = 1;
+}
+
+static void dequeueTimer(TimerEntry_t *timer) {
+	LIST_REMOVE(timer,listEntry);
+	if (LIST_EMPTY(&wheel.slots[timer->level][timer->slot])) {
+		wheel.occupied[timer->level] &= ~(1ULL << timer->slot);
+	}
+	timer->pending = 0;
+}
+
+/**
+ * Returns the first tick not before wheel.now the timing thread has to process, either to fire a timer or to cascade a slot.
+ * A slot s of level n is due, once the n-th digit of the tick equals s and all lower digits are zero.
+ */
+static unsigned long long nextExpiry(void) {
+	unsigned long long next = NO_EXPIRY, base = 0, tick = 0, bits = 0, lap = 0;
+	unsigned int level = 0, slot = 0;
+
+	for (level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+		lap = 1ULL << LEVEL_SHIFT(level + 1);
+		base = wheel.now & ~(lap - 1);
+		for (bits = wheel.occupied[level]; bits != 0; bits &= bits - 1) {
+			slot = __builtin_ctzll(bits);
+			tick = base + ((unsigned long long)slot << LEVEL_SHIFT(level));
+			if (tick < wheel.now) {
+				tick += lap;
+			}
+			if (tick < next) {
+				next = tick;
+			}
+		}
+	}
+
+	return next;
+}
+
+static void cascadeTimers(unsigned int level) {
+	struct TimerList list;
+	TimerEntry_t *timer = NULL;
+	unsigned int slot = (wheel.now >> LEVEL_SHIFT(level)) & LEVEL_MASK;
+
+	LIST_INIT(&list);
+	while ((timer = LIST_FIRST(&wheel.slots[level][slot])) != NULL) {
+		LIST_REMOVE(timer,listEntry);
+		LIST_INSERT_HEAD(&list,timer,listEntry);
+	}
+	wheel.occupied[level] &= ~(1ULL << slot);
+	while ((timer = LIST_FIRST(&list)) != NULL) {
+		LIST_REMOVE(timer,listEntry);
+		enqueueTimer(timer);
+	}
+}
+
+/**
+ * Fires the timers of the tick wheel.now. A fired timer gets its next deadline on the grid of its period.
+ * If the timing thread fell behind, a timer catches up: it fires once per deadline passed up to the current tick {@link target},
+ * but at most TIMER_MAX_CATCHUP times. Each expiry fired for a deadline before {@link target} is accounted as late.
+ * The remaining deadlines up to {@link target} are skipped and accounted as missed.
+ */
+static void runTick(unsigned long long target) {
+	struct TimerList list;
+	TimerEntry_t *timer = NULL;
+	unsigned long long skipped = 0;
+	unsigned int level = 0, slot = wheel.now & LEVEL_MASK, fired = 0, expiries = 0, owed = 0;
+
+	for (level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+		if ((wheel.now & ((1ULL << LEVEL_SHIFT(level)) - 1)) != 0) {
+			break;
+		}
+		cascadeTimers(level);
+	}
+	LIST_INIT(&list);
+	while ((timer = LIST_FIRST(&wheel.slots[0][slot])) != NULL) {
+		LIST_REMOVE(timer,listEntry);
+		LIST_INSERT_HEAD(&list,timer,listEntry);
+	}
+	wheel.occupied[0] &= ~(1ULL << slot);
+	while ((timer = LIST_FIRST(&list)) != NULL) {
+		LIST_REMOVE(timer,listEntry);
+		timer->pending = 0;
+		if (timer->expires <= wheel.now) {
+			for (owed = 0; owed < TIMER_MAX_CATCHUP && timer->expires <= target; owed++) {
+				if (timer->expires < target) {
+					timer->late++;
+					timerLate++;
+				}
+				timer->callback(timer);
+				expiries++;
+				timer->expires += timer->period;
+			}
+			fired++;
+			if (timer->expires <= target) {
+				skipped = (target - timer->expires) / timer->period + 1;
+				timer->expires += skipped * timer->period;
+				timer->missed += skipped;
+				timerMissed += skipped;
+			}
+		}
+		enqueueTimer(timer);
+	}
+	timerFired += expiries;
+	if (fired > 1) {
+		timerCoalesced += fired - 1;
+	}
+	wheel.now++;
+}
+
+/**
+ * Processes all ticks up to {@link target}. Ticks without any timer to fire or slot to cascade are skipped.
+ */
+static void runTimers(unsigned long long target) {
+	unsigned long long next = 0;
+
+	while (wheel.now <= target) {
+		next = nextExpiry();
+		if (next > target) {
+			wheel.now = target + 1;
+			break;
+		}
+		wheel.now = next;
+		runTick(target);
+	}
+}
+
+/**
+ * Arms the timerfd for the next tick to process. The caller has to hold wheelLock.
+ */
+static void armTimer(void) {
+	struct itimerspec value;
+	unsigned long long next = nextExpiry();
+
+	if (next == wheel.armed) {
+		return;
+	}
+	memset(&value,0,sizeof(value));
+	if (next != NO_EXPIRY) {
+		value.it_value.tv_sec = (next * TIMER_TICK_NS) / 1000000000ULL;
+		value.it_value.tv_nsec = (next * TIMER_TICK_NS) % 1000000000ULL;
+	}
+	// A zero it_value disarms the timerfd
+	if (timerfd_settime(timerFd,TFD_TIMER_ABSTIME,&value,NULL) < 0) {
+		ERR_MSG("Cannot arm the timerfd: %s\n",strerror(errno));
+		return;
+	}
+	wheel.armed = next;
+}
+
+static void* timerThreadWork(void *data) {
+	struct pollfd fds[2];
+	uint64_t expirations = 0;
+
+	fds[0].fd = timerFd;
+	fds[0].events = POLLIN;
+	fds[1].fd = timerStopFd;
+	fds[1].events = POLLIN;
+	while (LOAD_ACQUIRE(&timerThreadRunning) == 1) {
+		if (poll(fds,2,-1) < 0) {
+			if (errno != EINTR) {
+				ERR_MSG("Cannot poll the timerfd: %s\n",strerror(errno));
+			}
+			continue;
+		}
+		if ((fds[0].revents & POLLIN) == 0) {
+			continue;
+		}
+		if (read(timerFd,&expirations,sizeof(expirations)) < 0 && errno != EAGAIN) {
+			ERR_MSG("Cannot read the timerfd: %s\n",strerror(errno));
+		}
+		pthread_mutex_lock(&wheelLock);
+		timerWakeups++;
+		// The timerfd has expired. It has to be armed again in any case.
+		wheel.armed = NO_EXPIRY;
+		runTimers(currentTick());
+		armTimer();
+		pthread_mutex_unlock(&wheelLock);
+	}
+	DEBUG_MSG(3,"%s: Were asked to terminate.\n",__FUNCTION__);
+
+	return NULL;
+}
+
+/**
+ * Starts the timing thread. It waits on a timerfd of CLOCK_MONOTONIC for the next deadline.
+ */
+int startTimerWheel(void) {
+	unsigned int level = 0, slot = 0;
+
+	timerFd = timerfd_create(CLOCK_MONOTONIC,TFD_NONBLOCK|TFD_CLOEXEC);
+	if (timerFd < 0) {
+		ERR_MSG("Cannot create timerfd: %s\n",strerror(errno));
+		return -EPARAM;
+	}
+	timerStopFd = eventfd(0,EFD_NONBLOCK);
+	if (timerStopFd < 0) {
+		ERR_MSG("Cannot create eventfd: %s\n",strerror(errno));
+		close(timerFd);
+		timerFd = -1;
+		return -EPARAM;
+	}
+	pthread_mutex_lock(&wheelLock);
+	for (level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+		for (slot = 0; slot < TIMER_LEVEL_SIZE; slot++) {
+			LIST_INIT(&wheel.slots[level][slot]);
+		}
+		wheel.occupied[level] = 0;
+	}
+	wheel.now = currentTick();
+	wheel.armed = NO_EXPIRY;
+	wheel.timers = 0;
+	timerWakeups = 0;
+	timerFired = 0;
+	timerCoalesced = 0;
+	timerMissed = 0;
+	timerLate = 0;
+	pthread_mutex_unlock(&wheelLock);
+	timerThreadRunning = 1;
+	if (pthread_create(&timerThread,NULL,timerThreadWork,NULL) != 0) {
+		ERR_MSG("Cannot create the timing thread: %s\n",strerror(errno));
+		timerThreadRunning = 0;
+		close(timerStopFd);
+		close(timerFd);
+		timerStopFd = -1;
+		timerFd = -1;
+		return -EPARAM;
+	}
+
+	return 0;
+}
+
+/**
+ * Stops the timing thread. Pending timers stay in the wheel until their owners delete them.
+ */
+void stopTimerWheel(void) {
+	uint64_t stop = 1;
+
+	if (timerFd < 0) {
+		return;
+	}
+	STORE_RELEASE(&timerThreadRunning,0);
+	if (write(timerStopFd,&stop,sizeof(stop)) < 0) {
+		ERR_MSG("Cannot wake up the timing thread: %s\n",strerror(errno));
+	}
+	pthread_join(timerThread,NULL);
+	pthread_mutex_lock(&wheelLock);
+	close(timerStopFd);
+	close(timerFd);
+	timerStopFd = -1;
+	timerFd = -1;
+	pthread_mutex_unlock(&wheelLock);
+}
+
+/**
+ * Starts {@link timer}, which calls {@link callback} every {@link periodMS} ms.
+ * The first deadline is aligned to a multiple of the period. Hence, timers with the same period expire at the same ticks and get fired by one wakeup.
+ * @return 0 on success. -EPARAM, if the period is zero or the wheel is not running.
+ */
+int addTimer(TimerEntry_t *timer, unsigned int periodMS, timerCallback callback, void *data) {
+	unsigned long long now = 0;
+
+	if (periodMS == 0 || callback == NULL) {
+		return -EPARAM;
+	}
+	timer->period = periodMS * (1000000ULL / TIMER_TICK_NS);
+	timer->callback = callback;
+	timer->data = data;
+	timer->missed = 0;
+	timer->late = 0;
+	pthread_mutex_lock(&wheelLock);
+	if (timerFd < 0) {
+		pthread_mutex_unlock(&wheelLock);
+		return -EPARAM;
+	}
+	now = currentTick();
+	if (now < wheel.now) {
+		now = wheel.now;
+	}
+	timer->expires = (now / timer->period + 1) * timer->period;
+	enqueueTimer(timer);
+	wheel.timers++;
+	if (timer->expires < wheel.armed) {
+		armTimer();
+	}
+	pthread_mutex_unlock(&wheelLock);
+
+	return 0;
+}
+
+/**
+ * Stops {@link timer}. Once it returns, its callback is not running and will not be called any longer.
+ */
+void delTimer(TimerEntry_t *timer) {
+	pthread_mutex_lock(&wheelLock);
+	if (timer->pending) {
+		dequeueTimer(timer);
+		wheel.timers--;
+	}
+	pthread_mutex_unlock(&wheelLock);
+}
+
+void getTimerStats(TimerStats_t *stats) {
+	pthread_mutex_lock(&wheelLock);
+	stats->timers = wheel.timers;
+	stats->wakeups = timerWakeups;
+	stats->fired = timerFired;
+	stats->coalesced = timerCoalesced;
+	stats->missed = timerMissed;
+	stats->late = timerLate;
+	pthread_mutex_unlock(&wheelLock);
+}
@@ -12,6 +12,9 @@ static char *devName = "eth1";
 module_param(devName, charp, S_IRUGO);
 static int useRelayFS = 0;
 module_param(useRelayFS, int, S_IRUGO);
+static int joinCacheTTL = 0;
+module_param(joinCacheTTL, int, S_IRUGO);
+MODULE_PARM_DESC(joinCacheTTL, "Reuse the sockets of all processes for this number of ms [default: 0]");
 
 #include "eval-relay.c"
 #include "eval-txrxjoin.c"
@@ -77,6 +77,7 @@ static void setupQueriesTXRXJoin(Query_t **query) {
 	INIT_EVT_STREAM(rxStreamJoin,"net.device.onRx",1,0,GET_BASE(rxJoinProcess))
 	SET_SELECTOR_STRING(rxStreamJoin,0,devName)
 	INIT_JOIN(rxJoinProcess,"process.process.sockets",NULL,2)
+	SET_JOIN_CACHE(rxJoinProcess,joinCacheTTL)
 	ADD_PREDICATE(rxJoinProcess,0,rxJoinProcessPredicateSocket)
 	SET_PREDICATE(rxJoinProcessPredicateSocket,EQUAL, OP_JOIN, "process.process.sockets", OP_STREAM, "net.packetType.socket")
 	ADD_PREDICATE(rxJoinProcess,1,rxJoinProcessPredicatePID)
@@ -88,6 +89,7 @@ static void setupQueriesTXRXJoin(Query_t **query) {
 	INIT_EVT_STREAM(txStreamJoin,"net.device.onTx",1,0,GET_BASE(txJoinProcess))
 	SET_SELECTOR_STRING(txStreamJoin,0,devName)
 	INIT_JOIN(txJoinProcess,"process.process.sockets",NULL,2)
+	SET_JOIN_CACHE(txJoinProcess,joinCacheTTL)
 	ADD_PREDICATE(txJoinProcess,0,txJoinProcessPredicate)
 	SET_PREDICATE(txJoinProcessPredicate,EQUAL, OP_JOIN, "process.process.sockets", OP_STREAM, "net.packetType.socket")
 	ADD_PREDICATE(txJoinProcess,1,txJoinProcessPredicatePID)
@@ -31,6 +31,46 @@ DECLARE_ELEMENTS(nsNet, model)
 DECLARE_ELEMENTS(objSocket, objDevice, srcSocketType, srcSocketFlags, typePacketType, srcTXBytes, srcRXBytes, evtOnRX, evtOnTX)
 DECLARE_ELEMENTS(typeMacHdr, typeMacProt, typeNetHdr, typeNetProt, typeTranspHdr, typeTransProt, typeDataLen, typeSockRef)
 
+/**
+ * Precompiled accessors for the tuples created by this provider. They are resolved in net_init() right after the datamodel was registered.
+ */
+static MemberAccessor_t accDevice, accPacketType, accMacHdr, accMacProt, accDataLen, accSocket, accRxBytes, accTxBytes;
+static MemberAccessorDesc_t accessors[] = {
+	{ &accDevice, 0, "net.device", "net.device" },
+	{ &accPacketType, 1, "net.packetType", "net.packetType" },
+	{ &accMacHdr, 1, "net.packetType", "net.packetType.macHdr" },
+	{ &accMacProt, 1, "net.packetType", "net.packetType.macProtocol" },
+	{ &accDataLen, 1, "net.packetType", "net.packetType.dataLength" },
+	{ &accSocket, 1, "net.packetType", "net.packetType.socket" },
+	{ &accRxBytes, 1, "net.device.rxBytes", "net.device.rxBytes" },
+	{ &accTxBytes, 1, "net.device.txBytes", "net.device.txBytes" }
+};
+/**
+ * Both packet handlers create the same kind of tuple. Its layout is computed in net_init() as well.
+ */
+static TupleTemplate_t packetTemplate;
+static char *packetItems[] = { "net.device", "net.packetType" };
+static TupleBufferDesc_t packetBuffers[] = {
+	{ &accDevice, IFNAMSIZ },
+	{ &accMacHdr, ETH_HLEN }
+};
+/**
+ * The members of a packet tuple both handlers know before building it. A query is skipped, if their values violate its filters.
+ */
+enum PacketField {
+	PACKET_DEVICE = 0,
+	PACKET_MAC_PROT,
+	PACKET_DATA_LEN,
+	PACKET_SOCKET,
+	PACKET_FIELDS
+};
+static PushdownField_t packetFields[PACKET_FIELDS] = {
+	[PACKET_DEVICE] = { "net.device", STRING },
+	[PACKET_MAC_PROT] = { "net.packetType.macProtocol", BYTE },
+	[PACKET_DATA_LEN] = { "net.packetType.dataLength", INT },
+	[PACKET_SOCKET] = { "net.packetType.socket", INT }
+};
+
 DECLARE_QUERY_LIST(rx);
 DECLARE_QUERY_LIST(tx);
 DECLARE_QUERY_LIST(dev);
@@ -49,6 +89,17 @@ static bool useProtSpecific = 0;
 module_param(useProtSpecific, bool, 0644);
 MODULE_PARM_DESC(useProtSpecific, "Use protocol-specific rx probes/tp [default: 0]");
 
+static void initPacketFields(PushdownValue_t *values, struct sk_buff *skb, struct sock *sk) {
+	values[PACKET_DEVICE].stringValue = (PTR_TYPE)skb->dev->name;
+	values[PACKET_MAC_PROT].byteValue = 42;
+	values[PACKET_DATA_LEN].intValue = skb->len;
+	if (sk && sk->sk_socket) {
+		values[PACKET_SOCKET].intValue = SOCK_INODE(sk->sk_socket)->i_ino;
+	} else {
+		values[PACKET_SOCKET].intValue = -1;
+	}
+}
+
 static void handlerTX(struct sk_buff *skb) {
 	Tupel_t *tupel = NULL;
 #ifndef EVALUATION
@@ -58,7 +109,7 @@ static void handlerTX(struct sk_buff *skb) {
 	struct request_sock *reqsk = NULL;
 	struct list_head *pos = NULL;
 	QuerySelectors_t *querySelec = NULL;
-	char *devName = NULL;
+	PushdownValue_t values[PACKET_FIELDS];
 	unsigned long long timeUS = 0;
 
 #ifdef EVALUATION
@@ -97,33 +148,27 @@ static void handlerTX(struct sk_buff *skb) {
 		return;
 	}
 
+	initPacketFields(values,skb,sk);
 	// Was the packet received by a device a query was registered on?
 	forEachQueryEvent(slcLock,tx,pos,querySelec)
 		if (strcmp(skb->dev->name,GET_SELECTORS(querySelec->query)[0].value) != 0) {
 			continue;
 		}
-		devName = ALLOC(strlen(skb->dev->name) + 1);
-		if (devName == NULL) {
+		// Do not build a tuple the query would drop anyway
+		if (matchPushdown(LOAD_ACQUIRE(&querySelec->pushdown),values) == 0) {
 			continue;
 		}
-		strcpy(devName,skb->dev->name);
-		tupel = initTupel(timeUS,2);
+		tupel = initTupelFromTemplate(&packetTemplate,timeUS);
 		if (tupel == NULL) {
 			continue;
 		}
 
-		allocItem(SLC_DATA_MODEL,tupel,0,"net.device");
-		setItemString(SLC_DATA_MODEL,tupel,"net.device",devName);
-		allocItem(SLC_DATA_MODEL,tupel,1,"net.packetType");
-		setItemArray(SLC_DATA_MODEL,tupel,"net.packetType.macHdr",ETH_HLEN);
-		copyArrayByte(SLC_DATA_MODEL,tupel,"net.packetType.macHdr",0,skb->data,ETH_HLEN);
-		setItemByte(SLC_DATA_MODEL,tupel,"net.packetType.macProtocol",42);
-		setItemInt(SLC_DATA_MODEL,tupel,"net.packetType.dataLength",skb->len);
-		if (sk && sk->sk_socket) {
-			setItemInt(SLC_DATA_MODEL,tupel,"net.packetType.socket",SOCK_INODE(sk->sk_socket)->i_ino);
-		} else {
-			setItemInt(SLC_DATA_MODEL,tupel,"net.packetType.socket",-1);
-		}
+		copyItemStringAcc(tupel,&accDevice,skb->dev->name);
+		setItemArrayAcc(tupel,&accMacHdr,ETH_HLEN);
+		copyArrayByteAcc(tupel,&accMacHdr,0,skb->data,ETH_HLEN);
+		setItemByteAcc(tupel,&accMacProt,values[PACKET_MAC_PROT].byteValue);
+		setItemIntAcc(tupel,&accDataLen,values[PACKET_DATA_LEN].intValue);
+		setItemIntAcc(tupel,&accSocket,values[PACKET_SOCKET].intValue);
 		eventOccuredUnicast(querySelec->query,tupel);
 	endForEachQuery(slcLock,tx);
 }
@@ -163,7 +208,7 @@ static void handlerRX(struct sk_buff *skb) {
 #endif
 	struct list_head *pos = NULL;
 	QuerySelectors_t *querySelec = NULL;
-	char *devName = NULL;
+	PushdownValue_t values[PACKET_FIELDS];
 	unsigned long long timeUS = 0;
 
 	/*
@@ -253,34 +298,28 @@ static void handlerRX(struct sk_buff *skb) {
 	timeUS = (unsigned long long)time.tv_sec * (unsigned long long)USEC_PER_SEC + (unsigned long long)time.tv_usec;
 #endif
 
+	initPacketFields(values,skb,sk);
 	// Acquire the slcLock to avoid change in the datamodel while creating the tuple
 	forEachQueryEvent(slcLock,rx,pos,querySelec)
 		// Was the packet received by a device a query was registered on?
 		if (strcmp(skb->dev->name,GET_SELECTORS(querySelec->query)[0].value) != 0) {
 			continue;
 		}
-		devName = ALLOC(strlen(skb->dev->name) + 1);
-		if (devName == NULL) {
+		// Do not build a tuple the query would drop anyway
+		if (matchPushdown(LOAD_ACQUIRE(&querySelec->pushdown),values) == 0) {
 			continue;
 		}
-		strcpy(devName,skb->dev->name);
-		tupel = initTupel(timeUS,2);
+		tupel = initTupelFromTemplate(&packetTemplate,timeUS);
 		if (tupel == NULL) {
 			continue;
 		}
 
-		allocItem(SLC_DATA_MODEL,tupel,0,"net.device");
-		setItemString(SLC_DATA_MODEL,tupel,"net.device",devName);
-		allocItem(SLC_DATA_MODEL,tupel,1,"net.packetType");
-		setItemArray(SLC_DATA_MODEL,tupel,"net.packetType.macHdr",ETH_HLEN);
-		copyArrayByte(SLC_DATA_MODEL,tupel,"net.packetType.macHdr",0,skb->data,ETH_HLEN);
-		setItemByte(SLC_DATA_MODEL,tupel,"net.packetType.macProtocol",42);
-		setItemInt(SLC_DATA_MODEL,tupel,"net.packetType.dataLength",skb->len);
-		if (sk && sk->sk_socket) {
-			setItemInt(SLC_DATA_MODEL,tupel,"net.packetType.socket", SOCK_INODE(sk->sk_socket)->i_ino);
-		} else {
-			setItemInt(SLC_DATA_MODEL,tupel,"net.packetType.socket",-1);
-		}
+		copyItemStringAcc(tupel,&accDevice,skb->dev->name);
+		setItemArrayAcc(tupel,&accMacHdr,ETH_HLEN);
+		copyArrayByteAcc(tupel,&accMacHdr,0,skb->data,ETH_HLEN);
+		setItemByteAcc(tupel,&accMacProt,values[PACKET_MAC_PROT].byteValue);
+		setItemIntAcc(tupel,&accDataLen,values[PACKET_DATA_LEN].intValue);
+		setItemIntAcc(tupel,&accSocket,values[PACKET_SOCKET].intValue);
 		eventOccuredUnicast(querySelec->query,tupel);
 	endForEachQuery(slcLock,rx)
 
@@ -336,6 +375,8 @@ static void activateTX(Query_t *query) {
 	QuerySelectors_t *querySelec = NULL;
 
 	addAndEnqueueQuery(tx,ret, querySelec, query)
+	// A handler running concurrently either sees no predicates or all of them
+	STORE_RELEASE(&querySelec->pushdown,compilePushdown(query,packetFields,PACKET_FIELDS));
 	// list was empty before insertion
 	if (ret == 1) {
 		if (useTracepoints) {
@@ -387,6 +428,8 @@ static void activateRX(Query_t *query) {
 	QuerySelectors_t *querySelec = NULL;
 
 	addAndEnqueueQuery(rx,ret, querySelec, query)
+	// A handler running concurrently either sees no predicates or all of them
+	STORE_RELEASE(&querySelec->pushdown,compilePushdown(query,packetFields,PACKET_FIELDS));
 	// list was empty before insertion
 	if (ret == 1) {
 		if (useTracepoints) {
@@ -534,10 +577,10 @@ static Tupel_t* getRxBytes(Selector_t *selectors, int len, Tupel_t* leftTuple) {
 	if (tuple == NULL) {
 		return NULL;
 	}
-	allocItem(SLC_DATA_MODEL,tuple,0,"net.device");
-	setItemString(SLC_DATA_MODEL,tuple,"net.device",devName);
-	allocItem(SLC_DATA_MODEL,tuple,1,"net.device.rxBytes");
-	setItemInt(SLC_DATA_MODEL,tuple,"net.device.rxBytes",rxBytes);
+	allocItemAcc(tuple,&accDevice);
+	setItemStringAcc(tuple,&accDevice,devName);
+	allocItemAcc(tuple,&accRxBytes);
+	setItemIntAcc(tuple,&accRxBytes,rxBytes);
 
 	return tuple;
 };
@@ -584,10 +627,10 @@ static Tupel_t* getTxBytes(Selector_t *selectors, int len, Tupel_t* leftTuple) {
 	if (tuple == NULL) {
 		return NULL;
 	}
-	allocItem(SLC_DATA_MODEL,tuple,0,"net.device");
-	setItemString(SLC_DATA_MODEL,tuple,"net.device",devName);
-	allocItem(SLC_DATA_MODEL,tuple,1,"net.device.txBytes");
-	setItemInt(SLC_DATA_MODEL,tuple,"net.device.txBytes",txBytes);
+	allocItemAcc(tuple,&accDevice);
+	setItemStringAcc(tuple,&accDevice,devName);
+	allocItemAcc(tuple,&accTxBytes);
+	setItemIntAcc(tuple,&accTxBytes,txBytes);
 
 	return tuple;
 }
@@ -639,8 +682,8 @@ dev = (struct net_device*)regs->ARM_r0;
 		if (tupel == NULL) {
 			continue;
 		}
-		allocItem(SLC_DATA_MODEL,tupel,0,"net.device");
-		setItemString(SLC_DATA_MODEL,tupel,"net.device",devName);
+		allocItemAcc(tupel,&accDevice);
+		setItemStringAcc(tupel,&accDevice,devName);
 		objectChangedUnicast(querySelec->query,tupel);
 	endForEachQuery(slcLock,dev)
 
@@ -694,8 +737,8 @@ dev = (struct net_device*)regs->ARM_r0;
 		if (tupel == NULL) {
 			continue;
 		}
-		allocItem(SLC_DATA_MODEL,tupel,0,"net.device");
-		setItemString(SLC_DATA_MODEL,tupel,"net.device",devName);
+		allocItemAcc(tupel,&accDevice);
+		setItemStringAcc(tupel,&accDevice,devName);
 		eventOccuredUnicast(querySelec->query,tupel);
 	endForEachQuery(slcLock,dev)
 
@@ -773,8 +816,8 @@ static Tupel_t* generateDeviceStatus(Selector_t *selectors, int len, Tupel_t* le
 			head = curTuple;
 		}
 		strcpy(devName,curDev->name);
-		allocItem(SLC_DATA_MODEL,curTuple,0,"net.device");
-		setItemString(SLC_DATA_MODEL,curTuple,"net.device",devName);
+		allocItemAcc(curTuple,&accDevice);
+		setItemStringAcc(curTuple,&accDevice,devName);
 		if (prevTuple != NULL) {
 			prevTuple->next = curTuple;
 		}
@@ -805,7 +848,6 @@ static Tupel_t* generateSocketStatus(Selector_t *selectors, int len, Tupel_t* le
 }
 
 static void initDatamodel(void) {
-	int i = 0;
 	INIT_SOURCE_POD(srcSocketType,"type",objSocket,INT,getSockType)
 	INIT_SOURCE_POD(srcSocketFlags,"flags",objSocket,INT,getSockFlags)
 	INIT_OBJECT(objSocket,"socket",nsNet,2,INT,activateSocket,deactivateSocket,generateSocketStatus)
@@ -870,6 +912,7 @@ static void resolveTPs(struct tracepoint *tp, void *data) {
 int __init net_init(void)
 {
 	int ret = 0;
+	unsigned long flags;
 	initDatamodel();
 
 	ret = 2;
@@ -887,6 +930,18 @@ int __init net_init(void)
 		freeDataModel(&model,0);
 		return -1;
 	}
+	ACQUIRE_READ_LOCK(slcLock);
+	ret = initMemberAccessors(SLC_DATA_MODEL,accessors,ARRAY_SIZE(accessors));
+	if (ret == 0) {
+		ret = initTupleTemplate(SLC_DATA_MODEL,&packetTemplate,packetItems,ARRAY_SIZE(packetItems),packetBuffers,ARRAY_SIZE(packetBuffers));
+	}
+	RELEASE_READ_LOCK(slcLock);
+	if (ret < 0) {
+		ERR_MSG("Cannot resolve accessors or the packet template: %d\n",-ret);
+		unregisterProvider(&model, NULL);
+		freeDataModel(&model,0);
+		return -1;
+	}
 	INFO_MSG("Registered net provider\n");
 
 	return 0;
@@ -901,6 +956,7 @@ void __exit net_exit(void) {
 	}
 
 	freeDataModel(&model,0);
+	freeTupleTemplate(&packetTemplate);
 	INFO_MSG("Unregistered net provider\n");
 }
 
@@ -3,6 +3,7 @@
 #include <linux/kprobes.h>
 #include <linux/if_ether.h>
 #include <linux/fdtable.h>
+#include <linux/hashtable.h>
 #include <net/sock.h>
 #include <datamodel.h>
 #include <query.h>
@@ -11,6 +12,19 @@
 DECLARE_ELEMENTS(nsProcess, model)
 DECLARE_ELEMENTS(objProcess, srcUTime, srcSTime, srcComm, srcProcessSockets)
 
+/**
+ * Precompiled accessors for the tuples created by this provider. They are resolved in process_init() right after the datamodel was registered.
+ */
+static MemberAccessor_t accProcess, accComm, accSTime, accUTime, accSockets, accSocketComm;
+static MemberAccessorDesc_t accessors[] = {
+	{ &accProcess, 0, "process.process", "process.process" },
+	{ &accComm, 1, "process.process.comm", "process.process.comm" },
+	{ &accSTime, 1, "process.process.stime", "process.process.stime" },
+	{ &accUTime, 1, "process.process.utime", "process.process.utime" },
+	{ &accSockets, 1, "process.process.sockets", "process.process.sockets" },
+	{ &accSocketComm, 2, "process.process.comm", "process.process.comm" }
+};
+
 DECLARE_QUERY_LIST(fork)
 DECLARE_QUERY_LIST(exit)
 
@@ -28,6 +42,209 @@ static get_files_struct_ptr getFilesStructFn;
 static put_files_struct_ptr putFilesStructFn;
 static rwlock_t *kernTaskListLock;
 
+static bool useSocketIndex = 1;
+module_param(useSocketIndex, bool, S_IRUGO);
+MODULE_PARM_DESC(useSocketIndex, "Look up the owners of a socket in an index instead of scanning the fd table of each process [default: 1]");
+
+/**
+ * Maps the inode of a socket to the processes owning it. Probes on the creation and the release of a socket
+ * as well as on fork and exit keep it up to date. Readers only hold the rcu read lock, writers take socketIndexLock.
+ */
+#define SOCKET_INDEX_BITS				10
+
+typedef struct SocketEntry {
+	struct hlist_node inodeNode;			// Links the entry into socketsByInode
+	struct hlist_node pidNode;				// ... and into socketsByPID
+	unsigned long inode;
+	pid_t pid;
+	char comm[TASK_COMM_LEN];
+	struct rcu_head rcu;
+} SocketEntry_t;
+
+static DEFINE_HASHTABLE(socketsByInode,SOCKET_INDEX_BITS);
+static DEFINE_HASHTABLE(socketsByPID,SOCKET_INDEX_BITS);
+static DEFINE_SPINLOCK(socketIndexLock);
+static unsigned long socketIndexSize = 0;
+
+static struct kretprobe sockCreateKP;
+static char sockCreateSymbolName[] = "sock_alloc_file";
+static struct kprobe sockCloseKP;
+static char sockCloseSymbolName[] = "sock_close";
+static struct kprobe exitFilesKP;
+static char exitFilesSymbolName[] = "exit_files";
+
+/**
+ * Adds the socket {@link inode} to the process {@link pid}, unless the index already knows it. The caller has to hold socketIndexLock.
+ */
+static void addSocketLocked(unsigned long inode, pid_t pid, const char *comm) {
+	SocketEntry_t *entry = NULL;
+
+	hash_for_each_possible(socketsByInode,entry,inodeNode,inode) {
+		if (entry->inode == inode && entry->pid == pid) {
+			return;
+		}
+	}
+	entry = ALLOC(sizeof(SocketEntry_t));
+	if (entry == NULL) {
+		ERR_MSG("Cannot allocate an entry for socket %lu of process %d\n",inode,pid);
+		return;
+	}
+	entry->inode = inode;
+	entry->pid = pid;
+	strncpy(entry->comm,comm,TASK_COMM_LEN - 1);
+	entry->comm[TASK_COMM_LEN - 1] = '\0';
+	hash_add_rcu(socketsByInode,&entry->inodeNode,inode);
+	hash_add_rcu(socketsByPID,&entry->pidNode,pid);
+	socketIndexSize++;
+}
+
+/**
+ * Removes {@link entry} from the index. Its memory is not released until all readers left their rcu read-side critical section.
+ */
+static void delSocketLocked(SocketEntry_t *entry) {
+	hash_del_rcu(&entry->inodeNode);
+	hash_del_rcu(&entry->pidNode);
+	kfree_rcu(entry,rcu);
+	socketIndexSize--;
+}
+
+static void addSocket(unsigned long inode, pid_t pid, const char *comm) {
+	unsigned long flags;
+
+	spin_lock_irqsave(&socketIndexLock,flags);
+	addSocketLocked(inode,pid,comm);
+	spin_unlock_irqrestore(&socketIndexLock,flags);
+}
+
+/**
+ * Hands all sockets of {@link parent} down to the new process {@link child}, because it inherits the fd table.
+ * The child might have exited already. Its sockets are only added, if handlerExitFiles() did not remove them yet.
+ */
+static void copyProcessSockets(pid_t parent, struct task_struct *child, const char *comm) {
+	SocketEntry_t *entry = NULL;
+	unsigned long flags;
+
+	spin_lock_irqsave(&socketIndexLock,flags);
+	/*
+	 * The last thread of the child decrements signal->live, before handlerExitFiles() takes the lock.
+	 * If it is still positive, the entries added here will be removed by it.
+	 */
+	if (atomic_read(&child->signal->live) == 0) {
+		spin_unlock_irqrestore(&socketIndexLock,flags);
+		return;
+	}
+	// New entries are added at the head of a bucket. Hence, the loop does not see the ones of the child.
+	hash_for_each_possible(socketsByPID,entry,pidNode,parent) {
+		if (entry->pid == parent) {
+			addSocketLocked(entry->inode,child->tgid,comm);
+		}
+	}
+	spin_unlock_irqrestore(&socketIndexLock,flags);
+}
+
+static void delProcessSockets(pid_t pid) {
+	SocketEntry_t *entry = NULL;
+	struct hlist_node *tmp = NULL;
+	unsigned long flags;
+
+	spin_lock_irqsave(&socketIndexLock,flags);
+	hash_for_each_possible_safe(socketsByPID,entry,tmp,pidNode,pid) {
+		if (entry->pid == pid) {
+			delSocketLocked(entry);
+		}
+	}
+	spin_unlock_irqrestore(&socketIndexLock,flags);
+}
+
+/**
+ * The last reference to the socket {@link inode} is gone. Every process still owning it has closed it.
+ */
+static void delSocket(unsigned long inode) {
+	SocketEntry_t *entry = NULL;
+	struct hlist_node *tmp = NULL;
+	unsigned long flags;
+
+	spin_lock_irqsave(&socketIndexLock,flags);
+	hash_for_each_possible_safe(socketsByInode,entry,tmp,inodeNode,inode) {
+		if (entry->inode == inode) {
+			delSocketLocked(entry);
+		}
+	}
+	spin_unlock_irqrestore(&socketIndexLock,flags);
+}
+
+/**
+ * sock_alloc_file() binds a new socket to a file. It is called by socket(), socketpair() and accept() on behalf of the current process.
+ */
+static int handlerSocketCreate(struct kretprobe_instance *ri, struct pt_regs *regs) {
+	struct file *file = (struct file*)regs_return_value(regs);
+	struct socket *sock = NULL;
+
+	if (IS_ERR_OR_NULL(file)) {
+		return 0;
+	}
+	sock = (struct socket*)file->private_data;
+	if (sock == NULL) {
+		return 0;
+	}
+	addSocket(SOCK_INODE(sock)->i_ino,current->tgid,current->group_leader->comm);
+
+	return 0;
+}
+
+/**
+ * sock_close() is the release function of a socket file. It is called, once the last fd referring to it is closed.
+ */
+static int handlerSocketClose(struct kprobe *p, struct pt_regs *regs) {
+	struct inode *inode = NULL;
+
+#if defined(__i386__)
+	inode = (struct inode*)regs->ax;
+#elif defined(__x86_64__)
+	inode = (struct inode*)regs->di;
+#elif defined(__arm__)
+	inode = (struct inode*)regs->ARM_r0;
+#else
+#error Unknown architecture
+#endif
+	if (inode != NULL) {
+		delSocket(inode->i_ino);
+	}
+
+	return 0;
+}
+
+/**
+ * Updates the index, if {@link child} is a new process rather than a new thread of the current one
+ */
+static void forkSocketIndex(int child) {
+	struct task_struct *task = NULL;
+	char comm[TASK_COMM_LEN];
+	pid_t childTGID = 0;
+
+	if (child <= 0) {
+		return;
+	}
+	rcu_read_lock();
+	task = pid_task(find_vpid(child),PIDTYPE_PID);
+	if (task != NULL) {
+		// The child might exit and be reaped meanwhile. Keep its signal struct.
+		get_task_struct(task);
+		childTGID = task->tgid;
+		strncpy(comm,task->comm,TASK_COMM_LEN - 1);
+		comm[TASK_COMM_LEN - 1] = '\0';
+	}
+	rcu_read_unlock();
+	if (task == NULL) {
+		return;
+	}
+	// A thread shares the fd table of its process. Nothing to do.
+	if (childTGID != current->tgid) {
+		copyProcessSockets(current->tgid,task,comm);
+	}
+	put_task_struct(task);
+}
+
 static int handlerFork(struct kretprobe_instance *ri, struct pt_regs *regs) {
 	int retval = regs_return_value(regs);
 	Tupel_t *tuple = NULL;
@@ -45,13 +262,17 @@ static int handlerFork(struct kretprobe_instance *ri, struct pt_regs *regs) {
 	timeUS = (unsigned long long)time.tv_sec * (unsigned long long)USEC_PER_SEC + (unsigned long long)time.tv_usec;
 #endif
 
+	if (useSocketIndex) {
+		forkSocketIndex(retval);
+	}
+	objectInstancesChanged(&objProcess);
 	forEachQueryObject(slcLock, fork, pos, querySelec, OBJECT_CREATE)
 		tuple = initTupel(timeUS,1);
 		if (tuple == NULL) {
 			continue;
 		}
-		allocItem(SLC_DATA_MODEL,tuple,0,"process.process");
-		setItemInt(SLC_DATA_MODEL,tuple,"process.process",retval);
+		allocItemAcc(tuple,&accProcess);
+		setItemIntAcc(tuple,&accProcess,retval);
 		objectChangedUnicast(querySelec->query,tuple);
 	endForEachQuery(slcLock,fork)
 
@@ -75,19 +296,77 @@ static int handlerExit(struct kprobe *p, struct pt_regs *regs) {
 	timeUS = (unsigned long long)time.tv_sec * (unsigned long long)USEC_PER_SEC + (unsigned long long)time.tv_usec;
 #endif
 
+	objectInstancesChanged(&objProcess);
 	forEachQueryObject(slcLock, exit, pos, querySelec, OBJECT_DELETE)
 		tuple = initTupel(timeUS,1);
 		if (tuple == NULL) {
 			continue;
 		}
-		allocItem(SLC_DATA_MODEL,tuple,0,"process.process");
-		setItemInt(SLC_DATA_MODEL,tuple,"process.process",curTask->pid);
+		allocItemAcc(tuple,&accProcess);
+		setItemIntAcc(tuple,&accProcess,curTask->pid);
 		objectChangedUnicast(querySelec->query,tuple);
 	endForEachQuery(slcLock,exit)
 
 	return 0;
 }
 
+/**
+ * do_exit() calls exit_files() after it decremented signal->live. Once it is 0, each thread of the process passed that point.
+ * The sockets belong to the process. Hence, they are released along with its last thread.
+ * More than one exiting thread might see 0. Removing the sockets a second time does nothing.
+ */
+static int handlerExitFiles(struct kprobe *p, struct pt_regs *regs) {
+	if (atomic_read(&current->signal->live) == 0) {
+		delProcessSockets(current->tgid);
+	}
+
+	return 0;
+}
+
+static int registerForkProbe(void) {
+	int ret = 0;
+
+	memset(&forkKP,0,sizeof(struct kretprobe));
+	forkKP.kp.symbol_name = forkSymbolName;
+	forkKP.handler = handlerFork;
+	forkKP.maxactive = 20;
+	ret = register_kretprobe(&forkKP);
+	if (ret < 0) {
+		ERR_MSG("Registration of kprobe at %s failed. Reason: %d\n",forkKP.kp.symbol_name,ret);
+	} else {
+		INFO_MSG("Registered kretprobe at %s\n",forkKP.kp.symbol_name);
+	}
+	return ret;
+}
+
+static void unregisterForkProbe(void) {
+	unregister_kretprobe(&forkKP);
+	INFO_MSG("Unregistered kretprobe at %s. Missed it %lu times.\n",forkKP.kp.symbol_name,forkKP.kp.nmissed);
+}
+
+static int registerExitProbe(void) {
+	int ret = 0;
+
+	memset(&exitKP,0,sizeof(struct kprobe));
+	exitKP.symbol_name = exitSymbolName;
+	exitKP.pre_handler = handlerExit;
+	ret = register_kprobe(&exitKP);
+	if (ret < 0) {
+		ERR_MSG("Registration of kprobe at %s failed. Reason: %d\n",exitKP.symbol_name,ret);
+	} else {
+		INFO_MSG("Registered kprobe at %s\n",exitKP.symbol_name);
+	}
+	return ret;
+}
+
+static void unregisterExitProbe(void) {
+	unregister_kprobe(&exitKP);
+	INFO_MSG("Unregistered kprobe at %s. Missed it %lu times.\n",exitKP.symbol_name,exitKP.nmissed);
+}
+
+/**
+ * If the socket index is used, the probes on fork and exit stay registered as long as the module is loaded.
+ */
 static void activateProcess(Query_t *query) {
 	int ret = 0, events = 0;
 	QuerySelectors_t *querySelec = NULL;
@@ -95,32 +374,14 @@ static void activateProcess(Query_t *query) {
 	events = ((ObjectStream_t*)query->root)->objectEvents;
 	if ((events & OBJECT_CREATE) == OBJECT_CREATE) {
 		addAndEnqueueQuery(fork,ret, querySelec, query)
-		if (ret == 1) {
-			memset(&forkKP,0,sizeof(struct kretprobe));
-			forkKP.kp.symbol_name = forkSymbolName;
-			forkKP.handler = handlerFork;
-			forkKP.maxactive = 20;
-			ret = register_kretprobe(&forkKP);
-			if (ret < 0) {
-				ERR_MSG("Registration of kprobe at %s failed. Reason: %d\n",forkKP.kp.symbol_name,ret);
-			} else {
-				INFO_MSG("Registered kretprobe at %s\n",forkKP.kp.symbol_name);
-			}
+		if (ret == 1 && !useSocketIndex) {
+			registerForkProbe();
 		}
 	}
 	if ((events & OBJECT_DELETE) == OBJECT_DELETE) {
 		addAndEnqueueQuery(exit,ret, querySelec, query)
-		if (ret == 1) {
-			memset(&exitKP,0,sizeof(struct kprobe));
-			exitKP.symbol_name = exitSymbolName;
-			exitKP.pre_handler = handlerExit;
-			ret = register_kprobe(&exitKP);
-			if (ret < 0) {
-				ERR_MSG("Registration of kprobe at %s failed. Reason: %d\n",exitKP.symbol_name,ret);
-				return;
-			} else {
-				INFO_MSG("Registered kprobe at %s\n",exitKP.symbol_name);
-			}
+		if (ret == 1 && !useSocketIndex) {
+			registerExitProbe();
 		}
 	}
 }
@@ -133,16 +394,14 @@ static void deactivateProcess(Query_t *query) {
 	events = ((ObjectStream_t*)query->root)->objectEvents;
 	if ((events & OBJECT_CREATE) == OBJECT_CREATE) {
 		findAndDeleteQuery(fork,listEmpty, querySelec, query, pos, next);
-		if (listEmpty == 1) {
-			unregister_kretprobe(&forkKP);
-			INFO_MSG("Unregistered kretprobe at %s. Missed it %lu times.\n",forkKP.kp.symbol_name,forkKP.kp.nmissed);
+		if (listEmpty == 1 && !useSocketIndex) {
+			unregisterForkProbe();
 		}
 	}
 	if ((events & OBJECT_DELETE) == OBJECT_DELETE) {
 		findAndDeleteQuery(exit,listEmpty, querySelec, query, pos, next)
-		if (listEmpty == 1) {
-			unregister_kprobe(&exitKP);
-			INFO_MSG("Unregistered kprobe at %s. Missed it %lu times.\n",exitKP.symbol_name,exitKP.nmissed);
+		if (listEmpty == 1 && !useSocketIndex) {
+			unregisterExitProbe();
 		}
 	}
 }
@@ -170,8 +429,8 @@ static Tupel_t* generateProcessStatus(Selector_t *selectors, int len, Tupel_t *l
 		if (head == NULL) {
 			head = curTuple;
 		}
-		allocItem(SLC_DATA_MODEL,curTuple,0,"process.process");
-		setItemInt(SLC_DATA_MODEL,curTuple,"process.process",curTask->pid);
+		allocItemAcc(curTuple,&accProcess);
+		setItemIntAcc(curTuple,&accProcess,curTask->pid);
 		if (prevTuple != NULL) {
 			prevTuple->next = curTuple;
 		}
@@ -225,10 +484,10 @@ static Tupel_t* getComm(Selector_t *selectors, int len, Tupel_t *leftTuple) {
 	if (tuple == NULL) {
 		return NULL;
 	}
-	allocItem(SLC_DATA_MODEL,tuple,0,"process.process");
-	setItemInt(SLC_DATA_MODEL,tuple,"process.process",*(int*)(&selectors[0].value));
-	timeUS=allocItem(SLC_DATA_MODEL,tuple,1,"process.process.comm");
-	setItemString(SLC_DATA_MODEL,tuple,"process.process.comm",comm);
+	allocItemAcc(tuple,&accProcess);
+	setItemIntAcc(tuple,&accProcess,*(int*)(&selectors[0].value));
+	timeUS=allocItemAcc(tuple,&accComm);
+	setItemStringAcc(tuple,&accComm,comm);
 
 	return tuple;
 }
@@ -274,10 +533,10 @@ static Tupel_t* getSTime(Selector_t *selectors, int len, Tupel_t *leftTuple) {
 		return NULL;
 	}
 
-	allocItem(SLC_DATA_MODEL,tuple,0,"process.process");
-	setItemInt(SLC_DATA_MODEL,tuple,"process.process",*(int*)(&selectors[0].value));
-	allocItem(SLC_DATA_MODEL,tuple,1,"process.process.stime");
-	setItemInt(SLC_DATA_MODEL,tuple,"process.process.stime",sTimeUS);
+	allocItemAcc(tuple,&accProcess);
+	setItemIntAcc(tuple,&accProcess,*(int*)(&selectors[0].value));
+	allocItemAcc(tuple,&accSTime);
+	setItemIntAcc(tuple,&accSTime,sTimeUS);
 
 	return tuple;
 }
@@ -324,78 +583,92 @@ static Tupel_t* getUTime(Selector_t *selectors, int len, Tupel_t *leftTuple) {
 		return NULL;
 	}
 
-	allocItem(SLC_DATA_MODEL,tuple,0,"process.process");
-	setItemInt(SLC_DATA_MODEL,tuple,"process.process",*(int*)(&selectors[0].value));
-	allocItem(SLC_DATA_MODEL,tuple,1,"process.process.utime");
-	setItemInt(SLC_DATA_MODEL,tuple,"process.process.utime",uTimeUS);
+	allocItemAcc(tuple,&accProcess);
+	setItemIntAcc(tuple,&accProcess,*(int*)(&selectors[0].value));
+	allocItemAcc(tuple,&accUTime);
+	setItemIntAcc(tuple,&accUTime,uTimeUS);
 
 	return tuple;
 }
 
-static Tupel_t* getSockets(Selector_t *selectors, int len, Tupel_t *leftTuple) {
-	Tupel_t *curTuple = NULL, *head = NULL, *prevTuple = NULL;
-#ifndef EVALUATION
-	struct timeval time;
-#endif
-	struct fdtable *fdt = NULL;
-	struct file *file = NULL;
-	struct pid *pid = NULL;
-	struct task_struct *startTask, *curTask;
-	struct socket *sock = NULL;
-	struct files_struct *files;
-	unsigned long long timeUS = 0;
-	int foo = 0, i = 0, runOnce = 0, sockNo = -1;
-	//unsigned long flags;
-	char lastFileEmpty = 0;
+/**
+ * Collects the tuples of the sockets source. If {@link sockNo} is not -1, only the owners of this socket are collected.
+ */
+typedef struct SocketScan {
+	unsigned long long timeUS;
+	int sockNo;
+	Tupel_t *head;
+	Tupel_t *prev;
+} SocketScan_t;
 
-	if (selectors == NULL) {
-		return NULL;
+typedef void (*visitSocket_t)(struct task_struct *task, struct socket *sock, void *data);
+
+static void appendSocketTuple(SocketScan_t *scan, pid_t pid, unsigned long inode, const char *comm) {
+	Tupel_t *curTuple = NULL;
+
+	curTuple = initTupel(scan->timeUS,3);
+	if (curTuple == NULL) {
+		return;
 	}
-	if (leftTuple != NULL) {
-		sockNo = getItemInt(SLC_DATA_MODEL,leftTuple,"net.packetType.socket");
+	allocItemAcc(curTuple,&accProcess);
+	setItemIntAcc(curTuple,&accProcess,pid);
+	allocItemAcc(curTuple,&accSockets);
+	setItemIntAcc(curTuple,&accSockets,inode);
+	allocItemAcc(curTuple,&accSocketComm);
+	copyItemStringAcc(curTuple,&accSocketComm,comm);
+	if (scan->prev == NULL) {
+		scan->head = curTuple;
+	} else {
+		scan->prev->next = curTuple;
 	}
+	scan->prev = curTuple;
+}
 
-	foo = *(int*)(&selectors[0].value);
-	if (foo == -1) {
-		startTask = &init_task;
-	} else {
-		runOnce = 1;
-		// Retrieve the kernel representation of a pid
-		pid = find_get_pid(foo);
-		if (pid == NULL) {
-			return NULL;
-		}
-		// Resolve it to a struct task_struct
-		startTask = get_pid_task(pid,PIDTYPE_PID);
-		put_pid(pid);
-		if (startTask == NULL) {
-			return NULL;
-		}
+static void collectSocket(struct task_struct *task, struct socket *sock, void *data) {
+	SocketScan_t *scan = (SocketScan_t*)data;
+
+	if (scan->sockNo != -1 && scan->sockNo != SOCK_INODE(sock)->i_ino) {
+		return;
 	}
-	foo = 0;
+	appendSocketTuple(scan,task->pid,SOCK_INODE(sock)->i_ino,task->comm);
+}
 
-#ifdef EVALUATION
-	timeUS = getCycles();
-#else
-	do_gettimeofday(&time);
-	timeUS = (unsigned long long)time.tv_sec * (unsigned long long)USEC_PER_SEC + (unsigned long long)time.tv_usec;
-#endif
+static void indexSocket(struct task_struct *task, struct socket *sock, void *data) {
+	addSocket(SOCK_INODE(sock)->i_ino,task->tgid,task->comm);
+}
 
-	if (read_trylock(kernTaskListLock) == 0) {
-		return NULL;
+/**
+ * Calls {@link visitor} for each socket in the fd table of {@link task}. If {@link task} is NULL, all processes are visited.
+ * Unless {@link wait} is set, the scan gives up on a process, whose fd table is locked at the moment, and on all of them, if the tasklist is locked.
+ */
+static void scanSockets(struct task_struct *task, int wait, visitSocket_t visitor, void *data) {
+	struct fdtable *fdt = NULL;
+	struct file *file = NULL;
+	struct socket *sock = NULL;
+	struct files_struct *files = NULL;
+	struct task_struct *curTask = NULL;
+	int err = 0, i = 0;
+	char lastFileEmpty = 0;
+
+	if (wait) {
+		read_lock(kernTaskListLock);
+	} else if (read_trylock(kernTaskListLock) == 0) {
+		return;
 	}
-	//local_irq_save(flags);
-	for (curTask = startTask; (curTask  = next_task(curTask)) != &init_task;) { // <-- same as 'for_each_process(curTask)'
+	for (curTask = (task != NULL ? task : next_task(&init_task)); curTask != &init_task; curTask = next_task(curTask)) { // <-- same as 'for_each_process(curTask)'
 		get_task_struct(curTask);
 		// Increment the reference counter for the files struct. Otherwise it might be deleted during the following steps
 		files = getFilesStructFn(curTask);
 		if (files == NULL) {
 			goto puttask;
 		}
-		if (spin_trylock(&files->file_lock) == 0) {
+		if (wait) {
+			spin_lock(&files->file_lock);
+		} else if (spin_trylock(&files->file_lock) == 0) {
 			goto putfiles;
 		}
 		fdt = files_fdtable(files);
+		lastFileEmpty = 0;
 		for (i = 0; i < fdt->max_fds; i++) {
 			file = rcu_dereference_check_fdtable(files, fdt->fd[i]);
 			if (file == NULL) {
@@ -410,47 +683,181 @@ static Tupel_t* getSockets(Selector_t *selectors, int len, Tupel_t *leftTuple) {
 			}
 			lastFileEmpty = 0;
 			// Refers the current fd to a socket?
-			sock = sock_from_file(file,&foo);
+			sock = sock_from_file(file,&err);
 			if (sock == NULL) {
 				continue;
 			}
-			if (sockNo != -1 && sockNo != SOCK_INODE(sock)->i_ino) {
-				continue;
-			}
-			// Yeah, it does. \o/ Allocate a tuple and copy the information
-			curTuple = initTupel(timeUS,2);
-			if (curTuple == NULL) {
-				continue;
-			}
-			if (head == NULL) {
-				head = curTuple;
-			}
-			allocItem(SLC_DATA_MODEL,curTuple,0,"process.process");
-			setItemInt(SLC_DATA_MODEL,curTuple,"process.process",curTask->pid);
-			allocItem(SLC_DATA_MODEL,curTuple,1,"process.process.sockets");
-			setItemInt(SLC_DATA_MODEL,curTuple,"process.process.sockets",SOCK_INODE(sock)->i_ino);
-			if (prevTuple != NULL) {
-				prevTuple->next = curTuple;
-			}
-			prevTuple = curTuple;
+			visitor(curTask,sock,data);
 		}
 		spin_unlock(&files->file_lock);
 		// Give the files struct back to the kernel
 putfiles:	putFilesStructFn(files);
 		// Give the task back to the kernel
 puttask:	put_task_struct(curTask);
-		if (runOnce == 1) {
+		if (task != NULL) {
 			break;
 		}
 	}
-	//local_irq_restore(flags);
 	read_unlock(kernTaskListLock);
+}
 
-	return head;
+/**
+ * Answers a query from the socket index. Given a socket, only its bucket has to be searched.
+ */
+static void lookupSockets(SocketScan_t *scan, int pid) {
+	SocketEntry_t *entry = NULL;
+	int bkt = 0;
+
+	rcu_read_lock();
+	if (scan->sockNo != -1) {
+		hash_for_each_possible_rcu(socketsByInode,entry,inodeNode,(unsigned long)scan->sockNo) {
+			if (entry->inode == (unsigned long)scan->sockNo && (pid == -1 || entry->pid == pid)) {
+				appendSocketTuple(scan,entry->pid,entry->inode,entry->comm);
+			}
+		}
+	} else if (pid != -1) {
+		hash_for_each_possible_rcu(socketsByPID,entry,pidNode,pid) {
+			if (entry->pid == pid) {
+				appendSocketTuple(scan,entry->pid,entry->inode,entry->comm);
+			}
+		}
+	} else {
+		hash_for_each_rcu(socketsByInode,bkt,entry,inodeNode) {
+			appendSocketTuple(scan,entry->pid,entry->inode,entry->comm);
+		}
+	}
+	rcu_read_unlock();
+}
+
+static Tupel_t* getSockets(Selector_t *selectors, int len, Tupel_t *leftTuple) {
+	SocketScan_t scan;
+#ifndef EVALUATION
+	struct timeval time;
+#endif
+	struct pid *pid = NULL;
+	struct task_struct *task = NULL;
+	int pidNo = -1;
+
+	if (selectors == NULL) {
+		return NULL;
+	}
+	memset(&scan,0,sizeof(SocketScan_t));
+	scan.sockNo = -1;
+	if (leftTuple != NULL) {
+		scan.sockNo = getItemInt(SLC_DATA_MODEL,leftTuple,"net.packetType.socket");
+	}
+#ifdef EVALUATION
+	scan.timeUS = getCycles();
+#else
+	do_gettimeofday(&time);
+	scan.timeUS = (unsigned long long)time.tv_sec * (unsigned long long)USEC_PER_SEC + (unsigned long long)time.tv_usec;
+#endif
+
+	pidNo = *(int*)(&selectors[0].value);
+	if (useSocketIndex) {
+		lookupSockets(&scan,pidNo);
+		return scan.head;
+	}
+	if (pidNo != -1) {
+		// Retrieve the kernel representation of a pid
+		pid = find_get_pid(pidNo);
+		if (pid == NULL) {
+			return NULL;
+		}
+		// Resolve it to a struct task_struct
+		task = get_pid_task(pid,PIDTYPE_PID);
+		put_pid(pid);
+		if (task == NULL) {
+			return NULL;
+		}
+	}
+	scanSockets(task,0,collectSocket,&scan);
+	if (task != NULL) {
+		put_task_struct(task);
+	}
+
+	return scan.head;
+}
+
+/**
+ * Registers the probes maintaining the socket index and fills it with the sockets currently open.
+ * A socket created during the scan is added by the probe and the scan. The index drops the duplicate.
+ */
+static int initSocketIndex(void) {
+	int ret = 0;
+
+	memset(&sockCreateKP,0,sizeof(struct kretprobe));
+	sockCreateKP.kp.symbol_name = sockCreateSymbolName;
+	sockCreateKP.handler = handlerSocketCreate;
+	sockCreateKP.maxactive = 20;
+	ret = register_kretprobe(&sockCreateKP);
+	if (ret < 0) {
+		ERR_MSG("Registration of kprobe at %s failed. Reason: %d\n",sockCreateKP.kp.symbol_name,ret);
+		return ret;
+	}
+	memset(&sockCloseKP,0,sizeof(struct kprobe));
+	sockCloseKP.symbol_name = sockCloseSymbolName;
+	sockCloseKP.pre_handler = handlerSocketClose;
+	ret = register_kprobe(&sockCloseKP);
+	if (ret < 0) {
+		ERR_MSG("Registration of kprobe at %s failed. Reason: %d\n",sockCloseKP.symbol_name,ret);
+		goto unregCreate;
+	}
+	if ((ret = registerForkProbe()) < 0) {
+		goto unregClose;
+	}
+	if ((ret = registerExitProbe()) < 0) {
+		goto unregFork;
+	}
+	memset(&exitFilesKP,0,sizeof(struct kprobe));
+	exitFilesKP.symbol_name = exitFilesSymbolName;
+	exitFilesKP.pre_handler = handlerExitFiles;
+	ret = register_kprobe(&exitFilesKP);
+	if (ret < 0) {
+		ERR_MSG("Registration of kprobe at %s failed. Reason: %d\n",exitFilesKP.symbol_name,ret);
+		goto unregExit;
+	}
+	scanSockets(NULL,1,indexSocket,NULL);
+	INFO_MSG("Socket index holds %lu entries\n",socketIndexSize);
+
+	return 0;
+
+unregExit:
+	unregisterExitProbe();
+unregFork:
+	unregisterForkProbe();
+unregClose:
+	unregister_kprobe(&sockCloseKP);
+unregCreate:
+	unregister_kretprobe(&sockCreateKP);
+	return ret;
+}
+
+static void destroySocketIndex(void) {
+	SocketEntry_t *entry = NULL;
+	struct hlist_node *tmp = NULL;
+	unsigned long flags;
+	int bkt = 0;
+
+	unregister_kprobe(&exitFilesKP);
+	unregisterExitProbe();
+	unregisterForkProbe();
+	unregister_kprobe(&sockCloseKP);
+	unregister_kretprobe(&sockCreateKP);
+	INFO_MSG("Unregistered the probes of the socket index. Missed %s %lu times and %s %lu times.\n",sockCreateSymbolName,sockCreateKP.kp.nmissed,sockCloseSymbolName,sockCloseKP.nmissed);
+	// Wait for the readers and the entries removed before
+	synchronize_rcu();
+	spin_lock_irqsave(&socketIndexLock,flags);
+	hash_for_each_safe(socketsByInode,bkt,tmp,entry,inodeNode) {
+		hash_del(&entry->inodeNode);
+		hash_del(&entry->pidNode);
+		FREE(entry);
+	}
+	socketIndexSize = 0;
+	spin_unlock_irqrestore(&socketIndexLock,flags);
 }
 
 static void initDatamodel(void) {
-	int i = 0;
 	INIT_SOURCE_POD(srcUTime,"utime",objProcess,INT,getUTime)
 	INIT_SOURCE_POD(srcSTime,"stime",objProcess,INT,getSTime)
 	INIT_SOURCE_POD(srcComm,"comm",objProcess,STRING,getComm)
@@ -471,6 +878,7 @@ static void initDatamodel(void) {
 int __init process_init(void)
 {
 	int ret = 0;
+	unsigned long flags;
 	initDatamodel();
 
 	kernTaskListLock = (rwlock_t*)kallsyms_lookup_name("tasklist_lock");
@@ -498,6 +906,24 @@ int __init process_init(void)
 		freeDataModel(&model,0);
 		return -1;
 	}
+	ACQUIRE_READ_LOCK(slcLock);
+	ret = initMemberAccessors(SLC_DATA_MODEL,accessors,ARRAY_SIZE(accessors));
+	RELEASE_READ_LOCK(slcLock);
+	if (ret < 0) {
+		ERR_MSG("Cannot resolve accessors: %d\n",-ret);
+		unregisterProvider(&model, NULL);
+		freeDataModel(&model,0);
+		return -1;
+	}
+	if (useSocketIndex) {
+		ret = initSocketIndex();
+		if (ret < 0) {
+			ERR_MSG("Cannot set up the socket index: %d\n",-ret);
+			unregisterProvider(&model, NULL);
+			freeDataModel(&model,0);
+			return -1;
+		}
+	}
 	INFO_MSG("Registered process provider\n");
 
 	return 0;
@@ -510,6 +936,9 @@ void __exit process_exit(void) {
 	if (ret < 0 ) {
 		ERR_MSG("Unregister datamodel process failed: %d\n",-ret);
 	}
+	if (useSocketIndex) {
+		destroySocketIndex();
+	}
 	freeDataModel(&model,0);
 
 	INFO_MSG("Unregistered process provider\n");
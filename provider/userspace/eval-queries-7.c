@@ -17,6 +17,7 @@ static Predicate_t rxJoinProcessPredicateSocket, rxJoinProcessPredicatePID, txJo
 static Join_t rxJoinProcess, txJoinProcess;
 static Query_t queryRXJoin, queryTXJoin;
 static char *devName = NULL;
+static int joinCacheTTL = 0;
 
 static unsigned long long nRx, nTx;
 
@@ -84,6 +85,7 @@ static void setupQueries(void) {
 	INIT_EVT_STREAM(rxStreamJoin,"net.device.onRx",1,0,GET_BASE(rxJoinProcess))
 	SET_SELECTOR_STRING(rxStreamJoin,0,devName)
 	INIT_JOIN(rxJoinProcess,"process.process.sockets",NULL,2)
+	SET_JOIN_CACHE(rxJoinProcess,joinCacheTTL)
 	ADD_PREDICATE(rxJoinProcess,0,rxJoinProcessPredicateSocket)
 	SET_PREDICATE(rxJoinProcessPredicateSocket,EQUAL, OP_JOIN, "process.process.sockets", OP_STREAM, "net.packetType.socket")
 	ADD_PREDICATE(rxJoinProcess,1,rxJoinProcessPredicatePID)
@@ -95,6 +97,7 @@ static void setupQueries(void) {
 	INIT_EVT_STREAM(txStreamJoin,"net.device.onTx",1,0,GET_BASE(txJoinProcess))
 	SET_SELECTOR_STRING(txStreamJoin,0,devName)
 	INIT_JOIN(txJoinProcess,"process.process.sockets",NULL,2)
+	SET_JOIN_CACHE(txJoinProcess,joinCacheTTL)
 	ADD_PREDICATE(txJoinProcess,0,txJoinProcessPredicate)
 	SET_PREDICATE(txJoinProcessPredicate,EQUAL, OP_JOIN, "process.process.sockets", OP_STREAM, "net.packetType.socket")
 	ADD_PREDICATE(txJoinProcess,1,txJoinProcessPredicatePID)
@@ -107,8 +110,11 @@ int onLoad(int argc, char *argv[]) {
 
 	optind = 1;
 	opterr = 0;
-	while ((opt = getopt(argc, argv, "d:ef:")) != -1) {
+	while ((opt = getopt(argc, argv, "c:d:ef:")) != -1) {
 		switch (opt) {
+		case 'c':
+			joinCacheTTL = atoi(optarg);
+			break;
 		case 'd':
 			devName = strdup(optarg);
 			if (devName == NULL) {
@@ -123,7 +129,7 @@ int onLoad(int argc, char *argv[]) {
 			useEvalReader = 1;
 			break;
 		default:
-			ERR_MSG("Usage: %s [-d <device>] [-e] [-f outputFname]\n", __FILE__);
+			ERR_MSG("Usage: %s [-c <join cache ttl in ms>] [-d <device>] [-e] [-f outputFname]\n", __FILE__);
 			return -1;
 		}
 	}
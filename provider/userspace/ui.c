@@ -17,6 +17,17 @@ static pthread_attr_t displayEvtThreadAttr;
 static int displayEvtThreadRunning = 0;
 static int numQueriesForDisplay = 0;
 DECLARE_QUERY_LIST(app);
+/**
+ * Precompiled accessors for the tuples created by this provider. They are resolved in onLoad() right after the datamodel was registered.
+ */
+static MemberAccessor_t accEventType, accXPos, accYPos, accApp, accForegroundApp;
+static MemberAccessorDesc_t accessors[] = {
+	{ &accEventType, 0, "ui.eventType", "ui.eventType" },
+	{ &accXPos, 0, "ui.eventType", "ui.eventType.xPos" },
+	{ &accYPos, 0, "ui.eventType", "ui.eventType.yPos" },
+	{ &accApp, 0, "ui.app", "ui.app" },
+	{ &accForegroundApp, 0, "ui.foregroundApp", "ui.foregroundApp" }
+};
 
 static void* displayEvtWork(void *data) {
 	Tupel_t *tuple = NULL;
@@ -46,9 +57,9 @@ static void* displayEvtWork(void *data) {
 		srand(time(0));
 		//printf("timeStart=%llu, id=%u, tuple=%p\n",timeUS,tuple->id,tuple);
 		ACQUIRE_READ_LOCK(slcLock);
-		allocItem(SLC_DATA_MODEL,tuple,0,"ui.eventType");
-		setItemInt(SLC_DATA_MODEL,tuple,"ui.eventType.xPos",rand() % 1024);
-		setItemInt(SLC_DATA_MODEL,tuple,"ui.eventType.yPos",rand() % 1024);
+		allocItemAcc(tuple,&accEventType);
+		setItemIntAcc(tuple,&accXPos,rand() % 1024);
+		setItemIntAcc(tuple,&accYPos,rand() % 1024);
 		eventOccuredBroadcast("ui.display",tuple);
 		RELEASE_READ_LOCK(slcLock);
 	}
@@ -127,8 +138,8 @@ static Tupel_t* statusApp(Selector_t *selectors, int len, Tupel_t* leftTuple) {
 		return NULL;
 	}
 	strcpy(name,"lol.app");
-	allocItem(SLC_DATA_MODEL,tuple,0,"ui.app");
-	setItemString(SLC_DATA_MODEL,tuple,"ui.app",name);
+	allocItemAcc(tuple,&accApp);
+	setItemStringAcc(tuple,&accApp,name);
 
 	return tuple;
 }
@@ -158,15 +169,13 @@ static Tupel_t* sourceForegroundApp(Selector_t *selectors, int len, Tupel_t* lef
 		return NULL;
 	}
 	strcpy(name,"pferd.app");
-	allocItem(SLC_DATA_MODEL,tuple,0,"ui.foregroundApp");
-	setItemString(SLC_DATA_MODEL,tuple,"ui.foregroundApp",name);
+	allocItemAcc(tuple,&accForegroundApp);
+	setItemStringAcc(tuple,&accForegroundApp,name);
 
 	return tuple;
 }
 
 static void initDatamodel(void) {
-	int i = 0;
-
 	INIT_EVENT_COMPLEX(evtDisplay,"display",nsUI,"ui.eventType",activateDisplay,deactivateDisplay)
 	//INIT_SOURCE_COMPLEX(srcProcessess,"processes",objApp,"process.process",getSrc) //TODO: should be an array as well
 	
@@ -201,6 +210,14 @@ int onLoad(int argc, char *argv[]) {
 		ERR_MSG("Register provider ui failed: %d\n",-ret);
 		return -1;
 	}
+	ACQUIRE_READ_LOCK(slcLock);
+	ret = initMemberAccessors(SLC_DATA_MODEL,accessors,sizeof(accessors) / sizeof(MemberAccessorDesc_t));
+	RELEASE_READ_LOCK(slcLock);
+	if (ret < 0) {
+		ERR_MSG("Cannot resolve accessors: %d\n",-ret);
+		unregisterProvider(&model, NULL);
+		return -1;
+	}
 
 	INFO_MSG("Registered ui provider\n");
 	return 0;
@@ -0,0 +1,110 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <common.h>
+#include <communication.h>
+#include <liballoc.h>
+
+#define MAX_BLOCKS			(BUFFER_PAGES * PAGE_SIZE / 64)
+#define ROUNDS				3
+/**
+ * Each block of this size occupies a major block of 16 pages on its own
+ */
+#define LARGE_BLOCK			(60 * 1024)
+
+static void *blocks[MAX_BLOCKS];
+
+/**
+ * Allocates blocks of {@link size} bytes until the txMemory is exhausted
+ */
+static int fill(size_t size) {
+	int num = 0;
+
+	while (num < MAX_BLOCKS && (blocks[num] = slcmalloc(size)) != NULL) {
+		memset(blocks[num],num,size);
+		num++;
+	}
+	return num;
+}
+
+static void freeAll(int num) {
+	int i = 0;
+
+	for (i = 0; i < num; i++) {
+		slcfree(blocks[i]);
+	}
+}
+
+int main() {
+	SlcAllocStats_t stats;
+	void *sharedMemory = NULL, *big = NULL;
+	int failed = 0, i = 0, num = 0, first = 0;
+
+	if (posix_memalign(&sharedMemory,PAGE_SIZE,NUM_PAGES * PAGE_SIZE) != 0) {
+		printf("Cannot allocate shared memory\n");
+		return EXIT_FAILURE;
+	}
+	memset(sharedMemory,0,NUM_PAGES * PAGE_SIZE);
+	sharedMemoryUserBase = sharedMemory;
+	ringBufferInit();
+
+	printf("-------------------------\n");
+	printf("Filling and emptying the txMemory: ");
+	for (i = 0; i < ROUNDS; i++) {
+		num = fill(100);
+		if (i == 0) {
+			first = num;
+		}
+		freeAll(num);
+		slcallocstats(&stats);
+		if (num == 0 || num != first || stats.usedPages != 0 || stats.inUse != 0) {
+			printf("round %d: %d blocks (first round: %d), %u pages and %llu bytes still in use ",i,num,first,stats.usedPages,stats.inUse);
+			failed++;
+		}
+	}
+	if (stats.peakPages != BUFFER_PAGES || stats.failed != ROUNDS) {
+		printf("peak of %u pages, %llu failed allocations ",stats.peakPages,stats.failed);
+		failed++;
+	}
+	printf("%d blocks per round: %s\n",first,(failed == 0 ? "ok" : "FAILED"));
+
+	printf("Allocating most of the txMemory at once after emptying it: ");
+	big = slcmalloc((BUFFER_PAGES - 2) * PAGE_SIZE);
+	if (big == NULL) {
+		printf("FAILED\n");
+		failed++;
+	} else {
+		slcfree(big);
+		printf("ok\n");
+	}
+
+	printf("Fragmentation: ");
+	num = fill(LARGE_BLOCK);
+	// Free every other block. The free pages are not contiguous any longer.
+	for (i = 0; i < num; i += 2) {
+		slcfree(blocks[i]);
+		blocks[i] = NULL;
+	}
+	slcallocstats(&stats);
+	printf("%d blocks, %u/%u pages used, largest free run of %u pages, %u%% fragmented: ",num,stats.usedPages,stats.totalPages,stats.largestFreeRun,ALLOC_FRAGMENTATION(stats));
+	if (num < 3 || stats.largestFreeRun >= stats.totalPages - stats.usedPages || ALLOC_FRAGMENTATION(stats) == 0 ||
+		slcmalloc((stats.largestFreeRun + 1) * PAGE_SIZE) != NULL) {
+		printf("FAILED\n");
+		failed++;
+	} else {
+		printf("ok\n");
+	}
+	for (i = 1; i < num; i += 2) {
+		slcfree(blocks[i]);
+	}
+	slcallocstats(&stats);
+	if (stats.usedPages != 0 || ALLOC_FRAGMENTATION(stats) != 0) {
+		printf("%u pages still in use, %u%% fragmented\n",stats.usedPages,ALLOC_FRAGMENTATION(stats));
+		failed++;
+	}
+	printf("-------------------------\n");
+
+	free(sharedMemory);
+
+	return (failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,218 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <query.h>
+#include <datamodel.h>
+#include <resultset.h>
+#include <api.h>
+#include <communication.h>
+#include <liballoc.h>
+
+#define PRODUCERS			2
+#define CONTINUATIONS		100000
+
+DECLARE_ELEMENTS(nsNet, model)
+DECLARE_ELEMENTS(typePacketType, typeLen, typeProto, typeIfName, objDevice, evtOnRx)
+static void initDatamodel(void);
+extern void (*enqueueHook)(Query_t *query, Tupel_t *tuple, int step);
+
+static EventStream_t rxStream;
+static Query_t query;
+static volatile int producersDone = 0;
+static unsigned long long received = 0, messages = 0, failures = 0;
+
+/**
+ * Takes over the tuples the consumer dispatched. Each one has to carry the query and the values its producer set.
+ */
+static void countTuples(Query_t *dispatched, Tupel_t *tuple, int step) {
+	Tupel_t *next = NULL;
+
+	while (tuple != NULL) {
+		next = tuple->next;
+		if (dispatched != &query || getItemInt(&model,tuple,"net.packetType.len") < 0 ||
+			getItemInt(&model,tuple,"net.packetType.len") >= CONTINUATIONS || getItemByte(&model,tuple,"net.packetType.proto") != 17) {
+			failures++;
+		}
+		received++;
+		freeTupel(&model,tuple);
+		tuple = next;
+	}
+}
+
+static Tupel_t* createTuple(int seq) {
+	Tupel_t *tuple = NULL;
+
+	tuple = initTupel(seq,1);
+	allocItem(&model,tuple,0,"net.packetType");
+	setItemInt(&model,tuple,"net.packetType.len",seq);
+	setItemByte(&model,tuple,"net.packetType.proto",17);
+	setItemString(&model,tuple,"net.packetType.ifname",strdup("eth0"));
+	return tuple;
+}
+
+/**
+ * Executes the query once per tuple. It belongs to the remote layer. Hence, each tuple ends up in sendQueryContinue().
+ */
+static void* producer(void *arg) {
+	int seq = 0;
+
+	for (seq = 0; seq < CONTINUATIONS; seq++) {
+		executeQuery(&model,&query,createTuple(seq),0);
+	}
+	// Like an executor running out of queries
+	flushQueryContinues();
+	__sync_fetch_and_add(&producersDone,1);
+
+	return NULL;
+}
+
+/**
+ * Reads the txBuffer the same way the communication thread of the remote layer does.
+ */
+static void* consumer(void *arg) {
+	LayerMessage_t *msg = NULL;
+
+	for (;;) {
+		msg = ringBufferReadBegin(txBuffer);
+		if (msg == NULL) {
+			if (LOAD_ACQUIRE(&producersDone) == PRODUCERS && ringBufferReadBegin(txBuffer) == NULL) {
+				break;
+			}
+			sched_yield();
+			continue;
+		}
+		switch (msg->type) {
+			case MSG_QUERY_CONTINUE:
+				dispatchQueryContinue(&model,(QueryContinue_t*)msg->addr,sharedMemoryUserBase,sharedMemoryUserBase);
+				break;
+
+			case MSG_QUERY_CONTINUE_BATCH:
+				dispatchQueryContinueFrame(&model,(QueryContinueFrame_t*)msg->addr,sharedMemoryUserBase,sharedMemoryUserBase);
+				break;
+
+			default:
+				printf("Unexpected message type: 0x%x\n",msg->type);
+				failures++;
+		}
+		messages++;
+		ringBufferReadEnd(txBuffer);
+	}
+
+	return NULL;
+}
+
+/**
+ * Every continuation has to be either delivered or counted as skipped.
+ */
+static int runBench(int batching) {
+	pthread_t producers[PRODUCERS], reader;
+	unsigned long long start = 0, elapsed = 0;
+	int i = 0, ret = 0;
+
+	queryContBatching = batching;
+	received = 0;
+	messages = 0;
+	failures = 0;
+	producersDone = 0;
+	skippedQueryCont = 0;
+	totalQueryCont = 0;
+	sentQueryContFrames = 0;
+
+	start = getTimeNS();
+	pthread_create(&reader,NULL,consumer,NULL);
+	for (i = 0; i < PRODUCERS; i++) {
+		pthread_create(&producers[i],NULL,producer,NULL);
+	}
+	for (i = 0; i < PRODUCERS; i++) {
+		pthread_join(producers[i],NULL);
+	}
+	pthread_join(reader,NULL);
+	elapsed = getTimeNS() - start;
+
+	if (totalQueryCont != PRODUCERS * CONTINUATIONS || received + skippedQueryCont != totalQueryCont) {
+		printf("Sent %u continuations, delivered %llu, skipped %u\n",totalQueryCont,received,skippedQueryCont);
+		failures++;
+	}
+	ret = (failures == 0 ? 0 : 1);
+	printf("%-10s: %u continuations in %llu messages (%u frames), %llu delivered, %u dropped (%.2f%%), %.0f delivered/s: %s\n",
+		(batching ? "batched" : "unbatched"),totalQueryCont,messages,sentQueryContFrames,received,skippedQueryCont,
+		100.0 * skippedQueryCont / totalQueryCont,received * 1e9 / elapsed,(ret == 0 ? "ok" : "FAILED"));
+
+	return ret;
+}
+
+int main() {
+	void *sharedMemory = NULL;
+	int failed = 0;
+
+	if (posix_memalign(&sharedMemory,PAGE_SIZE,NUM_PAGES * PAGE_SIZE) != 0) {
+		printf("Cannot allocate shared memory\n");
+		return EXIT_FAILURE;
+	}
+	memset(sharedMemory,0,NUM_PAGES * PAGE_SIZE);
+	// Usually, the kernel sets up both ringbuffers.
+	ringBufferReset((Ringbuffer_t*)sharedMemory);
+	ringBufferReset((Ringbuffer_t*)(sharedMemory + sizeof(Ringbuffer_t)));
+	sharedMemoryUserBase = sharedMemory;
+	ringBufferInit();
+
+	initDatamodel();
+	slcDataModel = &model;
+	initQuery(&query);
+	INIT_EVT_STREAM(rxStream,"net.device.onRx",1,0,NULL)
+	SET_SELECTOR_STRING(rxStream,0,"eth0")
+	query.root = GET_BASE(rxStream);
+	// Pretend the query was registered by the remote layer
+	query.layerCode = LAYER_CODE + 1;
+	query.queryID = 1;
+	addQueryToRegistry(&((Event_t*)evtOnRx.typeInfo)->queries,&query);
+	hashQuery(&query);
+	enqueueHook = countTuples;
+
+	printf("-------------------------\n");
+	printf("Query continuations: %d producers, %d continuations each, %d ring slots\n",PRODUCERS,CONTINUATIONS,RING_BUFFER_SIZE);
+	failed += runBench(0);
+	failed += runBench(1);
+	printf("-------------------------\n");
+
+	unhashQuery(&query);
+	freeQueryRegistry(&((Event_t*)evtOnRx.typeInfo)->queries);
+	freeOperator(query.root,0);
+	free(sharedMemory);
+
+	return (failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+static void activateCallback(Query_t *query) {
+
+}
+
+static void deactivateCallback(Query_t *query) {
+
+}
+
+static Tupel_t* generateStatusObject(Selector_t *selectors, int len, Tupel_t* leftTuple) {
+	return NULL;
+}
+
+static void initDatamodel(void) {
+	INIT_PLAINTYPE(typeLen,"len",typePacketType,INT)
+	INIT_PLAINTYPE(typeProto,"proto",typePacketType,BYTE)
+	INIT_PLAINTYPE(typeIfName,"ifname",typePacketType,STRING)
+	INIT_COMPLEX_TYPE(typePacketType,"packetType",nsNet,3)
+	ADD_CHILD(typePacketType,0,typeLen)
+	ADD_CHILD(typePacketType,1,typeProto)
+	ADD_CHILD(typePacketType,2,typeIfName)
+
+	INIT_EVENT_COMPLEX(evtOnRx,"onRx",objDevice,"net.packetType",activateCallback,deactivateCallback)
+	INIT_OBJECT(objDevice,"device",nsNet,1,STRING,activateCallback,deactivateCallback,generateStatusObject)
+	ADD_CHILD(objDevice,0,evtOnRx)
+
+	INIT_NS(nsNet,"net",model,2)
+	ADD_CHILD(nsNet,0,objDevice)
+	ADD_CHILD(nsNet,1,typePacketType)
+
+	INIT_MODEL(model,1)
+	ADD_CHILD(model,0,nsNet)
+}
@@ -38,7 +38,7 @@ static Tupel_t* generateStatusObject(Selector_t *selectors, int len, Tupel_t* le
 }
 
 int main() {
-	int ret = 0, i = 0;
+	int ret = 0;
 	DataModelElement_t *errNode = NULL, *copy = NULL, *compactDM = NULL;
 
 	INIT_SOURCE_POD(srcSocketType,"type",objSocket,INT,getSrc)
@@ -1,6 +1,15 @@
 #include <api.h>
 
+/**
+ * A test receiving continuations sets it to take over the enqueued tuples
+ */
+void (*enqueueHook)(Query_t *query, Tupel_t *tuple, int step) = NULL;
+
 void enqueueQuery(Query_t *query, Tupel_t *tuple, int step) {
+	if (enqueueHook != NULL) {
+		enqueueHook(query,tuple,step);
+		return;
+	}
 	executeQuery(SLC_DATA_MODEL, query, tuple,step);
 }
 
@@ -16,6 +25,10 @@ void stopSourceTimer(Query_t *query) {
 	
 }
 
+void runSourceTimer(Query_t *query) {
+
+}
+
 void acquireSlcLock(void) {
 	
 }
@@ -27,3 +40,15 @@ void releaseSlcLock(void) {
 void delPendingQuery(Query_t *query) {
 	
 }
+
+
+/**
+ * A test waiting for a ringbuffer sets it to get notified of the doorbell
+ */
+void (*doorbellHook)(void) = NULL;
+
+void ringBufferDoorbell(void) {
+	if (doorbellHook != NULL) {
+		doorbellHook();
+	}
+}
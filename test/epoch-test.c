@@ -0,0 +1,230 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <common.h>
+#include <api.h>
+#include <epoch.h>
+
+#define WAIT_MS				50
+#define STRESS_READERS		4
+#define STRESS_UPDATES		20000
+#define STRESS_SPIN			4
+#define EXIT_ROUNDS			200
+#define EXIT_THREADS		8
+#define OBJ_MAGIC			0x5ec0de
+#define OBJ_POISON			0xdead
+
+/**
+ * An object of the datamodel as seen by the readers. It gets poisoned upon release and is kept until the end of the test.
+ * Hence, a reader detects a use after release.
+ */
+typedef struct TestObject {
+	unsigned int magic;
+	unsigned int released;
+	struct TestObject *next;
+} TestObject_t;
+
+static TestObject_t *shared = NULL, *graveyard = NULL;
+static volatile int readerInside = 0, readerLeave = 0, readerLeft = 0, stressDone = 0, exitDone = 0;
+static unsigned long long failures = 0, stressReads = 0;
+static unsigned int releasedEarly = 0;
+
+static void releaseObject(void *ptr) {
+	TestObject_t *obj = (TestObject_t*)ptr;
+
+	if (obj->released++ > 0) {
+		printf("Released object %p twice\n",ptr);
+		__sync_fetch_and_add(&failures,1);
+	}
+	obj->magic = OBJ_POISON;
+	// Only synchronizeSLC() calls it. Hence, there is no concurrent release.
+	obj->next = graveyard;
+	graveyard = obj;
+}
+
+/**
+ * Records, if the object got released while the reader was still inside its read section
+ */
+static void releaseAfterReader(void *ptr) {
+	if (!LOAD_ACQUIRE(&readerLeft)) {
+		releasedEarly++;
+	}
+	free(ptr);
+}
+
+static void waitFor(volatile int *flag) {
+	while (!LOAD_ACQUIRE(flag)) {
+		sched_yield();
+	}
+}
+
+/**
+ * Enters a nested read section. It leaves the inner one first. The object must survive until it leaves the outer one.
+ */
+static void* nestedReader(void *arg) {
+	SLC_READ_LOCK();
+	SLC_READ_LOCK();
+	STORE_RELEASE(&readerInside,1);
+	waitFor(&readerLeave);
+	SLC_READ_UNLOCK();
+	usleep(WAIT_MS * 1000);
+	STORE_RELEASE(&readerLeft,1);
+	SLC_READ_UNLOCK();
+
+	return NULL;
+}
+
+static void* retireWriter(void *arg) {
+	retireObject(arg,releaseAfterReader);
+	synchronizeSLC();
+
+	return NULL;
+}
+
+static int checkGracePeriod(void) {
+	pthread_t reader, writer;
+	void *obj = malloc(sizeof(TestObject_t));
+	int failed = 0;
+
+	pthread_create(&reader,NULL,nestedReader,NULL);
+	waitFor(&readerInside);
+	pthread_create(&writer,NULL,retireWriter,obj);
+	usleep(WAIT_MS * 1000);
+	STORE_RELEASE(&readerLeave,1);
+	pthread_join(writer,NULL);
+	pthread_join(reader,NULL);
+	if (releasedEarly > 0) {
+		printf("Released an object while a reader was inside a (nested) read section\n");
+		failed = 1;
+	}
+	printf("Grace period waits for a nested read section: %s\n",(failed ? "FAILED" : "ok"));
+
+	return failed;
+}
+
+/**
+ * Dereferences the shared object over and over again. It must never see a released one.
+ */
+static void* stressReader(void *arg) {
+	TestObject_t *obj = NULL;
+	unsigned long long reads = 0;
+	int i = 0;
+
+	while (!LOAD_ACQUIRE(&stressDone)) {
+		SLC_READ_LOCK();
+		obj = LOAD_ACQUIRE(&shared);
+		// Stay inside the read section for a while. The writer replaces the object meanwhile.
+		for (i = 0; i < STRESS_SPIN; i++) {
+			CPU_RELAX();
+		}
+		if (LOAD_ACQUIRE(&obj->magic) != OBJ_MAGIC || obj->released != 0) {
+			__sync_fetch_and_add(&failures,1);
+		}
+		SLC_READ_UNLOCK();
+		reads++;
+	}
+	__sync_fetch_and_add(&stressReads,reads);
+
+	return NULL;
+}
+
+static TestObject_t* newTestObject(void) {
+	TestObject_t *obj = malloc(sizeof(TestObject_t));
+
+	obj->magic = OBJ_MAGIC;
+	obj->released = 0;
+	obj->next = NULL;
+
+	return obj;
+}
+
+static int checkStress(void) {
+	pthread_t readers[STRESS_READERS];
+	TestObject_t *old = NULL;
+	int i = 0;
+
+	shared = newTestObject();
+	for (i = 0; i < STRESS_READERS; i++) {
+		pthread_create(&readers[i],NULL,stressReader,NULL);
+	}
+	for (i = 0; i < STRESS_UPDATES; i++) {
+		old = shared;
+		STORE_RELEASE(&shared,newTestObject());
+		retireObject(old,releaseObject);
+		synchronizeSLC();
+	}
+	STORE_RELEASE(&stressDone,1);
+	for (i = 0; i < STRESS_READERS; i++) {
+		pthread_join(readers[i],NULL);
+	}
+	free(shared);
+	while (graveyard != NULL) {
+		old = graveyard->next;
+		free(graveyard);
+		graveyard = old;
+	}
+	printf("%d updates, %llu reads by %d readers: %s\n",STRESS_UPDATES,stressReads,STRESS_READERS,(failures == 0 ? "ok" : "FAILED"));
+
+	return (failures != 0);
+}
+
+static void* shortReader(void *arg) {
+	SLC_READ_LOCK();
+	if (shared->magic != OBJ_MAGIC) {
+		__sync_fetch_and_add(&failures,1);
+	}
+	SLC_READ_UNLOCK();
+
+	return NULL;
+}
+
+/**
+ * Waits for grace periods over and over again. The readers terminate meanwhile. Their EpochReader_t are gone afterwards.
+ */
+static void* exitWriter(void *arg) {
+	while (!LOAD_ACQUIRE(&exitDone)) {
+		synchronizeEpoch();
+	}
+
+	return NULL;
+}
+
+static int checkExitingReaders(void) {
+	pthread_t threads[EXIT_THREADS], writer;
+	unsigned long long before = failures;
+	int i = 0, j = 0;
+
+	shared = newTestObject();
+	pthread_create(&writer,NULL,exitWriter,NULL);
+	for (i = 0; i < EXIT_ROUNDS; i++) {
+		for (j = 0; j < EXIT_THREADS; j++) {
+			pthread_create(&threads[j],NULL,shortReader,NULL);
+		}
+		for (j = 0; j < EXIT_THREADS; j++) {
+			pthread_join(threads[j],NULL);
+		}
+	}
+	STORE_RELEASE(&exitDone,1);
+	pthread_join(writer,NULL);
+	// Each reader unlinked itself upon termination. Otherwise, this one would read released memory.
+	synchronizeEpoch();
+	free(shared);
+	printf("%d readers exited during grace periods: %s\n",EXIT_ROUNDS * EXIT_THREADS,(failures == before ? "ok" : "FAILED"));
+
+	return (failures != before);
+}
+
+int main() {
+	int failed = 0;
+
+	printf("-------------------------\n");
+	printf("Epoch test\n");
+	failed |= checkGracePeriod();
+	failed |= checkStress();
+	failed |= checkExitingReaders();
+	printf("-------------------------\n");
+
+	return (failed ? EXIT_FAILURE : EXIT_SUCCESS);
+}
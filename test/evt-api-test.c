@@ -8,6 +8,7 @@
 #include <time.h>
 #include <errno.h>
 #include <communication.h>
+#include <liballoc.h>
 
 DECLARE_ELEMENTS(nsNet1, nsProcess, nsUI, model1)
 DECLARE_ELEMENTS(evtDisplay, typeEventType, srcForegroundApp, srcProcessess,objApp)
@@ -18,6 +19,11 @@ DECLARE_ELEMENTS(typeMacHdr, typeMacProt, typeNetHdr, typeNetProt, typeTranspHdr
 static void initDatamodel(void);
 static void setupQueries(void);
 static void issueEvent(void);
+static int checkSharedPlans(void);
+
+#define PLAN_QUERIES		4
+
+extern void (*enqueueHook)(Query_t *query, Tupel_t *tuple, int step);
 
 static EventStream_t processObjStream;
 static Join_t joinProcessStime;
@@ -25,6 +31,15 @@ static Predicate_t joinProcessStimePredicate, joinProcessOP_PODPredicate;
 static Query_t query;
 static Tupel_t *tupel = NULL;
 static unsigned int foo = 1;
+/**
+ * The first three queries start with the same filter on the eth1 stream. The first two differ in their second filter.
+ * The last one uses the same filter on the eth0 stream.
+ */
+static EventStream_t planStreams[PLAN_QUERIES];
+static Filter_t planFilters[PLAN_QUERIES], planSecondFilters[2];
+static Predicate_t planPredicates[PLAN_QUERIES], planSecondPredicates[2];
+static Query_t planQueries[PLAN_QUERIES];
+static int planSteps[PLAN_QUERIES], planCompleted[PLAN_QUERIES];
 
 void printResult(unsigned int id, Tupel_t *tuple) {
 	printf("Received tupel:\t");
@@ -33,10 +48,21 @@ void printResult(unsigned int id, Tupel_t *tuple) {
 }
 
 int main() {
+	void *sharedMemory = NULL;
 	int ret = 0;
 	clock_t startClock, endClock;
 
 	startClock = clock();
+	if (posix_memalign(&sharedMemory,PAGE_SIZE,NUM_PAGES * PAGE_SIZE) != 0) {
+		printf("Cannot allocate shared memory\n");
+		return EXIT_FAILURE;
+	}
+	memset(sharedMemory,0,NUM_PAGES * PAGE_SIZE);
+	// Registering a query sends it to the remote layer. Nobody reads the messages.
+	ringBufferReset((Ringbuffer_t*)sharedMemory);
+	ringBufferReset((Ringbuffer_t*)(sharedMemory + sizeof(Ringbuffer_t)));
+	sharedMemoryUserBase = sharedMemory;
+	ringBufferInit();
 
 	initDatamodel();
 	setupQueries();
@@ -53,6 +79,9 @@ int main() {
 	printf("Sucessfully registered datamodel and query. Query has id: 0x%x\n",query.queryID);
 
 	issueEvent();
+	if (checkSharedPlans() != 0) {
+		return EXIT_FAILURE;
+	}
 
 	if ((ret = unregisterProvider(&model1, &query)) < 0 ) {
 		printf("Unregister failed: %d\n",-ret);
@@ -62,6 +91,7 @@ int main() {
 	freeOperator(GET_BASE(processObjStream),0);
 	freeDataModel(&model1,0);
 	destroySLC();
+	free(sharedMemory);
 	endClock = clock();
 	printf("Start: %ld, end: %ld, diff: %ld/%e\n",startClock, endClock, (endClock - startClock),((double)endClock - (double)startClock) / (double)CLOCKS_PER_SEC);
 
@@ -130,6 +160,134 @@ static void issueEvent(void) {
 	eventOccuredBroadcast("net.device.onRx",tupel);
 }
 
+static int getPlanQueryIndex(Query_t *query) {
+	int i = 0;
+
+	for (i = 0; i < PLAN_QUERIES; i++) {
+		if (&planQueries[i] == query) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+static void recordPlanStep(Query_t *query, Tupel_t *tuple, int step) {
+	int i = getPlanQueryIndex(query);
+
+	if (i >= 0) {
+		planSteps[i] = step;
+	}
+	executeQuery(SLC_DATA_MODEL,query,tuple,step);
+}
+
+static void countPlanResult(unsigned int id, Tupel_t *tuple) {
+	int i = 0;
+
+	for (i = 0; i < PLAN_QUERIES; i++) {
+		if (planQueries[i].queryID == id) {
+			planCompleted[i]++;
+		}
+	}
+	freeTupel(SLC_DATA_MODEL,tuple);
+}
+
+/**
+ * Fires an event carrying {@link macProtocol} and compares the step each query was enqueued with and the number of its results.
+ * A query, which did not get the tuple, has the step -1.
+ */
+static int firePlanEvent(int macProtocol, int from, int *expSteps, int *expCompleted) {
+	Tupel_t *tuple = NULL;
+	char *name = NULL;
+	int i = 0, failed = 0;
+
+	for (i = 0; i < PLAN_QUERIES; i++) {
+		planSteps[i] = -1;
+		planCompleted[i] = 0;
+	}
+	tuple = initTupel(20140530,2);
+	name = malloc(strlen("eth1") + 1);
+	strcpy(name,"eth1");
+	allocItem(SLC_DATA_MODEL,tuple,0,"net.device");
+	setItemString(SLC_DATA_MODEL,tuple,"net.device",name);
+	allocItem(SLC_DATA_MODEL,tuple,1,"net.packetType");
+	setItemArray(SLC_DATA_MODEL,tuple,"net.packetType.macHdr",0);
+	setItemByte(SLC_DATA_MODEL,tuple,"net.packetType.macProtocol",macProtocol);
+	eventOccuredBroadcast("net.device.onRx",tuple);
+
+	for (i = from; i < PLAN_QUERIES; i++) {
+		if (planSteps[i] != expSteps[i] || planCompleted[i] != expCompleted[i]) {
+			printf("macProtocol=%d, query %d: step %d, %d results. Expected step %d, %d results\n",macProtocol,i,planSteps[i],planCompleted[i],expSteps[i],expCompleted[i]);
+			failed++;
+		}
+	}
+	return failed;
+}
+
+static int checkSharedPlans(void) {
+	DataModelElement_t *dm = NULL;
+	PlanNode_t *plan = NULL;
+	int expSteps[PLAN_QUERIES] = { 2, 2, 2, 1 }, expCompleted[PLAN_QUERIES] = { 1, 0, 1, 1 };
+	int rejSteps[PLAN_QUERIES] = { -1, -1, -1, 1 }, rejCompleted[PLAN_QUERIES] = { 0, 0, 0, 0 };
+	int i = 0, ret = 0, failed = 0;
+
+	printf("-------------------------\n");
+	printf("Sharing the leading filters of %d queries: ",PLAN_QUERIES);
+	for (i = 0; i < PLAN_QUERIES; i++) {
+		initQuery(&planQueries[i]);
+		planQueries[i].onQueryCompleted = countPlanResult;
+		planQueries[i].root = GET_BASE(planStreams[i]);
+		planQueries[i].next = (i < PLAN_QUERIES - 1 ? &planQueries[i + 1] : NULL);
+		INIT_EVT_STREAM(planStreams[i],"net.device.onRx",1,0,GET_BASE(planFilters[i]))
+		SET_SELECTOR_STRING(planStreams[i],0,(i < PLAN_QUERIES - 1 ? "eth1" : "eth0"))
+		INIT_FILTER(planFilters[i],(i < 2 ? GET_BASE(planSecondFilters[i]) : NULL),1)
+		ADD_PREDICATE(planFilters[i],0,planPredicates[i])
+		SET_PREDICATE(planPredicates[i],EQUAL, OP_STREAM, "net.packetType.macProtocol", OP_POD, "42")
+	}
+	for (i = 0; i < 2; i++) {
+		INIT_FILTER(planSecondFilters[i],NULL,1)
+		ADD_PREDICATE(planSecondFilters[i],0,planSecondPredicates[i])
+	}
+	SET_PREDICATE(planSecondPredicates[0],LEQ, OP_STREAM, "net.packetType.macProtocol", OP_POD, "100")
+	SET_PREDICATE(planSecondPredicates[1],GE, OP_STREAM, "net.packetType.macProtocol", OP_POD, "100")
+	if ((ret = registerQuery(&planQueries[0])) < 0) {
+		printf("Register failed: %d\n",-ret);
+		return 1;
+	}
+	for (i = 0; i < PLAN_QUERIES; i++) {
+		planQueries[i].next = NULL;
+	}
+	enqueueHook = recordPlanStep;
+	// The shared filter is applied once during the broadcast. The queries skip it.
+	failed += firePlanEvent(42,0,expSteps,expCompleted);
+	// The shared filter rejects the tuple. Only the eth0 query sees it.
+	failed += firePlanEvent(43,0,rejSteps,rejCompleted);
+
+	// The plan still refers to the first filter of query 0. It has to take the one of another query.
+	unregisterQuery(&planQueries[0]);
+	freeOperator(GET_BASE(planStreams[0]),0);
+	failed += firePlanEvent(42,1,expSteps,expCompleted);
+
+	dm = getDescription(SLC_DATA_MODEL,"net.device.onRx");
+	unregisterQuery(&planQueries[1]);
+	for (plan = ((Event_t*)dm->typeInfo)->plans; plan != NULL; plan = plan->sibling) {
+		// The eth1 stream keeps the query registered by setupQueries() and query 2
+		if (plan->count != (plan->op == GET_BASE(planStreams[3]) ? 1 : 2)) {
+printf("Plan of %s has %u queries\n",(char*)((GenStream_t*)plan->op)->selectors[0].value,plan->count);
+			failed++;
+		}
+	}
+	enqueueHook = NULL;
+	for (i = 1; i < PLAN_QUERIES; i++) {
+		if (i > 1) {
+			unregisterQuery(&planQueries[i]);
+		}
+		freeOperator(GET_BASE(planStreams[i]),0);
+	}
+	printf("%s\n",(failed == 0 ? "ok" : "FAILED"));
+
+	return failed;
+}
+
 static void setupQueries(void) {
 	initQuery(&query);
 	query.onQueryCompleted = printResult;
@@ -146,7 +304,6 @@ static void setupQueries(void) {
 }
 
 static void initDatamodel(void) {
-	int i = 0;
 	INIT_SOURCE_POD(srcSocketType,"type",objSocket,INT,getSrc)
 	INIT_SOURCE_POD(srcSocketFlags,"flags",objSocket,INT,getSrc)
 	INIT_OBJECT(objSocket,"socket",nsNet1,2,INT,regObjectCallback,unregObjectCallback,generateStatusObject)
@@ -0,0 +1,345 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/queue.h>
+#include <sys/ipc.h>
+#include <sys/sem.h>
+#include <query.h>
+#include <datamodel.h>
+#include <resultset.h>
+#include <api.h>
+#include <executor.h>
+
+#define PRODUCERS			4
+#define TUPLES				100000
+#define POOL_THREADS		4
+#define URGENT_TUPLES		1000
+
+DECLARE_ELEMENTS(nsNet, model)
+DECLARE_ELEMENTS(typePacketType, typeLen, typeProto, objDevice, evtOnRx)
+static void initDatamodel(void);
+
+static EventStream_t rxStream, urgentStream;
+static Query_t query, urgentQuery;
+static unsigned long long completed = 0, failures = 0;
+static int nextSeq[PRODUCERS];
+static int checkOrder = 0;
+static int nextUrgentSeq = 0;
+static unsigned long long urgentCompleted = 0, urgentMaxLatency = 0;
+static void (*submit)(Query_t *query, Tupel_t *tuple, int step) = NULL;
+
+/**
+ * The path enqueueQuery() used before: a malloc'ed job, a mutex protected list and a SysV semaphore
+ * signalled once per tuple. A single thread executes the jobs.
+ */
+static int legacySemID = -1, legacyRunning = 0;
+static unsigned long long legacyFull = 0;
+static pthread_t legacyThread;
+static pthread_mutex_t legacyListLock = PTHREAD_MUTEX_INITIALIZER;
+STAILQ_HEAD(LegacyListHead,QueryJob) legacyList = STAILQ_HEAD_INITIALIZER(legacyList);
+
+static void legacyEnqueue(Query_t *query, Tupel_t *tuple, int step) {
+	QueryJob_t *job = NULL;
+	struct sembuf operation = { .sem_num = 0, .sem_op = 1, .sem_flg = 0 };
+
+	job = ALLOC(sizeof(QueryJob_t));
+	job->query = query;
+	job->tuple = tuple;
+	job->step = step;
+	pthread_mutex_lock(&legacyListLock);
+	STAILQ_INSERT_TAIL(&legacyList,job,listEntry);
+	pthread_mutex_unlock(&legacyListLock);
+	// A SysV semaphore cannot count beyond SEMVMX (32767). Wait for the executor to catch up.
+	while (semop(legacySemID,&operation,1) < 0) {
+		if (errno != ERANGE) {
+			perror("semop");
+			break;
+		}
+		__sync_fetch_and_add(&legacyFull,1);
+		sched_yield();
+	}
+}
+
+static void* legacyWork(void *data) {
+	struct sembuf operation = { .sem_num = 0, .sem_op = -1, .sem_flg = 0 };
+	QueryJob_t *cur = NULL;
+
+	for (;;) {
+		if (semop(legacySemID,&operation,1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+		ACQUIRE_READ_LOCK(slcLock);
+		pthread_mutex_lock(&legacyListLock);
+		cur = STAILQ_FIRST(&legacyList);
+		if (cur != NULL) {
+			STAILQ_REMOVE_HEAD(&legacyList,listEntry);
+		}
+		pthread_mutex_unlock(&legacyListLock);
+		if (cur == NULL) {
+			RELEASE_READ_LOCK(slcLock);
+			// Each job posts the semaphore once. Hence, only the final post finds the list empty.
+			if (LOAD_ACQUIRE(&legacyRunning) == 0) {
+				break;
+			}
+			continue;
+		}
+		executeQuery(SLC_DATA_MODEL,cur->query,cur->tuple,cur->step);
+		RELEASE_READ_LOCK(slcLock);
+		FREE(cur);
+	}
+
+	return NULL;
+}
+
+/**
+ * Each tuple carries its producer and sequence number. An ORDERED query has to see each producers tuples in order.
+ */
+static void onQueryCompleted(unsigned int id, Tupel_t *tuple) {
+	int producer = getItemByte(&model,tuple,"net.packetType.proto"), seq = getItemInt(&model,tuple,"net.packetType.len");
+
+	if (producer < 0 || producer >= PRODUCERS || seq < 0 || seq >= TUPLES) {
+		__sync_fetch_and_add(&failures,1);
+	} else if (checkOrder) {
+		if (seq != nextSeq[producer]) {
+			printf("Producer %d: expected tuple %d, got %d\n",producer,nextSeq[producer],seq);
+			__sync_fetch_and_add(&failures,1);
+		}
+		nextSeq[producer] = seq + 1;
+	}
+	freeTupel(&model,tuple);
+	__sync_fetch_and_add(&completed,1);
+}
+
+/**
+ * Each urgent tuple carries its sequence number and the time it was submitted at. The urgent lane runs them in order.
+ */
+static void onUrgentCompleted(unsigned int id, Tupel_t *tuple) {
+	unsigned long long latency = getTimeNS() - tuple->timestamp;
+	int seq = getItemInt(&model,tuple,"net.packetType.len");
+
+	if (seq != nextUrgentSeq) {
+		printf("Urgent query: expected tuple %d, got %d\n",nextUrgentSeq,seq);
+		__sync_fetch_and_add(&failures,1);
+	}
+	nextUrgentSeq = seq + 1;
+	if (latency > urgentMaxLatency) {
+		urgentMaxLatency = latency;
+	}
+	freeTupel(&model,tuple);
+	__sync_fetch_and_add(&urgentCompleted,1);
+}
+
+static void* producer(void *arg) {
+	int id = (long)arg, seq = 0;
+	Tupel_t *tuple = NULL;
+
+	for (seq = 0; seq < TUPLES; seq++) {
+		tuple = initTupel(seq,1);
+		allocItem(&model,tuple,0,"net.packetType");
+		setItemInt(&model,tuple,"net.packetType.len",seq);
+		setItemByte(&model,tuple,"net.packetType.proto",id);
+		submit(&query,tuple,0);
+	}
+
+	return NULL;
+}
+
+static int runBench(const char *name, int ordered) {
+	pthread_t producers[PRODUCERS];
+	unsigned long long start = 0, elapsed = 0;
+	long i = 0;
+	int ret = 0;
+
+	completed = 0;
+	failures = 0;
+	checkOrder = ordered;
+	memset(nextSeq,0,sizeof(nextSeq));
+	if (ordered) {
+		query.flags |= ORDERED;
+	} else {
+		query.flags &= ~ORDERED;
+	}
+
+	start = getTimeNS();
+	for (i = 0; i < PRODUCERS; i++) {
+		pthread_create(&producers[i],NULL,producer,(void*)i);
+	}
+	for (i = 0; i < PRODUCERS; i++) {
+		pthread_join(producers[i],NULL);
+	}
+	while (LOAD_ACQUIRE(&completed) < PRODUCERS * TUPLES) {
+		sched_yield();
+	}
+	elapsed = getTimeNS() - start;
+
+	ret = (failures == 0 ? 0 : 1);
+	printf("%-22s: %llu tuples in %llu ms, %.0f tuples/s: %s\n",name,completed,elapsed / 1000000,
+		completed * 1e9 / elapsed,(ret == 0 ? "ok" : "FAILED"));
+
+	return ret;
+}
+
+static int runPool(const char *name, unsigned int threads, int ordered) {
+	ExecStats_t stats;
+	int ret = 0;
+
+	if (startExecutors(threads) < 0) {
+		printf("Cannot start %u executors\n",threads);
+		return 1;
+	}
+	submit = submitQueryJob;
+	ret = runBench(name,ordered);
+	stopExecutors();
+	getExecStats(&stats);
+	if (stats.executed != PRODUCERS * TUPLES) {
+		printf("Executors ran %llu jobs\n",stats.executed);
+		ret = 1;
+	}
+	printf("%-22s  max. %u waiting, %llu sleeps, %llu wakeups, %llu times full\n","",stats.maxWaiting,stats.sleeps,stats.wakeups,stats.queueFull);
+
+	return ret;
+}
+
+/**
+ * Submits urgent tuples while the producers flood a single executor. The urgent lane has to run all of them.
+ */
+static void* urgentProducer(void *arg) {
+	Tupel_t *tuple = NULL;
+	int seq = 0;
+
+	for (seq = 0; seq < URGENT_TUPLES; seq++) {
+		tuple = initTupel(getTimeNS(),1);
+		allocItem(&model,tuple,0,"net.packetType");
+		setItemInt(&model,tuple,"net.packetType.len",seq);
+		setItemByte(&model,tuple,"net.packetType.proto",0);
+		submitQueryJob(&urgentQuery,tuple,0);
+		usleep(100);
+	}
+
+	return NULL;
+}
+
+static int runUrgent(void) {
+	pthread_t urgent;
+	ExecStats_t stats;
+	int ret = 0;
+
+	if (startExecutors(1) < 0) {
+		printf("Cannot start the executors\n");
+		return 1;
+	}
+	submit = submitQueryJob;
+	nextUrgentSeq = 0;
+	urgentCompleted = 0;
+	urgentMaxLatency = 0;
+	pthread_create(&urgent,NULL,urgentProducer,NULL);
+	ret = runBench("pool, 1 thread, urgent",0);
+	pthread_join(urgent,NULL);
+	while (LOAD_ACQUIRE(&urgentCompleted) < URGENT_TUPLES) {
+		sched_yield();
+	}
+	stopExecutors();
+	getExecStats(&stats);
+	if (failures > 0 || stats.urgent != URGENT_TUPLES || stats.executed != PRODUCERS * TUPLES + URGENT_TUPLES) {
+		printf("Urgent lane ran %llu of %d jobs, executors ran %llu jobs\n",stats.urgent,URGENT_TUPLES,stats.executed);
+		ret = 1;
+	}
+	printf("%-22s  %llu urgent tuples, max. latency %llu us: %s\n","",urgentCompleted,urgentMaxLatency / 1000,(ret == 0 ? "ok" : "FAILED"));
+
+	return ret;
+}
+
+static int runLegacy(void) {
+	struct sembuf operation = { .sem_num = 0, .sem_op = 1, .sem_flg = 0 };
+	int ret = 0;
+
+	legacySemID = semget(IPC_PRIVATE,1,IPC_CREAT|0600);
+	if (legacySemID < 0) {
+		perror("semget");
+		return 1;
+	}
+	legacyRunning = 1;
+	pthread_create(&legacyThread,NULL,legacyWork,NULL);
+	submit = legacyEnqueue;
+	ret = runBench("semaphore, 1 thread",0);
+	STORE_RELEASE(&legacyRunning,0);
+	semop(legacySemID,&operation,1);
+	pthread_join(legacyThread,NULL);
+	semctl(legacySemID,0,IPC_RMID);
+	printf("%-22s  %llu times full\n","",legacyFull);
+
+	return ret;
+}
+
+int main() {
+	char name[32];
+	int failed = 0;
+
+	INIT_LOCK(slcLock);
+	initDatamodel();
+	slcDataModel = &model;
+	initQuery(&query);
+	INIT_EVT_STREAM(rxStream,"net.device.onRx",0,0,NULL)
+	query.root = GET_BASE(rxStream);
+	query.layerCode = LAYER_CODE;
+	query.queryID = 1;
+	query.onQueryCompleted = onQueryCompleted;
+	initQuery(&urgentQuery);
+	INIT_EVT_STREAM(urgentStream,"net.device.onRx",0,1,NULL)
+	urgentQuery.root = GET_BASE(urgentStream);
+	urgentQuery.layerCode = LAYER_CODE;
+	urgentQuery.queryID = 2;
+	urgentQuery.onQueryCompleted = onUrgentCompleted;
+
+	printf("-------------------------\n");
+	printf("Query executors: %d producers, %d tuples each\n",PRODUCERS,TUPLES);
+	failed += runLegacy();
+	failed += runPool("pool, 1 thread",1,0);
+	snprintf(name,sizeof(name),"pool, %d threads",POOL_THREADS);
+	failed += runPool(name,POOL_THREADS,0);
+	failed += runPool("pool, ordered",POOL_THREADS,1);
+	failed += runUrgent();
+	printf("-------------------------\n");
+
+	freeOperator(query.root,0);
+	freeOperator(urgentQuery.root,0);
+
+	return (failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+static void activateCallback(Query_t *query) {
+
+}
+
+static void deactivateCallback(Query_t *query) {
+
+}
+
+static Tupel_t* generateStatusObject(Selector_t *selectors, int len, Tupel_t* leftTuple) {
+	return NULL;
+}
+
+static void initDatamodel(void) {
+	INIT_PLAINTYPE(typeLen,"len",typePacketType,INT)
+	INIT_PLAINTYPE(typeProto,"proto",typePacketType,BYTE)
+	INIT_COMPLEX_TYPE(typePacketType,"packetType",nsNet,2)
+	ADD_CHILD(typePacketType,0,typeLen)
+	ADD_CHILD(typePacketType,1,typeProto)
+
+	INIT_EVENT_COMPLEX(evtOnRx,"onRx",objDevice,"net.packetType",activateCallback,deactivateCallback)
+	INIT_OBJECT(objDevice,"device",nsNet,1,STRING,activateCallback,deactivateCallback,generateStatusObject)
+	ADD_CHILD(objDevice,0,evtOnRx)
+
+	INIT_NS(nsNet,"net",model,2)
+	ADD_CHILD(nsNet,0,objDevice)
+	ADD_CHILD(nsNet,1,typePacketType)
+
+	INIT_MODEL(model,1)
+	ADD_CHILD(model,0,nsNet)
+}
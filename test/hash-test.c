@@ -0,0 +1,252 @@
+#include <stdlib.h>
+#include <string.h>
+#include <query.h>
+#include <datamodel.h>
+#include <api.h>
+#include <stdio.h>
+#include <output.h>
+#include <time.h>
+#include <errno.h>
+
+#define LOOKUPS		2000000
+
+DECLARE_ELEMENTS(nsNet1, nsProcess, nsUI, model1)
+DECLARE_ELEMENTS(evtDisplay, typeEventType, srcForegroundApp, srcProcessess,objApp)
+DECLARE_ELEMENTS(typeXPos, typeYPos)
+DECLARE_ELEMENTS(objProcess, srcUTime, srcSTime, srcProcessSockets)
+DECLARE_ELEMENTS(objSocket, objDevice, srcSocketType, srcSocketFlags, typePacketType, srcTXBytes, srcRXBytes, evtOnRX, evtOnTX)
+DECLARE_ELEMENTS(typeMacHdr, typeMacProt, typeNetHdr, typeNetProt, typeTranspHdr, typeTransProt, typeDataLen, typeSockRef)
+DECLARE_ELEMENTS(modelDel, nsUIDel, evtDisplayDel)
+static void initDatamodel(void);
+
+/**
+ * The paths used by providers and queries on every event. The last one does not exist.
+ */
+static char *paths[] = {
+	"net.packetType",
+	"net.packetType.macHdr",
+	"net.packetType.dataLength",
+	"net.packetType.socket",
+	"net.device.onRx",
+	"net.device.txBytes",
+	"process.process.sockets",
+	"ui.eventType.xPos",
+	"ui.app.processes",
+	"net.device.doesNotExist"
+};
+#define NUM_PATHS	(sizeof(paths) / sizeof(char*))
+
+/**
+ * The former implementation of getDescription(): copy the path, split it by strsep and walk each level.
+ */
+static DataModelElement_t* getDescriptionStrsep(DataModelElement_t *root, char *name) {
+	DataModelElement_t *cur = root;
+	char *token = NULL, *nameCopy = NULL, *nameCopy_ = NULL;
+	int found = 0, i = 0;
+
+	nameCopy = (char*)ALLOC(strlen(name) + 1);
+	if (!nameCopy) {
+		return NULL;
+	}
+	nameCopy_ = nameCopy;
+	strcpy(nameCopy,name);
+	token = strsep(&nameCopy,".");
+	while (token) {
+		found = 0;
+		for (i = 0; i < cur->childrenLen; i++) {
+			if (strcmp(token,cur->children[i]->name) == 0) {
+				cur = cur->children[i];
+				found = 1;
+				break;
+			}
+		}
+		if (found) {
+			token = strsep(&nameCopy,".");
+		} else {
+			break;
+		}
+	};
+	FREE(nameCopy_);
+	return (found ? cur : NULL);
+}
+
+static double benchLookup(char *desc, DataModelElement_t* (*lookupFn)(DataModelElement_t*,char*), DataModelElement_t *root) {
+	struct timespec start, end;
+	unsigned long found = 0;
+	double secs = 0.0;
+	int i = 0;
+
+	clock_gettime(CLOCK_MONOTONIC,&start);
+	for (i = 0; i < LOOKUPS; i++) {
+		if (lookupFn(root,paths[i % NUM_PATHS]) != NULL) {
+			found++;
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC,&end);
+	secs = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+	printf("%-28s %d lookups (%lu hits) in %.3f s = %.0f lookups/sec\n",desc,LOOKUPS,found,secs,LOOKUPS / secs);
+
+	return LOOKUPS / secs;
+}
+
+static void regEventCallback(Query_t *query) {
+	
+}
+
+static void unregEventCallback(Query_t *query) {
+	
+}
+
+static Tupel_t* getSrc(Selector_t *selectors, int len, Tupel_t* leftTuple) {
+	return NULL;
+};
+
+static void regObjectCallback(Query_t *query) {
+	
+};
+
+static void unregObjectCallback(Query_t *query) {
+	
+};
+
+static Tupel_t* generateStatusObject(Selector_t *selectors, int len, Tupel_t* leftTuple) {
+	return NULL;
+}
+
+int main() {
+	DataModelElement_t *elemSLC = NULL, *elemWalk = NULL;
+	double before = 0.0, after = 0.0;
+	int ret = 0, i = 0;
+
+	initDatamodel();
+	if (initSLCDatamodel() < 0) {
+		printf("Cannot init slc datamodel\n");
+		return EXIT_FAILURE;
+	}
+	ret = mergeDataModel(0,SLC_DATA_MODEL,&model1);
+	if (ret < 0) {
+		printf("Cannot merge datamodel: %d\n",ret);
+		return EXIT_FAILURE;
+	}
+
+	// The merged copy, the plain datamodel and the former implementation have to agree on each path.
+	for (i = 0; i < NUM_PATHS; i++) {
+		elemSLC = getDescription(SLC_DATA_MODEL,paths[i]);
+		elemWalk = getDescription(&model1,paths[i]);
+		if ((elemSLC == NULL) != (elemWalk == NULL) || (elemWalk != getDescriptionStrsep(&model1,paths[i])) ||
+			(elemSLC != NULL && strcmp(elemSLC->name,elemWalk->name) != 0)) {
+			printf("Lookup of %s differs: slc=%p, walk=%p\n",paths[i],elemSLC,elemWalk);
+			return EXIT_FAILURE;
+		}
+	}
+	if (getDescription(SLC_DATA_MODEL,"net") != SLC_DATA_MODEL->children[0] || getDescription(SLC_DATA_MODEL,"net.") != NULL ||
+		getDescription(SLC_DATA_MODEL,"") != NULL || getDescription(&model1,"net.device.onRx.foo") != NULL) {
+		printf("Lookup of an edge case failed\n");
+		return EXIT_FAILURE;
+	}
+
+	before = benchLookup("strsep walk (former):",getDescriptionStrsep,SLC_DATA_MODEL);
+	after = benchLookup("walk without allocation:",getDescription,SLC_DATA_MODEL);
+	printf("Speedup: %.1fx\n",after / before);
+
+	// Lookups have to see the result of deleteSubtree() ...
+	INIT_EVENT_COMPLEX(evtDisplayDel,"display",nsUIDel,"ui.eventType",regEventCallback,unregEventCallback)
+	INIT_NS(nsUIDel,"ui",modelDel,1)
+	ADD_CHILD(nsUIDel,0,evtDisplayDel)
+	INIT_MODEL(modelDel,1)
+	ADD_CHILD(modelDel,0,nsUIDel)
+	ret = deleteSubtree(&SLC_DATA_MODEL,&modelDel);
+	if (ret < 0 || getDescription(SLC_DATA_MODEL,"ui.display") != NULL || getDescription(SLC_DATA_MODEL,"ui.eventType.yPos") == NULL) {
+		printf("Lookup is wrong after deleting ui.display\n");
+		return EXIT_FAILURE;
+	}
+	// ... and of mergeDataModel().
+	ret = mergeDataModel(0,SLC_DATA_MODEL,&modelDel);
+	if (ret < 0 || getDescription(SLC_DATA_MODEL,"ui.display") == NULL) {
+		printf("Lookup is wrong after merging ui.display\n");
+		return EXIT_FAILURE;
+	}
+	destroySLC();
+	freeDataModel(&model1,0);
+
+	return EXIT_SUCCESS;
+}
+
+static void initDatamodel(void) {
+	INIT_SOURCE_POD(srcSocketType,"type",objSocket,INT,getSrc)
+	INIT_SOURCE_POD(srcSocketFlags,"flags",objSocket,INT,getSrc)
+	INIT_OBJECT(objSocket,"socket",nsNet1,2,INT,regObjectCallback,unregObjectCallback,generateStatusObject)
+	ADD_CHILD(objSocket,0,srcSocketFlags)
+	ADD_CHILD(objSocket,1,srcSocketType)
+	
+	INIT_PLAINTYPE(typeMacHdr,"macHdr",typePacketType,(BYTE | ARRAY))
+	INIT_PLAINTYPE(typeMacProt,"macProtocol",typePacketType,BYTE)
+	INIT_PLAINTYPE(typeNetHdr,"networkHdr",typePacketType,(BYTE | ARRAY))
+	INIT_PLAINTYPE(typeNetProt,"networkProtocol",typePacketType,BYTE)
+	INIT_PLAINTYPE(typeTranspHdr,"transportHdr",typePacketType,(BYTE | ARRAY))
+	INIT_PLAINTYPE(typeTransProt,"transportProtocol",typePacketType,BYTE)
+	INIT_PLAINTYPE(typeDataLen,"dataLength",typePacketType,BYTE)
+	INIT_REF(typeSockRef,"socket",typePacketType,"process.process.sockets")
+
+	INIT_COMPLEX_TYPE(typePacketType,"packetType",nsNet1,8)
+	ADD_CHILD(typePacketType,3,typeMacHdr);
+	ADD_CHILD(typePacketType,0,typeMacProt);
+	ADD_CHILD(typePacketType,1,typeNetProt);
+	ADD_CHILD(typePacketType,2,typeNetHdr);
+	ADD_CHILD(typePacketType,4,typeTranspHdr);
+	ADD_CHILD(typePacketType,7,typeTransProt);
+	ADD_CHILD(typePacketType,6,typeDataLen);
+	ADD_CHILD(typePacketType,5,typeSockRef);
+
+	INIT_SOURCE_POD(srcTXBytes,"txBytes",objDevice,INT,getSrc)
+	INIT_SOURCE_POD(srcRXBytes,"rxBytes",objDevice,STRING,getSrc)
+	INIT_EVENT_COMPLEX(evtOnRX,"onRx",objDevice,"net.packetType",regEventCallback,unregEventCallback)
+	INIT_EVENT_COMPLEX(evtOnTX,"onTx",objDevice,"net.packetType",regEventCallback,unregEventCallback)
+
+	INIT_OBJECT(objDevice,"device",nsNet1,4,STRING,regObjectCallback,unregObjectCallback,generateStatusObject)
+	ADD_CHILD(objDevice,0,srcTXBytes)
+	ADD_CHILD(objDevice,1,srcRXBytes)
+	ADD_CHILD(objDevice,2,evtOnRX)
+	ADD_CHILD(objDevice,3,evtOnTX)
+	
+	INIT_NS(nsNet1,"net",model1,3)
+	ADD_CHILD(nsNet1,0,objDevice)
+	ADD_CHILD(nsNet1,1,objSocket)
+	ADD_CHILD(nsNet1,2,typePacketType)
+
+	INIT_SOURCE_POD(srcUTime,"utime",objProcess,FLOAT,getSrc)
+	INIT_SOURCE_POD(srcSTime,"stime",objProcess,STRING|ARRAY,getSrc)
+	INIT_SOURCE_COMPLEX(srcProcessSockets,"sockets",objProcess,"net.socket",getSrc) //TODO: Should be an array
+	INIT_OBJECT(objProcess,"process",nsProcess,3,INT,regObjectCallback,unregObjectCallback,generateStatusObject)
+	ADD_CHILD(objProcess,0,srcUTime)
+	ADD_CHILD(objProcess,1,srcSTime)
+	ADD_CHILD(objProcess,2,srcProcessSockets)
+
+	INIT_NS(nsProcess,"process",model1,1)
+	ADD_CHILD(nsProcess,0,objProcess)
+
+	INIT_EVENT_COMPLEX(evtDisplay,"display",nsUI,"ui.eventType",regEventCallback,unregEventCallback)
+	INIT_SOURCE_COMPLEX(srcProcessess,"processes",objApp,"process.process",getSrc) //TODO: should be an array as well
+	
+	INIT_OBJECT(objApp,"app",nsUI,1,STRING,regObjectCallback,unregObjectCallback,generateStatusObject)
+	ADD_CHILD(objApp,0,srcProcessess)
+
+	INIT_SOURCE_COMPLEX(srcForegroundApp,"foregroundApp",nsUI,"ui.app",getSrc)
+	
+	INIT_PLAINTYPE(typeXPos,"xPos",typeEventType,INT)
+	INIT_PLAINTYPE(typeYPos,"yPos",typeEventType,INT)
+	INIT_COMPLEX_TYPE(typeEventType,"eventType",nsUI,2)
+	ADD_CHILD(typeEventType,0,typeXPos)
+	ADD_CHILD(typeEventType,1,typeYPos)
+
+	INIT_NS(nsUI,"ui",model1,4)
+	ADD_CHILD(nsUI,0,evtDisplay)
+	ADD_CHILD(nsUI,1,typeEventType)
+	ADD_CHILD(nsUI,2,srcForegroundApp)
+	ADD_CHILD(nsUI,3,objApp)
+	
+	INIT_MODEL(model1,3)
+	ADD_CHILD(model1,0,nsNet1)
+	ADD_CHILD(model1,1,nsProcess)
+	ADD_CHILD(model1,2,nsUI)
+}
@@ -0,0 +1,272 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <query.h>
+#include <datamodel.h>
+#include <resultset.h>
+#include <api.h>
+#include <stdio.h>
+#include <output.h>
+#include <errno.h>
+
+#define MAX_RESULTS		64
+#define CACHE_TTL		60000
+
+DECLARE_ELEMENTS(nsNet, nsProcess, model)
+DECLARE_ELEMENTS(typePacketType, typeSocket, objDevice, evtOnRx)
+DECLARE_ELEMENTS(objProcess, srcSockets)
+static void initDatamodel(void);
+
+/**
+ * The sockets each process owns. Socket 100 is shared by two processes.
+ */
+static struct {
+	int pid;
+	int socket;
+} processSockets[] = {
+	{1,	100},
+	{2,	101},
+	{3,	100},
+	{4,	102}
+};
+
+/**
+ * The sockets of the packets. Socket 103 does not belong to any process.
+ */
+static int packetSockets[] = { 100, 103, 101, 102, 100 };
+
+/**
+ * The pairs of socket and process each query has to emit
+ */
+static struct {
+	int socket;
+	int pid;
+} expected[] = {
+	{100,	1},
+	{100,	3},
+	{101,	2},
+	{102,	4},
+	{100,	1},
+	{100,	3}
+};
+
+static EventStream_t rxStream;
+static Join_t joinProcess;
+static Predicate_t joinSocketPredicate, joinPIDPredicate;
+static Query_t query;
+static int resultSockets[MAX_RESULTS], resultPIDs[MAX_RESULTS];
+static int numResults = 0, providerCalls = 0;
+
+static void collectResult(unsigned int id, Tupel_t *tuple) {
+	if (numResults < MAX_RESULTS) {
+		resultSockets[numResults] = getItemInt(&model,tuple,"net.packetType.socket");
+		resultPIDs[numResults] = getItemInt(&model,tuple,"process.process");
+	}
+	numResults++;
+	freeTupel(&model,tuple);
+}
+
+/**
+ * Works like the sockets source of the process provider. Given a stream tuple, only the processes owning its socket are returned.
+ */
+static Tupel_t* getSockets(Selector_t *selectors, int len, Tupel_t *leftTuple) {
+	Tupel_t *head = NULL, *prev = NULL, *cur = NULL;
+	int i = 0, socket = -1;
+
+	providerCalls++;
+	if (leftTuple != NULL) {
+		socket = getItemInt(&model,leftTuple,"net.packetType.socket");
+	}
+	for (i = 0; i < sizeof(processSockets) / sizeof(processSockets[0]); i++) {
+		if (socket != -1 && socket != processSockets[i].socket) {
+			continue;
+		}
+		cur = initTupel(i,2);
+		allocItem(&model,cur,0,"process.process");
+		setItemInt(&model,cur,"process.process",processSockets[i].pid);
+		allocItem(&model,cur,1,"process.process.sockets");
+		setItemInt(&model,cur,"process.process.sockets",processSockets[i].socket);
+		if (prev == NULL) {
+			head = cur;
+		} else {
+			prev->next = cur;
+		}
+		prev = cur;
+	}
+
+	return head;
+}
+
+static Tupel_t* createPacket(int seq, int socket) {
+	Tupel_t *tuple = initTupel(seq,1);
+
+	allocItem(&model,tuple,0,"net.packetType");
+	setItemInt(&model,tuple,"net.packetType.socket",socket);
+	return tuple;
+}
+
+static int setupQuery(unsigned int cacheTTL) {
+	Operator_t *errOperator = NULL;
+	int ret = 0;
+
+	initQuery(&query);
+	query.onQueryCompleted = collectResult;
+	INIT_EVT_STREAM(rxStream,"net.device.onRx",1,0,GET_BASE(joinProcess))
+	SET_SELECTOR_STRING(rxStream,0,"eth0")
+	INIT_JOIN(joinProcess,"process.process.sockets",NULL,2)
+	SET_JOIN_CACHE(joinProcess,cacheTTL)
+	ADD_PREDICATE(joinProcess,0,joinSocketPredicate)
+	SET_PREDICATE(joinSocketPredicate,EQUAL, OP_JOIN, "process.process.sockets", OP_STREAM, "net.packetType.socket")
+	ADD_PREDICATE(joinProcess,1,joinPIDPredicate)
+	SET_PREDICATE(joinPIDPredicate,EQUAL, OP_JOIN, "process.process", OP_POD, "-1")
+	query.root = GET_BASE(rxStream);
+
+	if ((ret = checkQuerySyntax(&model,query.root,&errOperator,0)) < 0) {
+		printf("Query syntax is wrong: %d\n",-ret);
+		freeOperator(query.root,0);
+		return -1;
+	}
+	if ((ret = compileOperators(&model,query.root)) < 0) {
+		printf("Cannot compile query: %d\n",-ret);
+		freeOperator(query.root,0);
+		return -1;
+	}
+	if ((cacheTTL > 0) != (joinProcess.state != NULL)) {
+		printf("Join has %s state\n",(cacheTTL > 0 ? "no" : "a"));
+		releaseCompiledOperators(query.root);
+		freeOperator(query.root,0);
+		return -1;
+	}
+	return 0;
+}
+
+static void sendPackets(void) {
+	int i = 0;
+
+	for (i = 0; i < sizeof(packetSockets) / sizeof(int); i++) {
+		executeQuery(&model,&query,createPacket(i,packetSockets[i]),0);
+	}
+}
+
+static int checkResults(void) {
+	int i = 0, failed = 0;
+
+	if (numResults != sizeof(expected) / sizeof(expected[0])) {
+		printf("Got %d tuples, expected %d\n",numResults,(int)(sizeof(expected) / sizeof(expected[0])));
+		return 1;
+	}
+	for (i = 0; i < numResults; i++) {
+		if (resultSockets[i] != expected[i].socket || resultPIDs[i] != expected[i].pid) {
+			printf("Tuple %d: socket %d of process %d, expected socket %d of process %d\n",i,resultSockets[i],resultPIDs[i],expected[i].socket,expected[i].pid);
+			failed++;
+		}
+	}
+	return failed;
+}
+
+/**
+ * Joins each packet with the processes owning its socket. Both the nested loop and the hash join have to emit the same tuples.
+ * The nested loop calls the provider once per packet. The hash join calls it once, as long as its cache is valid.
+ */
+static int runJoin(unsigned int cacheTTL) {
+	int failed = 0, calls = 0;
+
+	if (setupQuery(cacheTTL) < 0) {
+		return 1;
+	}
+	numResults = 0;
+	providerCalls = 0;
+	sendPackets();
+	failed += checkResults();
+	calls = (cacheTTL == 0 ? sizeof(packetSockets) / sizeof(int) : 1);
+	if (providerCalls != calls) {
+		printf("Provider got called %d times, expected %d\n",providerCalls,calls);
+		failed++;
+	}
+	if (cacheTTL > 0) {
+		// A new process invalidates the cached tuples
+		objectInstancesChanged(&objProcess);
+		executeQuery(&model,&query,createPacket(0,101),0);
+		if (providerCalls != 2) {
+			printf("Provider got called %d times after a process was created, expected 2\n",providerCalls);
+			failed++;
+		}
+		executeQuery(&model,&query,createPacket(0,101),0);
+		if (providerCalls != 2) {
+			printf("Provider got called %d times within the ttl, expected 2\n",providerCalls);
+			failed++;
+		}
+		// So does an expired ttl
+		joinProcess.cacheTTL = 1;
+		usleep(2000);
+		executeQuery(&model,&query,createPacket(0,101),0);
+		if (providerCalls != 3) {
+			printf("Provider got called %d times after the ttl expired, expected 3\n",providerCalls);
+			failed++;
+		}
+		if (numResults != sizeof(expected) / sizeof(expected[0]) + 3) {
+			printf("Got %d tuples after the cache was invalidated\n",numResults);
+			failed++;
+		}
+	}
+	printf("%s: %d tuples, %d provider calls, %s\n",(cacheTTL == 0 ? "nested loop" : "hash join"),numResults,providerCalls,(failed == 0 ? "ok" : "FAILED"));
+	releaseCompiledOperators(query.root);
+	freeOperator(query.root,0);
+
+	return failed;
+}
+
+int main() {
+	int failed = 0;
+
+	initDatamodel();
+	slcDataModel = &model;
+
+	printf("-------------------------\n");
+	printf("Joining packets with the processes owning their socket: \n");
+	failed += runJoin(0);
+	failed += runJoin(CACHE_TTL);
+	printf("-------------------------\n");
+	freeDataModel(&model,0);
+
+	return (failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+static void activateCallback(Query_t *query) {
+
+}
+
+static void deactivateCallback(Query_t *query) {
+
+}
+
+static Tupel_t* generateStatusObject(Selector_t *selectors, int len, Tupel_t* leftTuple) {
+	return NULL;
+}
+
+static void initDatamodel(void) {
+	INIT_PLAINTYPE(typeSocket,"socket",typePacketType,INT)
+	INIT_COMPLEX_TYPE(typePacketType,"packetType",nsNet,1)
+	ADD_CHILD(typePacketType,0,typeSocket)
+
+	INIT_EVENT_COMPLEX(evtOnRx,"onRx",objDevice,"net.packetType",activateCallback,deactivateCallback)
+	INIT_OBJECT(objDevice,"device",nsNet,1,STRING,activateCallback,deactivateCallback,generateStatusObject)
+	ADD_CHILD(objDevice,0,evtOnRx)
+
+	INIT_NS(nsNet,"net",model,2)
+	ADD_CHILD(nsNet,0,objDevice)
+	ADD_CHILD(nsNet,1,typePacketType)
+
+	INIT_SOURCE_POD(srcSockets,"sockets",objProcess,INT,getSockets)
+	// Usually, registering the datamodel sets up the lock of a source
+	INIT_LOCK(((Source_t*)srcSockets.typeInfo)->lock);
+	INIT_OBJECT(objProcess,"process",nsProcess,1,INT,activateCallback,deactivateCallback,generateStatusObject)
+	ADD_CHILD(objProcess,0,srcSockets)
+
+	INIT_NS(nsProcess,"process",model,1)
+	ADD_CHILD(nsProcess,0,objProcess)
+
+	INIT_MODEL(model,2)
+	ADD_CHILD(model,0,nsNet)
+	ADD_CHILD(model,1,nsProcess)
+}
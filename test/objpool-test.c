@@ -0,0 +1,134 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <common.h>
+#include <objpool.h>
+
+#define OBJECTS				200000
+#define IN_FLIGHT			1024
+#define ROUNDS				3
+
+/**
+ * Hands objects from the producer, e.g. a provider, over to the consumer, e.g. an executor.
+ */
+static void *inFlight[IN_FLIGHT];
+static unsigned int head = 0, tail = 0;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t notEmpty = PTHREAD_COND_INITIALIZER, notFull = PTHREAD_COND_INITIALIZER;
+static unsigned long long failures = 0;
+
+static unsigned int objectSize(unsigned int seq) {
+	// Cover every class
+	return 8 + (seq * 37) % (OBJ_POOL_MAX_SIZE - sizeof(ObjHeader_t) - 8);
+}
+
+static void* producer(void *arg) {
+	unsigned int seq = 0, size = 0;
+	unsigned char *obj = NULL;
+
+	for (seq = 0; seq < OBJECTS; seq++) {
+		size = objectSize(seq);
+		obj = allocObject(size);
+		if (obj == NULL) {
+			failures++;
+			continue;
+		}
+		*(unsigned int*)obj = seq;
+		memset(obj + sizeof(unsigned int),seq & 0xff,size - sizeof(unsigned int));
+		pthread_mutex_lock(&lock);
+		while (head - tail == IN_FLIGHT) {
+			pthread_cond_wait(&notFull,&lock);
+		}
+		inFlight[head++ % IN_FLIGHT] = obj;
+		pthread_cond_signal(&notEmpty);
+		pthread_mutex_unlock(&lock);
+	}
+
+	return NULL;
+}
+
+/**
+ * Frees the objects allocated by another thread. Each one has to be intact.
+ */
+static void* consumer(void *arg) {
+	unsigned int i = 0, seq = 0, size = 0, j = 0;
+	unsigned char *obj = NULL;
+
+	for (i = 0; i < OBJECTS - failures; i++) {
+		pthread_mutex_lock(&lock);
+		while (head == tail) {
+			pthread_cond_wait(&notEmpty,&lock);
+		}
+		obj = inFlight[tail++ % IN_FLIGHT];
+		pthread_cond_signal(&notFull);
+		pthread_mutex_unlock(&lock);
+
+		seq = *(unsigned int*)obj;
+		size = objectSize(seq);
+		for (j = sizeof(unsigned int); j < size; j++) {
+			if (obj[j] != (seq & 0xff)) {
+				printf("Object %u is corrupted at byte %u\n",seq,j);
+				failures++;
+				break;
+			}
+		}
+		freeObject(obj);
+	}
+
+	return NULL;
+}
+
+static unsigned long long totalSlabs(void) {
+	ObjPoolStats_t stats;
+	unsigned long long ret = 0;
+	int i = 0;
+
+	getObjPoolStats(&stats);
+	for (i = 0; i < OBJ_POOL_CLASSES; i++) {
+		ret += stats.grown[i];
+	}
+	return ret;
+}
+
+int main() {
+	pthread_t prod, cons;
+	ObjPoolStats_t stats;
+	unsigned long long slabs[ROUNDS];
+	unsigned char *obj = NULL;
+	int failed = 0, i = 0;
+
+	initObjPools();
+	printf("-------------------------\n");
+	printf("Moving %d objects from a producer to a consumer thread: ",OBJECTS);
+	for (i = 0; i < ROUNDS; i++) {
+		pthread_create(&cons,NULL,consumer,NULL);
+		pthread_create(&prod,NULL,producer,NULL);
+		pthread_join(prod,NULL);
+		pthread_join(cons,NULL);
+		slabs[i] = totalSlabs();
+	}
+	getObjPoolStats(&stats);
+	// Once the pools are warmed up, the objects have to be recycled
+	if (failures > 0 || stats.large > 0 || slabs[ROUNDS - 1] != slabs[1]) {
+		failed++;
+	}
+	printf("%llu slabs after the first round, %llu after the last one, %llu failures: %s\n",slabs[0],slabs[ROUNDS - 1],failures,(failed == 0 ? "ok" : "FAILED"));
+
+	printf("Growing an object beyond the largest class: ");
+	obj = allocObject(16);
+	memset(obj,0xab,16);
+	obj = reallocObject(obj,OBJ_POOL_MAX_SIZE);
+	getObjPoolStats(&stats);
+	if (obj == NULL || obj[0] != 0xab || obj[15] != 0xab || stats.large != 1) {
+		printf("FAILED\n");
+		failed++;
+	} else {
+		printf("ok\n");
+	}
+	freeObject(obj);
+	printf("-------------------------\n");
+	destroyObjPools();
+
+	return (failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -6,6 +6,8 @@
 #include <output.h>
 #include <errno.h>
 
+#define REGISTRY_QUERIES		20
+
 DECLARE_ELEMENTS(nsNet1, nsProcess, nsUI, model1)
 DECLARE_ELEMENTS(evtDisplay, typeEventType, srcForegroundApp, srcProcessess,objApp)
 DECLARE_ELEMENTS(typeXPos, typeYPos)
@@ -25,6 +27,208 @@ Select_t selectTest;
 Tupel_t *tupel = NULL;
 Query_t query;
 Element_t elemPacket, elemUTime;
+EventStream_t compiledStream;
+Filter_t compiledFilter;
+Predicate_t compiledPredicate;
+Query_t compiledQuery;
+int compiledResults = 0;
+EventStream_t pushdownStream;
+Filter_t pushdownFilter;
+Predicate_t pushdownPredicates[4];
+Query_t pushdownQuery;
+
+typedef struct PredicateCase {
+	int type;
+	int leftType;
+	char *left;
+	int rightType;
+	char *right;
+	int expected;
+} PredicateCase_t;
+
+static PredicateCase_t predicateCases[] = {
+	{EQUAL,	OP_STREAM,	"net.packetType.macProtocol",	OP_POD,		"65",		1},
+	{NEQ,	OP_STREAM,	"net.packetType.macProtocol",	OP_POD,		"65",		0},
+	{LE,	OP_STREAM,	"net.device.txBytes",			OP_POD,		"5000",		1},
+	{GEQ,	OP_STREAM,	"net.device.txBytes",			OP_POD,		"5000",		0},
+	{GE,	OP_POD,		"4000",							OP_STREAM,	"net.device.txBytes",	0},
+	{EQUAL,	OP_STREAM,	"net.device.rxBytes",			OP_POD,		"PFERD",	1},
+	{NEQ,	OP_STREAM,	"net.device",					OP_POD,		"eth0",		0},
+	{LE,	OP_STREAM,	"net.device",					OP_POD,		"eth0",		0},
+	{LEQ,	OP_STREAM,	"process.process.utime",		OP_POD,		"3.14",		1},
+	{GE,	OP_STREAM,	"process.process.utime",		OP_POD,		"3.0",		1},
+	{EQUAL,	OP_STREAM,	"net.packetType.macHdr",		OP_POD,		"1",		0},
+	{EQUAL,	OP_STREAM,	"ui.eventType.xPos",			OP_POD,		"1",		0},
+	{EQUAL,	OP_POD,		"3.14",							OP_POD,		"3.14",		1}
+};
+
+void countResult(unsigned int id, Tupel_t *tupel) {
+	compiledResults++;
+	freeTupel(&model1,tupel);
+}
+
+/**
+ * Runs each predicate case as the only predicate of a filter. Once interpreted and once compiled.
+ * Both have to agree on each case.
+ */
+static int checkCompiledPredicates(void) {
+	int i = 0, interpreted = 0, compiled = 0, failed = 0;
+	PredicateCase_t *cur = NULL;
+
+	initQuery(&compiledQuery);
+	compiledQuery.onQueryCompleted = countResult;
+	INIT_EVT_STREAM(compiledStream,"net.device.onTx",0,0,GET_BASE(compiledFilter))
+	INIT_FILTER(compiledFilter,NULL,1)
+	ADD_PREDICATE(compiledFilter,0,compiledPredicate)
+	compiledQuery.root = GET_BASE(compiledStream);
+
+	for (i = 0; i < sizeof(predicateCases) / sizeof(PredicateCase_t); i++) {
+		cur = &predicateCases[i];
+		SET_PREDICATE(compiledPredicate,cur->type,cur->leftType,cur->left,cur->rightType,cur->right)
+
+		compiledResults = 0;
+		executeQuery(&model1,&compiledQuery,copyTupel(&model1,tupel),0);
+		interpreted = compiledResults;
+
+		if (compileOperators(&model1,compiledQuery.root) < 0 || compiledFilter.compiled == NULL) {
+			printf("Cannot compile predicate %d\n",i);
+			return -1;
+		}
+		compiledResults = 0;
+		executeQuery(&model1,&compiledQuery,copyTupel(&model1,tupel),0);
+		compiled = compiledResults;
+		releaseCompiledOperators(compiledQuery.root);
+
+		printf("Predicate %d (%s,%s): interpreted=%d, compiled=%d, expected=%d\n",i,cur->left,cur->right,interpreted,compiled,cur->expected);
+		if (interpreted != compiled || compiled != cur->expected) {
+			failed++;
+		}
+	}
+	freeOperator(GET_BASE(compiledStream),0);
+
+	return failed;
+}
+
+/**
+ * Registers more queries than a registry initially holds on a single event. Afterwards, every second one is removed again.
+ * Each remaining query has to be found by its id and has to know its slot.
+ */
+static int checkQueryRegistry(void) {
+	Query_t queries[REGISTRY_QUERIES];
+	QueryRegistry_t **registry = getQueryRegistry(&evtOnTX);
+	QueryID_t id;
+	int i = 0, failed = 0;
+
+	strncpy(id.name,"net.device.onTx",MAX_NAME_LEN);
+	for (i = 0; i < REGISTRY_QUERIES; i++) {
+		initQuery(&queries[i]);
+		queries[i].root = GET_BASE(txStream);
+		queries[i].queryID = i + 1;
+		if (addQueryToRegistry(registry,&queries[i]) < 0) {
+			printf("Cannot register query %d\n",i + 1);
+			return -1;
+		}
+		hashQuery(&queries[i]);
+	}
+	for (i = 0; i < REGISTRY_QUERIES; i += 2) {
+		delQueryFromRegistry(registry,&queries[i]);
+		unhashQuery(&queries[i]);
+	}
+	if ((*registry)->num != REGISTRY_QUERIES / 2) {
+		printf("Registry holds %u queries, expected %d\n",(*registry)->num,REGISTRY_QUERIES / 2);
+		failed++;
+	}
+	for (i = 0; i < (*registry)->num; i++) {
+		if ((*registry)->queries[i]->idx != i) {
+			printf("Query %d is in slot %d, but expects slot %d\n",(*registry)->queries[i]->queryID,i,(*registry)->queries[i]->idx);
+			failed++;
+		}
+	}
+	for (i = 0; i < REGISTRY_QUERIES; i++) {
+		id.id = i + 1;
+		if (resolveQuery(&model1,&id) != (i % 2 == 1 ? &queries[i] : NULL)) {
+			printf("Query %d not resolved properly\n",i + 1);
+			failed++;
+		}
+	}
+	for (i = 1; i < REGISTRY_QUERIES; i += 2) {
+		unhashQuery(&queries[i]);
+	}
+	freeQueryRegistry(registry);
+
+	return failed;
+}
+
+typedef struct PushdownCase {
+	char *device;
+	char macProtocol;
+	int dataLength;
+	int expected;
+} PushdownCase_t;
+
+static PushdownField_t pushdownFields[] = {
+	{ "net.device", STRING },
+	{ "net.packetType.macProtocol", BYTE },
+	{ "net.packetType.dataLength", INT }
+};
+
+static PushdownCase_t pushdownCases[] = {
+	{"eth1",	65,	100,	1},
+	{"eth1",	66,	100,	0},
+	{"eth1",	65,	5000,	0},
+	{"eth0",	65,	100,	0}
+};
+
+/**
+ * Hands the leading filter of a query over to a provider knowing the device, the mac protocol and the data length of a packet.
+ * The predicate on the utime cannot be evaluated by the provider. Hence, it must not be part of the pushdown.
+ */
+static int checkPushdown(void) {
+	PushdownValue_t values[sizeof(pushdownFields) / sizeof(PushdownField_t)];
+	Pushdown_t *pushdown = NULL;
+	PushdownCase_t *cur = NULL;
+	int i = 0, ret = 0, failed = 0;
+
+	initQuery(&pushdownQuery);
+	INIT_EVT_STREAM(pushdownStream,"net.device.onTx",0,0,GET_BASE(pushdownFilter))
+	INIT_FILTER(pushdownFilter,NULL,4)
+	ADD_PREDICATE(pushdownFilter,0,pushdownPredicates[0])
+	ADD_PREDICATE(pushdownFilter,1,pushdownPredicates[1])
+	ADD_PREDICATE(pushdownFilter,2,pushdownPredicates[2])
+	ADD_PREDICATE(pushdownFilter,3,pushdownPredicates[3])
+	SET_PREDICATE(pushdownPredicates[0],EQUAL, OP_STREAM, "net.packetType.macProtocol", OP_POD, "65")
+	SET_PREDICATE(pushdownPredicates[1],GE, OP_POD, "4000", OP_STREAM, "net.packetType.dataLength")
+	SET_PREDICATE(pushdownPredicates[2],NEQ, OP_STREAM, "net.device", OP_POD, "eth0")
+	SET_PREDICATE(pushdownPredicates[3],GEQ, OP_STREAM, "process.process.utime", OP_POD, "3.14")
+	pushdownQuery.root = GET_BASE(pushdownStream);
+
+	pushdown = compilePushdown(&pushdownQuery,pushdownFields,sizeof(pushdownFields) / sizeof(PushdownField_t));
+	if (pushdown == NULL || pushdown->num != 3) {
+		printf("Expected 3 predicates, got %u\n",(pushdown == NULL ? 0 : pushdown->num));
+		freePushdown(pushdown);
+		freeOperator(GET_BASE(pushdownStream),0);
+		return -1;
+	}
+	for (i = 0; i < sizeof(pushdownCases) / sizeof(PushdownCase_t); i++) {
+		cur = &pushdownCases[i];
+		values[0].stringValue = (PTR_TYPE)cur->device;
+		values[1].byteValue = cur->macProtocol;
+		values[2].intValue = cur->dataLength;
+		ret = matchPushdown(pushdown,values);
+		printf("Packet %d (%s,%d,%d): match=%d, expected=%d\n",i,cur->device,cur->macProtocol,cur->dataLength,ret,cur->expected);
+		if (ret != cur->expected) {
+			failed++;
+		}
+	}
+	// Without any predicates, a provider has to build every tuple
+	if (matchPushdown(NULL,values) != 1) {
+		failed++;
+	}
+	freePushdown(pushdown);
+	freeOperator(GET_BASE(pushdownStream),0);
+
+	return failed;
+}
 
 void printResult(unsigned int id, Tupel_t *tupel) {
 	printf("Received tupel:\t");
@@ -86,6 +290,27 @@ int main() {
 	printQuery(copyRewrite->root);
 	free(copyRewrite);
 	printf("-------------------------\n");
+	printf("Comparing compiled and interpreted predicates: \n");
+	ret = checkCompiledPredicates();
+	printf("-------------------------\n");
+	if (ret != 0) {
+		printf("%d predicates differ\n",ret);
+		return EXIT_FAILURE;
+	}
+	printf("Registering %d queries on a single event: \n",REGISTRY_QUERIES);
+	ret = checkQueryRegistry();
+	printf("%s\n",(ret == 0 ? "ok" : "FAILED"));
+	printf("-------------------------\n");
+	if (ret != 0) {
+		return EXIT_FAILURE;
+	}
+	printf("Pushing the filter of a query down to its provider: \n");
+	ret = checkPushdown();
+	printf("%s\n",(ret == 0 ? "ok" : "FAILED"));
+	printf("-------------------------\n");
+	if (ret != 0) {
+		return EXIT_FAILURE;
+	}
 	printf("Executing txStream query: \n");
 	printTupel(&model1,tupel);
 	executeQuery(&model1,&query,tupel,0);
@@ -198,8 +423,6 @@ static void initResultset(void) {
 }
 
 static void initDatamodel(void) {
-	int i = 0;
-
 	INIT_SOURCE_POD(srcSocketType,"type",objSocket,INT,getSrc)
 	INIT_SOURCE_POD(srcSocketFlags,"flags",objSocket,INT,getSrc)
 	INIT_OBJECT(objSocket,"socket",nsNet1,2,INT,regObjectCallback,unregObjectCallback,generateStatusObject)
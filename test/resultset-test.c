@@ -16,7 +16,11 @@ DECLARE_ELEMENTS(typeMacHdr, typeMacProt, typeNetHdr, typeNetProt, typeTranspHdr
 static void initDatamodel(void);
 
 int main() {
-	Tupel_t *tupel = NULL, *tupelCompact = NULL, *tupelCompact2 = NULL, *tupleCopy = NULL, *tupleMerge = NULL;
+	Tupel_t *tupel = NULL, *tupelCompact = NULL, *tupelCompact2 = NULL, *tupleCopy = NULL, *tupleMerge = NULL, *shared[3];
+	MemberAccessor_t accDevice, accPacketType, accMacHdr, accMacProt, accNetProt, accNetHdr, accTranspHdr, accSocket;
+	TupleTemplate_t tmpl, tmplInvalid;
+	TupleBufferDesc_t bufferDesc[4];
+	char *templateItems[] = { "net.device", "net.packetType" };
 	char *string = NULL, values[] = {66,4,3,2,1};
 	clock_t startClock, endClock;
 	int size = 0, ret = 0;
@@ -137,6 +141,163 @@ int main() {
 		freeTupel(&model1,tupel);
 	}
 
+	printf("-------------------------\n");
+	printf("Accessing a tuple by precompiled accessors...");
+	if (initMemberAccessor(&model1,&accDevice,0,"net.device","net.device") != 0 ||
+		initMemberAccessor(&model1,&accPacketType,1,"net.packetType","net.packetType") != 0 ||
+		initMemberAccessor(&model1,&accMacHdr,1,"net.packetType","net.packetType.macHdr") != 0 ||
+		initMemberAccessor(&model1,&accMacProt,1,"net.packetType","net.packetType.macProtocol") != 0 ||
+		initMemberAccessor(&model1,&accNetProt,1,"net.packetType","net.packetType.networkProtocol") != 0 ||
+		initMemberAccessor(&model1,&accNetHdr,1,"net.packetType","net.packetType.networkHdr") != 0 ||
+		initMemberAccessor(&model1,&accTranspHdr,1,"net.packetType","net.packetType.transportHdr") != 0 ||
+		initMemberAccessor(&model1,&accSocket,1,"net.packetType","net.packetType.socket") != 0) {
+		printf("cannot resolve accessors\n");
+		return EXIT_FAILURE;
+	}
+	if (initMemberAccessor(&model1,&accSocket,1,"net.packetType","net.packetType.foo") != -ENOELEMENT ||
+		initMemberAccessor(&model1,&accSocket,1,"net.packetType","net.device.rxBytes") != -EPARAM) {
+		printf("resolved an invalid path\n");
+		return EXIT_FAILURE;
+	}
+	initMemberAccessor(&model1,&accSocket,1,"net.packetType","net.packetType.socket");
+	tupel = initTupel(20140530,2);
+	string = (char*)malloc(5);
+	strcpy(string,"eth0");
+	allocItemAcc(tupel,&accDevice);
+	setItemStringAcc(tupel,&accDevice,string);
+	allocItemAcc(tupel,&accPacketType);
+	setItemArrayAcc(tupel,&accMacHdr,5);
+	copyArrayByteAcc(tupel,&accMacHdr,0,values,5);
+	setArraySlotByteAcc(tupel,&accMacHdr,4,7);
+	setItemByteAcc(tupel,&accMacProt,65);
+	setItemByteAcc(tupel,&accNetProt,42);
+	setItemArrayAcc(tupel,&accNetHdr,0);
+	setItemArrayAcc(tupel,&accTranspHdr,0);
+	setItemIntAcc(tupel,&accSocket,1337);
+	if (strcmp(getItemString(&model1,tupel,"net.device"),"eth0") != 0 ||
+		getItemInt(&model1,tupel,"net.packetType.socket") != 1337 ||
+		getItemByte(&model1,tupel,"net.packetType.macProtocol") != 65 ||
+		getItemByte(&model1,tupel,"net.packetType.networkProtocol") != 42 ||
+		getArraySlotByte(&model1,tupel,"net.packetType.macHdr",0) != 66 ||
+		getArraySlotByte(&model1,tupel,"net.packetType.macHdr",4) != 7 ||
+		getItemIntAcc(tupel,&accSocket) != 1337 ||
+		getItemByteAcc(tupel,&accNetProt) != 42 ||
+		getArraySlotByteAcc(tupel,&accMacHdr,1) != 4) {
+		printf("values differ\n");
+		return EXIT_FAILURE;
+	}
+	printf("done\n");
+	printTupel(&model1,tupel);
+	freeTupel(&model1,tupel);
+
+	printf("-------------------------\n");
+	printf("Instantiating a tuple from a template...");
+	bufferDesc[0].accessor = &accDevice;
+	bufferDesc[0].capacity = 8;
+	bufferDesc[1].accessor = &accMacHdr;
+	bufferDesc[1].capacity = 6;
+	bufferDesc[2].accessor = &accNetHdr;
+	bufferDesc[2].capacity = 2;
+	bufferDesc[3].accessor = &accTranspHdr;
+	bufferDesc[3].capacity = 2;
+	if (initTupleTemplate(&model1,&tmpl,templateItems,2,bufferDesc,4) != 0) {
+		printf("cannot compile the template\n");
+		return EXIT_FAILURE;
+	}
+	bufferDesc[0].accessor = &accSocket;
+	if (initTupleTemplate(&model1,&tmplInvalid,templateItems,2,bufferDesc,4) != -EPARAM) {
+		printf("compiled a template with a buffer for an int\n");
+		return EXIT_FAILURE;
+	}
+	tupel = initTupelFromTemplate(&tmpl,20140530);
+	if (tupel == NULL || tupel->flags != (TUPLE_COMPACT | TUPLE_TEMPLATE | (tmpl.size << TUPLE_SIZE_SHIFT)) || strlen(getItemStringAcc(tupel,&accDevice)) != 0) {
+		printf("cannot instantiate the template\n");
+		return EXIT_FAILURE;
+	}
+	copyItemStringAcc(tupel,&accDevice,"wlan0-too-long");
+	setItemArrayAcc(tupel,&accMacHdr,5);
+	copyArrayByteAcc(tupel,&accMacHdr,0,values,5);
+	setItemArrayAcc(tupel,&accNetHdr,3);
+	setItemByteAcc(tupel,&accMacProt,65);
+	setItemIntAcc(tupel,&accSocket,1337);
+	// The string is truncated, the network header exceeds its capacity
+	if (strcmp(getItemString(&model1,tupel,"net.device"),"wlan0-t") != 0 ||
+		getArraySlotByte(&model1,tupel,"net.packetType.macHdr",4) != 1 ||
+		getArraySlotByteAcc(tupel,&accMacHdr,5) != '\0' ||
+		*(int*)(*(PTR_TYPE*)getMemberPointerAcc(tupel,&accNetHdr)) != 0 ||
+		getItemInt(&model1,tupel,"net.packetType.socket") != 1337) {
+		printf("values differ\n");
+		return EXIT_FAILURE;
+	}
+	tupleCopy = copyTupel(&model1,tupel);
+	size = getTupelSize(&model1,tupel);
+	tupelCompact = ALLOC(size);
+	copyAndCollectTupel(&model1,tupel,tupelCompact,size);
+	deleteItem(&model1,tupel,0);
+	freeTupel(&model1,tupel);
+	if (tupleCopy == NULL || !TEST_BIT(tupleCopy->flags,TUPLE_TEMPLATE) ||
+		strcmp(getItemStringAcc(tupleCopy,&accDevice),"wlan0-t") != 0 ||
+		getArraySlotByteAcc(tupleCopy,&accMacHdr,0) != 66 ||
+		getItemByte(&model1,tupleCopy,"net.packetType.macProtocol") != 65 ||
+		tupelCompact->flags != TUPLE_COMPACT ||
+		strcmp(getItemString(&model1,tupelCompact,"net.device"),"wlan0-t") != 0) {
+		printf("copies differ\n");
+		return EXIT_FAILURE;
+	}
+	FREE(tupelCompact);
+	tupleMerge = initTupel(4711,1);
+	allocItem(&model1,tupleMerge,0,"ui.eventType");
+	setItemInt(&model1,tupleMerge,"ui.eventType.xPos",314);
+	setItemInt(&model1,tupleMerge,"ui.eventType.yPos",42);
+	if (mergeTuple(&model1,&tupleCopy,tupleMerge) != 0 || TEST_BIT(tupleCopy->flags,TUPLE_COMPACT) ||
+		tupleCopy->itemLen != 3 || getItemInt(&model1,tupleCopy,"ui.eventType.xPos") != 314 ||
+		getArraySlotByte(&model1,tupleCopy,"net.packetType.macHdr",1) != 4) {
+		printf("merge failed\n");
+		return EXIT_FAILURE;
+	}
+	printf("done (%d bytes)\n",tmpl.size);
+	printTupel(&model1,tupleCopy);
+	freeTupel(&model1,tupleCopy);
+
+	printf("-------------------------\n");
+	printf("Sharing a tuple between three queries...");
+	tupel = initTupelFromTemplate(&tmpl,20140530);
+	copyItemStringAcc(tupel,&accDevice,"eth0");
+	setItemIntAcc(tupel,&accSocket,1337);
+	shared[0] = shareTupel(tupel);
+	shared[1] = shareTupel(tupel);
+	// Sharing a shared tuple refers to the owner of the items
+	shared[2] = shareTupel(shared[1]);
+	// Drop the owners reference. The items have to survive.
+	freeTupel(&model1,tupel);
+	if (shared[0] == NULL || shared[1] == NULL || shared[2] == NULL || shared[2]->shared != tupel || tupel->refs != 3 ||
+		shared[0]->items[1] != shared[2]->items[1] || allocItemAcc(shared[0],&accDevice) != -1) {
+		printf("cannot share the tuple\n");
+		return EXIT_FAILURE;
+	}
+	// A projection removes the item from its own tuple only
+	deleteItem(&model1,shared[0],1);
+	// A join works on a private copy
+	tupleMerge = initTupel(4711,1);
+	allocItem(&model1,tupleMerge,0,"ui.eventType");
+	setItemInt(&model1,tupleMerge,"ui.eventType.xPos",314);
+	setItemInt(&model1,tupleMerge,"ui.eventType.yPos",42);
+	if (mergeTuple(&model1,&shared[1],tupleMerge) != 0 || TEST_BIT(shared[1]->flags,TUPLE_SHARED) ||
+		shared[0]->items[1] != NULL || getItemIntAcc(shared[2],&accSocket) != 1337 ||
+		strcmp(getItemStringAcc(shared[2],&accDevice),"eth0") != 0 || getItemInt(&model1,shared[1],"ui.eventType.xPos") != 314) {
+		printf("shared items changed\n");
+		return EXIT_FAILURE;
+	}
+	freeTupel(&model1,shared[0]);
+	freeTupel(&model1,shared[1]);
+	if (tupel->refs != 1 || getItemIntAcc(shared[2],&accSocket) != 1337) {
+		printf("wrong number of references\n");
+		return EXIT_FAILURE;
+	}
+	freeTupel(&model1,shared[2]);
+	printf("done\n");
+	freeTupleTemplate(&tmpl);
+
 	freeDataModel(&model1,0);
 	endClock = clock();
 	printf("-------------------------\n");
@@ -171,7 +332,6 @@ static Tupel_t* generateStatusObject(Selector_t *selectors, int len, Tupel_t* le
 }
 
 static void initDatamodel(void) {
-	int i = 0;
 	INIT_SOURCE_POD(srcSocketType,"type",objSocket,INT,getSrc)
 	INIT_SOURCE_POD(srcSocketFlags,"flags",objSocket,INT,getSrc)
 	INIT_OBJECT(objSocket,"socket",nsNet1,2,INT,regObjectCallback,unregObjectCallback,generateStatusObject)
@@ -0,0 +1,182 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <poll.h>
+#include <stdint.h>
+#include <errno.h>
+#include <sys/eventfd.h>
+#include <common.h>
+#include <communication.h>
+#include <liballoc.h>
+
+#define PRODUCERS			4
+#define MESSAGES			200000
+#define MSG_STRESS			0x100
+
+/**
+ * The payload of each message. check allows to detect torn messages.
+ */
+typedef struct Payload {
+	unsigned int producer;
+	unsigned int seq;
+	unsigned int check;
+} Payload_t;
+
+static unsigned long long written[PRODUCERS];
+static unsigned long long fullRetries[PRODUCERS];
+static unsigned long long received = 0, failures = 0;
+static unsigned int nextSeq[PRODUCERS];
+static volatile int producersDone = 0;
+static unsigned long long blocked = 0, lostWakeups = 0;
+static int doorbellFd = -1;
+extern void (*doorbellHook)(void);
+
+static void ringDoorbell(void) {
+	uint64_t value = 1;
+
+	if (write(doorbellFd,&value,sizeof(value)) < 0) {
+		perror("write");
+	}
+}
+
+/**
+ * Blocks the same way the communication threads do. A message pending after a timeout is a lost wakeup.
+ */
+static void waitForMessages(void) {
+	struct pollfd fd;
+	uint64_t value = 0;
+
+	if (ringBufferWaitBegin(txBuffer)) {
+		blocked++;
+		fd.fd = doorbellFd;
+		fd.events = POLLIN;
+		if (poll(&fd,1,COMM_WAIT_TIMEOUT_MS) == 0 && ringBufferPending(txBuffer)) {
+			printf("Lost a wakeup\n");
+			lostWakeups++;
+		}
+		// Drain the doorbell. It might have been rung more than once.
+		if (read(doorbellFd,&value,sizeof(value)) < 0 && errno != EAGAIN) {
+			perror("read");
+		}
+	}
+	ringBufferWaitEnd(txBuffer);
+}
+
+static void* producer(void *arg) {
+	unsigned int id = (unsigned long)arg, seq = 0;
+	Payload_t *payload = NULL;
+
+	for (seq = 0; seq < MESSAGES; seq++) {
+		do {
+			payload = slcmalloc(sizeof(Payload_t));
+			if (payload == NULL) {
+				// The reader did not consume enough messages yet. Their payloads are still in use.
+				fullRetries[id]++;
+				sched_yield();
+			}
+		} while (payload == NULL);
+		payload->producer = id;
+		payload->seq = seq;
+		payload->check = ~(id ^ seq);
+		while (ringBufferWrite(txBuffer,MSG_STRESS + id,(char*)payload) < 0) {
+			fullRetries[id]++;
+			sched_yield();
+		}
+		written[id]++;
+	}
+	__sync_fetch_and_add(&producersDone,1);
+
+	return NULL;
+}
+
+/**
+ * Each message must arrive exactly once, untorn and in the order its producer wrote it.
+ */
+static void* consumer(void *arg) {
+	LayerMessage_t *msg = NULL;
+	Payload_t *payload = NULL;
+
+	for (;;) {
+		msg = ringBufferReadBegin(txBuffer);
+		if (msg == NULL) {
+			if (LOAD_ACQUIRE(&producersDone) == PRODUCERS && ringBufferReadBegin(txBuffer) == NULL) {
+				break;
+			}
+			waitForMessages();
+			continue;
+		}
+		payload = (Payload_t*)msg->addr;
+		if (payload == NULL || msg->type != MSG_STRESS + payload->producer || payload->producer >= PRODUCERS ||
+			payload->check != ~(payload->producer ^ payload->seq)) {
+			printf("Torn message: type=0x%x, addr=%p\n",msg->type,(void*)payload);
+			failures++;
+		} else if (payload->seq != nextSeq[payload->producer]) {
+			printf("Producer %u: expected message %u, got %u\n",payload->producer,nextSeq[payload->producer],payload->seq);
+			nextSeq[payload->producer] = payload->seq + 1;
+			failures++;
+		} else {
+			nextSeq[payload->producer]++;
+		}
+		received++;
+		ringBufferReadEnd(txBuffer);
+	}
+
+	return NULL;
+}
+
+int main() {
+	pthread_t producers[PRODUCERS], reader;
+	unsigned long long total = 0, retries = 0;
+	void *sharedMemory = NULL;
+	int i = 0;
+
+	if (posix_memalign(&sharedMemory,PAGE_SIZE,NUM_PAGES * PAGE_SIZE) != 0) {
+		printf("Cannot allocate shared memory\n");
+		return EXIT_FAILURE;
+	}
+	memset(sharedMemory,0,NUM_PAGES * PAGE_SIZE);
+	// Usually, the kernel sets up both ringbuffers.
+	ringBufferReset((Ringbuffer_t*)sharedMemory);
+	ringBufferReset((Ringbuffer_t*)(sharedMemory + sizeof(Ringbuffer_t)));
+	sharedMemoryUserBase = sharedMemory;
+	ringBufferInit();
+	doorbellFd = eventfd(0,EFD_NONBLOCK);
+	doorbellHook = ringDoorbell;
+
+	printf("-------------------------\n");
+	printf("Ringbuffer stress test: %d producers, %d messages each\n",PRODUCERS,MESSAGES);
+	pthread_create(&reader,NULL,consumer,NULL);
+	for (i = 0; i < PRODUCERS; i++) {
+		pthread_create(&producers[i],NULL,producer,(void*)(unsigned long)i);
+	}
+	for (i = 0; i < PRODUCERS; i++) {
+		pthread_join(producers[i],NULL);
+		total += written[i];
+		retries += fullRetries[i];
+	}
+	// The reader might wait for a further message
+	ringDoorbell();
+	pthread_join(reader,NULL);
+
+	for (i = 0; i < PRODUCERS; i++) {
+		if (nextSeq[i] != MESSAGES) {
+			printf("Producer %d: lost %u messages\n",i,MESSAGES - nextSeq[i]);
+			failures++;
+		}
+	}
+	if (lostWakeups > 0) {
+		failures++;
+	}
+	if (received != total) {
+		printf("Wrote %llu messages, read %llu\n",total,received);
+		failures++;
+	}
+	printf("Read %llu messages, %llu retries on a full buffer, reader blocked %llu times: %s\n",received,retries,blocked,(failures == 0 ? "ok" : "FAILED"));
+	printf("-------------------------\n");
+
+	close(doorbellFd);
+	free(sharedMemory);
+
+	return (failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,206 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <common.h>
+#include <timerwheel.h>
+
+#define PERIODIC_TIMERS		200
+#define RUN_MS				1000
+#define DRIFT_PERIOD		7
+#define MAX_FIRES			(RUN_MS / DRIFT_PERIOD + 16)
+#define MAX_LATENESS_NS		(50 * 1000000ULL)
+#define STALL_PERIOD		5
+#define STALL_MS			23
+
+static const unsigned int periods[] = { 5, 10, 20, 50, 100, 300 };
+
+typedef struct TestTimer {
+	TimerEntry_t timer;
+	unsigned int period;
+	unsigned long long fired;
+} TestTimer_t;
+
+static TestTimer_t timers[PERIODIC_TIMERS];
+static TimerEntry_t driftTimer, farTimer, stallTimer;
+static unsigned long long driftFires[MAX_FIRES];
+static unsigned int numDriftFires = 0, farFired = 0, stallFired = 0;
+
+static void countFire(TimerEntry_t *timer) {
+	((TestTimer_t*)timer->data)->fired++;
+}
+
+static void recordFire(TimerEntry_t *timer) {
+	if (numDriftFires < MAX_FIRES) {
+		driftFires[numDriftFires] = getTimeNS();
+	}
+	numDriftFires++;
+}
+
+static void countFarFire(TimerEntry_t *timer) {
+	farFired++;
+}
+
+/**
+ * Stalls the timing thread once. A callback must not block. Here, it simulates a timing thread, which got preempted.
+ */
+static void stallOnce(TimerEntry_t *timer) {
+	if (stallFired++ == 2) {
+		usleep(STALL_MS * 1000);
+	}
+}
+
+/**
+ * Each timer has to fire once per period. Timers sharing a period expire at the same ticks. Hence, they are fired by one wakeup.
+ */
+static int checkPeriodic(void) {
+	TimerStats_t stats;
+	unsigned long long expected = 0;
+	int i = 0, failed = 0;
+
+	printf("Firing %d timers for %d ms: ",PERIODIC_TIMERS,RUN_MS);
+	for (i = 0; i < PERIODIC_TIMERS; i++) {
+		timers[i].period = periods[i % (sizeof(periods) / sizeof(periods[0]))];
+		timers[i].fired = 0;
+		if (addTimer(&timers[i].timer,timers[i].period,countFire,&timers[i]) < 0) {
+			printf("Cannot add timer %d\n",i);
+			return 1;
+		}
+	}
+	usleep(RUN_MS * 1000);
+	for (i = 0; i < PERIODIC_TIMERS; i++) {
+		delTimer(&timers[i].timer);
+	}
+	for (i = 0; i < PERIODIC_TIMERS; i++) {
+		expected = RUN_MS / timers[i].period;
+		// The timers miss at most the first and last deadline
+		if (timers[i].fired + timers[i].timer.missed + 2 < expected || timers[i].fired > expected + 2) {
+			printf("Timer %d with period %u ms fired %llu times, expected %llu\n",i,timers[i].period,timers[i].fired,expected);
+			failed++;
+		}
+	}
+	getTimerStats(&stats);
+	if (stats.timers != 0 || stats.coalesced == 0 || stats.wakeups >= stats.fired) {
+		failed++;
+	}
+	printf("%llu fired in %llu wakeups, %llu coalesced, %llu missed: %s\n",stats.fired,stats.wakeups,stats.coalesced,stats.missed,(failed == 0 ? "ok" : "FAILED"));
+
+	return failed;
+}
+
+/**
+ * The n-th expiry must not come before the first one plus n periods. A late expiry must not delay the following ones.
+ */
+static int checkDrift(void) {
+	unsigned long long deadline = 0, lateness = 0, maxLateness = 0;
+	unsigned int i = 0, fires = 0;
+	int failed = 0;
+
+	printf("Firing a timer every %d ms: ",DRIFT_PERIOD);
+	numDriftFires = 0;
+	if (addTimer(&driftTimer,DRIFT_PERIOD,recordFire,NULL) < 0) {
+		printf("Cannot add timer\n");
+		return 1;
+	}
+	usleep(RUN_MS * 1000);
+	delTimer(&driftTimer);
+	fires = (numDriftFires < MAX_FIRES ? numDriftFires : MAX_FIRES);
+	if (fires < RUN_MS / DRIFT_PERIOD - 2) {
+		failed++;
+	}
+	// The first deadline lies on the grid of the period as well
+	deadline = driftFires[0] / 1000000ULL / DRIFT_PERIOD * DRIFT_PERIOD * 1000000ULL;
+	for (i = 0; i < fires; i++) {
+		if (driftFires[i] < deadline) {
+			printf("Expiry %u came %llu us early\n",i,(deadline - driftFires[i]) / 1000);
+			failed++;
+			break;
+		}
+		lateness = driftFires[i] - deadline;
+		if (lateness > maxLateness) {
+			maxLateness = lateness;
+		}
+		deadline += DRIFT_PERIOD * 1000000ULL;
+	}
+	if (maxLateness > MAX_LATENESS_NS + driftTimer.missed * DRIFT_PERIOD * 1000000ULL) {
+		failed++;
+	}
+	printf("%u expiries, max. %llu us late, %llu missed: %s\n",fires,maxLateness / 1000,driftTimer.missed,(failed == 0 ? "ok" : "FAILED"));
+
+	return failed;
+}
+
+/**
+ * A timer, which fell behind, catches up: it fires late once per deadline passed, but at most TIMER_MAX_CATCHUP times.
+ * It skips the remaining deadlines. Afterwards, it keeps firing on the grid of its period.
+ */
+static int checkCatchUp(void) {
+	TimerStats_t stats;
+	int failed = 0;
+
+	printf("Stalling a timer every %d ms for %d ms: ",STALL_PERIOD,STALL_MS);
+	stallFired = 0;
+	if (addTimer(&stallTimer,STALL_PERIOD,stallOnce,NULL) < 0) {
+		printf("Cannot add timer\n");
+		return 1;
+	}
+	usleep(RUN_MS * 1000);
+	delTimer(&stallTimer);
+	getTimerStats(&stats);
+	// More than TIMER_MAX_CATCHUP deadlines passed during the stall. The owed ones are fired late, the remaining ones are skipped.
+	if (stallTimer.late < TIMER_MAX_CATCHUP || stallTimer.missed < STALL_MS / STALL_PERIOD - TIMER_MAX_CATCHUP || stats.late < stallTimer.late) {
+		failed++;
+	}
+	// The stall must not shift the following deadlines
+	if (stallTimer.expires % stallTimer.period != 0 || stallFired + stallTimer.missed + 2 < RUN_MS / STALL_PERIOD) {
+		failed++;
+	}
+	printf("%u expiries, %llu late, %llu missed: %s\n",stallFired,stallTimer.late,stallTimer.missed,(failed == 0 ? "ok" : "FAILED"));
+
+	return failed;
+}
+
+/**
+ * A timer beyond the last level of the wheel must neither fire early nor remain pending once it got deleted.
+ */
+static int checkFarTimer(void) {
+	TimerStats_t stats;
+	int failed = 0;
+
+	printf("Adding a timer expiring in 5 hours: ");
+	if (addTimer(&farTimer,5 * 60 * 60 * 1000,countFarFire,NULL) < 0) {
+		printf("Cannot add timer\n");
+		return 1;
+	}
+	usleep(100 * 1000);
+	getTimerStats(&stats);
+	if (farFired != 0 || stats.timers != 1 || farTimer.pending == 0) {
+		failed++;
+	}
+	delTimer(&farTimer);
+	getTimerStats(&stats);
+	if (stats.timers != 0 || farTimer.pending != 0) {
+		failed++;
+	}
+	printf("%s\n",(failed == 0 ? "ok" : "FAILED"));
+
+	return failed;
+}
+
+int main() {
+	int failed = 0;
+
+	if (startTimerWheel() < 0) {
+		printf("Cannot start the timer wheel\n");
+		return EXIT_FAILURE;
+	}
+	printf("-------------------------\n");
+	failed += checkPeriodic();
+	failed += checkDrift();
+	failed += checkCatchUp();
+	failed += checkFarTimer();
+	printf("-------------------------\n");
+	stopTimerWheel();
+
+	return (failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,744 @@
+#include <stdlib.h>
+#include <string.h>
+#include <query.h>
+#include <datamodel.h>
+#include <resultset.h>
+#include <stdio.h>
+#include <output.h>
+#include <errno.h>
+#include <unistd.h>
+
+#define MAX_TUPLES		1024
+#define MAX_RESULTS		1024
+
+DECLARE_ELEMENTS(nsNet, nsProcess, model)
+DECLARE_ELEMENTS(typePacketType, typeLen, typeProto, typeIfName, objDevice, evtOnRx)
+DECLARE_ELEMENTS(objProcess, srcUTime)
+static void initDatamodel(void);
+
+/**
+ * Describes a window aggregate test: the operator and its window applied to a stream of values.
+ */
+typedef struct AggregateCase {
+	char *desc;
+	unsigned short opType;
+	char *element;
+	int type;
+	unsigned short sizeUnit;
+	unsigned int size;
+	unsigned short advanceUnit;
+	unsigned int advance;
+	int numTuples;
+	unsigned long long timestamps[MAX_TUPLES];
+	double values[MAX_TUPLES];
+} AggregateCase_t;
+
+/**
+ * Describes a group test: tuples carrying a key and a value are grouped by the key within tumbling windows
+ * measured in events. opType is 0, if no aggregate follows the group.
+ */
+typedef struct GroupCase {
+	char *desc;
+	char *keyElement;
+	int keyType;
+	unsigned short opType;
+	unsigned int size;
+	int numTuples;
+	int keys[MAX_TUPLES];
+	double values[MAX_TUPLES];
+} GroupCase_t;
+
+/**
+ * Describes a sort test: the tuples of tumbling windows sorted by one element. At most limit tuples are expected per window.
+ */
+typedef struct SortCase {
+	char *desc;
+	char *element;
+	int type;
+	unsigned short order;
+	unsigned short sizeUnit;
+	unsigned int size;
+	unsigned int limit;
+	int numTuples;
+	unsigned long long timestamps[MAX_TUPLES];
+	double values[MAX_TUPLES];
+} SortCase_t;
+
+static EventStream_t rxStream;
+static SourceStream_t utimeStream;
+static Aggregate_t aggregate;
+static Element_t aggregateElement;
+static Group_t group;
+static Sort_t sort;
+static Element_t sortElement;
+static SortCase_t *curSortCase = NULL;
+static Element_t groupElement;
+static GroupCase_t *curGroupCase = NULL;
+static int resultKeys[MAX_RESULTS];
+static int resultHasValue[MAX_RESULTS];
+static Query_t query;
+static AggregateCase_t *curCase = NULL;
+static AggregateCase_t scratch;
+static int numResults = 0;
+static unsigned long long resultTimestamps[MAX_RESULTS];
+static double resultValues[MAX_RESULTS];
+
+static void collectResult(unsigned int id, Tupel_t *tuple) {
+	if (numResults < MAX_RESULTS) {
+		resultTimestamps[numResults] = tuple->timestamp;
+		switch (curCase->type) {
+			case INT:
+				resultValues[numResults] = getItemInt(&model,tuple,curCase->element);
+				break;
+
+			case BYTE:
+				resultValues[numResults] = getItemByte(&model,tuple,curCase->element);
+				break;
+
+			case FLOAT:
+				resultValues[numResults] = getItemFloat(&model,tuple,curCase->element);
+				break;
+		}
+	}
+	numResults++;
+	freeTupel(&model,tuple);
+}
+
+static Tupel_t* createTuple(AggregateCase_t *test, int i) {
+	Tupel_t *tuple = NULL;
+
+	tuple = initTupel(test->timestamps[i],1);
+	if (test->type == FLOAT) {
+		allocItem(&model,tuple,0,"process.process.utime");
+		setItemFloat(&model,tuple,"process.process.utime",test->values[i]);
+	} else {
+		allocItem(&model,tuple,0,"net.packetType");
+		setItemInt(&model,tuple,"net.packetType.len",(int)test->values[i]);
+		setItemByte(&model,tuple,"net.packetType.proto",(char)test->values[i]);
+		setItemString(&model,tuple,"net.packetType.ifname",strdup("eth0"));
+	}
+	return tuple;
+}
+
+/**
+ * Folds the values of the tuples in [first,last) the same way the operator does.
+ */
+static int foldWindow(AggregateCase_t *test, int first, int last, double *result) {
+	long long sum = 0;
+	double sumD = 0, value = 0;
+	int i = 0, count = 0;
+
+	for (i = first; i < last; i++) {
+		value = test->values[i];
+		if (test->type == BYTE) {
+			value = (char)value;
+		}
+		if (count == 0 || (test->opType == MIN && value < *result) || (test->opType == MAX && value > *result)) {
+			*result = value;
+		}
+		sum += (long long)value;
+		sumD += value;
+		count++;
+	}
+	if (count > 0 && test->opType == AVG) {
+		*result = (test->type == FLOAT ? sumD / count : (double)(sum / count));
+	}
+	return count;
+}
+
+static unsigned long long unitToUS(unsigned short unit, unsigned int value) {
+	return (unit == TIME_SEC ? value * 1000000ULL : value * 1000ULL);
+}
+
+/**
+ * Computes the expected results by brute force and compares them with the ones emitted by the operator.
+ * A time-based window is expected, if it ends at or before {@link until}.
+ */
+static int checkResults(AggregateCase_t *test, unsigned long long until) {
+	unsigned long long size = 0, advance = 0, end = 0;
+	int expected = 0, i = 0, first = 0, stop = 0, failed = 0;
+	double value = 0;
+
+	if (test->sizeUnit == EVENTS) {
+		for (i = 1; i <= test->numTuples; i++) {
+			if (i < test->size || i % test->advance != 0) {
+				continue;
+			}
+			foldWindow(test,i - test->size,i,&value);
+			if (expected >= numResults || resultValues[expected] != value) {
+				printf("Window %d ending at tuple %d: expected %f, got %f\n",expected,i,value,(expected < numResults ? resultValues[expected] : -1.0));
+				failed++;
+			}
+			expected++;
+		}
+	} else {
+		size = unitToUS(test->sizeUnit,test->size);
+		advance = unitToUS(test->advanceUnit,test->advance);
+		for (end = advance; end <= until; end += advance) {
+			if (end < size) {
+				continue;
+			}
+			for (first = 0; first < test->numTuples && test->timestamps[first] < end - size; first++);
+			for (stop = first; stop < test->numTuples && test->timestamps[stop] < end; stop++);
+			if (foldWindow(test,first,stop,&value) == 0) {
+				continue;
+			}
+			if (expected >= numResults || resultValues[expected] != value || resultTimestamps[expected] != end) {
+				printf("Window %d ending at %llu: expected %f, got %f at %llu\n",expected,end,value,
+					(expected < numResults ? resultValues[expected] : -1.0),(expected < numResults ? resultTimestamps[expected] : 0));
+				failed++;
+			}
+			expected++;
+		}
+	}
+	if (expected != numResults) {
+		printf("Expected %d windows, got %d\n",expected,numResults);
+		failed++;
+	}
+	return failed;
+}
+
+static int runAggregateCase(AggregateCase_t *test) {
+	Operator_t *errOperator = NULL;
+	int ret = 0, i = 0;
+
+	curCase = test;
+	numResults = 0;
+	initQuery(&query);
+	query.onQueryCompleted = collectResult;
+	if (test->type == FLOAT) {
+		INIT_SRC_STREAM(utimeStream,"process.process.utime",1,0,GET_BASE(aggregate),100)
+		SET_SELECTOR_INT(utimeStream,0,1)
+		query.root = GET_BASE(utimeStream);
+	} else {
+		INIT_EVT_STREAM(rxStream,"net.device.onRx",1,0,GET_BASE(aggregate))
+		SET_SELECTOR_STRING(rxStream,0,"eth0")
+		query.root = GET_BASE(rxStream);
+	}
+	INIT_AGGREGATE(aggregate,test->opType,NULL,1,test->sizeUnit,test->size,test->advanceUnit,test->advance)
+	ADD_ELEMENT(aggregate,0,aggregateElement,test->element)
+
+	if ((ret = checkQuerySyntax(&model,query.root,&errOperator,0)) < 0) {
+		printf("Query syntax is wrong: %d\n",-ret);
+		freeOperator(query.root,0);
+		return 1;
+	}
+	if ((ret = compileOperators(&model,query.root)) < 0) {
+		printf("Cannot compile query: %d\n",-ret);
+		freeOperator(query.root,0);
+		return 1;
+	}
+	for (i = 0; i < test->numTuples; i++) {
+		executeQuery(&model,&query,createTuple(test,i),0);
+	}
+	ret = checkResults(test,test->timestamps[test->numTuples - 1]);
+	printf("%s: %d windows, %s\n",test->desc,numResults,(ret == 0 ? "ok" : "FAILED"));
+	releaseCompiledOperators(query.root);
+	freeOperator(query.root,0);
+
+	return ret;
+}
+
+/**
+ * Stops feeding tuples to a time-based window. The windows ending behind the last tuple are emitted by flushQueryWindows(),
+ * once they expired, but not before.
+ */
+static int runQuietCase(AggregateCase_t *test) {
+	unsigned long long size = unitToUS(test->sizeUnit,test->size), last = 0;
+	int ret = 0, i = 0, before = 0;
+
+	curCase = test;
+	numResults = 0;
+	initQuery(&query);
+	query.onQueryCompleted = collectResult;
+	INIT_EVT_STREAM(rxStream,"net.device.onRx",1,0,GET_BASE(aggregate))
+	SET_SELECTOR_STRING(rxStream,0,"eth0")
+	query.root = GET_BASE(rxStream);
+	INIT_AGGREGATE(aggregate,test->opType,NULL,1,test->sizeUnit,test->size,test->advanceUnit,test->advance)
+	ADD_ELEMENT(aggregate,0,aggregateElement,test->element)
+	if ((ret = compileOperators(&model,query.root)) < 0) {
+		printf("Cannot compile query: %d\n",-ret);
+		freeOperator(query.root,0);
+		return 1;
+	}
+	for (i = 0; i < test->numTuples; i++) {
+		executeQuery(&model,&query,createTuple(test,i),0);
+	}
+	last = test->timestamps[test->numTuples - 1];
+	// The current window has not ended yet
+	flushQueryWindows(&model,&query);
+	before = numResults;
+	ret = checkResults(test,last);
+	// Wait for every window containing one of the tuples to expire
+	usleep(2 * size);
+	flushQueryWindows(&model,&query);
+	if (numResults == before) {
+		printf("No window got flushed\n");
+		ret++;
+	}
+	ret += checkResults(test,last + size);
+	printf("%s: %d windows, %d of them flushed, %s\n",test->desc,numResults,numResults - before,(ret == 0 ? "ok" : "FAILED"));
+	releaseCompiledOperators(query.root);
+	freeOperator(query.root,0);
+
+	return ret;
+}
+
+static int getKey(GroupCase_t *test, Tupel_t *tuple) {
+	char *name = NULL;
+
+	switch (test->keyType) {
+		case INT:
+			return getItemInt(&model,tuple,test->keyElement);
+
+		case BYTE:
+			return getItemByte(&model,tuple,test->keyElement);
+
+		case STRING:
+			name = getItemString(&model,tuple,test->keyElement);
+			return (name == NULL ? -1 : atoi(name + 2));
+	}
+	return -1;
+}
+
+static void collectGroup(unsigned int id, Tupel_t *tuple) {
+	if (numResults < MAX_RESULTS) {
+		resultTimestamps[numResults] = tuple->timestamp;
+		resultKeys[numResults] = getKey(curGroupCase,tuple);
+		resultHasValue[numResults] = (curGroupCase->opType != 0 && tuple->itemLen > 1 && tuple->items[1] != NULL);
+		if (resultHasValue[numResults]) {
+			resultValues[numResults] = getItemInt(&model,tuple,"net.packetType.len");
+		}
+	}
+	numResults++;
+	freeTupel(&model,tuple);
+}
+
+static Tupel_t* createGroupTuple(GroupCase_t *test, int i) {
+	Tupel_t *tuple = NULL;
+	char *name = NULL;
+
+	tuple = initTupel(i,1);
+	allocItem(&model,tuple,0,"net.packetType");
+	setItemInt(&model,tuple,"net.packetType.len",(int)test->values[i]);
+	setItemByte(&model,tuple,"net.packetType.proto",(char)test->keys[i]);
+	name = malloc(16);
+	snprintf(name,16,"if%d",test->keys[i]);
+	setItemString(&model,tuple,"net.packetType.ifname",name);
+
+	return tuple;
+}
+
+/**
+ * Each result has to match the fold of its key within its window. Each group of a window has to be emitted exactly once.
+ */
+static int checkGroupResults(GroupCase_t *test) {
+	AggregateCase_t fold;
+	int i = 0, j = 0, window = 0, expected = 0, failed = 0;
+	double value = 0;
+
+	fold.opType = test->opType;
+	fold.type = INT;
+	for (window = 0; (window + 1) * test->size <= test->numTuples; window++) {
+		for (i = window * test->size; i < (window + 1) * test->size; i++) {
+			for (j = window * test->size; j < i && test->keys[j] != test->keys[i]; j++);
+			if (j == i) {
+				expected++;
+			}
+		}
+	}
+	for (i = 0; i < numResults && i < MAX_RESULTS; i++) {
+		window = resultTimestamps[i] / test->size;
+		for (j = 0; j < i; j++) {
+			if (resultKeys[j] == resultKeys[i] && resultTimestamps[j] / test->size == window) {
+				printf("Group %d of window %d emitted twice\n",resultKeys[i],window);
+				failed++;
+			}
+		}
+		fold.numTuples = 0;
+		for (j = window * test->size; j < (window + 1) * test->size && j < test->numTuples; j++) {
+			if (test->keys[j] == resultKeys[i]) {
+				fold.values[fold.numTuples++] = test->values[j];
+			}
+		}
+		if (foldWindow(&fold,0,fold.numTuples,&value) == 0) {
+			printf("Group %d does not exist in window %d\n",resultKeys[i],window);
+			failed++;
+		} else if (test->opType != 0 && (!resultHasValue[i] || resultValues[i] != value)) {
+			printf("Group %d of window %d: expected %f, got %f\n",resultKeys[i],window,value,resultValues[i]);
+			failed++;
+		}
+	}
+	if (expected != numResults) {
+		printf("Expected %d groups, got %d\n",expected,numResults);
+		failed++;
+	}
+	return failed;
+}
+
+static int runGroupCase(GroupCase_t *test) {
+	Operator_t *errOperator = NULL;
+	int ret = 0, i = 0;
+
+	curGroupCase = test;
+	numResults = 0;
+	initQuery(&query);
+	query.onQueryCompleted = collectGroup;
+	INIT_EVT_STREAM(rxStream,"net.device.onRx",1,0,GET_BASE(group))
+	SET_SELECTOR_STRING(rxStream,0,"eth0")
+	query.root = GET_BASE(rxStream);
+	INIT_GROUP(group,(test->opType != 0 ? GET_BASE(aggregate) : NULL),1,EVENTS,test->size)
+	ADD_ELEMENT(group,0,groupElement,test->keyElement)
+	if (test->opType != 0) {
+		INIT_AGGREGATE(aggregate,test->opType,NULL,1,EVENTS,test->size,EVENTS,test->size)
+		ADD_ELEMENT(aggregate,0,aggregateElement,"net.packetType.len")
+	}
+
+	if ((ret = checkQuerySyntax(&model,query.root,&errOperator,0)) < 0) {
+		printf("Query syntax is wrong: %d\n",-ret);
+		freeOperator(query.root,0);
+		return 1;
+	}
+	if ((ret = compileOperators(&model,query.root)) < 0) {
+		printf("Cannot compile query: %d\n",-ret);
+		freeOperator(query.root,0);
+		return 1;
+	}
+	for (i = 0; i < test->numTuples; i++) {
+		executeQuery(&model,&query,createGroupTuple(test,i),0);
+	}
+	ret = checkGroupResults(test);
+	printf("%s: %d groups, %s\n",test->desc,numResults,(ret == 0 ? "ok" : "FAILED"));
+	releaseCompiledOperators(query.root);
+	freeOperator(query.root,0);
+
+	return ret;
+}
+
+static double getSortValue(SortCase_t *test, Tupel_t *tuple) {
+	char *name = NULL;
+
+	switch (test->type) {
+		case INT:
+			return getItemInt(&model,tuple,test->element);
+
+		case BYTE:
+			return getItemByte(&model,tuple,test->element);
+
+		case FLOAT:
+			return getItemFloat(&model,tuple,test->element);
+
+		case STRING:
+			name = getItemString(&model,tuple,test->element);
+			return (name == NULL ? -1 : atoi(name + 2) - 100);
+	}
+	return -1;
+}
+
+static void collectSorted(unsigned int id, Tupel_t *tuple) {
+	if (numResults < MAX_RESULTS) {
+		resultTimestamps[numResults] = tuple->timestamp;
+		resultValues[numResults] = getSortValue(curSortCase,tuple);
+	}
+	numResults++;
+	freeTupel(&model,tuple);
+}
+
+static Tupel_t* createSortTuple(SortCase_t *test, int i) {
+	Tupel_t *tuple = NULL;
+	char *name = NULL;
+
+	tuple = initTupel(test->timestamps[i],1);
+	if (test->type == FLOAT) {
+		allocItem(&model,tuple,0,"process.process.utime");
+		setItemFloat(&model,tuple,"process.process.utime",test->values[i]);
+	} else {
+		allocItem(&model,tuple,0,"net.packetType");
+		setItemInt(&model,tuple,"net.packetType.len",(int)test->values[i]);
+		setItemByte(&model,tuple,"net.packetType.proto",(char)test->values[i]);
+		// Padded to make the lexical order match the numerical one
+		name = malloc(16);
+		snprintf(name,16,"if%04d",(int)test->values[i] + 100);
+		setItemString(&model,tuple,"net.packetType.ifname",name);
+	}
+	return tuple;
+}
+
+static int compareValues(const void *left, const void *right) {
+	double l = *(double*)left, r = *(double*)right;
+
+	return (curSortCase->order == SORT_DESCENDING ? (l < r) - (l > r) : (l > r) - (l < r));
+}
+
+/**
+ * Sorts the tuples of each completed window by brute force and compares the first limit ones with the emitted sequence.
+ */
+static int checkSortResults(SortCase_t *test) {
+	double window[MAX_TUPLES];
+	unsigned long long size = 0, windowNumber = 0;
+	int i = 0, first = 0, num = 0, expected = 0, failed = 0;
+
+	size = (test->sizeUnit == EVENTS ? test->size : unitToUS(test->sizeUnit,test->size));
+	while (first < test->numTuples) {
+		num = 0;
+		if (test->sizeUnit == EVENTS) {
+			if (first + test->size > test->numTuples) {
+				break;
+			}
+			for (i = first; i < first + test->size; i++) {
+				window[num++] = test->values[i];
+			}
+		} else {
+			windowNumber = test->timestamps[first] / size;
+			for (i = first; i < test->numTuples && test->timestamps[i] / size == windowNumber; i++) {
+				window[num++] = test->values[i];
+			}
+			// A time-based window is emitted as soon as a tuple of a later one arrives.
+			if (i == test->numTuples) {
+				break;
+			}
+		}
+		first += num;
+		qsort(window,num,sizeof(double),compareValues);
+		if (test->limit > 0 && num > test->limit) {
+			num = test->limit;
+		}
+		for (i = 0; i < num; i++, expected++) {
+			if (expected >= numResults || resultValues[expected] != window[i]) {
+				printf("Tuple %d: expected %f, got %f\n",expected,window[i],(expected < numResults ? resultValues[expected] : -1.0));
+				failed++;
+			}
+		}
+	}
+	if (expected != numResults) {
+		printf("Expected %d tuples, got %d\n",expected,numResults);
+		failed++;
+	}
+	return failed;
+}
+
+static int runSortCase(SortCase_t *test) {
+	Operator_t *errOperator = NULL;
+	int ret = 0, i = 0;
+
+	curSortCase = test;
+	numResults = 0;
+	initQuery(&query);
+	query.onQueryCompleted = collectSorted;
+	if (test->type == FLOAT) {
+		INIT_SRC_STREAM(utimeStream,"process.process.utime",1,0,GET_BASE(sort),100)
+		SET_SELECTOR_INT(utimeStream,0,1)
+		query.root = GET_BASE(utimeStream);
+	} else {
+		INIT_EVT_STREAM(rxStream,"net.device.onRx",1,0,GET_BASE(sort))
+		SET_SELECTOR_STRING(rxStream,0,"eth0")
+		query.root = GET_BASE(rxStream);
+	}
+	INIT_SORT(sort,NULL,1,test->sizeUnit,test->size,test->order,test->limit)
+	ADD_ELEMENT(sort,0,sortElement,test->element)
+
+	if ((ret = checkQuerySyntax(&model,query.root,&errOperator,0)) < 0) {
+		printf("Query syntax is wrong: %d\n",-ret);
+		freeOperator(query.root,0);
+		return 1;
+	}
+	if ((ret = compileOperators(&model,query.root)) < 0) {
+		printf("Cannot compile query: %d\n",-ret);
+		freeOperator(query.root,0);
+		return 1;
+	}
+	for (i = 0; i < test->numTuples; i++) {
+		executeQuery(&model,&query,createSortTuple(test,i),0);
+	}
+	ret = checkSortResults(test);
+	printf("%s: %d tuples, %s\n",test->desc,numResults,(ret == 0 ? "ok" : "FAILED"));
+	releaseCompiledOperators(query.root);
+	freeOperator(query.root,0);
+
+	return ret;
+}
+
+static void fillValues(AggregateCase_t *test, int num, unsigned long long start, unsigned long long step, unsigned int seed) {
+	int i = 0;
+
+	test->numTuples = num;
+	for (i = 0; i < num; i++) {
+		test->timestamps[i] = start + i * step;
+		// Some pseudo random values within [-100,100]. The multiplication has to wrap around. Hence, it is unsigned.
+		seed = seed * 1103515245U + 12345U;
+		test->values[i] = (int)((seed >> 16) & 0x7fff) % 201 - 100;
+		if (test->type == FLOAT) {
+			test->values[i] += 0.25;
+		}
+	}
+}
+
+static AggregateCase_t cases[] = {
+	{"Tumbling MAX over 3 events",			MAX,	"net.packetType.len",		INT,	EVENTS,		3,		EVENTS,		3},
+	{"Sliding AVG over 4 events by 2",		AVG,	"net.packetType.len",		INT,	EVENTS,		4,		EVENTS,		2},
+	{"Sliding MIN over 5 events by 3",		MIN,	"net.packetType.proto",		BYTE,	EVENTS,		5,		EVENTS,		3},
+	{"Hopping MAX over 2 events by 5",		MAX,	"net.packetType.len",		INT,	EVENTS,		2,		EVENTS,		5},
+	{"Tumbling MIN over 10 ms",				MIN,	"process.process.utime",	FLOAT,	TIME_MS,	10,		TIME_MS,	10},
+	{"Sliding AVG over 1 s by 250 ms",		AVG,	"process.process.utime",	FLOAT,	TIME_SEC,	1,		TIME_MS,	250},
+	{"Sliding MAX over 30 ms by 20 ms",		MAX,	"net.packetType.len",		INT,	TIME_MS,	30,		TIME_MS,	20}
+};
+#define NUM_CASES	(sizeof(cases) / sizeof(AggregateCase_t))
+
+static AggregateCase_t quietCase = {"Sliding MAX over 30 ms by 20 ms, quiet afterwards",	MAX,	"net.packetType.len",	INT,	TIME_MS,	30,		TIME_MS,	20};
+
+static GroupCase_t groupCases[] = {
+	{"GROUP by proto, AVG per 10 events",			"net.packetType.proto",		BYTE,	AVG,	10,		100},
+	{"GROUP by ifname, MAX per 7 events",			"net.packetType.ifname",	STRING,	MAX,	7,		100},
+	{"GROUP by len per 16 events",					"net.packetType.len",		INT,	0,		16,		100},
+	{"GROUP by ifname evicting, MIN per 600 events",	"net.packetType.ifname",	STRING,	MIN,	600,	600}
+};
+#define NUM_GROUP_CASES	(sizeof(groupCases) / sizeof(GroupCase_t))
+
+static SortCase_t sortCases[] = {
+	{"Top 5 len per 20 events",					"net.packetType.len",		INT,	SORT_DESCENDING,	EVENTS,		20,		5},
+	{"SORT proto ascending per 10 events",		"net.packetType.proto",		BYTE,	SORT_ASCENDING,		EVENTS,		10,		0},
+	{"First 3 ifnames per 10 ms",				"net.packetType.ifname",	STRING,	SORT_ASCENDING,		TIME_MS,	10,		3},
+	{"Top 10 utime per 50 ms",					"process.process.utime",	FLOAT,	SORT_DESCENDING,	TIME_MS,	50,		10}
+};
+#define NUM_SORT_CASES	(sizeof(sortCases) / sizeof(SortCase_t))
+
+int main() {
+	int i = 0, j = 0, failed = 0;
+
+	initDatamodel();
+
+	printf("-------------------------\n");
+	printf("Windowed aggregates: \n");
+	for (i = 0; i < NUM_CASES; i++) {
+		if (cases[i].sizeUnit == EVENTS) {
+			fillValues(&cases[i],100,1000,1,i + 1);
+		} else {
+			fillValues(&cases[i],200,1000000 + i * 777,3137,i + 1);
+			// A gap, which spans several windows
+			for (j = 150; j < cases[i].numTuples; j++) {
+				cases[i].timestamps[j] += 5000000;
+			}
+		}
+	}
+	for (i = 0; i < NUM_CASES; i++) {
+		failed += runAggregateCase(&cases[i]);
+	}
+	printf("-------------------------\n");
+
+	printf("Quiet streams: \n");
+	// The last tuple lies in the middle of a pane. Hence, its window does not expire right away.
+	fillValues(&quietCase,30,1000000,3000,42);
+	failed += runQuietCase(&quietCase);
+	printf("-------------------------\n");
+
+	printf("Groups: \n");
+	for (i = 0; i < NUM_GROUP_CASES; i++) {
+		for (j = 0; j < groupCases[i].numTuples; j++) {
+			groupCases[i].values[j] = (j * 7919 + i * 31) % 201 - 100;
+			// The last case has more groups per window than a group operator holds.
+			groupCases[i].keys[j] = (i == NUM_GROUP_CASES - 1 ? j : (j * 13 + i) % 5);
+		}
+		// Grouping by len uses the value as key
+		if (groupCases[i].keyType == INT) {
+			for (j = 0; j < groupCases[i].numTuples; j++) {
+				groupCases[i].keys[j] = groupCases[i].values[j];
+			}
+		}
+		failed += runGroupCase(&groupCases[i]);
+	}
+	printf("-------------------------\n");
+
+	printf("Sorting: \n");
+	for (i = 0; i < NUM_SORT_CASES; i++) {
+		scratch.type = sortCases[i].type;
+		if (sortCases[i].sizeUnit == EVENTS) {
+			fillValues(&scratch,100,1000,1,i + 7);
+		} else {
+			fillValues(&scratch,200,1000000 + i * 555,1371,i + 7);
+		}
+		sortCases[i].numTuples = scratch.numTuples;
+		memcpy(sortCases[i].timestamps,scratch.timestamps,sizeof(scratch.timestamps));
+		memcpy(sortCases[i].values,scratch.values,sizeof(scratch.values));
+		failed += runSortCase(&sortCases[i]);
+	}
+	printf("-------------------------\n");
+
+	printf("Rejecting a group followed by an aggregate using another window: ");
+	INIT_EVT_STREAM(rxStream,"net.device.onRx",1,0,GET_BASE(group))
+	SET_SELECTOR_STRING(rxStream,0,"eth0")
+	INIT_GROUP(group,GET_BASE(aggregate),1,EVENTS,10)
+	ADD_ELEMENT(group,0,groupElement,"net.packetType.proto")
+	INIT_AGGREGATE(aggregate,MAX,NULL,1,EVENTS,10,EVENTS,5)
+	ADD_ELEMENT(aggregate,0,aggregateElement,"net.packetType.len")
+	if (checkQuerySyntax(&model,GET_BASE(rxStream),NULL,0) != -ESIZE) {
+		printf("FAILED\n");
+		failed++;
+	} else {
+		printf("ok\n");
+	}
+	freeOperator(GET_BASE(rxStream),0);
+	printf("-------------------------\n");
+
+	printf("Rejecting windows mixing events and time: ");
+	INIT_EVT_STREAM(rxStream,"net.device.onRx",1,0,GET_BASE(aggregate))
+	SET_SELECTOR_STRING(rxStream,0,"eth0")
+	INIT_AGGREGATE(aggregate,MIN,NULL,1,EVENTS,10,TIME_MS,10)
+	ADD_ELEMENT(aggregate,0,aggregateElement,"net.packetType.len")
+	if (checkQuerySyntax(&model,GET_BASE(rxStream),NULL,0) != -EUNIT) {
+		printf("FAILED\n");
+		failed++;
+	} else {
+		printf("ok\n");
+	}
+	freeOperator(GET_BASE(rxStream),0);
+	printf("-------------------------\n");
+
+	freeDataModel(&model,0);
+
+	return (failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+static void activateCallback(Query_t *query) {
+
+}
+
+static void deactivateCallback(Query_t *query) {
+
+}
+
+static Tupel_t* getSrc(Selector_t *selectors, int len, Tupel_t* leftTuple) {
+	return NULL;
+}
+
+static Tupel_t* generateStatusObject(Selector_t *selectors, int len, Tupel_t* leftTuple) {
+	return NULL;
+}
+
+static void initDatamodel(void) {
+	INIT_PLAINTYPE(typeLen,"len",typePacketType,INT)
+	INIT_PLAINTYPE(typeProto,"proto",typePacketType,BYTE)
+	INIT_PLAINTYPE(typeIfName,"ifname",typePacketType,STRING)
+	INIT_COMPLEX_TYPE(typePacketType,"packetType",nsNet,3)
+	ADD_CHILD(typePacketType,0,typeLen)
+	ADD_CHILD(typePacketType,1,typeProto)
+	ADD_CHILD(typePacketType,2,typeIfName)
+
+	INIT_EVENT_COMPLEX(evtOnRx,"onRx",objDevice,"net.packetType",activateCallback,deactivateCallback)
+	INIT_OBJECT(objDevice,"device",nsNet,1,STRING,activateCallback,deactivateCallback,generateStatusObject)
+	ADD_CHILD(objDevice,0,evtOnRx)
+
+	INIT_NS(nsNet,"net",model,2)
+	ADD_CHILD(nsNet,0,objDevice)
+	ADD_CHILD(nsNet,1,typePacketType)
+
+	INIT_SOURCE_POD(srcUTime,"utime",objProcess,FLOAT,getSrc)
+	INIT_OBJECT(objProcess,"process",nsProcess,1,INT,activateCallback,deactivateCallback,generateStatusObject)
+	ADD_CHILD(objProcess,0,srcUTime)
+
+	INIT_NS(nsProcess,"process",model,1)
+	ADD_CHILD(nsProcess,0,objProcess)
+
+	INIT_MODEL(model,2)
+	ADD_CHILD(model,0,nsNet)
+	ADD_CHILD(model,1,nsProcess)
+}